@@ -0,0 +1,50 @@
+#ifndef ACPI_H
+#define ACPI_H
+
+#include <stdint.h>
+
+/*
+ * Minimal ACPI table lookup.
+ *
+ * The RSDP comes from Limine; tables are read through the HHDM.
+ */
+
+/* Common header of every System Description Table */
+struct acpi_sdt_header {
+    char signature[4];
+    uint32_t length;
+    uint8_t revision;
+    uint8_t checksum;
+    char oem_id[6];
+    char oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} __attribute__((packed));
+
+/* Generic Address Structure */
+struct acpi_gas {
+    uint8_t address_space;   /* 0 = system memory, 1 = system I/O */
+    uint8_t bit_width;
+    uint8_t bit_offset;
+    uint8_t access_size;
+    uint64_t address;
+} __attribute__((packed));
+
+/* HPET description table ("HPET") */
+struct acpi_hpet {
+    struct acpi_sdt_header header;
+    uint32_t event_timer_block_id;
+    struct acpi_gas base;
+    uint8_t hpet_number;
+    uint16_t min_tick;
+    uint8_t page_protection;
+} __attribute__((packed));
+
+/* Locate the RSDT/XSDT from the bootloader-provided RSDP */
+void acpi_init(void);
+
+/* Find a table by 4-character signature, or NULL if absent */
+void *acpi_find_table(const char *signature);
+
+#endif
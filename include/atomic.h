@@ -0,0 +1,100 @@
+#ifndef ATOMIC_H
+#define ATOMIC_H
+
+#include <stdint.h>
+
+/*
+ * Atomic counters and memory barriers.
+ *
+ * Thin wrappers over the GCC __atomic builtins with C11 semantics.
+ * Plain reads and writes are relaxed; read-modify-write operations are
+ * sequentially consistent (a locked instruction on x86 anyway).
+ */
+
+typedef struct {
+    volatile int32_t counter;
+} atomic_t;
+
+typedef struct {
+    volatile int64_t counter;
+} atomic64_t;
+
+#define ATOMIC_INIT(v) { (v) }
+
+/* Full, read and write barriers. x86 only reorders stores after loads. */
+#define smp_mb()  __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define smp_rmb() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define smp_wmb() __atomic_thread_fence(__ATOMIC_RELEASE)
+
+/* Hint to the CPU that we are busy-waiting */
+static inline void cpu_relax(void) {
+    asm volatile("pause" : : : "memory");
+}
+
+static inline int32_t atomic_read(const atomic_t *v) {
+    return __atomic_load_n(&v->counter, __ATOMIC_RELAXED);
+}
+
+static inline void atomic_set(atomic_t *v, int32_t i) {
+    __atomic_store_n(&v->counter, i, __ATOMIC_RELAXED);
+}
+
+static inline int32_t atomic_fetch_add(atomic_t *v, int32_t i) {
+    return __atomic_fetch_add(&v->counter, i, __ATOMIC_SEQ_CST);
+}
+
+static inline int32_t atomic_add_return(atomic_t *v, int32_t i) {
+    return __atomic_add_fetch(&v->counter, i, __ATOMIC_SEQ_CST);
+}
+
+static inline void atomic_inc(atomic_t *v) {
+    atomic_fetch_add(v, 1);
+}
+
+static inline void atomic_dec(atomic_t *v) {
+    atomic_fetch_add(v, -1);
+}
+
+/* Returns non-zero if the counter dropped to zero */
+static inline int atomic_dec_and_test(atomic_t *v) {
+    return atomic_add_return(v, -1) == 0;
+}
+
+static inline int32_t atomic_xchg(atomic_t *v, int32_t i) {
+    return __atomic_exchange_n(&v->counter, i, __ATOMIC_SEQ_CST);
+}
+
+/* Store new if the counter equals old. Returns the value seen. */
+static inline int32_t atomic_cmpxchg(atomic_t *v, int32_t old, int32_t new) {
+    __atomic_compare_exchange_n(&v->counter, &old, new, 0,
+                                __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return old;
+}
+
+static inline int64_t atomic64_read(const atomic64_t *v) {
+    return __atomic_load_n(&v->counter, __ATOMIC_RELAXED);
+}
+
+static inline void atomic64_set(atomic64_t *v, int64_t i) {
+    __atomic_store_n(&v->counter, i, __ATOMIC_RELAXED);
+}
+
+static inline int64_t atomic64_fetch_add(atomic64_t *v, int64_t i) {
+    return __atomic_fetch_add(&v->counter, i, __ATOMIC_SEQ_CST);
+}
+
+static inline int64_t atomic64_add_return(atomic64_t *v, int64_t i) {
+    return __atomic_add_fetch(&v->counter, i, __ATOMIC_SEQ_CST);
+}
+
+static inline void atomic64_inc(atomic64_t *v) {
+    atomic64_fetch_add(v, 1);
+}
+
+static inline int64_t atomic64_cmpxchg(atomic64_t *v, int64_t old, int64_t new) {
+    __atomic_compare_exchange_n(&v->counter, &old, new, 0,
+                                __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return old;
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef BOOTSTAT_H
+#define BOOTSTAT_H
+
+#include <stdint.h>
+
+/*
+ * Boot timeline.
+ *
+ * kmain() calls bootstat_start() on entry and bootstat_mark() after each
+ * init stage. A mark stores the TSC, and a stage takes the time since
+ * the mark before it, so the stages add up to the whole boot (a stage
+ * that fails before its mark is charged to the next one). The raw
+ * stamps are converted only once clocksource_init() has calibrated the
+ * TSC. bootstat_done() ends the timeline and prints it to the log; it
+ * is kept for the `bootstat` shell command.
+ *
+ * Boot runs on one CPU with nothing else going on, so there is no
+ * locking; marks are only valid from the boot CPU before the scheduler
+ * runs other tasks.
+ */
+
+#define BOOTSTAT_MAX_STAGES 40
+
+struct bootstat_stage {
+    const char *name;
+    uint64_t ns;                    /* Time since the previous mark */
+};
+
+/* Record the TSC at kernel entry */
+void bootstat_start(void);
+
+/* End the stage called name here; later marks are dropped once full */
+void bootstat_mark(const char *name);
+
+/* End the timeline and print it (needs the clocksource) */
+void bootstat_done(void);
+
+/* Number of stages recorded (0 before bootstat_done()) */
+int bootstat_count(void);
+
+/* Stage i of the timeline; returns 0, or -1 if there is no such stage */
+int bootstat_get(int i, struct bootstat_stage *out);
+
+/* Time from kernel entry to bootstat_done() */
+uint64_t bootstat_total_ns(void);
+
+/* Time from CPU reset to kernel entry: firmware and bootloader */
+uint64_t bootstat_preboot_ns(void);
+
+#endif
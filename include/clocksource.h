@@ -0,0 +1,36 @@
+#ifndef CLOCKSOURCE_H
+#define CLOCKSOURCE_H
+
+#include <stdint.h>
+
+#define NSEC_PER_SEC   1000000000ULL
+#define NSEC_PER_MSEC  1000000ULL
+#define NSEC_PER_USEC  1000ULL
+
+/*
+ * Monotonic nanosecond clock.
+ *
+ * Backed by the TSC when CPUID reports it invariant, otherwise by the
+ * HPET main counter (found via the ACPI "HPET" table). The TSC is
+ * calibrated against the HPET when present, else against PIT channel 2.
+ *
+ * Requires acpi_init() and paging_init().
+ */
+void clocksource_init(void);
+
+/* Nanoseconds since clocksource_init() */
+uint64_t ktime_get_ns(void);
+
+/*
+ * When the clock is the TSC, store its conversion (ns = ((tsc - base) *
+ * mult) >> 32) and return 1; otherwise return 0. Used by the vDSO.
+ */
+int clocksource_tsc_conversion(uint64_t *base, uint64_t *mult);
+
+/* Calibrated TSC frequency in kHz (also valid when the HPET is the clock) */
+uint64_t clocksource_tsc_khz(void);
+
+/* Name of the active clocksource ("tsc" or "hpet") */
+const char *clocksource_name(void);
+
+#endif
@@ -19,6 +19,76 @@ static inline void write_cr3(uint64_t cr3) {
     asm volatile("mov %0, %%cr3" : : "r"(cr3) : "memory");
 }
 
+static inline uint64_t read_cr4(void) {
+    uint64_t v;
+    asm volatile("mov %%cr4, %0" : "=r"(v));
+    return v;
+}
+
+static inline void write_cr4(uint64_t v) {
+    asm volatile("mov %0, %%cr4" : : "r"(v));
+}
+
+static inline void cpuid(uint32_t leaf, uint32_t subleaf,
+                         uint32_t *a, uint32_t *b, uint32_t *c, uint32_t *d) {
+    asm volatile("cpuid"
+                 : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d)
+                 : "a"(leaf), "c"(subleaf));
+}
+
+/* Read the time-stamp counter */
+static inline uint64_t rdtsc(void) {
+    uint32_t low, high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
+/* Read performance counter (bit 30 of counter selects the fixed ones) */
+static inline uint64_t rdpmc(uint32_t counter) {
+    uint32_t low, high;
+    asm volatile("rdpmc" : "=a"(low), "=d"(high) : "c"(counter));
+    return ((uint64_t)high << 32) | low;
+}
+
+/* Returns non-zero if RFLAGS.IF is set */
+static inline int cpu_irqs_enabled(void) {
+    uint64_t flags;
+    asm volatile("pushfq; pop %0" : "=r"(flags));
+    return (flags & 0x200) != 0;
+}
+
+/* FS/GS base access without an MSR round trip (needs CR4.FSGSBASE) */
+static inline uint64_t rdfsbase(void) {
+    uint64_t v;
+    asm volatile("rdfsbase %0" : "=r"(v));
+    return v;
+}
+
+static inline void wrfsbase(uint64_t v) {
+    asm volatile("wrfsbase %0" : : "r"(v) : "memory");
+}
+
+static inline uint64_t rdgsbase(void) {
+    uint64_t v;
+    asm volatile("rdgsbase %0" : "=r"(v));
+    return v;
+}
+
+static inline void wrgsbase(uint64_t v) {
+    asm volatile("wrgsbase %0" : : "r"(v) : "memory");
+}
+
+/* Disable interrupts, returning the previous RFLAGS for local_irq_restore() */
+static inline uint64_t local_irq_save(void) {
+    uint64_t flags;
+    asm volatile("pushfq; pop %0; cli" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+static inline void local_irq_restore(uint64_t flags) {
+    asm volatile("push %0; popfq" : : "r"(flags) : "memory", "cc");
+}
+
 static inline void cpu_halt(void) {
     for (;;) {
         asm volatile("cli; hlt");
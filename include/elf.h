@@ -32,6 +32,15 @@
 #define PF_W            0x2         /* Writable */
 #define PF_R            0x4         /* Readable */
 
+/* Section header type (sh_type) and flags (sh_flags) */
+#define SHT_SYMTAB      2
+#define SHF_EXECINSTR   0x4
+
+/* Symbol type (low nibble of st_info) */
+#define STT_NOTYPE      0
+#define STT_FUNC        2
+#define ELF64_ST_TYPE(info) ((info) & 0xf)
+
 /* e_ident indices */
 #define EI_MAG0         0
 #define EI_MAG1         1
@@ -73,6 +82,30 @@ typedef struct {
     uint64_t    p_align;            /* Alignment */
 } __attribute__((packed)) Elf64_Phdr;
 
+/* ELF64 Section Header */
+typedef struct {
+    uint32_t    sh_name;            /* Name (string table offset) */
+    uint32_t    sh_type;            /* Section type */
+    uint64_t    sh_flags;           /* Section flags */
+    uint64_t    sh_addr;            /* Virtual address */
+    uint64_t    sh_offset;          /* Offset in file */
+    uint64_t    sh_size;            /* Size in bytes */
+    uint32_t    sh_link;            /* Linked section (string table for SYMTAB) */
+    uint32_t    sh_info;            /* Extra information */
+    uint64_t    sh_addralign;       /* Alignment */
+    uint64_t    sh_entsize;         /* Entry size for tables */
+} __attribute__((packed)) Elf64_Shdr;
+
+/* ELF64 Symbol */
+typedef struct {
+    uint32_t    st_name;            /* Name (string table offset) */
+    uint8_t     st_info;            /* Type and binding */
+    uint8_t     st_other;           /* Visibility */
+    uint16_t    st_shndx;           /* Section index (0 = undefined) */
+    uint64_t    st_value;           /* Address */
+    uint64_t    st_size;            /* Size in bytes */
+} __attribute__((packed)) Elf64_Sym;
+
 /* ELF load result */
 typedef struct {
     uint64_t    entry;              /* Entry point */
@@ -116,4 +149,18 @@ int elf_load_at(const void *data, uint64_t size, uint64_t load_addr, elf_info_t
  */
 int elf_load_into(const void *data, uint64_t size, uint64_t *pml4, elf_info_t *info);
 
+/*
+ * Find the code symbol covering addr in an ELF64 executable's symbol
+ * table: the closest function or label at or below addr in the same
+ * executable section.
+ *
+ * data: pointer to ELF file in memory
+ * size: size of ELF file
+ * start: if non-NULL, receives the symbol's address
+ *
+ * Returns the symbol name (pointing into data), or NULL if the file has
+ * no symbol table or nothing covers addr.
+ */
+const char *elf_symbolize(const void *data, uint64_t size, uint64_t addr, uint64_t *start);
+
 #endif
@@ -0,0 +1,62 @@
+#ifndef FPU_H
+#define FPU_H
+
+#include <stdint.h>
+
+struct task;
+
+/*
+ * FPU/SSE/AVX state management.
+ *
+ * fpu_init() enables x87/SSE (and AVX when available) and picks the
+ * best save instruction: XSAVEOPT, then XSAVE, then FXSAVE. Extended
+ * state is switched eagerly in scheduler_yield(): the outgoing task's
+ * registers are saved and the incoming task's restored on every switch.
+ * XSAVEOPT skips components that are unmodified or still in their init
+ * state, so tasks that never touch SIMD registers cost little.
+ *
+ * The kernel itself is built with -mno-sse, so only tasks that own an
+ * FPU area (user tasks) have state to switch.
+ */
+
+/* Enable FPU/SSE/AVX in CR0/CR4/XCR0 and size the save area */
+void fpu_init(void);
+
+/* Apply the configuration chosen by fpu_init() on an application processor */
+void fpu_init_cpu(void);
+
+/* Allocate a task's save area, initialised to the default FPU state */
+int fpu_alloc_state(struct task *task);
+
+/* Free a task's save area */
+void fpu_free_state(struct task *task);
+
+/* Save current FPU registers into task's area (no-op if it has none) */
+void fpu_save(struct task *task);
+
+/* Load task's saved state into the FPU registers (no-op if it has none) */
+void fpu_restore(struct task *task);
+
+/* Bytes needed for a save area with the enabled features */
+uint32_t fpu_state_size(void);
+
+/* Non-zero if AVX (YMM) state is enabled */
+int fpu_has_avx(void);
+
+/* Name of the save mechanism in use ("xsaveopt", "xsave" or "fxsave") */
+const char *fpu_save_mode(void);
+
+/*
+ * Kernel SIMD sections.
+ *
+ * Code between kernel_fpu_begin() and kernel_fpu_end() may clobber
+ * XMM/YMM registers. Begin disables preemption and saves the current
+ * task's live FPU state (if it has any); end restores it. Sections do
+ * not nest, and an interrupt handler may land inside one, so callers
+ * must check kernel_fpu_usable() first and fall back to scalar code.
+ */
+int kernel_fpu_usable(void);
+void kernel_fpu_begin(void);
+void kernel_fpu_end(void);
+
+#endif
@@ -67,10 +67,19 @@ struct tss {
     uint16_t iopb_offset;   /* I/O permission bitmap offset */
 } __attribute__((packed));
 
-/* Initialize GDT with kernel/user segments and TSS */
+/* Initialize GDT with kernel/user segments and TSS (BSP) */
 void gdt_init(void);
 
-/* Set TSS RSP0 for interrupt stack switching */
+/* Build and load the GDT and TSS of CPU cpu (each CPU has its own) */
+void gdt_init_cpu(uint32_t cpu);
+
+/* TSS of CPU cpu */
+struct tss *gdt_get_tss(uint32_t cpu);
+
+/*
+ * Set the current CPU's kernel entry stack: TSS RSP0 for interrupts
+ * from ring 3 and the per-CPU copy syscall_entry loads.
+ */
 void tss_set_rsp0(uint64_t rsp0);
 
 #endif
@@ -0,0 +1,70 @@
+#ifndef HRTIMER_H
+#define HRTIMER_H
+
+#include <stdint.h>
+#include "spinlock.h"
+
+/*
+ * High-resolution timers.
+ *
+ * Each CPU keeps its pending timers in a binary min-heap ordered by
+ * deadline, and its one-shot hardware timer is always armed for the
+ * root. Nothing runs and no interrupt fires until the earliest deadline
+ * is reached. A timer is queued on the CPU that started it.
+ *
+ * Callbacks run from the timer interrupt with interrupts disabled; they
+ * must not block. A callback may re-arm its own timer.
+ */
+
+#define HRTIMER_MAX      256  /* Maximum number of pending timers per CPU */
+#define HRTIMER_RESERVED 32   /* Slots only hrtimer_start() may use */
+
+struct hrtimer;
+typedef void (*hrtimer_fn_t)(struct hrtimer *timer);
+typedef struct hrtimer_base hrtimer_base_t;
+
+typedef struct hrtimer {
+    uint64_t deadline_ns;   /* Absolute ktime_get_ns() expiry */
+    hrtimer_fn_t callback;
+    void *data;             /* Owner context for the callback */
+    int heap_index;         /* Position in the heap, -1 when not pending */
+    hrtimer_base_t *base;   /* CPU base it is queued on, NULL when not pending */
+} hrtimer_t;
+
+/* Prepare a timer for use (not pending) */
+void hrtimer_init(hrtimer_t *timer, void *data);
+
+/*
+ * Arm (or re-arm) a timer to call callback at the absolute time
+ * deadline_ns. A deadline in the past fires on the next timer interrupt.
+ * Returns 0, or -EAGAIN if this CPU already has HRTIMER_MAX timers
+ * pending; the timer is then left disarmed.
+ */
+int hrtimer_start(hrtimer_t *timer, uint64_t deadline_ns, hrtimer_fn_t callback);
+
+/*
+ * hrtimer_start() for timers armed on behalf of user space (sleeps,
+ * ring timeouts). It fails with -EAGAIN once all but HRTIMER_RESERVED
+ * slots are taken, so however many of these are pending the kernel's
+ * own timers (scheduler slice, profiler, log flush) can still be armed.
+ */
+int hrtimer_try_start(hrtimer_t *timer, uint64_t deadline_ns, hrtimer_fn_t callback);
+
+/* Disarm a timer. Returns 1 if it was pending, 0 otherwise. */
+int hrtimer_cancel(hrtimer_t *timer);
+
+/* Returns non-zero if the timer is pending */
+static inline int hrtimer_active(const hrtimer_t *timer) {
+    return timer->heap_index >= 0;
+}
+
+/*
+ * Run every expired timer of the calling CPU and re-arm its hardware for
+ * the next one. Called from the timer interrupt handler.
+ */
+void hrtimer_run_expired(void);
+
+/* Number of timers pending on the calling CPU */
+int hrtimer_pending(void);
+
+#endif
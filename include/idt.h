@@ -26,6 +26,9 @@ struct idtr {
 } __attribute__((packed));
 
 void idt_init(void);
+
+/* Load the (shared) IDT on the calling CPU; used by APs after idt_init() */
+void idt_load(void);
 void idt_set_gate(uint8_t vector, uint64_t handler, uint8_t type_attr);
 
 #endif
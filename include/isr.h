@@ -56,7 +56,17 @@ extern void irq_stub_0x21(void);
 /* IRQ stub for xHCI (vector 0x22) */
 extern void irq_stub_0x22(void);
 
+/* IRQ stub for COM1 (vector 0x24) */
+extern void irq_stub_0x24(void);
+
 /* IRQ stub for xHCI (vector 0x40) */
 extern void irq_stub_0x40(void);
 
+/* IRQ stub for LAPIC timer (vector 0x30) */
+extern void irq_stub_0x30(void);
+
+/* IPI stubs: reschedule (vector 0xF0) and stop (vector 0xF1) */
+extern void irq_stub_0xF0(void);
+extern void irq_stub_0xF1(void);
+
 #endif
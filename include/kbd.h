@@ -32,7 +32,7 @@ int kbd_translate(uint8_t scancode, int pressed);
 /* Get character from input buffer (non-blocking, returns -1 if empty) */
 int kbd_getc_nonblock(void);
 
-/* Get character from input buffer (blocking, uses hlt) */
+/* Get character from input buffer (blocks the task on a wait queue) */
 char kbd_getc_blocking(void);
 
 /* Read a line with echo and editing (returns length excluding null) */
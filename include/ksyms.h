@@ -0,0 +1,26 @@
+#ifndef KSYMS_H
+#define KSYMS_H
+
+#include <stdint.h>
+
+/*
+ * Kernel symbol table.
+ *
+ * The build links the kernel twice and embeds the text symbols of the
+ * first pass (scripts/gen_ksyms.sh), so addresses can be turned back
+ * into function names at run time, even in stripped release images.
+ */
+
+/*
+ * Name of the function containing addr, or NULL if addr is outside the
+ * kernel's text. If start is non-NULL it receives the symbol's address.
+ */
+const char *ksym_lookup(uint64_t addr, uint64_t *start);
+
+/* Address of the named text symbol, or 0 if there is none */
+uint64_t ksym_address(const char *name);
+
+/* Number of symbols in the table */
+uint64_t ksym_count(void);
+
+#endif
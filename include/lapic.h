@@ -3,6 +3,43 @@
 
 #include <stdint.h>
 
+/* Interrupt vector used by the LAPIC timer */
+#define LAPIC_TIMER_VECTOR 0x30
+
 void lapic_init(void);
 
+/* Signal end-of-interrupt for the current LAPIC-delivered interrupt */
+void lapic_eoi(void);
+
+/* APIC ID of the calling CPU */
+uint32_t lapic_id(void);
+
+/*
+ * Enable the calling AP's LAPIC and set its timer up in the mode chosen
+ * by lapic_timer_init() on the BSP (the calibration is shared).
+ */
+void lapic_init_ap(void);
+
+/* Send a fixed inter-processor interrupt to one CPU */
+void lapic_send_ipi(uint32_t apic_id, uint8_t vector);
+
+/* Send a fixed inter-processor interrupt to every CPU but the caller */
+void lapic_send_ipi_others(uint8_t vector);
+
+/*
+ * Calibrate the LAPIC timer against the TSC and set it up for one-shot
+ * operation, using TSC-deadline mode when the CPU supports it.
+ * tsc_khz: calibrated TSC frequency. Returns 0 on success.
+ */
+int lapic_timer_init(uint64_t tsc_khz);
+
+/* Fire LAPIC_TIMER_VECTOR once, delta_ns nanoseconds from now */
+void lapic_timer_oneshot(uint64_t delta_ns);
+
+/* Cancel any pending one-shot */
+void lapic_timer_stop(void);
+
+/* Returns non-zero if the timer runs in TSC-deadline mode */
+int lapic_timer_tsc_deadline(void);
+
 #endif
@@ -0,0 +1,63 @@
+#ifndef LOCKSTAT_H
+#define LOCKSTAT_H
+
+#include <stdint.h>
+
+/*
+ * Lock statistics.
+ *
+ * Debug and regtest builds embed a lock_stats record in every spinlock
+ * and mutex. It is updated by the lock holder only, so it needs no
+ * locking of its own; the first acquisition links it into a global
+ * registry that `lockstat` in the shell dumps. A lock that is freed (or
+ * goes out of scope) after it has been taken must be unregistered first,
+ * with spin_lock_destroy() or lockstat_unregister(). All times are in
+ * TSC cycles. Release builds compile all of this away.
+ */
+
+#if defined(DEBUG) || defined(REGTEST_BUILD)
+#define LOCK_STATS 1
+#endif
+
+#ifdef LOCK_STATS
+
+struct lock_stats {
+    const char *name;
+    struct lock_stats *next;        /* Registry link */
+    uint32_t registered;
+    uint64_t acquisitions;
+    uint64_t contended;             /* Acquisitions that had to wait */
+    uint64_t wait_cycles;           /* Total time spent waiting */
+    uint64_t hold_cycles;           /* Total time held */
+    uint64_t max_hold_cycles;
+    uint64_t acquired_at;           /* TSC of the current acquisition */
+};
+
+#define LOCK_STATS_INITIALIZER(lock_name) { .name = (lock_name) }
+
+void lockstat_init(struct lock_stats *stats, const char *name);
+
+/* Record an acquisition; wait_start is the TSC when waiting began, or 0 */
+void lockstat_acquired(struct lock_stats *stats, uint64_t wait_start);
+
+/* Record a release by the current holder */
+void lockstat_released(struct lock_stats *stats);
+
+/* Drop stats from the registry (no-op if the lock was never taken) */
+void lockstat_unregister(struct lock_stats *stats);
+
+/*
+ * Find the first registered lock with the given name (NULL if none).
+ * The result is only safe to use while that lock stays registered.
+ */
+struct lock_stats *lockstat_find(const char *name);
+
+/* Print every registered lock to serial and console */
+void lockstat_dump(void);
+
+/* Zero the counters of every registered lock */
+void lockstat_reset(void);
+
+#endif /* LOCK_STATS */
+
+#endif
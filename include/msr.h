@@ -9,6 +9,18 @@
 #define MSR_IA32_LSTAR      0xC0000082  /* Long mode SYSCALL target */
 #define MSR_IA32_CSTAR      0xC0000083  /* Compat mode SYSCALL target (unused) */
 #define MSR_IA32_FMASK      0xC0000084  /* SYSCALL flag mask */
+#define MSR_IA32_TSC_DEADLINE 0x6E0     /* LAPIC timer TSC-deadline */
+#define MSR_IA32_GS_BASE    0xC0000101  /* Active GS base */
+#define MSR_IA32_KERNEL_GS_BASE 0xC0000102  /* GS base swapped in by swapgs */
+
+/* Architectural performance monitoring (see pmu.h) */
+#define MSR_IA32_PMC0               0xC1    /* General-purpose counter 0 (+n) */
+#define MSR_IA32_PERFEVTSEL0        0x186   /* Event select for PMC0 (+n) */
+#define MSR_IA32_FIXED_CTR0         0x309   /* Fixed-function counter 0 (+n) */
+#define MSR_IA32_FIXED_CTR_CTRL     0x38D
+#define MSR_IA32_PERF_GLOBAL_STATUS 0x38E
+#define MSR_IA32_PERF_GLOBAL_CTRL   0x38F   /* PMU version 2+ */
+#define MSR_IA32_PERF_GLOBAL_OVF_CTRL 0x390
 
 /* EFER bits */
 #define EFER_SCE            (1 << 0)    /* SYSCALL Enable */
@@ -16,6 +28,15 @@
 #define EFER_LMA            (1 << 10)   /* Long Mode Active */
 #define EFER_NXE            (1 << 11)   /* No-Execute Enable */
 
+/* IA32_PERFEVTSELx bits (event select in 7:0, unit mask in 15:8) */
+#define PERFEVTSEL_USR      (1 << 16)   /* Count in ring 3 */
+#define PERFEVTSEL_OS       (1 << 17)   /* Count in ring 0 */
+#define PERFEVTSEL_EN       (1 << 22)   /* Counter enabled */
+
+/* IA32_FIXED_CTR_CTRL, four bits per counter */
+#define FIXED_CTR_CTRL_OS   0x1
+#define FIXED_CTR_CTRL_USR  0x2
+
 /* Read a Model-Specific Register */
 static inline uint64_t rdmsr(uint32_t msr) {
     uint32_t low, high;
@@ -0,0 +1,48 @@
+#ifndef MUTEX_H
+#define MUTEX_H
+
+#include <stddef.h>
+#include "task.h"
+#include "waitqueue.h"
+#include "lockstat.h"
+
+/*
+ * Sleeping mutexes.
+ *
+ * For long critical sections in task context (filesystem calls, block
+ * I/O). An uncontended lock is a single compare-and-swap; a contended
+ * one sleeps on the mutex's wait queue instead of spinning, and unlock
+ * wakes the longest waiter. Never take a mutex from an interrupt
+ * handler or while holding a spinlock. Mutexes are not recursive.
+ */
+
+typedef struct mutex {
+    task_t *volatile owner;
+    wait_queue_t wait;
+#ifdef LOCK_STATS
+    struct lock_stats stats;
+#endif
+} mutex_t;
+
+#ifdef LOCK_STATS
+#define MUTEX_INITIALIZER(lock_name) \
+    { NULL, WAIT_QUEUE_INITIALIZER, LOCK_STATS_INITIALIZER(lock_name) }
+#else
+#define MUTEX_INITIALIZER(lock_name) { NULL, WAIT_QUEUE_INITIALIZER }
+#endif
+
+void mutex_init(mutex_t *m, const char *name);
+
+/* Acquire, sleeping while another task holds the mutex */
+void mutex_lock(mutex_t *m);
+
+/* Acquire without sleeping. Returns 1 on success. */
+int mutex_trylock(mutex_t *m);
+
+void mutex_unlock(mutex_t *m);
+
+static inline int mutex_is_locked(mutex_t *m) {
+    return m->owner != NULL;
+}
+
+#endif
@@ -13,6 +13,7 @@
 #define PTE_DIRTY       (1ULL << 6)
 #define PTE_HUGE        (1ULL << 7)
 #define PTE_GLOBAL      (1ULL << 8)
+#define PTE_SHARED      (1ULL << 9)     /* Software bit: frame not owned by this address space */
 #define PTE_NX          (1ULL << 63)
 
 /* Physical address mask (bits 12-51 for 4-level paging) */
@@ -71,10 +72,18 @@ void paging_clone_kernel_mappings(uint64_t *dst_pml4);
 /*
  * Free all user-space pages in an address space.
  * Walks PML4 entries 0-255 (user half), frees leaf pages and intermediate tables.
+ * Leaf pages marked PTE_SHARED (e.g. the vDSO) are unmapped but not freed.
  * Does NOT touch kernel half (entries 256-511).
  */
 void paging_free_user_pages(uint64_t *pml4);
 
+/*
+ * Look up the leaf PTE mapping vaddr in pml4.
+ * Returns the entry (flags and frame), or 0 if vaddr is not mapped
+ * by a 4 KiB page.
+ */
+uint64_t paging_get_pte_in(uint64_t *pml4, uint64_t vaddr);
+
 /*
  * Flush TLB for a specific virtual address.
  */
@@ -96,4 +96,10 @@ void pci_write_config_16(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset
 
 uint8_t pci_find_capability(uint8_t bus, uint8_t slot, uint8_t func, uint8_t cap_id);
 
+/*
+ * Find the first function with the given vendor and device ID, without
+ * starting any drivers. Returns 0 and fills in *out, or -1.
+ */
+int pci_find_device(uint16_t vendor_id, uint16_t device_id, pci_device_t *out);
+
 #endif
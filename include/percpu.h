@@ -0,0 +1,66 @@
+#ifndef PERCPU_H
+#define PERCPU_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct task;
+struct tss;
+
+/*
+ * Per-CPU data.
+ *
+ * Each CPU's GS base points at its own percpu_t while in kernel mode
+ * (user mode runs with the user GS base; entry paths swapgs). The first
+ * fields are read directly by isr_stubs.S and syscall_entry.S through
+ * %gs, so their offsets are fixed.
+ */
+typedef struct percpu {
+    volatile int need_resched;      /* offset 0: reschedule at next IRQ/syscall return */
+    int kernel_fpu_active;          /* offset 4: inside kernel_fpu_begin()/end() */
+    struct percpu *self;            /* offset 8: this_cpu() reads %gs:8 */
+    struct task *curr;              /* offset 16: task running on this CPU */
+    uint64_t user_rsp_scratch;      /* offset 24: user RSP during syscall entry */
+    uint64_t kernel_stack;          /* offset 32: kernel stack top of curr (syscall RSP) */
+    uint32_t cpu_id;                /* Index into the per-CPU array (BSP = 0) */
+    uint32_t lapic_id;
+    struct task *idle_task;         /* Runs when this CPU has nothing to do */
+    struct tss *tss;                /* This CPU's TSS (RSP0 for ring 3 entry) */
+    volatile int online;            /* Set once the CPU is scheduling */
+} percpu_t;
+
+/* Offsets used from assembly */
+#define PERCPU_NEED_RESCHED  0
+#define PERCPU_CURRENT_TASK  16
+#define PERCPU_USER_RSP      24
+#define PERCPU_KERNEL_STACK  32
+
+_Static_assert(offsetof(percpu_t, need_resched) == PERCPU_NEED_RESCHED, "percpu layout");
+_Static_assert(offsetof(percpu_t, self) == 8, "percpu layout");
+_Static_assert(offsetof(percpu_t, curr) == PERCPU_CURRENT_TASK, "percpu layout");
+_Static_assert(offsetof(percpu_t, user_rsp_scratch) == PERCPU_USER_RSP, "percpu layout");
+_Static_assert(offsetof(percpu_t, kernel_stack) == PERCPU_KERNEL_STACK, "percpu layout");
+
+/*
+ * The running CPU's area. Volatile so the read is never cached across a
+ * point where the task could have migrated to another CPU.
+ */
+static inline percpu_t *this_cpu(void) {
+    percpu_t *cpu;
+    asm volatile("movq %%gs:8, %0" : "=r"(cpu));
+    return cpu;
+}
+
+/*
+ * Task running on this CPU. A single %gs-relative load, so the result is
+ * consistent even if the caller migrates right after reading it.
+ */
+static inline struct task *percpu_current(void) {
+    struct task *task;
+    asm volatile("movq %%gs:16, %0" : "=r"(task));
+    return task;
+}
+
+#define current_task percpu_current()
+
+#endif
@@ -21,4 +21,11 @@ uint64_t pit_get_ticks(void);
 /* Increment tick count (called from timer interrupt handler) */
 void pit_tick(void);
 
+/*
+ * Busy-wait for the given number of microseconds (max ~54ms) using PIT
+ * channel 2. Does not use interrupts; intended for calibrating other
+ * timers during early boot.
+ */
+void pit_wait_us(uint32_t us);
+
 #endif
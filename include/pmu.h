@@ -0,0 +1,80 @@
+#ifndef PMU_H
+#define PMU_H
+
+#include <stdint.h>
+
+struct task;
+
+/*
+ * Architectural performance monitoring (Intel, CPUID leaf 0xA).
+ *
+ * pmu_init() reads the PMU version and counter layout and gives every
+ * supported event below its own counter: instructions, cycles and
+ * reference cycles go to the fixed-function counters when the PMU has
+ * them, the rest to general-purpose ones (IA32_PERFEVTSELx/IA32_PMCx).
+ * The counters then run free on every CPU, in user and kernel mode.
+ *
+ * Tasks see virtual counters. Once a task enables them, the scheduler
+ * charges it the counts that accumulate while it runs: pmu_switch()
+ * reads the hardware when such a task is switched in or out, and costs
+ * nothing for tasks that never asked. User programs read their counts
+ * with SYS_perf_counter.
+ *
+ * Without a PMU (TCG, AMD, a hypervisor that hides it) everything here
+ * reports -ENODEV and no MSR is touched.
+ */
+
+/* Events, numbered as the CPUID.0xA EBX "not available" bits */
+#define PERF_COUNT_CYCLES           0   /* Unhalted core cycles */
+#define PERF_COUNT_INSTRUCTIONS     1   /* Instructions retired */
+#define PERF_COUNT_REF_CYCLES       2   /* Unhalted reference cycles */
+#define PERF_COUNT_LLC_REFERENCES   3   /* Last-level cache references */
+#define PERF_COUNT_LLC_MISSES       4   /* Last-level cache misses */
+#define PERF_COUNT_BRANCHES         5   /* Branch instructions retired */
+#define PERF_COUNT_BRANCH_MISSES    6   /* Mispredicted branches retired */
+#define PERF_COUNT_MAX              7
+
+/* Per-task virtual counters (embedded in task_t) */
+struct pmu_task_state {
+    uint64_t count[PERF_COUNT_MAX];     /* Charged to the task so far */
+    uint64_t base[PERF_COUNT_MAX];      /* Hardware values when it last ran */
+    int enabled;
+};
+
+/* Detect the PMU and program the boot CPU's counters */
+void pmu_init(void);
+
+/* Program the counters of an application processor like the boot CPU's */
+void pmu_init_cpu(void);
+
+/* PMU version (0 if there is none) */
+int pmu_version(void);
+
+/* Non-zero if event has a counter */
+int pmu_event_supported(int event);
+
+/* Name of an event ("cycles", "instructions", ...), NULL if out of range */
+const char *pmu_event_name(int event);
+
+/*
+ * Raw value of event's counter on the calling CPU. Only differences of
+ * two reads on the same CPU mean anything, modulo counter wrap (use
+ * pmu_delta()). Returns 0 for an unsupported event.
+ */
+uint64_t pmu_read(int event);
+
+/* Difference of two pmu_read() values, allowing for counter wrap */
+uint64_t pmu_delta(int event, uint64_t from, uint64_t to);
+
+/*
+ * The current task's virtual count of event, enabling its counters on
+ * first use (the count starts at zero then). Returns the count, or
+ * -ENODEV without a PMU, -EINVAL for an unknown event, -ENOENT for one
+ * this CPU cannot count.
+ */
+int64_t pmu_task_read(int event);
+
+/* Move counts from old to next on a context switch (sched lock held) */
+void pmu_switch(struct task *old, struct task *next);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef PREEMPT_H
+#define PREEMPT_H
+
+#include "task.h"
+#include "percpu.h"
+#include "cpu.h"
+
+/*
+ * Kernel preemption control.
+ *
+ * The timer never switches tasks directly. It sets this_cpu()->need_resched
+ * and the switch happens on the way out of irq_common_stub or the syscall
+ * return path - unless the running task is inside a preempt_disable()
+ * section, in which case it is deferred to the matching preempt_enable().
+ * A task with preemption disabled also stays on its CPU, so this_cpu()
+ * remains valid. current_task is provided by percpu.h.
+ */
+
+/* Reschedule now if requested (called when preempt_count drops to zero) */
+void preempt_schedule(void);
+
+/* Reschedule from IRQ/syscall return with interrupts disabled */
+void preempt_schedule_irq(void);
+
+static inline void set_need_resched(void) {
+    this_cpu()->need_resched = 1;
+}
+
+static inline void preempt_disable(void) {
+    if (current_task) {
+        current_task->preempt_count++;
+    }
+    asm volatile("" ::: "memory");
+}
+
+static inline void preempt_enable(void) {
+    asm volatile("" ::: "memory");
+    if (current_task && --current_task->preempt_count == 0 &&
+        this_cpu()->need_resched) {
+        preempt_schedule();
+    }
+}
+
+static inline int preemptible(void) {
+    return current_task && current_task->preempt_count == 0 && cpu_irqs_enabled();
+}
+
+#endif
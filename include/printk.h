@@ -0,0 +1,103 @@
+#ifndef PRINTK_H
+#define PRINTK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+/*
+ * Kernel log.
+ *
+ * printk() formats a message into a fixed-size record in a lock-free
+ * ring shared by all CPUs and returns; it never waits for a device.
+ * Sink workers (serial, console) drain the ring in the background, and
+ * the shell's dmesg command reads it back. Before klog_start(), and
+ * after klog_emergency(), the sinks are drained synchronously instead.
+ *
+ * Messages are lines; a trailing newline is optional. Records hold a
+ * TSC timestamp and the level, and text beyond KLOG_TEXT_MAX - 1
+ * characters is cut off.
+ */
+
+/* Log levels (lower is more severe) */
+#define LOG_ERR   0
+#define LOG_WARN  1
+#define LOG_INFO  2
+#define LOG_DEBUG 3
+
+/* Messages above this level are compiled out */
+#ifndef LOG_LEVEL_COMPILED
+#if defined(DEBUG) || defined(REGTEST_BUILD) || defined(TEST_BUILD)
+#define LOG_LEVEL_COMPILED LOG_DEBUG
+#else
+#define LOG_LEVEL_COMPILED LOG_INFO
+#endif
+#endif
+
+/* Highest level also shown on the framebuffer console */
+#define LOG_LEVEL_CONSOLE LOG_WARN
+
+#define KLOG_RECORDS  512               /* Must be a power of two */
+#define KLOG_TEXT_MAX 104
+
+struct klog_record {
+    volatile uint64_t state;            /* Sequence and commit state (printk.c) */
+    uint64_t tsc;
+    uint8_t level;
+    uint8_t reserved;
+    uint16_t len;
+    uint32_t reserved2;
+    char text[KLOG_TEXT_MAX];           /* NUL-terminated, no newline */
+};
+
+_Static_assert(sizeof(struct klog_record) == 128, "klog record size");
+
+void printk(int level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+void vprintk(int level, const char *fmt, va_list ap);
+
+#define pr_log(level, ...)                                          \
+    do {                                                            \
+        if ((level) <= LOG_LEVEL_COMPILED) printk((level), __VA_ARGS__); \
+    } while (0)
+
+#define pr_err(...)   pr_log(LOG_ERR, __VA_ARGS__)
+#define pr_warn(...)  pr_log(LOG_WARN, __VA_ARGS__)
+#define pr_info(...)  pr_log(LOG_INFO, __VA_ARGS__)
+#define pr_debug(...) pr_log(LOG_DEBUG, __VA_ARGS__)
+
+/*
+ * Formatting used by printk. Supports %d %i %u %x %X %p %s %c %% with
+ * an optional 0 flag, width and l/ll/z length modifier. Returns the
+ * length the full output would have had.
+ */
+int kvsnprintf(char *buf, size_t size, const char *fmt, va_list ap);
+int ksnprintf(char *buf, size_t size, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+/* Start the sink workers; printk stops writing to devices itself. Call after scheduler_init(). */
+void klog_start(void);
+
+/* Write everything queued to every sink before returning */
+void klog_flush(void);
+
+/* Records the slowest sink has not written yet */
+uint64_t klog_pending(void);
+
+/* Drain to serial without locks and stay synchronous (panic paths) */
+void klog_emergency(void);
+
+/*
+ * Reader interface (dmesg). *seq is the reader's position; start at
+ * klog_first_seq(). Returns 1 and copies the next record into *out,
+ * or 0 when there is nothing more to read yet. Records overwritten
+ * before they were read are skipped.
+ */
+uint64_t klog_first_seq(void);
+int klog_read(uint64_t *seq, struct klog_record *out);
+
+/* Format a record as "[seconds.micros] text\n" into buf; returns the length */
+int klog_format(const struct klog_record *rec, char *buf, size_t size);
+
+/* Records written since boot */
+uint64_t klog_count(void);
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+
+/*
+ * Sampling CPU profiler.
+ *
+ * While running, every CPU takes a sample PROFILE_HZ times a second
+ * from its timer interrupt: the interrupted RIP, and for user mode the
+ * running program. Samples are counted per (program, address) in a
+ * hash table; profile_top() folds them by function, using the embedded
+ * kernel symbol table (ksyms.h) or the program's ELF symbol table.
+ *
+ * A CPU joins on its first timer interrupt after profile_start(), so
+ * one that sits idle with no timers pending is not sampled at all.
+ * Code running with interrupts disabled is charged to the point where
+ * it enables them again.
+ */
+
+#define PROFILE_HZ          1000
+#define PROFILE_BUCKETS     4096    /* Distinct addresses; power of two */
+#define PROFILE_PROGS       8       /* Program slots, slot 0 is the kernel */
+#define PROFILE_KERNEL      0
+
+#define PROFILE_NAME_MAX    32
+
+/* One function in a report */
+struct profile_entry {
+    uint64_t start;                 /* Symbol address, or the raw address */
+    uint32_t samples;
+    char name[PROFILE_NAME_MAX];    /* "" if no symbol covers it */
+};
+
+struct profile_stats {
+    uint64_t samples;               /* Taken since profile_start() */
+    uint64_t user;                  /* ...of those, in user mode */
+    uint64_t dropped;               /* Lost to a full table */
+};
+
+struct interrupt_frame;
+
+extern volatile int profile_active;
+
+void profile_sample(struct interrupt_frame *frame);
+
+/* Called by the timer interrupt handler after running expired hrtimers */
+#define profile_tick(frame)                                 \
+    do {                                                    \
+        if (__builtin_expect(profile_active, 0))            \
+            profile_sample(frame);                          \
+    } while (0)
+
+/* Clear the samples and start sampling on every CPU */
+void profile_start(void);
+
+/* Stop sampling; the samples are kept for reports */
+void profile_stop(void);
+
+void profile_get_stats(struct profile_stats *stats);
+
+/* File name of the program in slot prog, or NULL if the slot is unused */
+const char *profile_prog_name(int prog);
+
+/*
+ * Fold the samples of program slot prog (PROFILE_KERNEL for the kernel)
+ * by function and write the max hottest to out, hottest first. User
+ * programs are symbolized from their ELF file. Task context only.
+ * Returns the number of entries written.
+ */
+int profile_top(int prog, struct profile_entry *out, int max);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef REGBENCH_H
+#define REGBENCH_H
+
+#include <stdint.h>
+
+/*
+ * Kernel microbenchmarks for the regtest flavor.
+ *
+ * BENCH() runs its body REGBENCH_WARMUP times untimed, then the given
+ * number of times timed one by one with the TSC, and prints
+ *
+ *   [REGTEST] BENCH name iters=N min=A median=B p99=C unit=tsc
+ *
+ * Times are TSC ticks with the cost of an empty body subtracted; the
+ * run starts with a "BENCH-INFO tsc_khz=K overhead=O" line. Interrupts
+ * stay enabled, so timer ticks show up in p99 rather than the median.
+ * Benchmarks cannot nest.
+ *
+ *   BENCH("kmalloc_kfree_64", 1000) {
+ *       kfree(kmalloc(64));
+ *   }
+ *
+ * BENCH_INDEX counts every run of the body, warmup included, from 0.
+ */
+
+#define REGBENCH_WARMUP     16
+#define REGBENCH_MAX_ITERS  2048
+
+struct regbench {
+    const char *name;
+    uint32_t iterations;    /* Timed runs */
+    uint32_t runs;          /* Timed runs plus warmup */
+    uint32_t index;         /* Current run */
+    int started;
+    uint64_t start;
+};
+
+struct regbench_result {
+    uint64_t min;
+    uint64_t median;
+    uint64_t p99;
+};
+
+/* Measure the timing overhead and print the BENCH-INFO line */
+void regbench_init(void);
+
+struct regbench regbench_begin(const char *name, uint32_t iterations);
+
+/* Time the run that just finished; returns 0 once all are done */
+int regbench_next(struct regbench *bench);
+
+#define BENCH(name, iterations)                                             \
+    for (struct regbench _bench = regbench_begin((name), (iterations));    \
+         regbench_next(&_bench); )
+
+#define BENCH_INDEX (_bench.index)
+
+/*
+ * Print the statistics of samples measured some other way (sorts them
+ * in place). BENCH() ends with this.
+ */
+void regbench_report(const char *name, uint64_t *samples, uint32_t n);
+
+/* Statistics of the last benchmark reported */
+const struct regbench_result *regbench_last(void);
+
+#endif
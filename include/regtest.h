@@ -15,8 +15,9 @@
  *   [REGTEST] START suite_name
  *   [REGTEST] PASS test_name
  *   [REGTEST] FAIL test_name: reason
- *   [REGTEST] END suite_name passed=N failed=M
- *   [REGTEST] SUMMARY total=N passed=P failed=F
+ *   [REGTEST] END suite_name passed=N failed=M time_us=T
+ *   [REGTEST] BENCH name iters=N min=A median=B p99=C unit=tsc (regbench.h)
+ *   [REGTEST] SUMMARY total=N passed=P failed=F time_ms=T
  *   [REGTEST] EXIT code
  */
 
@@ -47,6 +48,20 @@
 #define REGTEST_PROCESS 1
 #define REGTEST_VMM     1
 #define REGTEST_PREEMPT 1
+#define REGTEST_CLOCK   1
+#define REGTEST_SIMD    1
+#define REGTEST_SMP     1
+#define REGTEST_LOCKS   1
+#define REGTEST_RING    1
+#define REGTEST_SERIAL  1
+#define REGTEST_KLOG    1
+#define REGTEST_VIRTIO  1
+#define REGTEST_TRACE   1
+#define REGTEST_PROFILE 1
+#define REGTEST_PMU     1
+#define REGTEST_BOOT    1
+#define REGTEST_BENCH   1
+#define REGTEST_UBENCH  1
 #endif
 
 /* Default: run all tests if no specific suite is selected */
@@ -54,7 +69,12 @@
     !defined(REGTEST_USER) && !defined(REGTEST_ELF) && !defined(REGTEST_FS) && \
     !defined(REGTEST_FB) && !defined(REGTEST_CONSOLE) && !defined(REGTEST_KBD) && \
     !defined(REGTEST_SHELL) && !defined(REGTEST_LIBC) && !defined(REGTEST_PROCESS) && \
-    !defined(REGTEST_VMM) && !defined(REGTEST_PREEMPT)
+    !defined(REGTEST_VMM) && !defined(REGTEST_PREEMPT) && !defined(REGTEST_CLOCK) && \
+    !defined(REGTEST_SIMD) && !defined(REGTEST_SMP) && !defined(REGTEST_LOCKS) && \
+    !defined(REGTEST_RING) && !defined(REGTEST_SERIAL) && !defined(REGTEST_KLOG) && \
+    !defined(REGTEST_VIRTIO) && !defined(REGTEST_TRACE) && !defined(REGTEST_PROFILE) && \
+    !defined(REGTEST_PMU) && !defined(REGTEST_BOOT) && !defined(REGTEST_BENCH) && \
+    !defined(REGTEST_UBENCH)
 #define REGTEST_PMM     1
 #define REGTEST_HEAP    1
 #define REGTEST_TASK    1
@@ -69,6 +89,20 @@
 #define REGTEST_PROCESS 1
 #define REGTEST_VMM     1
 #define REGTEST_PREEMPT 1
+#define REGTEST_CLOCK   1
+#define REGTEST_SIMD    1
+#define REGTEST_SMP     1
+#define REGTEST_LOCKS   1
+#define REGTEST_RING    1
+#define REGTEST_SERIAL  1
+#define REGTEST_KLOG    1
+#define REGTEST_VIRTIO  1
+#define REGTEST_TRACE   1
+#define REGTEST_PROFILE 1
+#define REGTEST_PMU     1
+#define REGTEST_BOOT    1
+#define REGTEST_BENCH   1
+#define REGTEST_UBENCH  1
 #endif
 
 /*
@@ -127,5 +161,19 @@ int regtest_libc(void);
 int regtest_process(void);
 int regtest_vmm(void);
 int regtest_preempt(void);
+int regtest_clock(void);
+int regtest_simd(void);
+int regtest_smp(void);
+int regtest_locks(void);
+int regtest_ring(void);
+int regtest_serial(void);
+int regtest_klog(void);
+int regtest_virtio(void);
+int regtest_trace(void);
+int regtest_profile(void);
+int regtest_pmu(void);
+int regtest_boot(void);
+int regtest_bench(void);
+int regtest_ubench(void);
 
 #endif /* REGTEST_H */
@@ -1,21 +1,85 @@
 #ifndef SCHEDULER_H
 #define SCHEDULER_H
 
+#include <stdint.h>
 #include "task.h"
-#include "isr.h"
 
 /* Preemptive scheduling constants (Proto 17) */
 #define SCHED_TICK_SLICE 5  /* Time slice in ticks (50ms at 100Hz) */
+#define SCHED_SLICE_US   50000  /* Same slice, as armed on the slice hrtimer */
+
+/*
+ * Priority run queues, one set per CPU.
+ * Each level is a FIFO; a bitmap of non-empty levels lets the scheduler
+ * find the highest-priority runnable task with a single bit scan. New
+ * tasks go to the least-loaded CPU and an idle CPU steals queued tasks
+ * from the busiest one.
+ */
+#define SCHED_NUM_PRIO      8   /* Number of priority levels (max 32) */
+#define SCHED_PRIO_HIGHEST  0
+#define SCHED_PRIO_LOWEST   (SCHED_NUM_PRIO - 1)
+#define SCHED_PRIO_DEFAULT  4
 
 void scheduler_init(void);
 void scheduler_add(task_t *task);
 void scheduler_yield(void);
 
 /*
- * Preemptive scheduler entry point - called from timer IRQ handler.
- * Saves current task's RSP from interrupt frame, selects next task,
- * and sets preempt_new_rsp for the IRQ stub to perform the switch.
+ * Turn the calling AP's boot context into its idle task, mark the CPU
+ * online and enter the idle loop. Never returns.
+ */
+void scheduler_run_ap(void) __attribute__((noreturn));
+
+/*
+ * The scheduler lock protects task state changes into and out of
+ * PROC_BLOCKED and PROC_ZOMBIE, the parent/child links and every wait
+ * queue. Each CPU's run queue has its own lock inside scheduler.c.
+ * scheduler_lock() disables interrupts and returns the previous flags
+ * for scheduler_unlock().
+ */
+uint64_t scheduler_lock(void);
+void scheduler_unlock(uint64_t flags);
+
+/*
+ * Switch away with the scheduler lock held (e.g. after marking the
+ * current task a zombie). Releases the lock and returns with interrupts
+ * enabled if the task runs again.
+ */
+void scheduler_yield_locked(void);
+
+/*
+ * Release the run queue lock inherited from context_switch(). Must be the
+ * first thing a newly created task does.
  */
-void scheduler_preempt(struct interrupt_frame *frame);
+void scheduler_schedule_tail(void);
+
+/*
+ * Wake a PROC_BLOCKED task: unlink it from whatever list it is blocked
+ * on and put it back on its run queue. Safe to call from IRQ context.
+ * No-op for tasks that are not blocked. The _locked variant expects the
+ * scheduler lock to be held.
+ */
+void scheduler_wake(task_t *task);
+void scheduler_wake_locked(task_t *task);
+
+/*
+ * Block the current task on list (e.g. a wait queue, or NULL for a plain
+ * sleep) and switch away. Call with the scheduler lock held; returns with
+ * it held once scheduler_wake() has made the task runnable again.
+ */
+void scheduler_block_on(task_list_t *list);
+
+/*
+ * Unlink a task from every scheduler list (run queue, blocked or zombie
+ * list, and the global task list). Used when a task is reaped; waits for
+ * an exiting task to finish switching off its stack.
+ */
+void scheduler_remove(task_t *task);
+
+/* Change a task's priority, requeueing it if it is currently runnable */
+void scheduler_set_priority(task_t *task, int priority);
+
+/* Find a scheduled task by PID, or NULL */
+task_t *scheduler_find_by_pid(uint32_t pid);
 
 #endif
@@ -0,0 +1,74 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stdint.h>
+#include "spinlock.h"
+
+/*
+ * Sequence locks.
+ *
+ * For small, read-mostly data. Writers serialise on a spinlock and bump
+ * the sequence count before and after the update, so it is odd while a
+ * write is in progress. Readers never block or write shared memory; they
+ * copy the data out and retry if the sequence changed underneath them:
+ *
+ *     do {
+ *         seq = read_seqbegin(&sl);
+ *         ... copy the protected fields ...
+ *     } while (read_seqretry(&sl, seq));
+ *
+ * Readers must not follow pointers in the protected data, since they may
+ * observe a torn update before retrying.
+ */
+
+typedef struct seqlock {
+    volatile uint32_t sequence;
+    spinlock_t lock;
+} seqlock_t;
+
+#define SEQLOCK_INITIALIZER(lock_name) { 0, SPINLOCK_INITIALIZER(lock_name) }
+
+static inline void seqlock_init(seqlock_t *sl, const char *name) {
+    sl->sequence = 0;
+    spin_lock_init(&sl->lock, name);
+}
+
+static inline uint32_t read_seqbegin(const seqlock_t *sl) {
+    uint32_t seq;
+    while ((seq = __atomic_load_n(&sl->sequence, __ATOMIC_ACQUIRE)) & 1) {
+        cpu_relax();
+    }
+    return seq;
+}
+
+/* Returns non-zero if a writer ran since read_seqbegin() returned start */
+static inline int read_seqretry(const seqlock_t *sl, uint32_t start) {
+    smp_rmb();
+    return __atomic_load_n(&sl->sequence, __ATOMIC_RELAXED) != start;
+}
+
+static inline void write_seqlock(seqlock_t *sl) {
+    spin_lock(&sl->lock);
+    __atomic_store_n(&sl->sequence, sl->sequence + 1, __ATOMIC_RELAXED);
+    smp_wmb();
+}
+
+static inline void write_sequnlock(seqlock_t *sl) {
+    smp_wmb();
+    __atomic_store_n(&sl->sequence, sl->sequence + 1, __ATOMIC_RELAXED);
+    spin_unlock(&sl->lock);
+}
+
+/* Writers that can race with readers in interrupt context */
+static inline uint64_t write_seqlock_irqsave(seqlock_t *sl) {
+    uint64_t flags = local_irq_save();
+    write_seqlock(sl);
+    return flags;
+}
+
+static inline void write_sequnlock_irqrestore(seqlock_t *sl, uint64_t flags) {
+    write_sequnlock(sl);
+    local_irq_restore(flags);
+}
+
+#endif
@@ -3,10 +3,48 @@
 
 #include <stdint.h>
 
+/*
+ * COM1 serial port.
+ *
+ * Output is polled until serial_enable_irq(); after that it is queued
+ * in a TX ring drained by the THRE interrupt, and input is collected
+ * into an RX ring by the receive interrupt.
+ */
+
 void serial_init(void);
 void serial_putc(char c);
 void serial_puts(const char *s);
+void serial_write(const char *buf, uint64_t len);
 void serial_print_dec(uint64_t val);
 void serial_print_hex(uint64_t val);
 
+/* Switch to interrupt-driven TX/RX. Call once the IDT and PIC are set up. */
+void serial_enable_irq(void);
+
+/* IRQ4 handler */
+void serial_handle_irq(void);
+
+/* Block (polling the line) until everything queued has been sent */
+void serial_flush(void);
+
+/*
+ * Flush without taking locks and stay polled from now on. For panic and
+ * fatal fault paths, with interrupts off and the other CPUs stopped.
+ */
+void serial_emergency(void);
+
+/* Bytes queued but not yet handed to the UART */
+uint32_t serial_tx_pending(void);
+
+/* Next received byte, or -1 if none */
+int serial_getc_nonblock(void);
+
+/* Next received byte, sleeping until one arrives */
+char serial_getc_blocking(void);
+
+#ifdef REGTEST_BUILD
+/* Route TX back into RX inside the UART (nothing reaches the host) */
+void serial_set_loopback(int on);
+#endif
+
 #endif
@@ -0,0 +1,56 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdint.h>
+
+/*
+ * Bulk memory operations for the framebuffer, console and page
+ * allocator.
+ *
+ * Each routine picks the best implementation found by simd_init()
+ * (AVX2, SSE2 or scalar 64-bit loops) and wraps the SIMD part in a
+ * kernel_fpu_begin()/end() section. Small sizes, early boot and calls
+ * made while a kernel SIMD section is already active (e.g. from an
+ * interrupt handler) fall back to the scalar loops.
+ */
+
+typedef enum {
+    SIMD_SCALAR = 0,
+    SIMD_SSE2,
+    SIMD_AVX2
+} simd_impl_t;
+
+/* Detect CPU support and select the fastest implementation */
+void simd_init(void);
+
+/* Currently selected implementation */
+simd_impl_t simd_get_impl(void);
+
+/* Force an implementation (benchmarks); returns -1 if unsupported */
+int simd_set_impl(simd_impl_t impl);
+
+/* Non-zero if the CPU supports impl */
+int simd_impl_supported(simd_impl_t impl);
+
+/* "avx2", "sse2" or "scalar" */
+const char *simd_impl_name(simd_impl_t impl);
+
+/*
+ * Copy a rectangle of rows with non-temporal stores (framebuffer
+ * present: the destination is not read back).
+ */
+void simd_copy_rect_nt(void *dst, uint64_t dst_pitch,
+                       const void *src, uint64_t src_pitch,
+                       uint64_t row_bytes, uint32_t rows);
+
+/* Fill a rectangle of rows with a 32-bit pattern (non-temporal stores) */
+void simd_fill32_rect_nt(void *dst, uint64_t pitch, uint32_t value,
+                         uint64_t row_bytes, uint32_t rows);
+
+/* memmove; the forward direction is vectorized */
+void simd_memmove(void *dst, const void *src, uint64_t n);
+
+/* Zero a 4 KB page (non-temporal stores) */
+void simd_zero_page(void *page);
+
+#endif
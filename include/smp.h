@@ -0,0 +1,47 @@
+#ifndef SMP_H
+#define SMP_H
+
+#include <stdint.h>
+#include "percpu.h"
+#include "task.h"
+
+/*
+ * Symmetric multiprocessing.
+ *
+ * The BSP gets its per-CPU area in smp_early_init(); smp_init() then
+ * starts every application processor reported by the Limine SMP request.
+ * Each AP loads its own GDT/TSS, enables its LAPIC timer and drops into
+ * its idle task, from where it picks up (or steals) runnable tasks.
+ */
+
+#define SMP_MAX_CPUS 16
+
+/* IPI vectors */
+#define SMP_RESCHED_VECTOR 0xF0   /* Target should reschedule */
+#define SMP_STOP_VECTOR    0xF1   /* Target should halt (panic) */
+
+/* Set up the BSP's per-CPU area and GS base. Call right after gdt_init(). */
+void smp_early_init(void);
+
+/* Start the application processors. Call after scheduler_init(). */
+void smp_init(void);
+
+/* Non-zero if GS bases are loaded with WRGSBASE (CR4.FSGSBASE set) */
+int smp_has_fsgsbase(void);
+
+/* Save prev's and load next's user FS/GS bases (no-op without FSGSBASE) */
+void smp_switch_user_bases(task_t *prev, task_t *next);
+
+/* Number of CPUs currently online (BSP included) */
+uint32_t smp_cpu_count(void);
+
+/* Per-CPU area of CPU id (0 <= id < SMP_MAX_CPUS), or NULL if not present */
+percpu_t *smp_cpu(uint32_t id);
+
+/* Ask CPU id to reschedule (IPI if it is not the calling CPU) */
+void smp_send_resched(uint32_t id);
+
+/* Halt every other CPU (used by panic) */
+void smp_stop_others(void);
+
+#endif
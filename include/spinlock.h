@@ -0,0 +1,118 @@
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include <stdint.h>
+#include "atomic.h"
+#include "cpu.h"
+#include "lockstat.h"
+
+/*
+ * Spinlocks.
+ *
+ * Ticket locks: an acquirer takes the next ticket and spins until the
+ * owner counter reaches it, so waiters are served strictly in arrival
+ * order and a busy CPU cannot starve the others. The _irqsave variants
+ * also disable interrupts on the local CPU, which is required for any
+ * lock that an interrupt handler may take.
+ *
+ * A spinlock may be released on a different CPU than it was taken on
+ * (the scheduler hands run queue locks across context switches).
+ */
+
+typedef struct spinlock {
+    union {
+        volatile uint32_t val;
+        struct {
+            volatile uint16_t owner;    /* Ticket now being served */
+            volatile uint16_t next;     /* Next ticket to hand out */
+        } tickets;
+    };
+#ifdef LOCK_STATS
+    struct lock_stats stats;
+#endif
+} spinlock_t;
+
+#ifdef LOCK_STATS
+#define SPINLOCK_INITIALIZER(lock_name) { .val = 0, .stats = LOCK_STATS_INITIALIZER(lock_name) }
+#else
+#define SPINLOCK_INITIALIZER(lock_name) { .val = 0 }
+#endif
+
+static inline void spin_lock_init(spinlock_t *lock, const char *name) {
+    lock->val = 0;
+#ifdef LOCK_STATS
+    lockstat_init(&lock->stats, name);
+#else
+    (void)name;
+#endif
+}
+
+/* Unregister the statistics of a lock about to be freed; must not be held */
+static inline void spin_lock_destroy(spinlock_t *lock) {
+#ifdef LOCK_STATS
+    lockstat_unregister(&lock->stats);
+#else
+    (void)lock;
+#endif
+}
+
+static inline void spin_lock(spinlock_t *lock) {
+    uint16_t ticket = __atomic_fetch_add(&lock->tickets.next, 1, __ATOMIC_RELAXED);
+    uint64_t wait_start = 0;
+
+    if (__atomic_load_n(&lock->tickets.owner, __ATOMIC_ACQUIRE) != ticket) {
+#ifdef LOCK_STATS
+        wait_start = rdtsc();
+#endif
+        while (__atomic_load_n(&lock->tickets.owner, __ATOMIC_ACQUIRE) != ticket) {
+            cpu_relax();
+        }
+    }
+#ifdef LOCK_STATS
+    lockstat_acquired(&lock->stats, wait_start);
+#else
+    (void)wait_start;
+#endif
+}
+
+/* Take the lock only if nobody holds or is waiting for it */
+static inline int spin_trylock(spinlock_t *lock) {
+    uint32_t old = __atomic_load_n(&lock->val, __ATOMIC_RELAXED);
+    if ((uint16_t)old != (uint16_t)(old >> 16)) {
+        return 0;
+    }
+    if (!__atomic_compare_exchange_n(&lock->val, &old, old + (1U << 16), 0,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return 0;
+    }
+#ifdef LOCK_STATS
+    lockstat_acquired(&lock->stats, 0);
+#endif
+    return 1;
+}
+
+static inline void spin_unlock(spinlock_t *lock) {
+#ifdef LOCK_STATS
+    lockstat_released(&lock->stats);
+#endif
+    __atomic_store_n(&lock->tickets.owner, (uint16_t)(lock->tickets.owner + 1),
+                     __ATOMIC_RELEASE);
+}
+
+static inline int spin_is_locked(spinlock_t *lock) {
+    uint32_t val = __atomic_load_n(&lock->val, __ATOMIC_RELAXED);
+    return (uint16_t)val != (uint16_t)(val >> 16);
+}
+
+static inline uint64_t spin_lock_irqsave(spinlock_t *lock) {
+    uint64_t flags = local_irq_save();
+    spin_lock(lock);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t *lock, uint64_t flags) {
+    spin_unlock(lock);
+    local_irq_restore(flags);
+}
+
+#endif
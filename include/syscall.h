@@ -10,16 +10,97 @@
 #define SYS_wait    3
 #define SYS_getpid  4
 #define SYS_getppid 5
+#define SYS_clock_gettime 6
+#define SYS_nanosleep 7
+#define SYS_ring_setup 8
+#define SYS_ring_enter 9
+#define SYS_perf_counter 10
+
+/* Size of the dispatch table; numbers at or above it get -ENOSYS */
+#define NR_SYSCALLS 11
+
+/* Error returned for unknown syscall numbers */
+#define ENOSYS 38
+
+/* Negated error codes (submission rings, see uring.h; SYS_perf_counter; SYS_nanosleep) */
+#define ENOENT    2
+#define EBADF     9
+#define ECHILD    10
+#define EAGAIN    11
+#define ENOMEM    12
+#define EFAULT    14
+#define EBUSY     16
+#define EEXIST    17
+#define ENODEV    19
+#define EINVAL    22
+#define ECANCELED 125
+
+/* User pointers must lie in the low canonical half */
+#define USER_ADDR_LIMIT 0x800000000000ULL
+
+/* Clock IDs for SYS_clock_gettime (only CLOCK_MONOTONIC is supported) */
+#define CLOCK_REALTIME  0
+#define CLOCK_MONOTONIC 1
+
+/* Time value for SYS_clock_gettime/SYS_nanosleep (matches user/include/time.h) */
+struct timespec {
+    int64_t tv_sec;
+    int64_t tv_nsec;
+};
+
+/*
+ * Registers saved by syscall_entry.S, lowest address first. rax holds
+ * the syscall number on entry and the return value on exit.
+ */
+struct syscall_frame {
+    uint64_t r10;       /* arg4 (RCX is taken by SYSCALL) */
+    uint64_t r9;        /* arg6 */
+    uint64_t r8;        /* arg5 */
+    uint64_t rdx;       /* arg3 */
+    uint64_t rsi;       /* arg2 */
+    uint64_t rdi;       /* arg1 */
+    uint64_t rax;
+    uint64_t rip;       /* User RIP (RCX on entry) */
+    uint64_t rflags;    /* User RFLAGS (R11 on entry) */
+    uint64_t rsp;       /* User RSP */
+};
+
+/*
+ * Syscall handler. Handlers keep their natural arity; the table stores
+ * each under the pointer type for its argument count, and dispatch
+ * calls through the member that nargs selects.
+ */
+typedef struct {
+    union {
+        int64_t (*fn0)(void);
+        int64_t (*fn1)(uint64_t);
+        int64_t (*fn2)(uint64_t, uint64_t);
+        int64_t (*fn3)(uint64_t, uint64_t, uint64_t);
+        int64_t (*fn4)(uint64_t, uint64_t, uint64_t, uint64_t);
+        int64_t (*fn5)(uint64_t, uint64_t, uint64_t, uint64_t, uint64_t);
+        int64_t (*fn6)(uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t);
+    };
+    uint8_t nargs;
+    const char *name;
+} syscall_desc_t;
 
 /* Initialize SYSCALL/SYSRET mechanism */
 void syscall_init(void);
 
+/* Program the SYSCALL MSRs on the calling CPU (APs call this directly) */
+void syscall_init_cpu(void);
+
 /*
- * Syscall dispatcher - called from syscall_entry.S
- * Arguments follow System V AMD64 ABI:
- *   num in RAX, arg1 in RDI, arg2 in RSI, arg3 in RDX
- * Returns result in RAX
+ * Run syscall num with up to six arguments. Returns the handler's
+ * result, or -ENOSYS if num has no handler.
  */
-uint64_t syscall_dispatch(uint64_t num, uint64_t arg1, uint64_t arg2, uint64_t arg3);
+int64_t syscall_dispatch(uint64_t num, uint64_t arg1, uint64_t arg2, uint64_t arg3,
+                         uint64_t arg4, uint64_t arg5, uint64_t arg6);
+
+/* Entry from syscall_entry.S: dispatches frame->rax and stores the result there */
+void syscall_handler(struct syscall_frame *frame);
+
+/* Table entry for num, or NULL if there is none */
+const syscall_desc_t *syscall_lookup(uint64_t num);
 
 #endif
@@ -2,6 +2,8 @@
 #define TASK_H
 
 #include <stdint.h>
+#include "hrtimer.h"
+#include "pmu.h"
 
 /* Process states */
 typedef enum {
@@ -17,17 +19,31 @@ typedef enum {
 #define TASK_FINISHED  PROC_ZOMBIE
 
 #define TASK_STACK_SIZE  4096  /* 4 KiB per task (1 PMM frame) */
+#define TASK_COMM_LEN    16    /* Program name, including the NUL */
+
+struct task;
+
+/* Doubly linked FIFO of tasks, used for run queues and wait lists */
+typedef struct task_list {
+    struct task *head;
+    struct task *tail;
+} task_list_t;
+
+/* Tasks blocked until an event; see waitqueue.h */
+typedef struct wait_queue {
+    task_list_t waiters;
+} wait_queue_t;
 
 typedef struct task {
     uint64_t rsp;           /* Saved stack pointer - MUST be at offset 0 */
-    struct task *next;      /* Next in scheduler queue (circular) */
+    struct task *next;      /* Next in current scheduler list */
     proc_state_t state;     /* Process state */
     void *stack_base;       /* Stack allocation base (kernel stack) */
     uint64_t id;            /* Task ID for debugging */
     void (*entry)(void);    /* Entry point function */
-    /* User mode fields - offsets must match syscall_entry.S */
+    /* User mode fields */
     uint64_t user_rsp;      /* offset 48: User stack pointer */
-    uint64_t kernel_rsp;    /* offset 56: Kernel stack top for syscalls/interrupts */
+    uint64_t kernel_rsp;    /* offset 56: Kernel stack top (TSS RSP0 and percpu kernel_stack) */
     uint64_t user_rip;      /* offset 64: User entry point */
     int is_user;            /* offset 72: 1 if user mode task */
     void *user_stack_base;  /* offset 80: User stack allocation base */
@@ -45,7 +61,44 @@ typedef struct task {
     uint64_t *pml4;         /* Virtual address of PML4 (via HHDM) */
 
     /* Preemptive scheduling fields (Proto 17) */
-    uint32_t ticks_remaining;  /* Time slice countdown (0 = preempt) */
+    uint32_t ticks_remaining;  /* Slice granted at last switch (0 = expired) */
+
+    /* Run queue fields */
+    struct task *prev;         /* Previous in current scheduler list */
+    struct task_list *queue;   /* List this task is linked on (NULL if none) */
+    int priority;              /* Run queue level (0 = highest) */
+    struct task *all_next;     /* Global task list (for PID lookup) */
+    struct task *all_prev;
+
+    /* Kernel preemption (see preempt.h) */
+    int preempt_count;         /* >0: not preemptible */
+
+    /* Timed sleep: wakes the task from the timer interrupt */
+    hrtimer_t sleep_timer;
+
+    /* Woken when one of this task's children exits (task_wait) */
+    wait_queue_t child_exit_wait;
+
+    /* Saved FPU/SSE/AVX state (see fpu.h); NULL for kernel tasks */
+    void *fpu_state;           /* 64-byte aligned save area */
+    void *fpu_alloc;           /* Raw allocation backing fpu_state */
+
+    /* CPU whose run queue the task belongs to (see scheduler.c) */
+    uint32_t cpu;
+    volatile int on_cpu;       /* Set until its last switch away has completed */
+
+    /* User FS/GS bases, switched only when FSGSBASE lets ring 3 set them */
+    uint64_t user_fs_base;
+    uint64_t user_gs_base;
+
+    /* Submission/completion ring, NULL until SYS_ring_setup (see uring.h) */
+    struct uring *uring;
+
+    /* Program file name for ELF tasks (profiler reports), "" otherwise */
+    char comm[TASK_COMM_LEN];
+
+    /* Virtual performance counters, charged while the task runs (see pmu.h) */
+    struct pmu_task_state perf;
 } task_t;
 
 task_t *task_create(void (*entry)(void));
@@ -89,9 +142,36 @@ task_t *task_current(void);
 uint32_t task_getpid(void);
 uint32_t task_getppid(void);
 int task_wait(int *status);           /* Wait for any child to exit */
+
+/*
+ * task_wait() on behalf of parent, which need not be the caller, without
+ * blocking (used by ring WAIT operations, see uring.h). Returns the pid
+ * of the child reaped, 0 if children are still running, or -1 if there
+ * are none or *cancel is non-zero (checked first, under the scheduler
+ * lock, so parent is not touched once it is set).
+ */
+int task_try_wait_for(task_t *parent, int *status, const volatile int *cancel);
+
+/*
+ * Tell task's parent that task has exited: wake it in task_wait() and
+ * retry its pending ring WAITs. Called with the scheduler lock held.
+ */
+void task_notify_exit_locked(task_t *task);
 void task_set_parent(task_t *child, task_t *parent);
 task_t *task_find_by_pid(uint32_t pid);
 void task_reap(task_t *zombie);       /* Free zombie task resources */
 void task_exit(int code);             /* Exit current task with code */
 
+/*
+ * Block the current task until ktime_get_ns() reaches deadline_ns.
+ * The task sits in PROC_BLOCKED with its sleep_timer queued on the
+ * deadline-ordered hrtimer heap and uses no CPU until it fires.
+ * Returns 0, or -EAGAIN without sleeping if the hrtimer heap has no
+ * room (see hrtimer_try_start()).
+ */
+int task_sleep_until(uint64_t deadline_ns);
+
+/* Block the current task for ns nanoseconds; as task_sleep_until() */
+int task_sleep_ns(uint64_t ns);
+
 #endif
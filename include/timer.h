@@ -4,19 +4,38 @@
 #include <stdint.h>
 #include "isr.h"
 
-/* Timer frequency in Hz (configured via pit_init) */
+/* Tick rate reported by timer_get_ticks() (also the PIT fallback rate) */
 #define TIMER_HZ 100
 
-/* Initialize the timer subsystem */
+/*
+ * Initialize the timer subsystem: switch to the one-shot LAPIC timer.
+ * Requires lapic_init(), pit_init() and clocksource_init().
+ */
 void timer_init(void);
 
-/* Get current tick count */
+/*
+ * Non-zero if the per-CPU LAPIC one-shot timer is in use (required for
+ * application processors; the PIT fallback only interrupts the BSP).
+ */
+int timer_is_oneshot(void);
+
+/* Get current tick count (derived from ktime_get_ns()) */
 uint64_t timer_get_ticks(void);
 
+/*
+ * Program the one-shot hardware timer to interrupt at deadline_ns
+ * (ktime), or stop it if deadline_ns is 0. Used by the hrtimer layer;
+ * call with interrupts disabled.
+ */
+void timer_arm(uint64_t deadline_ns);
+
 /* Sleep for specified number of ticks */
 void timer_sleep_ticks(uint64_t ticks);
 
 /* Sleep for specified number of milliseconds */
 void timer_sleep_ms(uint64_t ms);
 
+/* Sleep for specified number of nanoseconds */
+void timer_sleep_ns(uint64_t ns);
+
 #endif
@@ -0,0 +1,77 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+/*
+ * Static tracepoints.
+ *
+ * trace_event() appends a fixed-size binary record (event id, TSC,
+ * CPU, pid and two arguments) to the running CPU's ring, overwriting
+ * the oldest record when full. Nothing is formatted until a dump:
+ * trace_dump() writes every ring out as hex lines that
+ * scripts/trace2json.py turns into Chrome trace JSON.
+ *
+ * Tracing starts with trace_init() and can be switched off at run time;
+ * a disabled tracepoint costs one load and branch.
+ */
+
+/* Event ids (B/E pairs bracket a span, I is an instant) */
+#define TRACE_SCHED_SWITCH      0   /* I: prev pid, next pid */
+#define TRACE_SYSCALL_ENTER     1   /* B: number, arg1 */
+#define TRACE_SYSCALL_EXIT      2   /* E: number, result */
+#define TRACE_IRQ_ENTER         3   /* B: vector */
+#define TRACE_IRQ_EXIT          4   /* E: vector */
+#define TRACE_BLOCK_READ_BEGIN  5   /* B: lba, sectors */
+#define TRACE_BLOCK_READ_END    6   /* E: lba, result */
+#define TRACE_FAT_READ_BEGIN    7   /* B: fd, bytes */
+#define TRACE_FAT_READ_END      8   /* E: fd, result */
+#define TRACE_MARK              9   /* I: caller-defined */
+#define TRACE_NR_EVENTS         10
+
+#define TRACE_EVENTS_PER_CPU    1024    /* Must be a power of two */
+
+struct trace_event {
+    uint64_t tsc;
+    uint16_t id;
+    uint16_t cpu;
+    uint32_t pid;                       /* Running task, 0 if none */
+    uint64_t arg0;
+    uint64_t arg1;
+};
+
+_Static_assert(sizeof(struct trace_event) == 32, "trace record size");
+
+extern volatile int trace_enabled;
+
+void trace_record(uint16_t id, uint64_t arg0, uint64_t arg1);
+
+#define trace_event(id, arg0, arg1)                                 \
+    do {                                                            \
+        if (__builtin_expect(trace_enabled, 0))                     \
+            trace_record((id), (uint64_t)(arg0), (uint64_t)(arg1)); \
+    } while (0)
+
+/* Start tracing. Call once the per-CPU areas are set up. */
+void trace_init(void);
+
+/* Switch recording on or off (rings are kept) */
+void trace_set_enabled(int on);
+
+/* Empty every ring */
+void trace_clear(void);
+
+/*
+ * Records held for cpu, and the n-th oldest of them. trace_get()
+ * returns 0, or -1 if n is out of range.
+ */
+uint32_t trace_count(uint32_t cpu);
+int trace_get(uint32_t cpu, uint32_t n, struct trace_event *out);
+
+/*
+ * Write every ring to the host (virtio-console if present, else
+ * serial), pausing recording meanwhile. Returns the records written.
+ */
+uint64_t trace_dump(void);
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Submission/completion rings.
+ *
+ * SYS_ring_setup maps one page at URING_VADDR into the calling process,
+ * holding a submission queue (SQ) that user code fills and a completion
+ * queue (CQ) that the kernel fills. SYS_ring_enter(to_submit,
+ * min_complete) takes a batch of queued operations in a single kernel
+ * entry and optionally blocks until enough completions are posted.
+ *
+ * Operations run asynchronously: nanosleep on an hrtimer, everything
+ * else on a small pool of kernel worker tasks, which post the CQEs.
+ * A read or wait that cannot finish yet does not hold a worker; it is
+ * parked until a key arrives or a child exits.
+ * Unlinked operations may complete in any order; an SQE with
+ * URING_SQE_LINK holds the next SQE back until it has completed (and
+ * cancels it with -ECANCELED if it failed).
+ *
+ * The layout is duplicated in user/include/uring.h.
+ */
+
+#define URING_VADDR 0x70003000ULL   /* Above the vDSO (see vdso.h) */
+
+#define URING_SQ_ENTRIES 32
+#define URING_CQ_ENTRIES 64
+
+/* Largest buffer a single read or write may cover */
+#define URING_MAX_IO 4096
+
+/* Most nanosleeps a ring may have pending; more complete with -EAGAIN */
+#define URING_MAX_TIMERS 16
+
+/* Opcodes */
+#define URING_OP_NOP       0    /* Complete with res = 0 */
+#define URING_OP_WRITE     1    /* fd = 1; addr, len = buffer (copied at submit) */
+#define URING_OP_READ      2    /* fd = 0 (keyboard); addr, len = buffer; res = bytes */
+#define URING_OP_NANOSLEEP 3    /* addr = struct timespec * */
+#define URING_OP_WAIT      4    /* addr = int *status or 0; res = child pid */
+
+/* SQE flags */
+#define URING_SQE_LINK 0x01     /* Start the next SQE only after this one completes */
+
+struct uring_sqe {
+    uint8_t opcode;
+    uint8_t flags;
+    uint16_t reserved;
+    int32_t fd;
+    uint64_t addr;
+    uint32_t len;
+    uint32_t reserved2;
+    uint64_t user_data;         /* Copied to the CQE untouched */
+};
+
+struct uring_cqe {
+    uint64_t user_data;
+    int64_t res;                /* Result, or a negated error code */
+};
+
+/*
+ * The shared page. User code advances sq_tail and cq_head; the kernel
+ * advances sq_head and cq_tail. Indices run freely and are masked with
+ * the queue size.
+ */
+struct uring_shared {
+    volatile uint32_t sq_head;
+    volatile uint32_t sq_tail;
+    volatile uint32_t cq_head;
+    volatile uint32_t cq_tail;
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    volatile uint32_t cq_overflow;  /* CQEs dropped because the CQ was full */
+    uint32_t reserved[9];
+    struct uring_sqe sqes[URING_SQ_ENTRIES];
+    struct uring_cqe cqes[URING_CQ_ENTRIES];
+};
+
+_Static_assert(sizeof(struct uring_sqe) == 32, "SQE layout");
+_Static_assert(sizeof(struct uring_cqe) == 16, "CQE layout");
+_Static_assert(offsetof(struct uring_shared, sqes) == 64, "ring layout");
+_Static_assert(sizeof(struct uring_shared) <= 4096, "ring must fit in a page");
+
+struct task;
+
+/*
+ * Map a ring into the current process. Returns URING_VADDR, or a
+ * negated error code (-EEXIST if it already has one).
+ */
+int64_t uring_setup(void);
+
+/*
+ * Submit up to to_submit queued SQEs, then block until at least
+ * min_complete CQEs are waiting (or nothing is left in flight).
+ * Returns the number of SQEs consumed, or a negated error code.
+ */
+int64_t uring_enter(uint32_t to_submit, uint32_t min_complete);
+
+/*
+ * Detach task's ring when it exits. Parked reads and waits complete
+ * with -ECANCELED; other operations still in flight finish without
+ * touching the task's memory. The ring page is freed with the last of
+ * them.
+ */
+void uring_exit(struct task *task);
+
+/* A key was queued: hand the oldest parked read to a worker. Safe from IRQs. */
+void uring_kbd_input(void);
+
+/* A child of parent exited: retry parent's parked waits. Scheduler lock held. */
+void uring_child_exit(struct task *parent);
+
+#endif
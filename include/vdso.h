@@ -0,0 +1,54 @@
+#ifndef VDSO_H
+#define VDSO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * vDSO and vvar pages.
+ *
+ * Every ELF process gets two extra user pages at fixed addresses:
+ *   VVAR_VADDR  read-only data: its pid and the TSC-to-ns conversion
+ *   VDSO_VADDR  read-only code shared by all processes (src/vdso_image.S)
+ * so getpid() and clock reads need no kernel entry. The vDSO starts
+ * with a table of entry points at fixed offsets; user/libc calls
+ * through them (the constants are duplicated in user/libc/syscalls.c).
+ */
+
+#define VVAR_VADDR 0x70001000ULL    /* One guard page above the ELF stack */
+#define VDSO_VADDR 0x70002000ULL
+
+/* Entry point offsets within the vDSO page */
+#define VDSO_CLOCK_GETTIME 0x00     /* int clock_gettime(int clk, struct timespec *ts) */
+#define VDSO_GETPID        0x10     /* uint32_t getpid(void) */
+#define VDSO_MONOTONIC_NS  0x20     /* uint64_t monotonic_ns(void) */
+
+/* vvar clock modes */
+#define VDSO_CLOCK_NONE 0           /* Not readable from user mode: use the syscall */
+#define VDSO_CLOCK_TSC  1           /* ns = ((rdtsc - tsc_base) * tsc_mult) >> 32 */
+
+/* Layout of the vvar page (offsets are hardcoded in vdso_image.S) */
+struct vdso_data {
+    volatile uint32_t seq;          /* offset 0: odd while being updated */
+    uint32_t clock_mode;            /* offset 4 */
+    uint64_t tsc_base;              /* offset 8 */
+    uint64_t tsc_mult;              /* offset 16 */
+    uint64_t tsc_khz;               /* offset 24 */
+    uint32_t pid;                   /* offset 32 */
+};
+
+_Static_assert(offsetof(struct vdso_data, clock_mode) == 4, "vvar layout");
+_Static_assert(offsetof(struct vdso_data, tsc_base) == 8, "vvar layout");
+_Static_assert(offsetof(struct vdso_data, tsc_mult) == 16, "vvar layout");
+_Static_assert(offsetof(struct vdso_data, pid) == 32, "vvar layout");
+
+/* Copy the vDSO image into its shared page. Call after pmm_init(). */
+void vdso_init(void);
+
+/*
+ * Map the vDSO and a fresh vvar page for process pid into pml4.
+ * Returns 0 on success, -1 on failure.
+ */
+int vdso_map(uint64_t *pml4, uint32_t pid);
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef VIRTIO_H
+#define VIRTIO_H
+
+#include <stdint.h>
+
+/*
+ * Virtio over legacy PCI (the I/O-port interface of QEMU's transitional
+ * devices) and split virtqueues.
+ *
+ * A virtqueue is a descriptor table, an avail ring the driver fills and
+ * a used ring the device returns buffers on, in physically contiguous
+ * pages whose frame number is handed to the device.
+ */
+
+#define VIRTIO_PCI_VENDOR           0x1AF4
+#define VIRTIO_PCI_DEVICE_CONSOLE   0x1003  /* Transitional virtio-serial */
+
+/* Legacy register offsets (relative to the I/O BAR) */
+#define VIRTIO_REG_DEVICE_FEATURES  0x00    /* 32-bit */
+#define VIRTIO_REG_GUEST_FEATURES   0x04    /* 32-bit */
+#define VIRTIO_REG_QUEUE_PFN        0x08    /* 32-bit */
+#define VIRTIO_REG_QUEUE_SIZE       0x0C    /* 16-bit */
+#define VIRTIO_REG_QUEUE_SELECT     0x0E    /* 16-bit */
+#define VIRTIO_REG_QUEUE_NOTIFY     0x10    /* 16-bit */
+#define VIRTIO_REG_STATUS           0x12    /* 8-bit */
+#define VIRTIO_REG_ISR              0x13    /* 8-bit */
+#define VIRTIO_REG_CONFIG           0x14    /* Device-specific (no MSI-X) */
+
+/* Device status bits */
+#define VIRTIO_STATUS_ACKNOWLEDGE   0x01
+#define VIRTIO_STATUS_DRIVER        0x02
+#define VIRTIO_STATUS_DRIVER_OK     0x04
+#define VIRTIO_STATUS_FAILED        0x80
+
+/* Descriptor flags */
+#define VRING_DESC_F_NEXT           0x01
+#define VRING_DESC_F_WRITE          0x02    /* Device writes (receive buffer) */
+
+#define VRING_AVAIL_F_NO_INTERRUPT  0x01
+#define VRING_USED_F_NO_NOTIFY      0x01
+
+#define VIRTQ_MAX_SIZE              256     /* Largest queue we set up */
+
+struct vring_desc {
+    uint64_t addr;                  /* Physical address */
+    uint32_t len;
+    uint16_t flags;
+    uint16_t next;
+};
+
+struct vring_avail {
+    uint16_t flags;
+    uint16_t idx;
+    uint16_t ring[];
+};
+
+struct vring_used_elem {
+    uint32_t id;                    /* Head descriptor of the returned chain */
+    uint32_t len;                   /* Bytes the device wrote */
+};
+
+struct vring_used {
+    uint16_t flags;
+    uint16_t idx;
+    struct vring_used_elem ring[];
+};
+
+typedef struct virtqueue {
+    uint16_t io_base;               /* Device this queue belongs to */
+    uint16_t index;
+    uint16_t size;                  /* Entries, a power of two */
+    uint16_t last_used;             /* used->idx we have consumed up to */
+    volatile struct vring_desc *desc;
+    volatile struct vring_avail *avail;
+    volatile struct vring_used *used;
+    uint64_t phys;
+    uint64_t pages;
+} virtqueue_t;
+
+/*
+ * Reset the device at io_base and acknowledge it. Returns the device's
+ * feature bits. Enables I/O decoding and bus mastering on the PCI
+ * function.
+ */
+uint32_t virtio_reset(uint16_t io_base, uint8_t bus, uint8_t dev, uint8_t func);
+
+/* Accept features and go live (after the queues are set up) */
+void virtio_set_features(uint16_t io_base, uint32_t features);
+void virtio_driver_ok(uint16_t io_base);
+
+/*
+ * Allocate queue index of the device and hand it over. Returns 0, or
+ * -1 if the device has no such queue or memory ran out.
+ */
+int virtq_init(virtqueue_t *vq, uint16_t io_base, uint16_t index);
+
+/*
+ * Make the single-descriptor buffer desc_id (already filled in)
+ * available to the device. Call virtq_kick() to tell it.
+ */
+void virtq_submit(virtqueue_t *vq, uint16_t desc_id);
+
+/* Notify the device of new buffers, unless it asked not to be */
+void virtq_kick(virtqueue_t *vq);
+
+/* Next buffer the device has finished with, or -1 */
+int virtq_next_used(virtqueue_t *vq, uint32_t *len);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef VIRTIO_CONSOLE_H
+#define VIRTIO_CONSOLE_H
+
+#include <stdint.h>
+
+/*
+ * virtio-console (QEMU: -device virtio-serial-pci -device virtconsole).
+ *
+ * An output channel to the host that moves whole pages per request
+ * instead of a byte per port write, so it runs at memory speed where
+ * the 16550 manages about 11 KB/s. When present it carries the kernel
+ * log and stdout of user programs; the UART keeps warnings and panics.
+ * Output only: port 0's transmit queue, no multiport.
+ */
+
+/* Look for the device on PCI and bring it up. Returns 0 if found. */
+int virtio_console_init(void);
+
+/* Non-zero once the device is up (and has not stalled) */
+int virtio_console_present(void);
+
+/*
+ * Queue len bytes for the host. Copies the data, so buf can be reused
+ * on return. Waits only when every transmit buffer is in flight. Safe
+ * from any context; a no-op without the device.
+ */
+void virtio_console_write(const char *buf, uint64_t len);
+
+/* Wait until the host has taken everything written so far */
+void virtio_console_flush(void);
+
+/* Transmit buffers the host has not returned yet */
+uint32_t virtio_console_in_flight(void);
+
+#endif
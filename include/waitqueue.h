@@ -0,0 +1,54 @@
+#ifndef WAITQUEUE_H
+#define WAITQUEUE_H
+
+#include "task.h"
+#include "scheduler.h"
+
+/*
+ * Wait queues.
+ *
+ * A task that needs to wait for an event blocks on the event's wait
+ * queue (PROC_BLOCKED, linked on the queue rather than the scheduler's
+ * blocked list). Whoever produces the event - often an IRQ handler -
+ * calls wake_up_one()/wake_up_all() to make exactly those tasks
+ * runnable again. Nothing polls.
+ */
+
+#define WAIT_QUEUE_INITIALIZER { { NULL, NULL } }
+
+void wait_queue_init(wait_queue_t *wq);
+
+/*
+ * Block the current task on wq until woken. Must be called with the
+ * scheduler lock held; returns with it held. Callers should use
+ * wait_event() rather than calling this directly.
+ */
+void wait_queue_sleep(wait_queue_t *wq);
+
+/* Wake the longest-waiting task. Returns 1 if a task was woken. Safe from IRQs. */
+int wake_up_one(wait_queue_t *wq);
+
+/* Wake every waiting task. Returns the number woken. Safe from IRQs. */
+int wake_up_all(wait_queue_t *wq);
+
+/* wake_up_all() for callers already holding the scheduler lock */
+int wake_up_all_locked(wait_queue_t *wq);
+
+/*
+ * Block until condition is true. The condition is evaluated under the
+ * scheduler lock (interrupts disabled), so a wakeup between the check
+ * and the block cannot be lost, even from another CPU. The condition
+ * must not take the scheduler lock itself. The caller's interrupt state
+ * is restored on return.
+ */
+#define wait_event(wq, condition)                                   \
+    do {                                                            \
+        uint64_t __wq_flags = scheduler_lock();                     \
+        for (;;) {                                                  \
+            if (condition) break;                                   \
+            wait_queue_sleep(wq);                                   \
+        }                                                           \
+        scheduler_unlock(__wq_flags);                               \
+    } while (0)
+
+#endif
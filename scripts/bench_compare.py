@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""
+Compare cool-os benchmark results against a checked-in baseline.
+
+The regtest "bench" suite prints one line per benchmark:
+
+    [REGTEST] BENCH <name> iters=<n> min=<a> median=<b> p99=<c> unit=tsc
+
+Every statistic is a metric "<name>.<stat>". The baseline file lists
+
+    <metric> <value|-> <tolerance %> <tracked: yes|no>
+
+plus a "# mode: <mode>" line naming the QEMU mode it was recorded in.
+A metric regresses when it is slower than its baseline by more than its
+tolerance and improves when it is faster by as much. A regression in
+a tracked metric fails the comparison, but only when the run used the
+baseline's mode; numbers from another mode are shown for information.
+
+Usage: scripts/bench_compare.py LOG --baseline FILE --mode MODE [--update]
+--update records this run's values (and mode) in the baseline instead.
+"""
+
+import argparse
+import re
+import sys
+
+BENCH_RE = re.compile(r"\[REGTEST\] BENCH (\S+) (.*)")
+STATS = ("min", "median", "p99")
+DEFAULT_TOLERANCE = 25
+
+
+def parse_log(path):
+    """Return {metric: value} for every BENCH line in the log."""
+    results = {}
+    with open(path, errors="replace") as f:
+        for line in f:
+            m = BENCH_RE.search(line)
+            if not m:
+                continue
+            fields = dict(f.split("=", 1) for f in m.group(2).split() if "=" in f)
+            for stat in STATS:
+                if stat in fields:
+                    try:
+                        results["%s.%s" % (m.group(1), stat)] = int(fields[stat])
+                    except ValueError:
+                        pass  # Line mangled in transit
+    return results
+
+
+def parse_baseline(path):
+    """Return (mode, ordered list of [metric, value, tolerance, tracked])."""
+    mode, rows = None, []
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if line.startswith("# mode:"):
+                mode = line.split(":", 1)[1].strip() or None
+                continue
+            if not line or line.startswith("#"):
+                continue
+            metric, value, tolerance, tracked = line.split()[:4]
+            rows.append([metric, None if value == "-" else int(value),
+                         float(tolerance), tracked == "yes"])
+    return mode, rows
+
+
+def update(path, rows, results, mode):
+    """Rewrite the baseline with this run's values, keeping the policy columns."""
+    lines = []
+    with open(path) as f:
+        for line in f:
+            fields = line.split()
+            if line.startswith("# mode:"):
+                line = "# mode: %s\n" % mode
+            elif fields and not line.startswith("#") and fields[0] in results:
+                fields[1] = str(results[fields[0]])
+                line = "%-34s %10s %10s %8s\n" % tuple(fields[:4])
+            lines.append(line)
+
+    # New benchmarks start out as untracked medians
+    known = {r[0] for r in rows}
+    for metric in sorted(results):
+        if metric not in known and metric.endswith(".median"):
+            lines.append("%-34s %10s %10s %8s\n" % (metric, results[metric],
+                                                    DEFAULT_TOLERANCE, "no"))
+
+    with open(path, "w") as f:
+        f.writelines(lines)
+    print("bench: recorded %s mode results in %s" % (mode, path))
+
+
+def compare(rows, results, enforce):
+    """Print the table; return the number of tracked regressions."""
+    failures = 0
+    print("%-34s %10s %10s %8s  %s" % ("metric", "baseline", "current", "change", "status"))
+    for metric, value, tolerance, tracked in rows:
+        current = results.get(metric)
+        if current is None:
+            if value is None:
+                continue  # Never recorded and not run
+            status, change = "missing", ""
+        elif value is None:
+            status, change = "new", ""
+        else:
+            delta = (current - value) * 100.0 / value if value else 0.0
+            change = "%+.1f%%" % delta
+            if delta > tolerance:
+                status = "REGRESSED" if tracked and enforce else "slower"
+                if tracked and enforce:
+                    failures += 1
+            elif delta < -tolerance:
+                status = "improved"
+            else:
+                status = "ok"
+        if status == "ok" and not tracked:
+            continue  # Keep the table to what matters
+        print("%-34s %10s %10s %8s  %s" % (metric, "-" if value is None else value,
+                                            "-" if current is None else current,
+                                            change, status))
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("log", help="regtest log with BENCH lines")
+    parser.add_argument("--baseline", required=True, help="baseline file")
+    parser.add_argument("--mode", required=True, help="QEMU mode of this run (icount, kvm)")
+    parser.add_argument("--update", action="store_true", help="record this run as the baseline")
+    args = parser.parse_args()
+
+    results = parse_log(args.log)
+    if not results:
+        print("bench: no BENCH results in %s" % args.log)
+        return 0
+    mode, rows = parse_baseline(args.baseline)
+
+    if args.update:
+        update(args.baseline, rows, results, args.mode)
+        return 0
+
+    enforce = mode == args.mode
+    if not enforce:
+        print("bench: baseline is from %s mode, this run is %s: not enforcing"
+              % (mode or "no", args.mode))
+    elif not any(value is not None for _, value, _, tracked in rows if tracked):
+        print("bench: no tracked metric has a baseline value: regression gate inert"
+              " until one is recorded with REGTEST_BENCH_UPDATE=1")
+        enforce = False
+    failures = compare(rows, results, enforce)
+    if failures:
+        print("bench: %d tracked metric(s) regressed beyond tolerance" % failures)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,53 @@
+#!/bin/sh
+#
+# Generate the kernel symbol table that src/ksyms.c searches.
+#
+# Usage: scripts/gen_ksyms.sh [KERNEL.ELF] > ksyms.S
+#
+# Writes every text symbol of KERNEL.ELF, sorted by address, as
+# read-only data: ksym_addrs[] (addresses), ksym_name_offsets[] (into
+# ksym_names) and ksym_num. Without an ELF the table is empty; that is
+# what the first link pass uses. The table lives in .rodata, after all
+# of .text, so linking it in does not move any function and the second
+# pass can embed the addresses learnt from the first.
+
+set -e
+
+ELF="$1"
+
+{
+    if [ -n "$ELF" ]; then
+        nm -n --defined-only "$ELF"
+    fi
+} | awk '
+BEGIN { n = 0 }
+$2 ~ /^[TtWw]$/ && $1 != last {
+    addr[n] = $1
+    name[n] = $3
+    last = $1
+    n++
+}
+END {
+    print "/* Generated by scripts/gen_ksyms.sh - do not edit */"
+    print "    .section .rodata.ksyms, \"a\""
+    print "    .balign 8"
+    print "    .globl ksym_num"
+    print "ksym_num:"
+    printf "    .quad %d\n", n
+    print "    .globl ksym_addrs"
+    print "ksym_addrs:"
+    for (i = 0; i < n; i++)
+        printf "    .quad 0x%s\n", addr[i]
+    print "    .globl ksym_name_offsets"
+    print "ksym_name_offsets:"
+    off = 0
+    for (i = 0; i < n; i++) {
+        printf "    .long %d\n", off
+        off += length(name[i]) + 1
+    }
+    print "    .globl ksym_names"
+    print "ksym_names:"
+    for (i = 0; i < n; i++)
+        printf "    .asciz \"%s\"\n", name[i]
+    print "    .section .note.GNU-stack, \"\", @progbits"
+}'
@@ -9,17 +9,51 @@
 #
 # Usage: ./scripts/run_regtest.sh [options]
 # Options are passed through to QEMU (e.g., -d int for debug)
+# REGTEST_SMP sets the number of virtual CPUs (default 1)
+# REGTEST_DETERMINISTIC=1 runs under TCG with -icount instead of KVM, so
+#   the guest TSC advances with instructions executed and benchmark
+#   numbers repeat from run to run (slower; one CPU, fixed CPU model)
+# REGTEST_BENCH_UPDATE=1 records the run's benchmark results as the new
+#   baseline instead of comparing against it
+#
+# Benchmark results ([REGTEST] BENCH lines) are compared against
+# tests/bench_baseline.txt; a tracked metric that regressed beyond its
+# tolerance fails the run (see scripts/bench_compare.py).
+#
+# Test output goes over a virtio-console (saved to build/regtest-virtio.log)
+# rather than the much slower UART; both streams are shown and parsed.
 
 set -e
 
 # Configuration
 TIMEOUT=${REGTEST_TIMEOUT:-60}
+SMP=${REGTEST_SMP:-1}
+DETERMINISTIC=${REGTEST_DETERMINISTIC:-0}
+ICOUNT_SHIFT=${REGTEST_ICOUNT_SHIFT:-3}
 BUILD_DIR="build"
 DIST_DIR="${BUILD_DIR}/dist"
 IMG="${DIST_DIR}/cool-os-regtest.img"
 OVMF_CODE="${OVMF_CODE:-/usr/share/edk2/x64/OVMF_CODE.4m.fd}"
 OVMF_VARS="${BUILD_DIR}/OVMF_VARS.4m.fd"
 LOG_FILE="${BUILD_DIR}/regtest.log"
+SERIAL_LOG="${BUILD_DIR}/regtest-serial.log"
+VIRTIO_LOG="${BUILD_DIR}/regtest-virtio.log"
+BENCH_BASELINE="tests/bench_baseline.txt"
+
+# Execution mode: icount ticks the clocks by instruction count, with
+# everything that could vary between hosts pinned
+if [ "${DETERMINISTIC}" = "1" ]; then
+    MODE="icount"
+    SMP=1
+    TIMEOUT=${REGTEST_TIMEOUT:-300}
+    ACCEL_ARGS=(-accel tcg,thread=single
+                -icount shift=${ICOUNT_SHIFT},align=off,sleep=off
+                -cpu qemu64
+                -rtc base=2000-01-01T00:00:00,clock=vm)
+else
+    MODE="kvm"
+    ACCEL_ARGS=(-enable-kvm -cpu host)
+fi
 
 # Colors for output
 RED='\033[0;31m'
@@ -47,16 +81,23 @@ fi
 echo "Running cool-os regression tests..."
 echo "Image: ${IMG}"
 echo "Timeout: ${TIMEOUT}s"
+echo "CPUs: ${SMP}"
+echo "Mode: ${MODE}"
 echo "Log: ${LOG_FILE}"
 echo ""
 
 # Run QEMU with debug exit device, capture output
 set +e  # Don't exit on non-zero
 
+# Show the virtio-console stream as it arrives
+: > "${VIRTIO_LOG}"
+tail -n +1 -F "${VIRTIO_LOG}" 2>/dev/null &
+TAIL_PID=$!
+
 timeout ${TIMEOUT} qemu-system-x86_64 \
-    -enable-kvm \
-    -cpu host \
+    "${ACCEL_ARGS[@]}" \
     -m 256M \
+    -smp "${SMP}" \
     -no-reboot \
     -device isa-debug-exit,iobase=0x501,iosize=1 \
     -drive if=pflash,format=raw,readonly=on,file="${OVMF_CODE}" \
@@ -64,13 +105,43 @@ timeout ${TIMEOUT} qemu-system-x86_64 \
     -drive format=raw,file="${IMG}" \
     -display none \
     -serial stdio \
-    "$@" 2>&1 | tee "${LOG_FILE}"
+    -device virtio-serial-pci \
+    -chardev file,id=vcon,path="${VIRTIO_LOG}" \
+    -device virtconsole,chardev=vcon \
+    "$@" 2>&1 | tee "${SERIAL_LOG}"
 
 EXIT_CODE=${PIPESTATUS[0]}
 
+sleep 0.2
+kill ${TAIL_PID} 2>/dev/null
+wait ${TAIL_PID} 2>/dev/null
+
+# Parse both streams together
+cat "${SERIAL_LOG}" "${VIRTIO_LOG}" > "${LOG_FILE}"
+
+# Tracepoints dumped at the end of the run, for chrome://tracing
+if grep -q "^TRACE-BEGIN" "${LOG_FILE}" && command -v python3 > /dev/null; then
+    python3 "$(dirname "$0")/trace2json.py" "${LOG_FILE}" -o "${BUILD_DIR}/regtest-trace.json"
+fi
+
 echo ""
 echo "========================================"
 
+# Benchmarks against the baseline
+BENCH_FAILED=0
+if grep -q "\[REGTEST\] BENCH " "${LOG_FILE}"; then
+    if ! command -v python3 > /dev/null; then
+        echo -e "${YELLOW}python3 not found, benchmark results not compared${NC}"
+    elif [ "${REGTEST_BENCH_UPDATE:-0}" = "1" ]; then
+        python3 "$(dirname "$0")/bench_compare.py" "${LOG_FILE}" \
+            --baseline "${BENCH_BASELINE}" --mode "${MODE}" --update
+    else
+        python3 "$(dirname "$0")/bench_compare.py" "${LOG_FILE}" \
+            --baseline "${BENCH_BASELINE}" --mode "${MODE}" || BENCH_FAILED=1
+    fi
+    echo ""
+fi
+
 # Parse results from log
 PASSED=$(grep -c "\[REGTEST\] PASS" "${LOG_FILE}" 2>/dev/null || echo "0")
 FAILED=$(grep -c "\[REGTEST\] FAIL" "${LOG_FILE}" 2>/dev/null || echo "0")
@@ -90,7 +161,11 @@ fi
 # isa-debug-exit: exit code = (value << 1) | 1
 # value 0x00 -> exit 1 (success)
 # value 0x01 -> exit 3 (failure)
-if [ ${EXIT_CODE} -eq 1 ]; then
+if [ ${EXIT_CODE} -eq 1 ] && [ ${BENCH_FAILED} -ne 0 ]; then
+    echo -e "${RED}BENCHMARK REGRESSION${NC}"
+    echo "Summary: ${PASSED} passed, ${FAILED} failed"
+    exit 1
+elif [ ${EXIT_CODE} -eq 1 ]; then
     echo -e "${GREEN}REGRESSION TESTS PASSED${NC}"
     echo "Summary: ${PASSED} passed, ${FAILED} failed"
     exit 0
@@ -109,7 +184,7 @@ else
     # Check if we got a summary line
     if grep -q "\[REGTEST\] SUMMARY" "${LOG_FILE}"; then
         # Tests ran but QEMU exited unexpectedly
-        if [ "${FAILED}" -eq 0 ] && [ "${PASSED}" -gt 0 ]; then
+        if [ "${FAILED}" -eq 0 ] && [ "${PASSED}" -gt 0 ] && [ ${BENCH_FAILED} -eq 0 ]; then
             echo -e "${GREEN}Tests appear to have passed${NC}"
             exit 0
         fi
@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+"""
+Convert a cool-os trace dump into Chrome trace JSON.
+
+The kernel's trace_dump() (shell `trace`, and the end of every regtest
+run) writes its per-CPU tracepoint rings as:
+
+    TRACE-BEGIN khz=<tsc kHz> cpus=<n>
+    TRACE-EVENT <id> <B|E|I> <name>
+    TRACE <32-byte record as hex>
+    TRACE-END records=<n>
+
+Each record is struct trace_event from include/trace.h. Begin/end
+pairs become complete ("X") events, instants stay instants, and
+sched_switch records also give each CPU a track of which task ran when.
+Open the result in chrome://tracing or https://ui.perfetto.dev.
+
+Usage: scripts/trace2json.py LOG [-o OUT.json]
+The last dump in LOG is used.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+RECORD = struct.Struct("<QHHIQQ")  # tsc, id, cpu, pid, arg0, arg1
+
+# Argument names per event, for the JSON "args"
+ARG_NAMES = {
+    "sched_switch": ("prev_pid", "next_pid"),
+    "syscall": ("nr", "arg1/ret"),
+    "irq": ("vector", None),
+    "block_read": ("lba", "sectors/ret"),
+    "fat_read": ("fd", "bytes/ret"),
+    "mark": ("arg0", "arg1"),
+}
+
+
+def parse(lines):
+    """Return (khz, events table, records) for the last dump in lines."""
+    khz, table, records = None, {}, None
+    for line in lines:
+        line = line.strip()
+        if line.startswith("TRACE-BEGIN"):
+            fields = dict(f.split("=", 1) for f in line.split()[1:])
+            khz, table, records = int(fields["khz"]), {}, []
+        elif records is None:
+            continue
+        elif line.startswith("TRACE-EVENT "):
+            _, ident, phase, name = line.split(None, 3)
+            table[int(ident)] = (phase, name)
+        elif line.startswith("TRACE "):
+            try:
+                raw = bytes.fromhex(line[6:])
+            except ValueError:
+                continue  # Line mangled in transit
+            if len(raw) == RECORD.size:
+                records.append(RECORD.unpack(raw))
+    if records is None:
+        sys.exit("no TRACE-BEGIN found")
+    return khz, table, records
+
+
+def signed(value):
+    return value - (1 << 64) if value >= 1 << 63 else value
+
+
+def convert(khz, table, records):
+    records.sort(key=lambda r: r[0])
+    base = records[0][0] if records else 0
+    scale = 1000.0 / khz if khz else 1.0  # TSC ticks to microseconds
+
+    def ts(tsc):
+        return (tsc - base) * scale
+
+    out = []
+    cpus = sorted({r[2] for r in records})
+    for cpu in cpus:
+        out.append({"ph": "M", "name": "process_name", "pid": cpu,
+                    "args": {"name": "CPU %d" % cpu}})
+
+    open_spans = {}     # key -> (begin record)
+    running = {}        # cpu -> (start tsc, pid)
+    for tsc, ident, cpu, pid, arg0, arg1 in records:
+        phase, name = table.get(ident, ("I", "event%d" % ident))
+        names = ARG_NAMES.get(name, ("arg0", "arg1"))
+        # IRQs nest per CPU; everything else belongs to the task
+        key = (name, cpu) if name == "irq" else (name, pid)
+
+        if phase == "B":
+            open_spans[key] = (tsc, cpu, pid, arg0, arg1)
+        elif phase == "E":
+            begin = open_spans.pop(key, None)
+            if begin is None:
+                continue  # Began before the ring's oldest record
+            b_tsc, b_cpu, b_pid, b_arg0, _ = begin
+            args = {names[0]: b_arg0}
+            if names[1]:
+                args[names[1]] = signed(arg1)
+            out.append({"ph": "X", "name": name, "pid": b_cpu, "tid": b_pid,
+                        "ts": ts(b_tsc), "dur": ts(tsc) - ts(b_tsc), "args": args})
+        else:
+            args = {names[0]: arg0}
+            if names[1]:
+                args[names[1]] = arg1
+            out.append({"ph": "i", "s": "t", "name": name, "pid": cpu, "tid": pid,
+                        "ts": ts(tsc), "args": args})
+            if name == "sched_switch":
+                prev = running.get(cpu)
+                if prev is not None:
+                    out.append({"ph": "X", "name": "pid %d" % prev[1], "pid": cpu,
+                                "tid": "running", "ts": ts(prev[0]),
+                                "dur": ts(tsc) - ts(prev[0])})
+                running[cpu] = (tsc, arg1)
+
+    return {"traceEvents": out, "displayTimeUnit": "ns"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("log", help="serial or virtio-console log with a trace dump")
+    parser.add_argument("-o", "--output", help="output file (default: stdout)")
+    args = parser.parse_args()
+
+    with open(args.log, errors="replace") as f:
+        khz, table, records = parse(f)
+    trace = convert(khz, table, records)
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(trace, f)
+        print("%d records -> %s" % (len(records), args.output))
+    else:
+        json.dump(trace, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
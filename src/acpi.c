@@ -0,0 +1,106 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "acpi.h"
+#define LIMINE_API_REVISION 2
+#include "limine.h"
+#include "hhdm.h"
+#include "serial.h"
+
+/* Global Limine response pointer (set by kernel.c, may be NULL) */
+extern struct limine_rsdp_response *limine_rsdp;
+
+struct acpi_rsdp {
+    char signature[8];      /* "RSD PTR " */
+    uint8_t checksum;
+    char oem_id[6];
+    uint8_t revision;       /* 0 = ACPI 1.0 (RSDT only), 2+ = XSDT */
+    uint32_t rsdt_address;
+    /* ACPI 2.0+ */
+    uint32_t length;
+    uint64_t xsdt_address;
+    uint8_t ext_checksum;
+    uint8_t reserved[3];
+} __attribute__((packed));
+
+static struct acpi_sdt_header *root_sdt = NULL;
+static int root_is_xsdt = 0;
+
+/* Base revision 2 hands out an HHDM pointer; newer ones a physical address */
+static void *acpi_ptr(uint64_t addr) {
+    if (addr >= hhdm_offset) {
+        return (void *)addr;
+    }
+    return phys_to_hhdm(addr);
+}
+
+static int sig_equal(const char *a, const char *b, int n) {
+    for (int i = 0; i < n; i++) {
+        if (a[i] != b[i]) return 0;
+    }
+    return 1;
+}
+
+static int checksum_ok(const void *table, uint32_t length) {
+    const uint8_t *p = (const uint8_t *)table;
+    uint8_t sum = 0;
+    for (uint32_t i = 0; i < length; i++) {
+        sum += p[i];
+    }
+    return sum == 0;
+}
+
+void acpi_init(void) {
+    if (limine_rsdp == NULL || limine_rsdp->address == 0) {
+        serial_puts("ACPI: No RSDP from bootloader\n");
+        return;
+    }
+
+    struct acpi_rsdp *rsdp = acpi_ptr((uint64_t)limine_rsdp->address);
+    if (!sig_equal(rsdp->signature, "RSD PTR ", 8)) {
+        serial_puts("ACPI: Bad RSDP signature\n");
+        return;
+    }
+
+    if (rsdp->revision >= 2 && rsdp->xsdt_address != 0) {
+        root_sdt = acpi_ptr(rsdp->xsdt_address);
+        root_is_xsdt = 1;
+    } else {
+        root_sdt = acpi_ptr(rsdp->rsdt_address);
+        root_is_xsdt = 0;
+    }
+
+    if (!checksum_ok(root_sdt, root_sdt->length)) {
+        serial_puts("ACPI: Root table checksum mismatch\n");
+        root_sdt = NULL;
+        return;
+    }
+
+    serial_puts("ACPI: Using ");
+    serial_puts(root_is_xsdt ? "XSDT" : "RSDT");
+    serial_puts("\n");
+}
+
+void *acpi_find_table(const char *signature) {
+    if (root_sdt == NULL) {
+        return NULL;
+    }
+
+    uint32_t entry_size = root_is_xsdt ? 8 : 4;
+    uint32_t count = (root_sdt->length - sizeof(struct acpi_sdt_header)) / entry_size;
+    uint8_t *entries = (uint8_t *)root_sdt + sizeof(struct acpi_sdt_header);
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t addr;
+        if (root_is_xsdt) {
+            addr = *(uint64_t *)(entries + i * 8);
+        } else {
+            addr = *(uint32_t *)(entries + i * 4);
+        }
+
+        struct acpi_sdt_header *sdt = acpi_ptr(addr);
+        if (sig_equal(sdt->signature, signature, 4) && checksum_ok(sdt, sdt->length)) {
+            return sdt;
+        }
+    }
+    return NULL;
+}
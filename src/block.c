@@ -2,6 +2,7 @@
 #include "block.h"
 #include "ports.h"
 #include "serial.h"
+#include "trace.h"
 
 /*
  * ATA PIO Mode Driver
@@ -130,7 +131,8 @@ int block_init(void) {
     return 0;
 }
 
-int block_read(uint64_t lba, uint16_t count, void *dst) {
+/* PIO read of count sectors from the primary ATA drive */
+static int ata_read(uint64_t lba, uint16_t count, void *dst) {
     if (!ata_drive_present) {
         return -1;
     }
@@ -186,3 +188,10 @@ int block_read(uint64_t lba, uint16_t count, void *dst) {
 
     return 0;
 }
+
+int block_read(uint64_t lba, uint16_t count, void *dst) {
+    trace_event(TRACE_BLOCK_READ_BEGIN, lba, count);
+    int ret = ata_read(lba, count, dst);
+    trace_event(TRACE_BLOCK_READ_END, lba, ret);
+    return ret;
+}
@@ -0,0 +1,84 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "bootstat.h"
+#include "clocksource.h"
+#include "cpu.h"
+#include "printk.h"
+
+static struct {
+    const char *name;
+    uint64_t tsc;
+} marks[BOOTSTAT_MAX_STAGES];
+
+static int nmarks;
+static uint64_t entry_tsc;
+static uint64_t done_tsc;
+static int done;
+
+static uint64_t tsc_to_ns(uint64_t ticks) {
+    uint64_t khz = clocksource_tsc_khz();
+    if (khz == 0) {
+        return 0;
+    }
+    /* Exact for stages under ~5 hours at 1 GHz */
+    return ticks * NSEC_PER_MSEC / khz;
+}
+
+void bootstat_start(void) {
+    entry_tsc = rdtsc();
+    nmarks = 0;
+    done = 0;
+}
+
+void bootstat_mark(const char *name) {
+    uint64_t now = rdtsc();
+    if (done || nmarks == BOOTSTAT_MAX_STAGES) {
+        return;
+    }
+    marks[nmarks].name = name;
+    marks[nmarks].tsc = now;
+    nmarks++;
+}
+
+int bootstat_count(void) {
+    return done ? nmarks : 0;
+}
+
+int bootstat_get(int i, struct bootstat_stage *out) {
+    if (!done || i < 0 || i >= nmarks) {
+        return -1;
+    }
+    uint64_t prev = i == 0 ? entry_tsc : marks[i - 1].tsc;
+    out->name = marks[i].name;
+    out->ns = tsc_to_ns(marks[i].tsc - prev);
+    return 0;
+}
+
+uint64_t bootstat_total_ns(void) {
+    return done ? tsc_to_ns(done_tsc - entry_tsc) : 0;
+}
+
+uint64_t bootstat_preboot_ns(void) {
+    return tsc_to_ns(entry_tsc);
+}
+
+void bootstat_done(void) {
+    done_tsc = nmarks > 0 ? marks[nmarks - 1].tsc : rdtsc();
+    done = 1;
+
+    uint64_t total = bootstat_total_ns();
+    uint64_t ms = total / NSEC_PER_MSEC;
+    uint64_t us = total % NSEC_PER_MSEC / NSEC_PER_USEC;
+    uint64_t preboot_ms = bootstat_preboot_ns() / NSEC_PER_MSEC;
+    pr_info("boot: %d stages, %lu.%03lu ms (firmware and loader before: %lu ms)",
+            nmarks, ms, us, preboot_ms);
+
+    struct bootstat_stage st;
+    for (int i = 0; bootstat_get(i, &st) == 0; i++) {
+        uint64_t permille = total ? st.ns * 1000 / total : 0;
+        ms = st.ns / NSEC_PER_MSEC;
+        us = st.ns % NSEC_PER_MSEC / NSEC_PER_USEC;
+        pr_info("boot: %6lu.%03lu ms %3lu.%lu%%  %s",
+                ms, us, permille / 10, permille % 10, st.name);
+    }
+}
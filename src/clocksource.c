@@ -0,0 +1,180 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "clocksource.h"
+#include "acpi.h"
+#include "paging.h"
+#include "pit.h"
+#include "cpu.h"
+#include "serial.h"
+#include "seqlock.h"
+
+/* CPUID.80000007H:EDX bit 8 - TSC runs at a constant rate in all states */
+#define CPUID_80000007_EDX_INVARIANT_TSC (1U << 8)
+
+/* HPET registers */
+#define HPET_CAP        0x000   /* Bits 63:32 = counter period in fs */
+#define HPET_CONFIG     0x010
+#define HPET_COUNTER    0x0F0
+#define HPET_CAP_64BIT  (1ULL << 13)
+#define HPET_CFG_ENABLE 0x1
+
+#define HPET_VIRT 0xFFFFFFFFFED00000ULL
+
+#define FSEC_PER_NSEC 1000000ULL
+
+/* Calibration window */
+#define CALIBRATE_US 10000
+
+enum clock_kind {
+    CLOCK_KIND_TSC,
+    CLOCK_KIND_HPET
+};
+
+/*
+ * Conversion read by ktime_get_ns() on every CPU. Published under a
+ * seqlock so a reader can never combine the base of one calibration
+ * with the multiplier of another.
+ */
+static struct {
+    enum clock_kind kind;
+    uint64_t base;      /* Counter value at time zero */
+    uint64_t mult;      /* ns = (counts * mult) >> 32; 0 until calibrated */
+} clock = { CLOCK_KIND_TSC, 0, 0 };
+
+static seqlock_t clock_seq = SEQLOCK_INITIALIZER("clock");
+
+static uint64_t tsc_khz = 0;
+
+static int hpet_present = 0;
+static uint64_t hpet_period_fs = 0;
+
+static inline uint64_t hpet_read(uint32_t reg) {
+    return *(volatile uint64_t *)(HPET_VIRT + reg);
+}
+
+static inline void hpet_write(uint32_t reg, uint64_t value) {
+    *(volatile uint64_t *)(HPET_VIRT + reg) = value;
+}
+
+static void hpet_init(void) {
+    struct acpi_hpet *table = acpi_find_table("HPET");
+    if (table == NULL || table->base.address_space != 0) {
+        serial_puts("CLOCK: No HPET\n");
+        return;
+    }
+
+    paging_map_page(HPET_VIRT, table->base.address,
+                    PTE_PRESENT | PTE_WRITABLE | PTE_CACHE_DIS);
+
+    uint64_t cap = hpet_read(HPET_CAP);
+    hpet_period_fs = cap >> 32;
+    if (hpet_period_fs == 0 || hpet_period_fs > 100000000 || !(cap & HPET_CAP_64BIT)) {
+        serial_puts("CLOCK: HPET unusable\n");
+        return;
+    }
+
+    hpet_write(HPET_CONFIG, hpet_read(HPET_CONFIG) | HPET_CFG_ENABLE);
+    hpet_present = 1;
+
+    serial_puts("CLOCK: HPET at ");
+    serial_print_hex(table->base.address);
+    serial_puts(", period ");
+    serial_print_dec(hpet_period_fs);
+    serial_puts(" fs\n");
+}
+
+/* Measure the TSC rate over a fixed interval of the best reference */
+static uint64_t calibrate_tsc_khz(void) {
+    uint64_t start, end;
+
+    if (hpet_present) {
+        uint64_t ticks = (CALIBRATE_US * NSEC_PER_USEC * FSEC_PER_NSEC) / hpet_period_fs;
+        uint64_t h0 = hpet_read(HPET_COUNTER);
+        start = rdtsc();
+        while (hpet_read(HPET_COUNTER) - h0 < ticks) {
+            asm volatile("pause");
+        }
+        end = rdtsc();
+    } else {
+        start = rdtsc();
+        pit_wait_us(CALIBRATE_US);
+        end = rdtsc();
+    }
+
+    return (end - start) / (CALIBRATE_US / 1000);
+}
+
+void clocksource_init(void) {
+    uint32_t a, b, c, d;
+    int invariant = 0;
+
+    cpuid(0x80000000, 0, &a, &b, &c, &d);
+    if (a >= 0x80000007) {
+        cpuid(0x80000007, 0, &a, &b, &c, &d);
+        invariant = (d & CPUID_80000007_EDX_INVARIANT_TSC) != 0;
+    }
+
+    hpet_init();
+
+    tsc_khz = calibrate_tsc_khz();
+
+    uint64_t flags = write_seqlock_irqsave(&clock_seq);
+    if (invariant || !hpet_present) {
+        clock.kind = CLOCK_KIND_TSC;
+        clock.mult = (NSEC_PER_MSEC << 32) / tsc_khz;
+        clock.base = rdtsc();
+    } else {
+        clock.kind = CLOCK_KIND_HPET;
+        clock.mult = (hpet_period_fs << 32) / FSEC_PER_NSEC;
+        clock.base = hpet_read(HPET_COUNTER);
+    }
+    write_sequnlock_irqrestore(&clock_seq, flags);
+
+    serial_puts("CLOCK: TSC ");
+    serial_print_dec(tsc_khz);
+    serial_puts(invariant ? " kHz (invariant)" : " kHz");
+    serial_puts(", using ");
+    serial_puts(clocksource_name());
+    serial_puts("\n");
+}
+
+uint64_t ktime_get_ns(void) {
+    enum clock_kind kind;
+    uint64_t base, mult, now;
+    uint32_t seq;
+
+    do {
+        seq = read_seqbegin(&clock_seq);
+        kind = clock.kind;
+        base = clock.base;
+        mult = clock.mult;
+    } while (read_seqretry(&clock_seq, seq));
+
+    if (mult == 0) {
+        return 0;  /* Not calibrated yet */
+    }
+    now = kind == CLOCK_KIND_HPET ? hpet_read(HPET_COUNTER) : rdtsc();
+    return (uint64_t)(((unsigned __int128)(now - base) * mult) >> 32);
+}
+
+int clocksource_tsc_conversion(uint64_t *base, uint64_t *mult) {
+    enum clock_kind kind;
+    uint32_t seq;
+
+    do {
+        seq = read_seqbegin(&clock_seq);
+        kind = clock.kind;
+        *base = clock.base;
+        *mult = clock.mult;
+    } while (read_seqretry(&clock_seq, seq));
+
+    return kind == CLOCK_KIND_TSC && *mult != 0;
+}
+
+uint64_t clocksource_tsc_khz(void) {
+    return tsc_khz;
+}
+
+const char *clocksource_name(void) {
+    return clock.kind == CLOCK_KIND_HPET ? "hpet" : "tsc";
+}
@@ -1,6 +1,7 @@
 #include "console.h"
 #include "framebuffer.h"
 #include "serial.h"
+#include "simd.h"
 #include <stdint.h>
 #include <stddef.h>
 
@@ -398,46 +399,6 @@ static const uint8_t font[256][16] = {
     {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00},
 };
 
-/* Helper: fast memmove using 64-bit copies where possible */
-static void *memmove(void *dest, const void *src, uint64_t n) {
-    uint8_t *d = (uint8_t *)dest;
-    const uint8_t *s = (const uint8_t *)src;
-
-    if (d < s) {
-        /* Copy forward - use 64-bit words for bulk */
-        uint64_t *d64 = (uint64_t *)d;
-        const uint64_t *s64 = (const uint64_t *)s;
-        uint64_t words = n / 8;
-        uint64_t rem = n % 8;
-
-        for (uint64_t i = 0; i < words; i++) {
-            d64[i] = s64[i];
-        }
-        /* Copy remaining bytes */
-        d += words * 8;
-        s += words * 8;
-        for (uint64_t i = 0; i < rem; i++) {
-            d[i] = s[i];
-        }
-    } else {
-        /* Copy backward */
-        uint64_t words = n / 8;
-        uint64_t rem = n % 8;
-
-        /* Copy trailing bytes first */
-        for (uint64_t i = 0; i < rem; i++) {
-            d[n - 1 - i] = s[n - 1 - i];
-        }
-        /* Copy 64-bit words backward */
-        uint64_t *d64 = (uint64_t *)d;
-        const uint64_t *s64 = (const uint64_t *)s;
-        for (uint64_t i = words; i > 0; i--) {
-            d64[i - 1] = s64[i - 1];
-        }
-    }
-    return dest;
-}
-
 static void serial_print_dec_local(uint32_t val) {
     char buf[12];
     int i = 11;
@@ -487,18 +448,12 @@ static void console_scroll(void) {
     uint32_t scroll_bytes = FONT_HEIGHT * pitch;
     uint32_t total_height = rows * FONT_HEIGHT;
 
-    /* Move rows up using memmove (handles overlapping regions) */
-    memmove(buffer, buffer + scroll_bytes, (total_height - FONT_HEIGHT) * pitch);
+    /* Move rows up (overlapping, forward copy is vectorized) */
+    simd_memmove(buffer, buffer + scroll_bytes, (uint64_t)(total_height - FONT_HEIGHT) * pitch);
 
-    /* Clear bottom row - use 64-bit writes (2 pixels at a time) */
-    uint64_t bg_pair = ((uint64_t)bg_color << 32) | bg_color;
-    for (uint32_t y = (rows - 1) * FONT_HEIGHT; y < rows * FONT_HEIGHT; y++) {
-        uint64_t *row_ptr = (uint64_t *)(buffer + y * pitch);
-        uint32_t pairs = fb->render_width / 2;
-        for (uint32_t x = 0; x < pairs; x++) {
-            row_ptr[x] = bg_pair;
-        }
-    }
+    /* Clear bottom row */
+    simd_fill32_rect_nt(buffer + (uint64_t)(rows - 1) * FONT_HEIGHT * pitch, pitch, bg_color,
+                        (uint64_t)fb->render_width * 4, FONT_HEIGHT);
 }
 
 void console_init(void) {
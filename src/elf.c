@@ -2,8 +2,9 @@
 #include "paging.h"
 #include "pmm.h"
 #include "hhdm.h"
-#include "serial.h"
+#include "printk.h"
 #include "panic.h"
+#include "simd.h"
 #include <stddef.h>
 
 /* For paging_map_user_page_in */
@@ -12,14 +13,6 @@
 #define USER_ADDR_MIN   0x10000ULL          /* Minimum user address (leave null page unmapped) */
 #define USER_ADDR_MAX   0x7FFFFFFFFFFFULL   /* Maximum user address (end of low canonical) */
 
-static void print_hex(uint64_t val) {
-    const char *hex = "0123456789abcdef";
-    serial_puts("0x");
-    for (int i = 60; i >= 0; i -= 4) {
-        serial_putc(hex[(val >> i) & 0xf]);
-    }
-}
-
 /*
  * Validate ELF header.
  * Returns 0 if valid, -1 if invalid.
@@ -30,44 +23,44 @@ static int elf_validate_header(const Elf64_Ehdr *ehdr, uint64_t file_size) {
         ehdr->e_ident[EI_MAG1] != 'E' ||
         ehdr->e_ident[EI_MAG2] != 'L' ||
         ehdr->e_ident[EI_MAG3] != 'F') {
-        serial_puts("ELF: Invalid magic number\n");
+        pr_err("ELF: Invalid magic number");
         return -1;
     }
 
     /* Check class (must be 64-bit) */
     if (ehdr->e_ident[EI_CLASS] != ELFCLASS64) {
-        serial_puts("ELF: Not 64-bit\n");
+        pr_err("ELF: Not 64-bit");
         return -1;
     }
 
     /* Check endianness (must be little-endian) */
     if (ehdr->e_ident[EI_DATA] != ELFDATA2LSB) {
-        serial_puts("ELF: Not little-endian\n");
+        pr_err("ELF: Not little-endian");
         return -1;
     }
 
     /* Check type (must be executable) */
     if (ehdr->e_type != ET_EXEC && ehdr->e_type != ET_DYN) {
-        serial_puts("ELF: Not executable\n");
+        pr_err("ELF: Not executable");
         return -1;
     }
 
     /* Check machine (must be x86-64) */
     if (ehdr->e_machine != EM_X86_64) {
-        serial_puts("ELF: Not x86-64\n");
+        pr_err("ELF: Not x86-64");
         return -1;
     }
 
     /* Check program header offset */
     if (ehdr->e_phoff == 0 || ehdr->e_phnum == 0) {
-        serial_puts("ELF: No program headers\n");
+        pr_err("ELF: No program headers");
         return -1;
     }
 
     /* Check program header bounds */
     uint64_t ph_end = ehdr->e_phoff + (uint64_t)ehdr->e_phnum * ehdr->e_phentsize;
     if (ph_end > file_size) {
-        serial_puts("ELF: Program headers extend past file end\n");
+        pr_err("ELF: Program headers extend past file end");
         return -1;
     }
 
@@ -81,21 +74,19 @@ static int elf_validate_header(const Elf64_Ehdr *ehdr, uint64_t file_size) {
 static int elf_validate_segment(const Elf64_Phdr *phdr) {
     /* Check that memsz >= filesz */
     if (phdr->p_memsz < phdr->p_filesz) {
-        serial_puts("ELF: memsz < filesz\n");
+        pr_err("ELF: memsz < filesz");
         return -1;
     }
 
     /* Check that segment is in user address range */
     if (phdr->p_vaddr < USER_ADDR_MIN) {
-        serial_puts("ELF: Segment below user address range: ");
-        print_hex(phdr->p_vaddr);
-        serial_puts("\n");
+        pr_err("ELF: Segment below user address range: 0x%lx", phdr->p_vaddr);
         return -1;
     }
 
     uint64_t seg_end = phdr->p_vaddr + phdr->p_memsz;
     if (seg_end > USER_ADDR_MAX || seg_end < phdr->p_vaddr) {
-        serial_puts("ELF: Segment extends past user address range\n");
+        pr_err("ELF: Segment extends past user address range");
         return -1;
     }
 
@@ -104,7 +95,7 @@ static int elf_validate_segment(const Elf64_Phdr *phdr) {
 
 int elf_load(const void *data, uint64_t size, elf_info_t *info) {
     if (data == NULL || size < sizeof(Elf64_Ehdr) || info == NULL) {
-        serial_puts("ELF: Invalid parameters\n");
+        pr_err("ELF: Invalid parameters");
         return -1;
     }
 
@@ -115,9 +106,7 @@ int elf_load(const void *data, uint64_t size, elf_info_t *info) {
         return -1;
     }
 
-    serial_puts("ELF: Loading executable, entry ");
-    print_hex(ehdr->e_entry);
-    serial_puts("\n");
+    pr_debug("ELF: Loading executable, entry 0x%lx", ehdr->e_entry);
 
     /* Initialize load bounds */
     info->entry = ehdr->e_entry;
@@ -147,7 +136,7 @@ int elf_load(const void *data, uint64_t size, elf_info_t *info) {
 
         /* Check file bounds */
         if (phdr->p_offset + phdr->p_filesz > size) {
-            serial_puts("ELF: Segment file data extends past file end\n");
+            pr_err("ELF: Segment file data extends past file end");
             return -1;
         }
 
@@ -162,13 +151,13 @@ int elf_load(const void *data, uint64_t size, elf_info_t *info) {
     }
 
     if (!has_load) {
-        serial_puts("ELF: No PT_LOAD segments\n");
+        pr_err("ELF: No PT_LOAD segments");
         return -1;
     }
 
     /* Validate entry point is within loaded range */
     if (info->entry < info->load_base || info->entry >= info->load_end) {
-        serial_puts("ELF: Entry point outside loaded segments\n");
+        pr_err("ELF: Entry point outside loaded segments");
         return -1;
     }
 
@@ -184,15 +173,11 @@ int elf_load(const void *data, uint64_t size, elf_info_t *info) {
         int writable = (phdr->p_flags & PF_W) ? 1 : 0;
         int executable = (phdr->p_flags & PF_X) ? 1 : 0;
 
-        serial_puts("ELF: Loading segment at ");
-        print_hex(phdr->p_vaddr);
-        serial_puts(" size ");
-        print_hex(phdr->p_memsz);
-        serial_puts(" flags ");
-        if (phdr->p_flags & PF_R) serial_putc('R');
-        if (phdr->p_flags & PF_W) serial_putc('W');
-        if (phdr->p_flags & PF_X) serial_putc('X');
-        serial_puts("\n");
+        pr_debug("ELF: Loading segment at 0x%lx size 0x%lx flags %s%s%s",
+                 phdr->p_vaddr, phdr->p_memsz,
+                 (phdr->p_flags & PF_R) ? "R" : "",
+                 (phdr->p_flags & PF_W) ? "W" : "",
+                 (phdr->p_flags & PF_X) ? "X" : "");
 
         /* Align start address down to page boundary */
         uint64_t page_start = phdr->p_vaddr & ~0xFFFULL;
@@ -203,19 +188,17 @@ int elf_load(const void *data, uint64_t size, elf_info_t *info) {
             /* Allocate physical frame */
             uint64_t paddr = pmm_alloc_frame();
             if (paddr == 0) {
-                serial_puts("ELF: Out of physical memory\n");
+                pr_err("ELF: Out of physical memory");
                 return -1;
             }
 
             /* Zero the frame first */
             uint8_t *frame_ptr = (uint8_t *)phys_to_hhdm(paddr);
-            for (int j = 0; j < 4096; j++) {
-                frame_ptr[j] = 0;
-            }
+            simd_zero_page(frame_ptr);
 
             /* Map with user permissions */
             if (paging_map_user_page(vaddr, paddr, writable, executable) != 0) {
-                serial_puts("ELF: Failed to map page\n");
+                pr_err("ELF: Failed to map page");
                 return -1;
             }
 
@@ -249,18 +232,14 @@ int elf_load(const void *data, uint64_t size, elf_info_t *info) {
         }
     }
 
-    serial_puts("ELF: Loaded successfully, range ");
-    print_hex(info->load_base);
-    serial_puts(" - ");
-    print_hex(info->load_end);
-    serial_puts("\n");
+    pr_debug("ELF: Loaded successfully, range 0x%lx - 0x%lx", info->load_base, info->load_end);
 
     return 0;
 }
 
 int elf_load_into(const void *data, uint64_t size, uint64_t *pml4, elf_info_t *info) {
     if (data == NULL || size < sizeof(Elf64_Ehdr) || info == NULL || pml4 == NULL) {
-        serial_puts("ELF: Invalid parameters\n");
+        pr_err("ELF: Invalid parameters");
         return -1;
     }
 
@@ -271,9 +250,7 @@ int elf_load_into(const void *data, uint64_t size, uint64_t *pml4, elf_info_t *i
         return -1;
     }
 
-    serial_puts("ELF: Loading executable into address space, entry ");
-    print_hex(ehdr->e_entry);
-    serial_puts("\n");
+    pr_debug("ELF: Loading executable into address space, entry 0x%lx", ehdr->e_entry);
 
     /* Initialize load bounds */
     info->entry = ehdr->e_entry;
@@ -303,7 +280,7 @@ int elf_load_into(const void *data, uint64_t size, uint64_t *pml4, elf_info_t *i
 
         /* Check file bounds */
         if (phdr->p_offset + phdr->p_filesz > size) {
-            serial_puts("ELF: Segment file data extends past file end\n");
+            pr_err("ELF: Segment file data extends past file end");
             return -1;
         }
 
@@ -318,13 +295,13 @@ int elf_load_into(const void *data, uint64_t size, uint64_t *pml4, elf_info_t *i
     }
 
     if (!has_load) {
-        serial_puts("ELF: No PT_LOAD segments\n");
+        pr_err("ELF: No PT_LOAD segments");
         return -1;
     }
 
     /* Validate entry point is within loaded range */
     if (info->entry < info->load_base || info->entry >= info->load_end) {
-        serial_puts("ELF: Entry point outside loaded segments\n");
+        pr_err("ELF: Entry point outside loaded segments");
         return -1;
     }
 
@@ -340,15 +317,11 @@ int elf_load_into(const void *data, uint64_t size, uint64_t *pml4, elf_info_t *i
         int writable = (phdr->p_flags & PF_W) ? 1 : 0;
         int executable = (phdr->p_flags & PF_X) ? 1 : 0;
 
-        serial_puts("ELF: Loading segment at ");
-        print_hex(phdr->p_vaddr);
-        serial_puts(" size ");
-        print_hex(phdr->p_memsz);
-        serial_puts(" flags ");
-        if (phdr->p_flags & PF_R) serial_putc('R');
-        if (phdr->p_flags & PF_W) serial_putc('W');
-        if (phdr->p_flags & PF_X) serial_putc('X');
-        serial_puts("\n");
+        pr_debug("ELF: Loading segment at 0x%lx size 0x%lx flags %s%s%s",
+                 phdr->p_vaddr, phdr->p_memsz,
+                 (phdr->p_flags & PF_R) ? "R" : "",
+                 (phdr->p_flags & PF_W) ? "W" : "",
+                 (phdr->p_flags & PF_X) ? "X" : "");
 
         /* Align start address down to page boundary */
         uint64_t page_start = phdr->p_vaddr & ~0xFFFULL;
@@ -359,19 +332,17 @@ int elf_load_into(const void *data, uint64_t size, uint64_t *pml4, elf_info_t *i
             /* Allocate physical frame */
             uint64_t paddr = pmm_alloc_frame();
             if (paddr == 0) {
-                serial_puts("ELF: Out of physical memory\n");
+                pr_err("ELF: Out of physical memory");
                 return -1;
             }
 
             /* Zero the frame first */
             uint8_t *frame_ptr = (uint8_t *)phys_to_hhdm(paddr);
-            for (int j = 0; j < 4096; j++) {
-                frame_ptr[j] = 0;
-            }
+            simd_zero_page(frame_ptr);
 
             /* Map with user permissions into the specified PML4 */
             if (paging_map_user_page_in(pml4, vaddr, paddr, writable, executable) != 0) {
-                serial_puts("ELF: Failed to map page\n");
+                pr_err("ELF: Failed to map page");
                 return -1;
             }
 
@@ -405,18 +376,14 @@ int elf_load_into(const void *data, uint64_t size, uint64_t *pml4, elf_info_t *i
         }
     }
 
-    serial_puts("ELF: Loaded into address space, range ");
-    print_hex(info->load_base);
-    serial_puts(" - ");
-    print_hex(info->load_end);
-    serial_puts("\n");
+    pr_debug("ELF: Loaded into address space, range 0x%lx - 0x%lx", info->load_base, info->load_end);
 
     return 0;
 }
 
 int elf_load_at(const void *data, uint64_t size, uint64_t load_addr, elf_info_t *info) {
     if (data == NULL || size < sizeof(Elf64_Ehdr) || info == NULL) {
-        serial_puts("ELF: Invalid parameters\n");
+        pr_err("ELF: Invalid parameters");
         return -1;
     }
 
@@ -443,7 +410,7 @@ int elf_load_at(const void *data, uint64_t size, uint64_t load_addr, elf_info_t
         has_load = 1;
 
         if (phdr->p_offset + phdr->p_filesz > size) {
-            serial_puts("ELF: Segment file data extends past file end\n");
+            pr_err("ELF: Segment file data extends past file end");
             return -1;
         }
 
@@ -453,18 +420,15 @@ int elf_load_at(const void *data, uint64_t size, uint64_t load_addr, elf_info_t
     }
 
     if (!has_load) {
-        serial_puts("ELF: No PT_LOAD segments\n");
+        pr_err("ELF: No PT_LOAD segments");
         return -1;
     }
 
     /* Calculate offset to apply to all addresses */
     int64_t addr_offset = (int64_t)load_addr - (int64_t)orig_base;
 
-    serial_puts("ELF: Loading executable at ");
-    print_hex(load_addr);
-    serial_puts(", entry ");
-    print_hex(ehdr->e_entry + addr_offset);
-    serial_puts("\n");
+    pr_debug("ELF: Loading executable at 0x%lx, entry 0x%lx", load_addr,
+             ehdr->e_entry + addr_offset);
 
     /* Initialize load bounds with offset applied */
     info->entry = ehdr->e_entry + addr_offset;
@@ -485,7 +449,7 @@ int elf_load_at(const void *data, uint64_t size, uint64_t load_addr, elf_info_t
 
         /* Validate adjusted addresses are in user range */
         if (seg_vaddr < USER_ADDR_MIN || seg_end > USER_ADDR_MAX) {
-            serial_puts("ELF: Adjusted segment outside user range\n");
+            pr_err("ELF: Adjusted segment outside user range");
             return -1;
         }
 
@@ -510,19 +474,17 @@ int elf_load_at(const void *data, uint64_t size, uint64_t load_addr, elf_info_t
             /* Allocate physical frame */
             uint64_t paddr = pmm_alloc_frame();
             if (paddr == 0) {
-                serial_puts("ELF: Out of physical memory\n");
+                pr_err("ELF: Out of physical memory");
                 return -1;
             }
 
             /* Zero the frame first */
             uint8_t *frame_ptr = (uint8_t *)phys_to_hhdm(paddr);
-            for (int j = 0; j < 4096; j++) {
-                frame_ptr[j] = 0;
-            }
+            simd_zero_page(frame_ptr);
 
             /* Map with user permissions */
             if (paging_map_user_page(vaddr, paddr, writable, executable) != 0) {
-                serial_puts("ELF: Failed to map page\n");
+                pr_err("ELF: Failed to map page");
                 return -1;
             }
 
@@ -557,11 +519,62 @@ int elf_load_at(const void *data, uint64_t size, uint64_t load_addr, elf_info_t
         }
     }
 
-    serial_puts("ELF: Loaded successfully, range ");
-    print_hex(info->load_base);
-    serial_puts(" - ");
-    print_hex(info->load_end);
-    serial_puts("\n");
+    pr_debug("ELF: Loaded successfully, range 0x%lx - 0x%lx", info->load_base, info->load_end);
 
     return 0;
 }
+
+const char *elf_symbolize(const void *data, uint64_t size, uint64_t addr, uint64_t *start) {
+    const uint8_t *file = (const uint8_t *)data;
+    const Elf64_Ehdr *ehdr = (const Elf64_Ehdr *)data;
+
+    if (size < sizeof(Elf64_Ehdr) || ehdr->e_shoff == 0 ||
+        ehdr->e_shentsize != sizeof(Elf64_Shdr) ||
+        ehdr->e_shoff + (uint64_t)ehdr->e_shnum * sizeof(Elf64_Shdr) > size) {
+        return NULL;
+    }
+    const Elf64_Shdr *shdrs = (const Elf64_Shdr *)(file + ehdr->e_shoff);
+
+    const char *best = NULL;
+    uint64_t best_value = 0;
+
+    for (uint16_t i = 0; i < ehdr->e_shnum; i++) {
+        const Elf64_Shdr *symtab = &shdrs[i];
+        if (symtab->sh_type != SHT_SYMTAB || symtab->sh_link >= ehdr->e_shnum ||
+            symtab->sh_offset + symtab->sh_size > size) {
+            continue;
+        }
+        const Elf64_Shdr *strtab = &shdrs[symtab->sh_link];
+        if (strtab->sh_offset + strtab->sh_size > size) {
+            continue;
+        }
+
+        const Elf64_Sym *syms = (const Elf64_Sym *)(file + symtab->sh_offset);
+        uint64_t nsyms = symtab->sh_size / sizeof(Elf64_Sym);
+        for (uint64_t j = 0; j < nsyms; j++) {
+            const Elf64_Sym *sym = &syms[j];
+            uint8_t type = ELF64_ST_TYPE(sym->st_info);
+            if ((type != STT_FUNC && type != STT_NOTYPE) ||
+                sym->st_shndx == 0 || sym->st_shndx >= ehdr->e_shnum ||
+                sym->st_name == 0 || sym->st_name >= strtab->sh_size) {
+                continue;
+            }
+
+            /* Only code, and only the section addr is in */
+            const Elf64_Shdr *sec = &shdrs[sym->st_shndx];
+            if (!(sec->sh_flags & SHF_EXECINSTR) ||
+                addr < sec->sh_addr || addr >= sec->sh_addr + sec->sh_size) {
+                continue;
+            }
+            if (sym->st_value <= addr && (best == NULL || sym->st_value > best_value)) {
+                best = (const char *)(file + strtab->sh_offset + sym->st_name);
+                best_value = sym->st_value;
+            }
+        }
+    }
+
+    if (best != NULL && start != NULL) {
+        *start = best_value;
+    }
+    return best;
+}
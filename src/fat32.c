@@ -3,6 +3,7 @@
 #include "block.h"
 #include "heap.h"
 #include "serial.h"
+#include "trace.h"
 
 /*
  * FAT32 Filesystem Driver
@@ -235,16 +236,8 @@ int fat_open(const char *path) {
     return -1;  /* File not found */
 }
 
-int fat_read(int fd, void *buf, uint32_t n) {
-    if (fd < 0 || fd >= FAT_MAX_OPEN || !open_files[fd].in_use) {
-        return -1;
-    }
-    if (buf == NULL || n == 0) {
-        return 0;
-    }
-
-    fat_file_t *file = &open_files[fd];
-    uint8_t *dst = (uint8_t *)buf;
+/* Read up to n bytes at the file's position */
+static int fat_read_file(fat_file_t *file, uint8_t *dst, uint32_t n) {
     uint32_t bytes_read = 0;
 
     /* Limit read to remaining file size */
@@ -294,6 +287,20 @@ int fat_read(int fd, void *buf, uint32_t n) {
     return bytes_read;
 }
 
+int fat_read(int fd, void *buf, uint32_t n) {
+    if (fd < 0 || fd >= FAT_MAX_OPEN || !open_files[fd].in_use) {
+        return -1;
+    }
+    if (buf == NULL || n == 0) {
+        return 0;
+    }
+
+    trace_event(TRACE_FAT_READ_BEGIN, fd, n);
+    int ret = fat_read_file(&open_files[fd], (uint8_t *)buf, n);
+    trace_event(TRACE_FAT_READ_END, fd, ret);
+    return ret;
+}
+
 int fat_seek(int fd, uint32_t offset) {
     if (fd < 0 || fd >= FAT_MAX_OPEN || !open_files[fd].in_use) {
         return -1;
@@ -0,0 +1,240 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "fpu.h"
+#include "task.h"
+#include "heap.h"
+#include "cpu.h"
+#include "panic.h"
+#include "serial.h"
+#include "percpu.h"
+#include "preempt.h"
+
+/* CR0 bits */
+#define CR0_MP  (1ULL << 1)   /* Monitor coprocessor */
+#define CR0_EM  (1ULL << 2)   /* x87 emulation (must be clear) */
+#define CR0_TS  (1ULL << 3)   /* Task switched (#NM on FPU use) */
+#define CR0_NE  (1ULL << 5)   /* Native FPU error reporting */
+
+/* CR4 bits */
+#define CR4_OSFXSR     (1ULL << 9)    /* FXSAVE/FXRSTOR and SSE */
+#define CR4_OSXMMEXCPT (1ULL << 10)   /* Unmasked SSE exceptions raise #XM */
+#define CR4_OSXSAVE    (1ULL << 18)   /* XSAVE and XCR0 */
+
+/* CPUID.01H:ECX */
+#define CPUID_1_ECX_XSAVE (1U << 26)
+#define CPUID_1_ECX_AVX   (1U << 28)
+
+/* CPUID.(0DH,1):EAX */
+#define CPUID_D_1_EAX_XSAVEOPT (1U << 0)
+
+/* XCR0 state components */
+#define XSTATE_X87 (1ULL << 0)
+#define XSTATE_SSE (1ULL << 1)
+#define XSTATE_AVX (1ULL << 2)
+
+#define FXSAVE_SIZE   512
+#define FPU_ALIGN     64      /* XSAVE needs 64-byte alignment */
+#define MXCSR_DEFAULT 0x1F80  /* All SIMD exceptions masked */
+
+enum fpu_mode {
+    FPU_FXSAVE,
+    FPU_XSAVE,
+    FPU_XSAVEOPT
+};
+
+static enum fpu_mode mode = FPU_FXSAVE;
+static uint64_t xstate_mask = XSTATE_X87 | XSTATE_SSE;
+static uint32_t state_size = FXSAVE_SIZE;
+static int fpu_ready = 0;
+
+/* Clean FPU image copied into every new task */
+static uint8_t init_state[4096] __attribute__((aligned(FPU_ALIGN)));
+
+static inline uint64_t read_cr0(void) {
+    uint64_t v;
+    asm volatile("mov %%cr0, %0" : "=r"(v));
+    return v;
+}
+
+static inline void write_cr0(uint64_t v) {
+    asm volatile("mov %0, %%cr0" : : "r"(v));
+}
+
+static inline void xsetbv(uint32_t reg, uint64_t value) {
+    asm volatile("xsetbv" : : "c"(reg), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)));
+}
+
+static void save_to(void *area) {
+    uint32_t lo = (uint32_t)xstate_mask;
+    uint32_t hi = (uint32_t)(xstate_mask >> 32);
+
+    switch (mode) {
+        case FPU_XSAVEOPT:
+            asm volatile("xsaveopt64 (%0)" : : "r"(area), "a"(lo), "d"(hi) : "memory");
+            break;
+        case FPU_XSAVE:
+            asm volatile("xsave64 (%0)" : : "r"(area), "a"(lo), "d"(hi) : "memory");
+            break;
+        default:
+            asm volatile("fxsave64 (%0)" : : "r"(area) : "memory");
+            break;
+    }
+}
+
+static void restore_from(const void *area) {
+    uint32_t lo = (uint32_t)xstate_mask;
+    uint32_t hi = (uint32_t)(xstate_mask >> 32);
+
+    if (mode == FPU_FXSAVE) {
+        asm volatile("fxrstor64 (%0)" : : "r"(area) : "memory");
+    } else {
+        asm volatile("xrstor64 (%0)" : : "r"(area), "a"(lo), "d"(hi) : "memory");
+    }
+}
+
+void fpu_init(void) {
+    uint32_t a, b, c, d;
+    cpuid(1, 0, &a, &b, &c, &d);
+    int has_xsave = (c & CPUID_1_ECX_XSAVE) != 0;
+    int has_avx = (c & CPUID_1_ECX_AVX) != 0;
+
+    /* FPU present and native, no emulation or lazy-switch trapping */
+    write_cr0((read_cr0() & ~(CR0_EM | CR0_TS)) | CR0_MP | CR0_NE);
+
+    uint64_t cr4 = read_cr4() | CR4_OSFXSR | CR4_OSXMMEXCPT;
+    if (has_xsave) {
+        cr4 |= CR4_OSXSAVE;
+    }
+    write_cr4(cr4);
+
+    if (has_xsave) {
+        cpuid(0xD, 0, &a, &b, &c, &d);
+        uint64_t supported = ((uint64_t)d << 32) | a;
+
+        xstate_mask = XSTATE_X87 | XSTATE_SSE;
+        if (has_avx && (supported & XSTATE_AVX)) {
+            xstate_mask |= XSTATE_AVX;
+        }
+        xsetbv(0, xstate_mask);
+
+        /* EBX now reports the area size for the enabled components */
+        cpuid(0xD, 0, &a, &b, &c, &d);
+        state_size = b;
+
+        cpuid(0xD, 1, &a, &b, &c, &d);
+        mode = (a & CPUID_D_1_EAX_XSAVEOPT) ? FPU_XSAVEOPT : FPU_XSAVE;
+    }
+
+    ASSERT(state_size <= sizeof(init_state));
+
+    /* Capture the default state (XSAVE header must start zeroed) */
+    for (uint32_t i = 0; i < sizeof(init_state); i++) {
+        init_state[i] = 0;
+    }
+    uint32_t mxcsr = MXCSR_DEFAULT;
+    asm volatile("fninit; ldmxcsr %0" : : "m"(mxcsr));
+    if (mode == FPU_FXSAVE) {
+        asm volatile("fxsave64 (%0)" : : "r"(init_state) : "memory");
+    } else {
+        uint32_t lo = (uint32_t)xstate_mask;
+        uint32_t hi = (uint32_t)(xstate_mask >> 32);
+        asm volatile("xsave64 (%0)" : : "r"(init_state), "a"(lo), "d"(hi) : "memory");
+    }
+
+    fpu_ready = 1;
+
+    serial_puts("FPU: ");
+    serial_puts(fpu_save_mode());
+    serial_puts(xstate_mask & XSTATE_AVX ? ", x87/SSE/AVX" : ", x87/SSE");
+    serial_puts(", area ");
+    serial_print_dec(state_size);
+    serial_puts(" bytes\n");
+}
+
+void fpu_init_cpu(void) {
+    /* Same configuration as the BSP, which has already probed the CPU */
+    write_cr0((read_cr0() & ~(CR0_EM | CR0_TS)) | CR0_MP | CR0_NE);
+
+    uint64_t cr4 = read_cr4() | CR4_OSFXSR | CR4_OSXMMEXCPT;
+    if (mode != FPU_FXSAVE) {
+        cr4 |= CR4_OSXSAVE;
+    }
+    write_cr4(cr4);
+
+    if (mode != FPU_FXSAVE) {
+        xsetbv(0, xstate_mask);
+    }
+
+    uint32_t mxcsr = MXCSR_DEFAULT;
+    asm volatile("fninit; ldmxcsr %0" : : "m"(mxcsr));
+}
+
+int fpu_alloc_state(task_t *task) {
+    uint8_t *raw = kmalloc(state_size + FPU_ALIGN);
+    if (raw == NULL) {
+        return -1;
+    }
+    uint8_t *area = (uint8_t *)ALIGN_UP((uint64_t)raw, FPU_ALIGN);
+    for (uint32_t i = 0; i < state_size; i++) {
+        area[i] = init_state[i];
+    }
+    task->fpu_alloc = raw;
+    task->fpu_state = area;
+    return 0;
+}
+
+void fpu_free_state(task_t *task) {
+    if (task->fpu_alloc != NULL) {
+        kfree(task->fpu_alloc);
+    }
+    task->fpu_alloc = NULL;
+    task->fpu_state = NULL;
+}
+
+void fpu_save(task_t *task) {
+    if (task != NULL && task->fpu_state != NULL) {
+        save_to(task->fpu_state);
+    }
+}
+
+void fpu_restore(task_t *task) {
+    if (task != NULL && task->fpu_state != NULL) {
+        restore_from(task->fpu_state);
+    }
+}
+
+uint32_t fpu_state_size(void) {
+    return state_size;
+}
+
+int fpu_has_avx(void) {
+    return (xstate_mask & XSTATE_AVX) != 0;
+}
+
+const char *fpu_save_mode(void) {
+    switch (mode) {
+        case FPU_XSAVEOPT: return "xsaveopt";
+        case FPU_XSAVE:    return "xsave";
+        default:           return "fxsave";
+    }
+}
+
+int kernel_fpu_usable(void) {
+    return fpu_ready && !this_cpu()->kernel_fpu_active;
+}
+
+void kernel_fpu_begin(void) {
+    preempt_disable();
+    ASSERT(!this_cpu()->kernel_fpu_active);
+    this_cpu()->kernel_fpu_active = 1;
+
+    /* Eager switching keeps the running task's registers live; park them */
+    fpu_save(current_task);
+}
+
+void kernel_fpu_end(void) {
+    ASSERT(this_cpu()->kernel_fpu_active);
+    fpu_restore(current_task);
+    this_cpu()->kernel_fpu_active = 0;
+    preempt_enable();
+}
@@ -5,6 +5,7 @@
 #include "heap.h"
 #include "serial.h"
 #include "panic.h"
+#include "simd.h"
 
 /* External Limine framebuffer response from kernel.c */
 extern volatile struct limine_framebuffer_request framebuffer_request;
@@ -157,15 +158,9 @@ void fb_clear(uint32_t color) {
     void *target = fb.back ? fb.back : fb.front;
     uint32_t pitch = fb.back ? fb.back_pitch : fb.hw_pitch;
 
-    /* Use 64-bit writes for speed (2 pixels at a time) */
-    uint64_t color_pair = ((uint64_t)color << 32) | color;
-    for (uint32_t y = 0; y < fb.render_height; y++) {
-        uint64_t *row = (uint64_t *)((uint8_t *)target + y * pitch);
-        uint32_t pairs = fb.render_width / 2;
-        for (uint32_t x = 0; x < pairs; x++) {
-            row[x] = color_pair;
-        }
-    }
+    /* Streaming SIMD stores when available, 64-bit writes otherwise */
+    simd_fill32_rect_nt(target, pitch, color, (uint64_t)fb.render_width * 4,
+                        fb.render_height);
 }
 
 void fb_fill_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t color) {
@@ -190,19 +185,12 @@ void fb_fill_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t color
 void fb_present(void) {
     if (!initialized || !fb.back) return;
 
-    uint8_t *src = (uint8_t *)fb.back;
-    uint8_t *dst = (uint8_t *)fb.front;
-    uint32_t row_bytes = fb.render_width * 4;
-
-    /* Copy row by row using 64-bit transfers */
-    for (uint32_t y = 0; y < fb.render_height; y++) {
-        uint64_t *s = (uint64_t *)(src + y * fb.back_pitch);
-        uint64_t *d = (uint64_t *)(dst + y * fb.hw_pitch);
-        uint32_t words = row_bytes / 8;
-        for (uint32_t i = 0; i < words; i++) {
-            d[i] = s[i];
-        }
-    }
+    /*
+     * Copy row by row. VRAM is never read back, so non-temporal stores
+     * avoid pulling the whole frame through the cache.
+     */
+    simd_copy_rect_nt(fb.front, fb.hw_pitch, fb.back, fb.back_pitch,
+                      (uint64_t)fb.render_width * 4, fb.render_height);
 }
 
 const framebuffer_t *fb_get_info(void) {
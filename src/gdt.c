@@ -1,5 +1,7 @@
 #include "gdt.h"
 #include "serial.h"
+#include "smp.h"
+#include "percpu.h"
 
 /*
  * GDT access byte bits:
@@ -44,86 +46,95 @@ struct gdt_combined {
     struct gdt_entry_tss tss;
 } __attribute__((packed, aligned(8)));
 
-static struct gdt_combined gdt;
-static struct gdtr gdtr;
-static struct tss tss;
+/* One GDT and TSS per CPU: the TSS descriptor is CPU-specific */
+static struct gdt_combined gdt_table[SMP_MAX_CPUS];
+static struct gdtr gdtr_table[SMP_MAX_CPUS];
+static struct tss tss_table[SMP_MAX_CPUS];
 
-static void gdt_set_entry(int index, uint8_t access, uint8_t flags) {
+static void gdt_set_entry(struct gdt_combined *gdt, int index, uint8_t access, uint8_t flags) {
     /* Base and limit are ignored in 64-bit mode for code/data segments */
-    gdt.entries[index].limit_low = 0xFFFF;
-    gdt.entries[index].base_low = 0;
-    gdt.entries[index].base_mid = 0;
-    gdt.entries[index].access = access;
-    gdt.entries[index].flags_limit_high = flags | 0x0F;  /* Limit bits 16-19 = 0xF */
-    gdt.entries[index].base_high = 0;
+    gdt->entries[index].limit_low = 0xFFFF;
+    gdt->entries[index].base_low = 0;
+    gdt->entries[index].base_mid = 0;
+    gdt->entries[index].access = access;
+    gdt->entries[index].flags_limit_high = flags | 0x0F;  /* Limit bits 16-19 = 0xF */
+    gdt->entries[index].base_high = 0;
 }
 
-static void gdt_set_tss(uint64_t base, uint32_t limit) {
-    gdt.tss.limit_low = limit & 0xFFFF;
-    gdt.tss.base_low = base & 0xFFFF;
-    gdt.tss.base_mid = (base >> 16) & 0xFF;
-    gdt.tss.access = TSS_ACCESS_PRESENT;
-    gdt.tss.flags_limit_high = ((limit >> 16) & 0x0F);
-    gdt.tss.base_high = (base >> 24) & 0xFF;
-    gdt.tss.base_upper = base >> 32;
-    gdt.tss.reserved = 0;
+static void gdt_set_tss(struct gdt_combined *gdt, uint64_t base, uint32_t limit) {
+    gdt->tss.limit_low = limit & 0xFFFF;
+    gdt->tss.base_low = base & 0xFFFF;
+    gdt->tss.base_mid = (base >> 16) & 0xFF;
+    gdt->tss.access = TSS_ACCESS_PRESENT;
+    gdt->tss.flags_limit_high = ((limit >> 16) & 0x0F);
+    gdt->tss.base_high = (base >> 24) & 0xFF;
+    gdt->tss.base_upper = base >> 32;
+    gdt->tss.reserved = 0;
 }
 
 void gdt_init(void) {
+    gdt_init_cpu(0);
+}
+
+void gdt_init_cpu(uint32_t cpu) {
+    struct gdt_combined *gdt = &gdt_table[cpu];
+    struct gdtr *gdtr = &gdtr_table[cpu];
+    struct tss *tss = &tss_table[cpu];
+
     /* Entry 0: Null descriptor */
-    gdt.entries[0].limit_low = 0;
-    gdt.entries[0].base_low = 0;
-    gdt.entries[0].base_mid = 0;
-    gdt.entries[0].access = 0;
-    gdt.entries[0].flags_limit_high = 0;
-    gdt.entries[0].base_high = 0;
+    gdt->entries[0].limit_low = 0;
+    gdt->entries[0].base_low = 0;
+    gdt->entries[0].base_mid = 0;
+    gdt->entries[0].access = 0;
+    gdt->entries[0].flags_limit_high = 0;
+    gdt->entries[0].base_high = 0;
 
     /* Entry 1: Kernel Code (0x08) - DPL=0, executable, readable, 64-bit */
-    gdt_set_entry(1,
+    gdt_set_entry(gdt, 1,
         GDT_ACCESS_PRESENT | GDT_ACCESS_CODE_DATA | GDT_ACCESS_EXECUTABLE | GDT_ACCESS_READWRITE,
         GDT_FLAG_LONG_MODE | GDT_FLAG_GRANULARITY);
 
     /* Entry 2: Kernel Data (0x10) - DPL=0, writable */
-    gdt_set_entry(2,
+    gdt_set_entry(gdt, 2,
         GDT_ACCESS_PRESENT | GDT_ACCESS_CODE_DATA | GDT_ACCESS_READWRITE,
         GDT_FLAG_GRANULARITY);
 
     /* Entry 3: User Data (0x18) - DPL=3, writable */
-    gdt_set_entry(3,
+    gdt_set_entry(gdt, 3,
         GDT_ACCESS_PRESENT | GDT_ACCESS_DPL_USER | GDT_ACCESS_CODE_DATA | GDT_ACCESS_READWRITE,
         GDT_FLAG_GRANULARITY);
 
     /* Entry 4: User Code (0x20) - DPL=3, executable, readable, 64-bit */
-    gdt_set_entry(4,
+    gdt_set_entry(gdt, 4,
         GDT_ACCESS_PRESENT | GDT_ACCESS_DPL_USER | GDT_ACCESS_CODE_DATA | GDT_ACCESS_EXECUTABLE | GDT_ACCESS_READWRITE,
         GDT_FLAG_LONG_MODE | GDT_FLAG_GRANULARITY);
 
     /* Initialize TSS */
-    tss.reserved0 = 0;
-    tss.rsp0 = 0;
-    tss.rsp1 = 0;
-    tss.rsp2 = 0;
-    tss.reserved1 = 0;
-    tss.ist1 = 0;
-    tss.ist2 = 0;
-    tss.ist3 = 0;
-    tss.ist4 = 0;
-    tss.ist5 = 0;
-    tss.ist6 = 0;
-    tss.ist7 = 0;
-    tss.reserved2 = 0;
-    tss.reserved3 = 0;
-    tss.iopb_offset = sizeof(struct tss);  /* No I/O bitmap */
+    tss->reserved0 = 0;
+    tss->rsp0 = 0;
+    tss->rsp1 = 0;
+    tss->rsp2 = 0;
+    tss->reserved1 = 0;
+    tss->ist1 = 0;
+    tss->ist2 = 0;
+    tss->ist3 = 0;
+    tss->ist4 = 0;
+    tss->ist5 = 0;
+    tss->ist6 = 0;
+    tss->ist7 = 0;
+    tss->reserved2 = 0;
+    tss->reserved3 = 0;
+    tss->iopb_offset = sizeof(struct tss);  /* No I/O bitmap */
 
     /* Entry 5-6: TSS (0x28) - 16 bytes */
-    gdt_set_tss((uint64_t)&tss, sizeof(struct tss) - 1);
+    gdt_set_tss(gdt, (uint64_t)tss, sizeof(struct tss) - 1);
 
     /* Build GDTR */
-    gdtr.limit = sizeof(gdt) - 1;
-    gdtr.base = (uint64_t)&gdt;
+    gdtr->limit = sizeof(*gdt) - 1;
+    gdtr->base = (uint64_t)gdt;
 
     /* Load GDT */
-    asm volatile("lgdt %0" : : "m"(gdtr));
+    asm volatile("lgdt %0" : : "m"(*gdtr));
 
     /*
      * Reload segment registers:
@@ -154,6 +165,12 @@ void gdt_init(void) {
     asm volatile("ltr %0" : : "r"((uint16_t)TSS_SEL));
 }
 
+struct tss *gdt_get_tss(uint32_t cpu) {
+    return &tss_table[cpu];
+}
+
 void tss_set_rsp0(uint64_t rsp0) {
-    tss.rsp0 = rsp0;
+    percpu_t *cpu = this_cpu();
+    cpu->tss->rsp0 = rsp0;
+    cpu->kernel_stack = rsp0;
 }
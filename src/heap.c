@@ -3,8 +3,9 @@
 #include "heap.h"
 #include "pmm.h"
 #include "hhdm.h"
-#include "serial.h"
+#include "printk.h"
 #include "panic.h"
+#include "spinlock.h"
 
 #define HEAP_MAGIC 0xDEADC0DE
 
@@ -24,6 +25,9 @@ typedef struct arena {
 
 static arena_t *arena_list = NULL;
 
+/* Protects the arena and block lists (kmalloc/kfree run on any CPU) */
+static spinlock_t heap_lock = SPINLOCK_INITIALIZER("heap");
+
 static void heap_memset(void *dest, uint8_t val, uint64_t count) {
     uint8_t *d = (uint8_t *)dest;
     for (uint64_t i = 0; i < count; i++) {
@@ -31,14 +35,6 @@ static void heap_memset(void *dest, uint8_t val, uint64_t count) {
     }
 }
 
-static void print_hex(uint64_t val) {
-    const char *hex = "0123456789abcdef";
-    serial_puts("0x");
-    for (int i = 60; i >= 0; i -= 4) {
-        serial_putc(hex[(val >> i) & 0xf]);
-    }
-}
-
 static arena_t *heap_expand_size(uint64_t needed_size) {
     /* Calculate how many pages we need */
     uint64_t arena_header_size = ALIGN_UP(sizeof(arena_t), HEAP_ALIGN);
@@ -77,16 +73,11 @@ static arena_t *heap_expand(void) {
 void heap_init(void) {
     arena_list = heap_expand();
 
-    serial_puts("HEAP: Initialized with arena at ");
-    print_hex((uint64_t)arena_list);
-    serial_puts("\n");
+    pr_info("HEAP: Initialized with arena at %p", (void *)arena_list);
 }
 
-void *kmalloc(uint64_t size) {
-    if (size == 0) {
-        return NULL;
-    }
-
+/* Allocate with heap_lock held */
+static void *kmalloc_locked(uint64_t size) {
     size = ALIGN_UP(size, HEAP_ALIGN);
 
     arena_t *arena = arena_list;
@@ -137,7 +128,18 @@ void *kmalloc(uint64_t size) {
     }
     arena->next = new_arena;
 
-    return kmalloc(size);
+    return kmalloc_locked(size);
+}
+
+void *kmalloc(uint64_t size) {
+    if (size == 0) {
+        return NULL;
+    }
+
+    uint64_t flags = spin_lock_irqsave(&heap_lock);
+    void *ptr = kmalloc_locked(size);
+    spin_unlock_irqrestore(&heap_lock, flags);
+    return ptr;
 }
 
 void kfree(void *ptr) {
@@ -145,6 +147,8 @@ void kfree(void *ptr) {
         return;
     }
 
+    uint64_t flags = spin_lock_irqsave(&heap_lock);
+
     block_t *block = (block_t *)((uint8_t *)ptr - sizeof(block_t));
 
     ASSERT(block->magic == HEAP_MAGIC);
@@ -171,4 +175,6 @@ void kfree(void *ptr) {
             block->next->prev = prev;
         }
     }
+
+    spin_unlock_irqrestore(&heap_lock, flags);
 }
@@ -0,0 +1,210 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "hrtimer.h"
+#include "clocksource.h"
+#include "timer.h"
+#include "panic.h"
+#include "percpu.h"
+#include "smp.h"
+#include "cpu.h"
+#include "syscall.h"
+
+/*
+ * Per-CPU timer base: a min-heap of pending timers ordered by
+ * deadline_ns. Each CPU arms its own LAPIC timer for its own root.
+ */
+struct hrtimer_base {
+    spinlock_t lock;
+    hrtimer_t *heap[HRTIMER_MAX];
+    int heap_size;
+};
+
+static hrtimer_base_t bases[SMP_MAX_CPUS] = {
+    [0 ... SMP_MAX_CPUS - 1] = { .lock = SPINLOCK_INITIALIZER("hrtimer") }
+};
+
+static inline hrtimer_base_t *local_base(void) {
+    return &bases[this_cpu()->cpu_id];
+}
+
+static void heap_set(hrtimer_base_t *base, int index, hrtimer_t *timer) {
+    base->heap[index] = timer;
+    timer->heap_index = index;
+}
+
+static void sift_up(hrtimer_base_t *base, int index) {
+    hrtimer_t *timer = base->heap[index];
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (base->heap[parent]->deadline_ns <= timer->deadline_ns) {
+            break;
+        }
+        heap_set(base, index, base->heap[parent]);
+        index = parent;
+    }
+    heap_set(base, index, timer);
+}
+
+static void sift_down(hrtimer_base_t *base, int index) {
+    hrtimer_t *timer = base->heap[index];
+    for (;;) {
+        int child = 2 * index + 1;
+        if (child >= base->heap_size) {
+            break;
+        }
+        if (child + 1 < base->heap_size &&
+            base->heap[child + 1]->deadline_ns < base->heap[child]->deadline_ns) {
+            child++;
+        }
+        if (timer->deadline_ns <= base->heap[child]->deadline_ns) {
+            break;
+        }
+        heap_set(base, index, base->heap[child]);
+        index = child;
+    }
+    heap_set(base, index, timer);
+}
+
+/* Remove the timer at index, keeping the heap ordered */
+static void heap_remove(hrtimer_base_t *base, int index) {
+    hrtimer_t *timer = base->heap[index];
+    base->heap_size--;
+
+    if (index != base->heap_size) {
+        heap_set(base, index, base->heap[base->heap_size]);
+        if (index > 0 &&
+            base->heap[index]->deadline_ns < base->heap[(index - 1) / 2]->deadline_ns) {
+            sift_up(base, index);
+        } else {
+            sift_down(base, index);
+        }
+    }
+    base->heap[base->heap_size] = NULL;
+    timer->heap_index = -1;
+    timer->base = NULL;
+}
+
+/* Arm this CPU's hardware for the heap root (or stop it). Call with IF=0. */
+static void reprogram(hrtimer_base_t *base) {
+    timer_arm(base->heap_size > 0 ? base->heap[0]->deadline_ns : 0);
+}
+
+/*
+ * Lock the base timer is queued on and return it, or NULL (nothing
+ * locked) if the timer is not pending. Call with interrupts disabled.
+ */
+static hrtimer_base_t *lock_timer_base(hrtimer_t *timer) {
+    for (;;) {
+        hrtimer_base_t *base = timer->base;
+        if (base == NULL) {
+            return NULL;
+        }
+        spin_lock(&base->lock);
+        if (timer->base == base) {
+            return base;
+        }
+        spin_unlock(&base->lock);  /* Moved meanwhile: retry */
+    }
+}
+
+void hrtimer_init(hrtimer_t *timer, void *data) {
+    timer->deadline_ns = 0;
+    timer->callback = NULL;
+    timer->data = data;
+    timer->heap_index = -1;
+    timer->base = NULL;
+}
+
+static int start_timer(hrtimer_t *timer, uint64_t deadline_ns,
+                       hrtimer_fn_t callback, int limit) {
+    ASSERT(timer != NULL && callback != NULL);
+
+    uint64_t flags = local_irq_save();
+
+    /* A pending timer is moved to this CPU's base */
+    hrtimer_base_t *old = lock_timer_base(timer);
+    if (old != NULL) {
+        heap_remove(old, timer->heap_index);
+        spin_unlock(&old->lock);
+    }
+
+    hrtimer_base_t *base = local_base();
+    spin_lock(&base->lock);
+
+    if (base->heap_size >= limit) {
+        spin_unlock(&base->lock);
+        local_irq_restore(flags);
+        return -EAGAIN;
+    }
+
+    timer->deadline_ns = deadline_ns;
+    timer->callback = callback;
+    timer->base = base;
+    heap_set(base, base->heap_size, timer);
+    base->heap_size++;
+    sift_up(base, base->heap_size - 1);
+
+    /* Only a new earliest deadline changes what the hardware waits for */
+    if (base->heap[0] == timer) {
+        reprogram(base);
+    }
+
+    spin_unlock(&base->lock);
+    local_irq_restore(flags);
+    return 0;
+}
+
+int hrtimer_start(hrtimer_t *timer, uint64_t deadline_ns, hrtimer_fn_t callback) {
+    return start_timer(timer, deadline_ns, callback, HRTIMER_MAX);
+}
+
+int hrtimer_try_start(hrtimer_t *timer, uint64_t deadline_ns, hrtimer_fn_t callback) {
+    return start_timer(timer, deadline_ns, callback, HRTIMER_MAX - HRTIMER_RESERVED);
+}
+
+int hrtimer_cancel(hrtimer_t *timer) {
+    int was_pending = 0;
+
+    uint64_t flags = local_irq_save();
+
+    hrtimer_base_t *base = lock_timer_base(timer);
+    if (base != NULL) {
+        int was_root = timer->heap_index == 0;
+        heap_remove(base, timer->heap_index);
+        /*
+         * Only the local LAPIC can be reprogrammed; another CPU just
+         * takes one early interrupt and re-arms for its new root.
+         */
+        if (was_root && base == local_base()) {
+            reprogram(base);
+        }
+        spin_unlock(&base->lock);
+        was_pending = 1;
+    }
+
+    local_irq_restore(flags);
+    return was_pending;
+}
+
+void hrtimer_run_expired(void) {
+    hrtimer_base_t *base = local_base();
+    uint64_t now = ktime_get_ns();
+
+    spin_lock(&base->lock);
+    while (base->heap_size > 0 && base->heap[0]->deadline_ns <= now) {
+        hrtimer_t *timer = base->heap[0];
+        heap_remove(base, 0);
+
+        /* Callbacks may take other locks or re-arm: run them unlocked */
+        spin_unlock(&base->lock);
+        timer->callback(timer);
+        spin_lock(&base->lock);
+    }
+
+    reprogram(base);
+    spin_unlock(&base->lock);
+}
+
+int hrtimer_pending(void) {
+    return local_base()->heap_size;
+}
@@ -1,6 +1,7 @@
 #include "idt.h"
 #include "isr.h"
 #include "serial.h"
+#include "smp.h"
 
 /* IDT with 256 entries (only first 32 used for exceptions) */
 static struct idt_entry idt[IDT_ENTRIES];
@@ -33,15 +34,29 @@ void idt_init(void) {
     /* Install IRQ handler for keyboard (vector 0x21) */
     idt_set_gate(0x21, (uint64_t)irq_stub_0x21, IDT_TYPE_INTERRUPT_GATE);
 
+    /* Install IRQ handler for COM1 (vector 0x24) */
+    idt_set_gate(0x24, (uint64_t)irq_stub_0x24, IDT_TYPE_INTERRUPT_GATE);
+
     /* Install IRQ handler for xHCI (vector 0x22) */
     idt_set_gate(0x22, (uint64_t)irq_stub_0x22, IDT_TYPE_INTERRUPT_GATE);
 
     /* Install IRQ handler for xHCI (vector 0x40) */
     idt_set_gate(0x40, (uint64_t)irq_stub_0x40, IDT_TYPE_INTERRUPT_GATE);
 
+    /* Install IRQ handler for LAPIC timer (vector 0x30) */
+    idt_set_gate(0x30, (uint64_t)irq_stub_0x30, IDT_TYPE_INTERRUPT_GATE);
+
+    /* Inter-processor interrupts (see smp.h) */
+    idt_set_gate(SMP_RESCHED_VECTOR, (uint64_t)irq_stub_0xF0, IDT_TYPE_INTERRUPT_GATE);
+    idt_set_gate(SMP_STOP_VECTOR, (uint64_t)irq_stub_0xF1, IDT_TYPE_INTERRUPT_GATE);
+
     /* Load IDT register */
     idtr.limit = sizeof(idt) - 1;
     idtr.base  = (uint64_t)&idt;
 
+    idt_load();
+}
+
+void idt_load(void) {
     asm volatile("lidt %0" : : "m"(idtr));
 }
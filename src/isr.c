@@ -3,6 +3,7 @@
 #include "serial.h"
 #include "task.h"
 #include "scheduler.h"
+#include "uring.h"
 
 /* Re-entrancy guard to prevent recursive exceptions during crash report */
 static volatile int in_handler = 0;
@@ -112,15 +113,27 @@ void isr_handler(struct interrupt_frame *frame) {
         print_hex64(frame->rip);
         serial_puts("\n");
 
-        /* Mark task as finished and yield to let scheduler pick next task */
+        /*
+         * Mark task as finished, wake a parent blocked in task_wait() and
+         * let the scheduler pick the next task. task_reap() waits for our
+         * switch away, so the parent cannot free our stack early.
+         */
+        if (t) {
+            uring_exit(t);
+        }
+        scheduler_lock();
         if (t) {
             t->state = TASK_FINISHED;
+            task_notify_exit_locked(t);
         }
-        scheduler_yield();
+        scheduler_yield_locked();
         /* Should not return, but just in case */
         return;
     }
 
+    /* Kernel fault: nothing will drain the TX ring again, so go polled */
+    serial_emergency();
+
     /* Re-entrancy guard: if we fault while handling a fault, halt immediately */
     if (in_handler) {
         serial_puts("\n!!! NESTED EXCEPTION - HALTING !!!\n");
@@ -4,6 +4,9 @@
 #include "serial.h"
 #include "console.h"
 #include "framebuffer.h"
+#include "waitqueue.h"
+#include "spinlock.h"
+#include "uring.h"
 
 /* Modifier key states */
 static int shift_left;
@@ -18,6 +21,12 @@ static char kbd_buffer[KBD_BUFFER_SIZE];
 static volatile uint32_t kbd_head;  /* Write position (IRQ context) */
 static volatile uint32_t kbd_tail;  /* Read position (consumer) */
 
+/* Protects the ring (filled from the IRQ handler and kbd_inject_string()) */
+static spinlock_t kbd_lock = SPINLOCK_INITIALIZER("kbd");
+
+/* Tasks blocked in kbd_getc_blocking() */
+static wait_queue_t kbd_wait = WAIT_QUEUE_INITIALIZER;
+
 /*
  * Scancode Set 1 - Normal (unshifted) key mappings
  * Index is scancode, value is ASCII character (0 = no char)
@@ -151,10 +160,19 @@ void kbd_process_scancode(uint8_t key, int pressed) {
 
     /* If we got a character, add to ring buffer */
     if (c != 0) {
+        int queued = 0;
+        uint64_t flags = spin_lock_irqsave(&kbd_lock);
         uint32_t next_head = (kbd_head + 1) % KBD_BUFFER_SIZE;
         if (next_head != kbd_tail) {
             kbd_buffer[kbd_head] = (char)c;
             kbd_head = next_head;
+            queued = 1;
+        }
+        spin_unlock_irqrestore(&kbd_lock, flags);
+
+        if (queued) {
+            wake_up_one(&kbd_wait);
+            uring_kbd_input();
         }
     }
 }
@@ -187,38 +205,25 @@ void kbd_handle_irq(void) {
 }
 
 int kbd_getc_nonblock(void) {
-    int c;
+    int c = -1;
+    uint64_t flags = spin_lock_irqsave(&kbd_lock);
 
-    /* Disable interrupts for atomic buffer access */
-    asm volatile("cli");
-
-    if (kbd_head == kbd_tail) {
-        /* Buffer empty */
-        asm volatile("sti");
-        return -1;
+    if (kbd_head != kbd_tail) {
+        c = kbd_buffer[kbd_tail];
+        kbd_tail = (kbd_tail + 1) % KBD_BUFFER_SIZE;
     }
 
-    c = kbd_buffer[kbd_tail];
-    kbd_tail = (kbd_tail + 1) % KBD_BUFFER_SIZE;
-
-    asm volatile("sti");
+    spin_unlock_irqrestore(&kbd_lock, flags);
     return c;
 }
 
 char kbd_getc_blocking(void) {
-    int c;
-
     for (;;) {
-        /* Enable interrupts and wait */
-        asm volatile("sti");
-        asm volatile("hlt");
-
-        /* Check buffer (with interrupts disabled) */
-        asm volatile("cli");
-        if (kbd_head != kbd_tail) {
-            c = kbd_buffer[kbd_tail];
-            kbd_tail = (kbd_tail + 1) % KBD_BUFFER_SIZE;
-            asm volatile("sti");
+        /* Sleep until the IRQ handler queues a character */
+        wait_event(&kbd_wait, kbd_head != kbd_tail);
+
+        int c = kbd_getc_nonblock();
+        if (c >= 0) {
             return (char)c;
         }
     }
@@ -335,8 +340,7 @@ void kbd_inject_string(const char *s) {
 }
 
 void kbd_reset_state(void) {
-    /* Disable interrupts for atomic state reset */
-    asm volatile("cli");
+    uint64_t flags = spin_lock_irqsave(&kbd_lock);
 
     /* Reset modifier state */
     shift_left = 0;
@@ -349,6 +353,6 @@ void kbd_reset_state(void) {
     kbd_head = 0;
     kbd_tail = 0;
 
-    asm volatile("sti");
+    spin_unlock_irqrestore(&kbd_lock, flags);
 }
 #endif /* REGTEST_BUILD */
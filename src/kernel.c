@@ -26,6 +26,17 @@
 #include "lapic.h"
 #include "shell.h"
 #include "paging.h"
+#include "acpi.h"
+#include "clocksource.h"
+#include "fpu.h"
+#include "simd.h"
+#include "smp.h"
+#include "vdso.h"
+#include "printk.h"
+#include "virtio_console.h"
+#include "trace.h"
+#include "pmu.h"
+#include "bootstat.h"
 
 #ifdef REGTEST_BUILD
 #include "regtest.h"
@@ -76,6 +87,19 @@ volatile struct limine_framebuffer_request framebuffer_request = {
     .revision = 0
 };
 
+__attribute__((used, section(".limine_requests")))
+static volatile struct limine_rsdp_request rsdp_request = {
+    .id = LIMINE_RSDP_REQUEST,
+    .revision = 0
+};
+
+__attribute__((used, section(".limine_requests")))
+static volatile struct limine_mp_request mp_request = {
+    .id = LIMINE_MP_REQUEST,
+    .revision = 0,
+    .flags = 0   /* xAPIC mode */
+};
+
 __attribute__((used, section(".limine_requests_end")))
 static volatile LIMINE_REQUESTS_END_MARKER
 
@@ -85,6 +109,8 @@ uint64_t hhdm_offset;
 struct limine_memmap_response *limine_memmap;
 struct limine_executable_address_response *limine_exec_addr;
 struct limine_module_response *limine_modules;
+struct limine_rsdp_response *limine_rsdp;
+struct limine_mp_response *limine_mp;
 
 /*
  * Find a Limine module by path suffix (e.g., "init.elf").
@@ -216,8 +242,11 @@ static void print_kernel_info(void) {
 static volatile uint64_t test_global = 0xDEADBEEF;
 
 void panic(const char *msg) {
-    /* Disable interrupts */
+    /* Disable interrupts and halt the other CPUs */
     asm volatile("cli");
+    smp_stop_others();
+    serial_emergency();
+    klog_emergency();
 
     /* Try framebuffer console first */
     console_clear();
@@ -245,8 +274,10 @@ extern void run_kernel_tests(void);
 #endif
 
 void kmain(void) {
+    bootstat_start();
     serial_init();
     serial_puts("cool-os: kernel loaded\n");
+    bootstat_mark("serial_init");
 
     /* Check if Limine base revision is supported */
     if (!LIMINE_BASE_REVISION_SUPPORTED) {
@@ -281,9 +312,15 @@ void kmain(void) {
 
     /* Initialize GDT with user segments and TSS (must be before IDT) */
     gdt_init();
+    bootstat_mark("gdt_init");
+
+    /* Per-CPU area for the BSP (GS base) */
+    smp_early_init();
+    bootstat_mark("smp_early_init");
 
     /* Initialize IDT and exception handlers */
     idt_init();
+    bootstat_mark("idt_init");
 
     /* Validate Limine memmap and exec_addr responses */
     if (memmap_request.response == NULL) {
@@ -295,31 +332,52 @@ void kmain(void) {
     limine_memmap = memmap_request.response;
     limine_exec_addr = exec_addr_request.response;
     limine_modules = module_request.response;  /* May be NULL if no modules */
+    limine_rsdp = rsdp_request.response;       /* May be NULL without ACPI */
+    limine_mp = mp_request.response;           /* May be NULL on some firmware */
 
     /* Initialize physical memory manager */
     pmm_init();
+    bootstat_mark("pmm_init");
 
     /* Initialize paging subsystem (save kernel CR3) */
     paging_init();
+    bootstat_mark("paging_init");
 
     /* Initialize heap allocator */
     heap_init();
+    bootstat_mark("heap_init");
 
     /* Initialize SYSCALL/SYSRET mechanism */
     syscall_init();
+    bootstat_mark("syscall_init");
+
+    /* Enable FPU/SSE/AVX and pick SIMD bulk memory routines */
+    fpu_init();
+    simd_init();
+    bootstat_mark("fpu_simd_init");
+
+    /* Detect the performance counters and start them on this CPU */
+    pmu_init();
+    bootstat_mark("pmu_init");
 
     /* Initialize block device, filesystem, and VFS */
     if (block_init() == 0) {
+        bootstat_mark("block_init");
         if (fat_mount() == 0) {
+            bootstat_mark("fat_mount");
             vfs_init();
+            bootstat_mark("vfs_init");
         }
     }
 
     /* Initialize framebuffer */
     if (fb_init() != 0) {
         serial_puts("fb: Initialization failed\n");
+        bootstat_mark("fb_init");
     } else {
+        bootstat_mark("fb_init");
         console_init();
+        bootstat_mark("console_init");
     }
 
     /* Test triggers (activated via -DTEST_UD or -DTEST_PF) */
@@ -334,19 +392,55 @@ void kmain(void) {
     /* Initialize PCI Bus (Experimental XHCI disabled for stability) */
     /* pci_init(); */
 
-    /* Initialize PIC, PIT, and timer subsystem */
+    /* Fast log and stdout channel, if QEMU provides a virtio-console */
+    virtio_console_init();
+    bootstat_mark("virtio_console_init");
+
+    /* Initialize PIC and PIT */
     pic_init();
     pit_init(100);
-    timer_init();
-    
+    bootstat_mark("pic_pit_init");
+
     /* Enable Local APIC for MSI support */
     lapic_init();
+    bootstat_mark("lapic_init");
+
+    /* Find ACPI tables and bring up the nanosecond clocksource */
+    acpi_init();
+    bootstat_mark("acpi_init");
+    clocksource_init();
+    bootstat_mark("clocksource_init");
+
+    /* Shared vDSO code page: getpid() and clock reads without syscalls */
+    vdso_init();
+    bootstat_mark("vdso_init");
+
+    /* Calibrate LAPIC timer and switch to one-shot mode */
+    timer_init();
+    bootstat_mark("timer_init");
 
     /* Initialize keyboard driver (after PIC so IRQ1 unmask works) */
     kbd_init();
+    bootstat_mark("kbd_init");
+
+    /* Buffered, interrupt-driven serial output from here on */
+    serial_enable_irq();
 
     /* Initialize scheduler (before enabling interrupts) */
     scheduler_init();
+    bootstat_mark("scheduler_init");
+
+    /* Hand log output to the background sink workers */
+    klog_start();
+    bootstat_mark("klog_start");
+
+    /* Start recording tracepoints */
+    trace_init();
+    bootstat_mark("trace_init");
+
+    /* Start the application processors; each idles until given work */
+    smp_init();
+    bootstat_mark("smp_init");
 
     /* Enable interrupts */
     serial_puts("cool-os: enabling interrupts\n");
@@ -354,6 +448,10 @@ void kmain(void) {
 
     /* Print kernel info to both console and serial */
     print_kernel_info();
+    bootstat_mark("print_kernel_info");
+
+    /* Boot timeline, kept for `bootstat` */
+    bootstat_done();
 
 #ifdef TEST_BUILD
     /* Run interactive tests from tests/kernel_tests.c */
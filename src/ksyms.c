@@ -0,0 +1,54 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "ksyms.h"
+
+/* Generated at link time (scripts/gen_ksyms.sh), sorted by address */
+extern const uint64_t ksym_num;
+extern const uint64_t ksym_addrs[];
+extern const uint32_t ksym_name_offsets[];
+extern const char ksym_names[];
+
+/* End of .text (linker.ld) */
+extern const char __text_end[];
+
+const char *ksym_lookup(uint64_t addr, uint64_t *start) {
+    uint64_t n = ksym_num;
+    if (n == 0 || addr < ksym_addrs[0] || addr >= (uint64_t)__text_end) {
+        return NULL;
+    }
+
+    /* Last symbol at or below addr */
+    uint64_t lo = 0, hi = n - 1;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo + 1) / 2;
+        if (ksym_addrs[mid] <= addr) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    if (start != NULL) {
+        *start = ksym_addrs[lo];
+    }
+    return &ksym_names[ksym_name_offsets[lo]];
+}
+
+uint64_t ksym_address(const char *name) {
+    for (uint64_t i = 0; i < ksym_num; i++) {
+        const char *s = &ksym_names[ksym_name_offsets[i]];
+        const char *p = name;
+        while (*s && *s == *p) {
+            s++;
+            p++;
+        }
+        if (*s == '\0' && *p == '\0') {
+            return ksym_addrs[i];
+        }
+    }
+    return 0;
+}
+
+uint64_t ksym_count(void) {
+    return ksym_num;
+}
@@ -1,22 +1,64 @@
 #include "lapic.h"
 #include "msr.h"
+#include "cpu.h"
 #include "paging.h"
 #include "serial.h"
 
 #define IA32_APIC_BASE_MSR 0x1B
 #define IA32_APIC_BASE_MSR_ENABLE 0x800
+#define LAPIC_ID  0x20
+#define LAPIC_EOI 0xB0
 #define LAPIC_SVR 0xF0
 #define LAPIC_SVR_ENABLE 0x100
 
+/* Timer registers */
+#define LAPIC_LVT_TIMER     0x320
+#define LAPIC_TIMER_INIT    0x380   /* Initial count */
+#define LAPIC_TIMER_CUR     0x390   /* Current count */
+#define LAPIC_TIMER_DIV     0x3E0   /* Divide configuration */
+
+/* Interrupt command register */
+#define LAPIC_ICR_LOW       0x300
+#define LAPIC_ICR_HIGH      0x310
+#define LAPIC_ICR_PENDING   (1 << 12)   /* Delivery status: send pending */
+#define LAPIC_ICR_ASSERT    (1 << 14)
+#define LAPIC_ICR_ALL_BUT_SELF (3 << 18)
+
+#define LAPIC_LVT_MASKED        (1 << 16)
+#define LAPIC_TIMER_ONESHOT     (0 << 17)
+#define LAPIC_TIMER_TSC_DEADLINE (2 << 17)
+#define LAPIC_TIMER_DIV_16      0x3
+
+/* CPUID.01H:ECX bit 24 - TSC-deadline timer supported */
+#define CPUID_1_ECX_TSC_DEADLINE (1U << 24)
+
+/* Calibration window */
+#define LAPIC_CALIBRATE_MS 10
+
+#define LAPIC_VIRT 0xFFFFFFFFFEE00000ULL
+
 static uint64_t lapic_base;
 
+/* Timer state */
+static int use_tsc_deadline = 0;
+static uint64_t timer_tsc_khz = 0;
+static uint64_t timer_lapic_khz = 0;  /* LAPIC timer counts per ms (after divide) */
+
+static inline uint32_t lapic_read(uint32_t reg) {
+    return *(volatile uint32_t *)(LAPIC_VIRT + reg);
+}
+
+static inline void lapic_write(uint32_t reg, uint32_t value) {
+    *(volatile uint32_t *)(LAPIC_VIRT + reg) = value;
+}
+
 void lapic_init(void) {
     uint64_t apic_base_msr = rdmsr(IA32_APIC_BASE_MSR);
     lapic_base = apic_base_msr & 0xFFFFF000;
     
     /* Map LAPIC (4KB) */
     /* We map it to a high virtual address */
-    uint64_t lapic_virt = 0xFFFFFFFFFEE00000;
+    uint64_t lapic_virt = LAPIC_VIRT;
     paging_map_page(lapic_virt, lapic_base, PTE_PRESENT | PTE_WRITABLE | PTE_CACHE_DIS);
     
     serial_puts("LAPIC: Base (Phys) = ");
@@ -36,3 +78,129 @@ void lapic_init(void) {
     serial_print_hex(apic_id);
     serial_puts("\n");
 }
+
+void lapic_eoi(void) {
+    lapic_write(LAPIC_EOI, 0);
+}
+
+uint32_t lapic_id(void) {
+    return lapic_read(LAPIC_ID) >> 24;
+}
+
+/* Program LVT Timer for the mode chosen by lapic_timer_init() */
+static void timer_set_lvt(void) {
+    if (use_tsc_deadline) {
+        lapic_write(LAPIC_LVT_TIMER, LAPIC_TIMER_TSC_DEADLINE | LAPIC_TIMER_VECTOR);
+        /*
+         * xAPIC: the MMIO write that selects TSC-deadline mode must be
+         * ordered before the first IA32_TSC_DEADLINE wrmsr (which is not
+         * serializing), or the deadline may be dropped (SDM 10.5.4.1).
+         */
+        asm volatile("mfence" ::: "memory");
+    } else {
+        lapic_write(LAPIC_LVT_TIMER, LAPIC_TIMER_ONESHOT | LAPIC_TIMER_VECTOR);
+    }
+}
+
+void lapic_init_ap(void) {
+    /* Same MMIO window as the BSP: each CPU sees its own LAPIC there */
+    lapic_write(LAPIC_SVR, lapic_read(LAPIC_SVR) | LAPIC_SVR_ENABLE | 0xFF);
+
+    /* Reuse the BSP's calibration; every LAPIC runs off the same clock */
+    if (timer_lapic_khz != 0) {
+        lapic_write(LAPIC_TIMER_DIV, LAPIC_TIMER_DIV_16);
+        timer_set_lvt();
+    }
+}
+
+static void icr_wait(void) {
+    while (lapic_read(LAPIC_ICR_LOW) & LAPIC_ICR_PENDING) {
+        asm volatile("pause");
+    }
+}
+
+void lapic_send_ipi(uint32_t apic_id, uint8_t vector) {
+    uint64_t flags = local_irq_save();
+
+    icr_wait();
+    lapic_write(LAPIC_ICR_HIGH, apic_id << 24);
+    lapic_write(LAPIC_ICR_LOW, LAPIC_ICR_ASSERT | vector);  /* Fixed, physical */
+
+    local_irq_restore(flags);
+}
+
+void lapic_send_ipi_others(uint8_t vector) {
+    uint64_t flags = local_irq_save();
+
+    icr_wait();
+    lapic_write(LAPIC_ICR_LOW, LAPIC_ICR_ALL_BUT_SELF | LAPIC_ICR_ASSERT | vector);
+
+    local_irq_restore(flags);
+}
+
+int lapic_timer_init(uint64_t tsc_khz) {
+    if (tsc_khz == 0) {
+        return -1;
+    }
+    timer_tsc_khz = tsc_khz;
+
+    /*
+     * Measure the LAPIC timer rate against the (already calibrated) TSC:
+     * run a masked one-shot countdown from the maximum count for a fixed
+     * TSC interval and see how far it got.
+     */
+    lapic_write(LAPIC_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_TIMER_ONESHOT | LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_TIMER_INIT, 0xFFFFFFFF);
+
+    uint64_t end = rdtsc() + tsc_khz * LAPIC_CALIBRATE_MS;
+    while (rdtsc() < end) {
+        asm volatile("pause");
+    }
+
+    uint32_t elapsed = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CUR);
+    lapic_write(LAPIC_TIMER_INIT, 0);
+    timer_lapic_khz = elapsed / LAPIC_CALIBRATE_MS;
+
+    if (timer_lapic_khz == 0) {
+        serial_puts("LAPIC: Timer calibration failed\n");
+        return -1;
+    }
+
+    uint32_t a, b, c, d;
+    cpuid(1, 0, &a, &b, &c, &d);
+    use_tsc_deadline = (c & CPUID_1_ECX_TSC_DEADLINE) != 0;
+    timer_set_lvt();
+
+    serial_puts("LAPIC: Timer ");
+    serial_puts(use_tsc_deadline ? "TSC-deadline" : "one-shot");
+    serial_puts(" mode, ");
+    serial_print_dec(timer_lapic_khz);
+    serial_puts(" counts/ms\n");
+    return 0;
+}
+
+void lapic_timer_oneshot(uint64_t delta_ns) {
+    if (use_tsc_deadline) {
+        wrmsr(MSR_IA32_TSC_DEADLINE, rdtsc() + (delta_ns * timer_tsc_khz) / 1000000);
+        return;
+    }
+
+    /* counts/ms == counts per 10^6 ns */
+    uint64_t count = (delta_ns * timer_lapic_khz) / 1000000;
+    if (count == 0) count = 1;
+    if (count > 0xFFFFFFFF) count = 0xFFFFFFFF;
+    lapic_write(LAPIC_TIMER_INIT, (uint32_t)count);
+}
+
+void lapic_timer_stop(void) {
+    if (use_tsc_deadline) {
+        wrmsr(MSR_IA32_TSC_DEADLINE, 0);
+    } else {
+        lapic_write(LAPIC_TIMER_INIT, 0);
+    }
+}
+
+int lapic_timer_tsc_deadline(void) {
+    return use_tsc_deadline;
+}
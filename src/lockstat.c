@@ -0,0 +1,207 @@
+#include <stddef.h>
+#include "lockstat.h"
+
+#ifdef LOCK_STATS
+
+#include "atomic.h"
+#include "cpu.h"
+#include "serial.h"
+#include "console.h"
+
+/* Every lock that has been taken at least once and not unregistered */
+static struct lock_stats *registry = NULL;
+
+/*
+ * Guards the registry list. A bare test-and-set flag rather than a
+ * spinlock_t, which would register itself from inside the registry.
+ * Nothing that can take another lock runs while it is held.
+ */
+static volatile uint32_t registry_busy = 0;
+
+static uint64_t registry_lock(void) {
+    uint64_t flags = local_irq_save();
+    while (__atomic_exchange_n(&registry_busy, 1, __ATOMIC_ACQUIRE)) {
+        cpu_relax();
+    }
+    return flags;
+}
+
+static void registry_unlock(uint64_t flags) {
+    __atomic_store_n(&registry_busy, 0, __ATOMIC_RELEASE);
+    local_irq_restore(flags);
+}
+
+static void lockstat_register(struct lock_stats *stats) {
+    uint64_t flags = registry_lock();
+    if (!stats->registered) {
+        stats->next = registry;
+        registry = stats;
+        stats->registered = 1;
+    }
+    registry_unlock(flags);
+}
+
+void lockstat_unregister(struct lock_stats *stats) {
+    uint64_t flags = registry_lock();
+    if (stats->registered) {
+        struct lock_stats **link = &registry;
+        while (*link != NULL && *link != stats) {
+            link = &(*link)->next;
+        }
+        if (*link != NULL) {
+            *link = stats->next;
+        }
+        stats->registered = 0;
+        stats->next = NULL;
+    }
+    registry_unlock(flags);
+}
+
+static void clear_counters(struct lock_stats *stats) {
+    stats->acquisitions = 0;
+    stats->contended = 0;
+    stats->wait_cycles = 0;
+    stats->hold_cycles = 0;
+    stats->max_hold_cycles = 0;
+}
+
+void lockstat_init(struct lock_stats *stats, const char *name) {
+    stats->name = name;
+    stats->next = NULL;
+    stats->registered = 0;
+    stats->acquired_at = 0;
+    clear_counters(stats);
+}
+
+void lockstat_acquired(struct lock_stats *stats, uint64_t wait_start) {
+    uint64_t now = rdtsc();
+
+    if (!stats->registered) {
+        lockstat_register(stats);
+    }
+    stats->acquisitions++;
+    if (wait_start != 0) {
+        stats->contended++;
+        stats->wait_cycles += now - wait_start;
+    }
+    stats->acquired_at = now;
+}
+
+void lockstat_released(struct lock_stats *stats) {
+    uint64_t held = rdtsc() - stats->acquired_at;
+
+    stats->hold_cycles += held;
+    if (held > stats->max_hold_cycles) {
+        stats->max_hold_cycles = held;
+    }
+}
+
+static int name_eq(const char *a, const char *b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+struct lock_stats *lockstat_find(const char *name) {
+    uint64_t flags = registry_lock();
+    struct lock_stats *s = registry;
+    while (s != NULL && (s->name == NULL || !name_eq(s->name, name))) {
+        s = s->next;
+    }
+    registry_unlock(flags);
+    return s;
+}
+
+static void out_puts(const char *s) {
+    serial_puts(s);
+    console_puts(s);
+}
+
+static void out_dec(uint64_t val) {
+    serial_print_dec(val);
+    console_print_dec(val);
+}
+
+/* Rows copied out of the registry per pass of lockstat_dump() */
+#define DUMP_BATCH 8
+
+struct dump_row {
+    const char *name;
+    uint64_t values[5];
+};
+
+/*
+ * Copy up to DUMP_BATCH rows, starting at the skip'th registered lock.
+ * Printing takes the console and serial locks, so it cannot be done
+ * with the registry held.
+ */
+static int copy_rows(int skip, struct dump_row *rows) {
+    int n = 0;
+    uint64_t flags = registry_lock();
+    struct lock_stats *s = registry;
+    for (; s != NULL && skip > 0; s = s->next) {
+        skip--;
+    }
+    for (; s != NULL && n < DUMP_BATCH; s = s->next, n++) {
+        uint64_t acq = s->acquisitions;
+        uint64_t contended = s->contended;
+        rows[n].name = s->name ? s->name : "?";
+        rows[n].values[0] = acq;
+        rows[n].values[1] = contended;
+        rows[n].values[2] = contended ? s->wait_cycles / contended : 0;
+        rows[n].values[3] = acq ? s->hold_cycles / acq : 0;
+        rows[n].values[4] = s->max_hold_cycles;
+    }
+    registry_unlock(flags);
+    return n;
+}
+
+static void dump_row(const struct dump_row *row) {
+    const char *name = row->name;
+    out_puts(name);
+    int len = 0;
+    while (name[len]) len++;
+    for (; len < 14; len++) out_puts(" ");
+
+    for (int i = 0; i < 5; i++) {
+        out_dec(row->values[i]);
+        if (i < 4) {
+            /* Pad to an 11-column field */
+            int digits = 1;
+            for (uint64_t v = row->values[i]; v >= 10; v /= 10) digits++;
+            for (; digits < 11; digits++) out_puts(" ");
+        }
+    }
+    out_puts("\n");
+}
+
+/*
+ * Counters are read without the locks themselves, so a line may be
+ * slightly stale, and a lock registered or dropped between batches may
+ * be missed or shown twice.
+ */
+void lockstat_dump(void) {
+    out_puts("lock          acq        contended  avg_wait   avg_hold   max_hold\n");
+    struct dump_row rows[DUMP_BATCH];
+    int skip = 0;
+    int n;
+    do {
+        n = copy_rows(skip, rows);
+        for (int i = 0; i < n; i++) {
+            dump_row(&rows[i]);
+        }
+        skip += n;
+    } while (n == DUMP_BATCH);
+}
+
+void lockstat_reset(void) {
+    uint64_t flags = registry_lock();
+    for (struct lock_stats *s = registry; s != NULL; s = s->next) {
+        clear_counters(s);
+    }
+    registry_unlock(flags);
+}
+
+#endif /* LOCK_STATS */
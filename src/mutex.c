@@ -0,0 +1,75 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "mutex.h"
+#include "percpu.h"
+#include "panic.h"
+#include "cpu.h"
+
+/* Stands in for the owner before the scheduler has a current task */
+#define MUTEX_BOOT_OWNER ((task_t *)1)
+
+static inline task_t *owner_token(void) {
+    task_t *self = current_task;
+    return self != NULL ? self : MUTEX_BOOT_OWNER;
+}
+
+static inline int try_acquire(mutex_t *m, task_t *self) {
+    task_t *expected = NULL;
+    return __atomic_compare_exchange_n(&m->owner, &expected, self, 0,
+                                       __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+void mutex_init(mutex_t *m, const char *name) {
+    m->owner = NULL;
+    wait_queue_init(&m->wait);
+#ifdef LOCK_STATS
+    lockstat_init(&m->stats, name);
+#else
+    (void)name;
+#endif
+}
+
+void mutex_lock(mutex_t *m) {
+    task_t *self = owner_token();
+    uint64_t wait_start = 0;
+
+    if (!try_acquire(m, self)) {
+        ASSERT(m->owner != self || self == MUTEX_BOOT_OWNER);
+#ifdef LOCK_STATS
+        wait_start = rdtsc();
+#endif
+        /* The CAS takes no scheduler lock, so it is a valid condition */
+        wait_event(&m->wait, try_acquire(m, self));
+    }
+
+#ifdef LOCK_STATS
+    lockstat_acquired(&m->stats, wait_start);
+#else
+    (void)wait_start;
+#endif
+}
+
+int mutex_trylock(mutex_t *m) {
+    if (!try_acquire(m, owner_token())) {
+        return 0;
+    }
+#ifdef LOCK_STATS
+    lockstat_acquired(&m->stats, 0);
+#endif
+    return 1;
+}
+
+void mutex_unlock(mutex_t *m) {
+    ASSERT(m->owner != NULL);
+#ifdef LOCK_STATS
+    lockstat_released(&m->stats);
+#endif
+    __atomic_store_n(&m->owner, NULL, __ATOMIC_RELEASE);
+
+    /*
+     * A waiter checks the owner and enqueues itself under the scheduler
+     * lock, which wake_up_one() also takes, so it is either already on
+     * the queue here or will see the mutex free.
+     */
+    wake_up_one(&m->wait);
+}
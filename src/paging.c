@@ -4,6 +4,7 @@
 #include "hhdm.h"
 #include "pmm.h"
 #include "serial.h"
+#include "simd.h"
 
 /*
  * Page table structure for x86-64 4-level paging:
@@ -52,9 +53,7 @@ static uint64_t *alloc_page_table(void) {
     }
     uint64_t *virt = (uint64_t *)phys_to_hhdm(phys);
     /* Zero the page */
-    for (int i = 0; i < 512; i++) {
-        virt[i] = 0;
-    }
+    simd_zero_page(virt);
     return virt;
 }
 
@@ -195,7 +194,7 @@ void paging_free_user_pages(uint64_t *pml4) {
 
                 /* Free all leaf pages in this page table */
                 for (int pt_idx = 0; pt_idx < 512; pt_idx++) {
-                    if (pt[pt_idx] & PTE_PRESENT) {
+                    if ((pt[pt_idx] & PTE_PRESENT) && !(pt[pt_idx] & PTE_SHARED)) {
                         uint64_t page_phys = pt[pt_idx] & PTE_ADDR_MASK;
                         pmm_free_frame(page_phys);
                     }
@@ -217,6 +216,23 @@ void paging_free_user_pages(uint64_t *pml4) {
     }
 }
 
+uint64_t paging_get_pte_in(uint64_t *pml4, uint64_t vaddr) {
+    uint64_t entry = pml4[PML4_INDEX(vaddr)];
+    if (!(entry & PTE_PRESENT)) return 0;
+
+    uint64_t *pdpt = (uint64_t *)phys_to_hhdm(entry & PTE_ADDR_MASK);
+    entry = pdpt[PDPT_INDEX(vaddr)];
+    if (!(entry & PTE_PRESENT) || (entry & PTE_HUGE)) return 0;
+
+    uint64_t *pd = (uint64_t *)phys_to_hhdm(entry & PTE_ADDR_MASK);
+    entry = pd[PD_INDEX(vaddr)];
+    if (!(entry & PTE_PRESENT) || (entry & PTE_HUGE)) return 0;
+
+    uint64_t *pt = (uint64_t *)phys_to_hhdm(entry & PTE_ADDR_MASK);
+    entry = pt[PT_INDEX(vaddr)];
+    return (entry & PTE_PRESENT) ? entry : 0;
+}
+
 void paging_flush_tlb(uint64_t vaddr) {
     asm volatile("invlpg (%0)" : : "r"(vaddr) : "memory");
 }
@@ -142,6 +142,35 @@ static void pci_check_function(uint8_t bus, uint8_t device, uint8_t function) {
     }
 }
 
+int pci_find_device(uint16_t vendor_id, uint16_t device_id, pci_device_t *out) {
+    for (uint16_t bus = 0; bus < 256; bus++) {
+        for (uint8_t dev = 0; dev < 32; dev++) {
+            if (pci_read_config_16(bus, dev, 0, PCI_OFFSET_VENDOR_ID) == 0xFFFF) continue;
+
+            uint8_t header_type = (uint8_t)(pci_read_config_32(bus, dev, 0, PCI_OFFSET_HEADER_TYPE) >> 16);
+            uint8_t funcs = (header_type & 0x80) ? 8 : 1;
+            for (uint8_t func = 0; func < funcs; func++) {
+                if (pci_read_config_16(bus, dev, func, PCI_OFFSET_VENDOR_ID) != vendor_id ||
+                    pci_read_config_16(bus, dev, func, PCI_OFFSET_DEVICE_ID) != device_id) {
+                    continue;
+                }
+                uint32_t class_reg = pci_read_config_32(bus, dev, func, 0x08);
+                out->bus = (uint8_t)bus;
+                out->device = dev;
+                out->function = func;
+                out->vendor_id = vendor_id;
+                out->device_id = device_id;
+                out->class_id = (uint8_t)(class_reg >> 24);
+                out->subclass_id = (uint8_t)(class_reg >> 16);
+                out->prog_if = (uint8_t)(class_reg >> 8);
+                out->header_type = header_type;
+                return 0;
+            }
+        }
+    }
+    return -1;
+}
+
 void pci_init(void) {
     serial_puts("PCI: Enumerating bus...\n");
 
@@ -3,7 +3,9 @@
 #include "serial.h"
 
 #define PIT_CHANNEL0  0x40
+#define PIT_CHANNEL2  0x42
 #define PIT_COMMAND   0x43
+#define PIT_GATE      0x61  /* Bit 0: channel 2 gate, bit 1: speaker, bit 5: OUT2 */
 
 /*
  * Command byte for channel 0, mode 3 (square wave), lo/hi byte access
@@ -14,6 +16,9 @@
  */
 #define PIT_CMD_CHANNEL0_MODE3  0x36
 
+/* Channel 2, lo/hi byte access, mode 0 (interrupt on terminal count) */
+#define PIT_CMD_CHANNEL2_MODE0  0xB0
+
 static volatile uint64_t ticks = 0;
 
 void pit_init(uint32_t hz) {
@@ -45,3 +50,25 @@ uint64_t pit_get_ticks(void) {
 void pit_tick(void) {
     ticks++;
 }
+
+void pit_wait_us(uint32_t us) {
+    uint32_t count = (uint32_t)(((uint64_t)PIT_FREQ * us) / 1000000);
+    if (count > 65535) {
+        count = 65535;
+    }
+    if (count < 1) {
+        count = 1;
+    }
+
+    /* Gate channel 2 on, speaker off */
+    outb(PIT_GATE, (inb(PIT_GATE) & ~0x02) | 0x01);
+
+    /* Loading the count starts the countdown; OUT2 goes high at zero */
+    outb(PIT_COMMAND, PIT_CMD_CHANNEL2_MODE0);
+    outb(PIT_CHANNEL2, (uint8_t)(count & 0xFF));
+    outb(PIT_CHANNEL2, (uint8_t)((count >> 8) & 0xFF));
+
+    while ((inb(PIT_GATE) & 0x20) == 0) {
+        asm volatile("pause");
+    }
+}
@@ -6,6 +6,7 @@
 #include "serial.h"
 #include "panic.h"
 #include "hhdm.h"
+#include "spinlock.h"
 
 /* Global Limine response pointers (set by kernel.c) */
 extern struct limine_memmap_response *limine_memmap;
@@ -19,6 +20,9 @@ static uint64_t pmm_free_frames; /* Current free frame count */
 static uint64_t pmm_max_phys_addr; /* Highest physical address */
 static uint64_t pmm_bitmap_phys; /* Physical address of bitmap */
 
+/* Protects the bitmap and free count (frames are allocated from any CPU) */
+static spinlock_t pmm_lock = SPINLOCK_INITIALIZER("pmm");
+
 /* Freestanding memset */
 static void pmm_memset(void *dest, uint8_t val, uint64_t count) {
     uint8_t *d = (uint8_t *)dest;
@@ -134,16 +138,20 @@ void pmm_init(void) {
 }
 
 uint64_t pmm_alloc_frame(void) {
+    uint64_t flags = spin_lock_irqsave(&pmm_lock);
+
     /* Linear search for first free frame */
     for (uint64_t frame = 0; frame < pmm_frame_count; frame++) {
         if (!bitmap_test(frame)) {
             bitmap_set(frame);
             pmm_free_frames--;
+            spin_unlock_irqrestore(&pmm_lock, flags);
             uint64_t phys_addr = frame * PAGE_SIZE;
             ASSERT(IS_PAGE_ALIGNED(phys_addr));
             return phys_addr;
         }
     }
+    spin_unlock_irqrestore(&pmm_lock, flags);
     panic("PMM: Out of memory!");
     return 0; /* Unreachable */
 }
@@ -156,6 +164,8 @@ uint64_t pmm_alloc_frames_contiguous(uint64_t count) {
     uint64_t run_start = 0;
     uint64_t run_length = 0;
 
+    uint64_t flags = spin_lock_irqsave(&pmm_lock);
+
     for (uint64_t frame = 0; frame < pmm_frame_count; frame++) {
         if (!bitmap_test(frame)) {
             if (run_length == 0) {
@@ -168,6 +178,7 @@ uint64_t pmm_alloc_frames_contiguous(uint64_t count) {
                     bitmap_set(run_start + i);
                     pmm_free_frames--;
                 }
+                spin_unlock_irqrestore(&pmm_lock, flags);
                 uint64_t phys_addr = run_start * PAGE_SIZE;
                 ASSERT(IS_PAGE_ALIGNED(phys_addr));
                 return phys_addr;
@@ -178,6 +189,8 @@ uint64_t pmm_alloc_frames_contiguous(uint64_t count) {
         }
     }
 
+    spin_unlock_irqrestore(&pmm_lock, flags);
+
     /* No contiguous region found */
     return 0;
 }
@@ -186,9 +199,12 @@ void pmm_free_frame(uint64_t phys_addr) {
     ASSERT(IS_PAGE_ALIGNED(phys_addr));
     uint64_t frame = phys_addr / PAGE_SIZE;
     ASSERT(frame < pmm_frame_count);
+
+    uint64_t flags = spin_lock_irqsave(&pmm_lock);
     ASSERT(bitmap_test(frame)); /* Double-free detection */
     bitmap_clear(frame);
     pmm_free_frames++;
+    spin_unlock_irqrestore(&pmm_lock, flags);
 }
 
 uint64_t pmm_get_free_frames(void) {
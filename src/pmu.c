@@ -0,0 +1,223 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "pmu.h"
+#include "msr.h"
+#include "cpu.h"
+#include "task.h"
+#include "percpu.h"
+#include "syscall.h"
+#include "printk.h"
+
+/* CPUID leaf 0xA fields */
+#define CPUID_A_EAX_VERSION(a)      ((a) & 0xff)
+#define CPUID_A_EAX_NUM_GP(a)       (((a) >> 8) & 0xff)
+#define CPUID_A_EAX_GP_WIDTH(a)     (((a) >> 16) & 0xff)
+#define CPUID_A_EAX_EBX_LEN(a)      (((a) >> 24) & 0xff)
+#define CPUID_A_EDX_NUM_FIXED(d)    ((d) & 0x1f)
+#define CPUID_A_EDX_FIXED_WIDTH(d)  (((d) >> 5) & 0xff)
+
+/* rdpmc selector bit for the fixed-function counters */
+#define RDPMC_FIXED                 (1u << 30)
+
+#define PMU_MAX_GP                  8
+#define PMU_MAX_FIXED               3
+
+/* Architectural event encodings: event select | unit mask << 8 */
+static const struct {
+    const char *name;
+    uint16_t evtsel;
+    int8_t fixed;           /* Fixed counter that counts it, or -1 */
+} pmu_events[PERF_COUNT_MAX] = {
+    [PERF_COUNT_CYCLES]         = { "cycles",        0x003C,  1 },
+    [PERF_COUNT_INSTRUCTIONS]   = { "instructions",  0x00C0,  0 },
+    [PERF_COUNT_REF_CYCLES]     = { "ref-cycles",    0x013C,  2 },
+    [PERF_COUNT_LLC_REFERENCES] = { "llc-refs",      0x4F2E, -1 },
+    [PERF_COUNT_LLC_MISSES]     = { "llc-misses",    0x412E, -1 },
+    [PERF_COUNT_BRANCHES]       = { "branches",      0x00C4, -1 },
+    [PERF_COUNT_BRANCH_MISSES]  = { "branch-misses", 0x00C5, -1 },
+};
+
+/* Layout chosen by pmu_init(), applied identically on every CPU */
+static struct {
+    int version;
+    uint32_t ngp;                       /* General-purpose counters in use */
+    uint16_t gp_event[PMU_MAX_GP];      /* Event select per GP counter */
+    uint32_t nfixed;                    /* Fixed counters in use */
+    uint32_t selector[PERF_COUNT_MAX];  /* rdpmc selector per event */
+    uint64_t mask[PERF_COUNT_MAX];      /* Counter width, 0 = unsupported */
+} pmu;
+
+void pmu_init_cpu(void) {
+    if (pmu.version == 0) {
+        return;
+    }
+
+    uint64_t global = 0;
+    if (pmu.version >= 2) {
+        wrmsr(MSR_IA32_PERF_GLOBAL_CTRL, 0);
+    }
+
+    for (uint32_t i = 0; i < pmu.ngp; i++) {
+        wrmsr(MSR_IA32_PERFEVTSEL0 + i, 0);
+        wrmsr(MSR_IA32_PMC0 + i, 0);
+        wrmsr(MSR_IA32_PERFEVTSEL0 + i,
+              pmu.gp_event[i] | PERFEVTSEL_USR | PERFEVTSEL_OS | PERFEVTSEL_EN);
+        global |= 1ULL << i;
+    }
+
+    if (pmu.nfixed > 0) {
+        uint64_t ctrl = 0;
+        for (uint32_t i = 0; i < pmu.nfixed; i++) {
+            wrmsr(MSR_IA32_FIXED_CTR0 + i, 0);
+            ctrl |= (uint64_t)(FIXED_CTR_CTRL_OS | FIXED_CTR_CTRL_USR) << (4 * i);
+            global |= 1ULL << (32 + i);
+        }
+        wrmsr(MSR_IA32_FIXED_CTR_CTRL, ctrl);
+    }
+
+    if (pmu.version >= 2) {
+        wrmsr(MSR_IA32_PERF_GLOBAL_CTRL, global);
+    }
+}
+
+void pmu_init(void) {
+    uint32_t a, b, c, d;
+    cpuid(0, 0, &a, &b, &c, &d);
+    if (a < 0xA) {
+        pr_info("PMU: none");
+        return;
+    }
+    cpuid(0xA, 0, &a, &b, &c, &d);
+    int version = CPUID_A_EAX_VERSION(a);
+    uint32_t num_gp = CPUID_A_EAX_NUM_GP(a);
+    if (version == 0 || (num_gp == 0 && version < 2)) {
+        pr_info("PMU: none");
+        return;
+    }
+
+    /* EBX bit n set: architectural event n cannot be counted */
+    uint32_t ebx_len = CPUID_A_EAX_EBX_LEN(a);
+    uint32_t missing = b | (ebx_len < 32 ? ~0u << ebx_len : 0);
+    uint64_t gp_mask = CPUID_A_EAX_GP_WIDTH(a) >= 64 ? ~0ULL
+                     : (1ULL << CPUID_A_EAX_GP_WIDTH(a)) - 1;
+
+    uint32_t num_fixed = 0;
+    uint64_t fixed_mask = 0;
+    if (version >= 2) {
+        num_fixed = CPUID_A_EDX_NUM_FIXED(d);
+        fixed_mask = CPUID_A_EDX_FIXED_WIDTH(d) >= 64 ? ~0ULL
+                   : (1ULL << CPUID_A_EDX_FIXED_WIDTH(d)) - 1;
+        if (num_fixed > PMU_MAX_FIXED) {
+            num_fixed = PMU_MAX_FIXED;
+        }
+    }
+    if (num_gp > PMU_MAX_GP) {
+        num_gp = PMU_MAX_GP;
+    }
+
+    pmu.version = version;
+    for (int e = 0; e < PERF_COUNT_MAX; e++) {
+        int fixed = pmu_events[e].fixed;
+        if (fixed >= 0 && (uint32_t)fixed < num_fixed) {
+            pmu.selector[e] = RDPMC_FIXED | (uint32_t)fixed;
+            pmu.mask[e] = fixed_mask;
+            if ((uint32_t)fixed + 1 > pmu.nfixed) {
+                pmu.nfixed = (uint32_t)fixed + 1;
+            }
+        } else if (!(missing & (1u << e)) && pmu.ngp < num_gp) {
+            pmu.selector[e] = pmu.ngp;
+            pmu.mask[e] = gp_mask;
+            pmu.gp_event[pmu.ngp++] = pmu_events[e].evtsel;
+        }
+    }
+
+    pmu_init_cpu();
+    pr_info("PMU: version %d, %u general-purpose and %u fixed counters in use",
+            version, pmu.ngp, pmu.nfixed);
+}
+
+int pmu_version(void) {
+    return pmu.version;
+}
+
+int pmu_event_supported(int event) {
+    return event >= 0 && event < PERF_COUNT_MAX && pmu.mask[event] != 0;
+}
+
+const char *pmu_event_name(int event) {
+    if (event < 0 || event >= PERF_COUNT_MAX) {
+        return NULL;
+    }
+    return pmu_events[event].name;
+}
+
+uint64_t pmu_read(int event) {
+    if (!pmu_event_supported(event)) {
+        return 0;
+    }
+    return rdpmc(pmu.selector[event]);
+}
+
+uint64_t pmu_delta(int event, uint64_t from, uint64_t to) {
+    if (!pmu_event_supported(event)) {
+        return 0;
+    }
+    return (to - from) & pmu.mask[event];
+}
+
+/* Snapshot every counter into base (interrupts off) */
+static void pmu_load_bases(struct pmu_task_state *st) {
+    for (int e = 0; e < PERF_COUNT_MAX; e++) {
+        if (pmu.mask[e] != 0) {
+            st->base[e] = rdpmc(pmu.selector[e]);
+        }
+    }
+}
+
+/* Charge what the counters advanced since the bases (interrupts off) */
+static void pmu_charge(struct pmu_task_state *st) {
+    for (int e = 0; e < PERF_COUNT_MAX; e++) {
+        if (pmu.mask[e] != 0) {
+            uint64_t now = rdpmc(pmu.selector[e]);
+            st->count[e] += (now - st->base[e]) & pmu.mask[e];
+            st->base[e] = now;
+        }
+    }
+}
+
+int64_t pmu_task_read(int event) {
+    if (pmu.version == 0) {
+        return -ENODEV;
+    }
+    if (event < 0 || event >= PERF_COUNT_MAX) {
+        return -EINVAL;
+    }
+    if (pmu.mask[event] == 0) {
+        return -ENOENT;
+    }
+
+    uint64_t flags = local_irq_save();
+    struct pmu_task_state *st = &current_task->perf;
+    if (!st->enabled) {
+        for (int e = 0; e < PERF_COUNT_MAX; e++) {
+            st->count[e] = 0;
+        }
+        pmu_load_bases(st);
+        st->enabled = 1;
+    } else {
+        pmu_charge(st);
+    }
+    uint64_t count = st->count[event];
+    local_irq_restore(flags);
+
+    return (int64_t)count;
+}
+
+void pmu_switch(struct task *old, struct task *next) {
+    if (old->perf.enabled) {
+        pmu_charge(&old->perf);
+    }
+    if (next->perf.enabled) {
+        pmu_load_bases(&next->perf);
+    }
+}
@@ -0,0 +1,412 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include "printk.h"
+#include "atomic.h"
+#include "spinlock.h"
+#include "cpu.h"
+#include "clocksource.h"
+#include "hrtimer.h"
+#include "task.h"
+#include "scheduler.h"
+#include "waitqueue.h"
+#include "serial.h"
+#include "console.h"
+#include "virtio_console.h"
+
+/*
+ * Record states. A producer reserves sequence number seq with one
+ * fetch-add, marks the slot BUSY(seq), fills it in and publishes it as
+ * DONE(seq). States only grow, so a reader expecting seq that finds a
+ * larger one knows the slot was reused by a later message.
+ */
+#define DONE(seq) (((seq) + 1) << 1)
+#define BUSY(seq) (DONE(seq) | 1)
+
+static struct klog_record klog_ring[KLOG_RECORDS];
+static atomic64_t klog_next = ATOMIC_INIT(0);
+
+/* TSC at the first message; timestamps count from here */
+static uint64_t klog_tsc_base = 0;
+
+/* A consumer of the log with its own read position */
+typedef struct klog_sink {
+    uint64_t seq;
+    int max_level;
+    void (*write)(const char *line, uint64_t len);
+    int (*ready)(void);         /* NULL if always usable; else records wait for it */
+    spinlock_t lock;            /* Held while draining, so lines stay in order */
+    wait_queue_t wait;          /* Its worker, sleeping until records arrive */
+} klog_sink_t;
+
+static void serial_sink_write(const char *line, uint64_t len) {
+    serial_write(line, len);
+}
+
+static void console_sink_write(const char *line, uint64_t len) {
+    (void)len;
+    console_puts(line);
+}
+
+static klog_sink_t sinks[] = {
+    { 0, LOG_DEBUG, serial_sink_write, NULL,
+      SPINLOCK_INITIALIZER("klog_serial"), WAIT_QUEUE_INITIALIZER },
+    { 0, LOG_LEVEL_CONSOLE, console_sink_write, NULL,
+      SPINLOCK_INITIALIZER("klog_console"), WAIT_QUEUE_INITIALIZER },
+    { 0, LOG_DEBUG, virtio_console_write, virtio_console_present,
+      SPINLOCK_INITIALIZER("klog_virtio"), WAIT_QUEUE_INITIALIZER },
+};
+#define NR_SINKS (sizeof(sinks) / sizeof(sinks[0]))
+
+/* 1 once the workers own the sinks */
+static volatile int klog_deferred = 0;
+
+/*
+ * Waking a worker takes the scheduler lock, which printk's caller may
+ * already hold. Instead printk arms an immediate hrtimer, and the
+ * wakeup happens from the timer interrupt.
+ */
+static hrtimer_t klog_kick_timer;
+static atomic_t klog_kick_armed = ATOMIC_INIT(0);
+
+/* ---- Formatting ---- */
+
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t pos;
+} fmt_out_t;
+
+static void fmt_putc(fmt_out_t *out, char c) {
+    if (out->pos + 1 < out->size) {
+        out->buf[out->pos] = c;
+    }
+    out->pos++;
+}
+
+static void fmt_number(fmt_out_t *out, uint64_t val, int base, int upper, int neg,
+                       int width, char pad) {
+    const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char tmp[24];
+    int n = 0;
+
+    do {
+        tmp[n++] = digits[val % (uint64_t)base];
+        val /= (uint64_t)base;
+    } while (val != 0);
+
+    int len = n + (neg ? 1 : 0);
+    if (neg && pad == '0') {
+        fmt_putc(out, '-');
+    }
+    for (; len < width; len++) {
+        fmt_putc(out, pad);
+    }
+    if (neg && pad != '0') {
+        fmt_putc(out, '-');
+    }
+    while (n > 0) {
+        fmt_putc(out, tmp[--n]);
+    }
+}
+
+int kvsnprintf(char *buf, size_t size, const char *fmt, va_list ap) {
+    fmt_out_t out = { buf, size, 0 };
+
+    for (; *fmt; fmt++) {
+        if (*fmt != '%') {
+            fmt_putc(&out, *fmt);
+            continue;
+        }
+        fmt++;
+
+        char pad = ' ';
+        if (*fmt == '0') {
+            pad = '0';
+            fmt++;
+        }
+        int width = 0;
+        while (*fmt >= '0' && *fmt <= '9') {
+            width = width * 10 + (*fmt++ - '0');
+        }
+        int longs = 0;
+        while (*fmt == 'l' || *fmt == 'z') {
+            longs++;
+            fmt++;
+        }
+
+        switch (*fmt) {
+        case 'd':
+        case 'i': {
+            int64_t v = longs ? va_arg(ap, int64_t) : va_arg(ap, int);
+            uint64_t mag = v < 0 ? -(uint64_t)v : (uint64_t)v;
+            fmt_number(&out, mag, 10, 0, v < 0, width, pad);
+            break;
+        }
+        case 'u':
+            fmt_number(&out, longs ? va_arg(ap, uint64_t) : va_arg(ap, unsigned int),
+                       10, 0, 0, width, pad);
+            break;
+        case 'x':
+        case 'X':
+            fmt_number(&out, longs ? va_arg(ap, uint64_t) : va_arg(ap, unsigned int),
+                       16, *fmt == 'X', 0, width, pad);
+            break;
+        case 'p':
+            fmt_putc(&out, '0');
+            fmt_putc(&out, 'x');
+            fmt_number(&out, (uint64_t)va_arg(ap, void *), 16, 0, 0, 16, '0');
+            break;
+        case 's': {
+            const char *s = va_arg(ap, const char *);
+            if (s == NULL) {
+                s = "(null)";
+            }
+            int len = 0;
+            while (s[len]) {
+                len++;
+            }
+            for (; len < width; len++) {
+                fmt_putc(&out, ' ');
+            }
+            while (*s) {
+                fmt_putc(&out, *s++);
+            }
+            break;
+        }
+        case 'c':
+            fmt_putc(&out, (char)va_arg(ap, int));
+            break;
+        case '%':
+            fmt_putc(&out, '%');
+            break;
+        case '\0':
+            fmt--;  /* Lone '%' at the end */
+            break;
+        default:
+            fmt_putc(&out, '%');
+            fmt_putc(&out, *fmt);
+            break;
+        }
+    }
+
+    if (size > 0) {
+        buf[out.pos < size ? out.pos : size - 1] = '\0';
+    }
+    return (int)out.pos;
+}
+
+int ksnprintf(char *buf, size_t size, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = kvsnprintf(buf, size, fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+/* ---- Ring ---- */
+
+uint64_t klog_count(void) {
+    return (uint64_t)atomic64_read(&klog_next);
+}
+
+uint64_t klog_first_seq(void) {
+    uint64_t next = klog_count();
+    return next > KLOG_RECORDS ? next - KLOG_RECORDS : 0;
+}
+
+/* Is there something for a reader at seq (a record, or a gap to skip)? */
+static int klog_ready(uint64_t seq) {
+    uint64_t next = klog_count();
+    if (seq >= next) {
+        return 0;
+    }
+    if (next - seq > KLOG_RECORDS) {
+        return 1;
+    }
+    uint64_t state = __atomic_load_n(&klog_ring[seq & (KLOG_RECORDS - 1)].state, __ATOMIC_ACQUIRE);
+    return state >= DONE(seq) && state != BUSY(seq);
+}
+
+int klog_read(uint64_t *seq, struct klog_record *out) {
+    for (;;) {
+        uint64_t next = klog_count();
+        if (*seq >= next) {
+            return 0;
+        }
+        if (next - *seq > KLOG_RECORDS) {
+            *seq = next - KLOG_RECORDS;     /* Lapped: skip what was overwritten */
+        }
+
+        const struct klog_record *rec = &klog_ring[*seq & (KLOG_RECORDS - 1)];
+        uint64_t state = __atomic_load_n(&rec->state, __ATOMIC_ACQUIRE);
+        if (state < DONE(*seq) || state == BUSY(*seq)) {
+            return 0;                       /* Still being written */
+        }
+        if (state == DONE(*seq)) {
+            *out = *rec;
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&rec->state, __ATOMIC_RELAXED) == state) {
+                (*seq)++;
+                return 1;
+            }
+        }
+        (*seq)++;                           /* Reused by a later message */
+    }
+}
+
+int klog_format(const struct klog_record *rec, char *buf, size_t size) {
+    uint64_t khz = clocksource_tsc_khz();
+    uint64_t ticks = rec->tsc - klog_tsc_base;
+    uint64_t us = 0;
+    if (khz != 0) {
+        us = (ticks / khz) * 1000 + (ticks % khz) * 1000 / khz;
+    }
+    return ksnprintf(buf, size, "[%5lu.%06lu] %s\n",
+                     us / 1000000, us % 1000000, rec->text);
+}
+
+/* ---- Sinks ---- */
+
+static int sink_ready(const klog_sink_t *sink) {
+    return sink->ready == NULL || sink->ready();
+}
+
+/* Write everything new to one sink. With lock == 0 the sink lock is skipped (emergency). */
+static void sink_drain(klog_sink_t *sink, int lock) {
+    struct klog_record rec;
+    char line[KLOG_TEXT_MAX + 24];
+
+    if (!sink_ready(sink)) {
+        return;     /* Keep its records until the device shows up */
+    }
+    uint64_t flags = 0;
+    if (lock) {
+        flags = spin_lock_irqsave(&sink->lock);
+    }
+    while (klog_read(&sink->seq, &rec)) {
+        if (rec.level <= sink->max_level) {
+            int len = klog_format(&rec, line, sizeof(line));
+            if (len >= (int)sizeof(line)) {
+                len = sizeof(line) - 1;
+            }
+            sink->write(line, (uint64_t)len);
+        }
+    }
+    if (lock) {
+        spin_unlock_irqrestore(&sink->lock, flags);
+    }
+}
+
+static void sink_worker(klog_sink_t *sink) {
+    for (;;) {
+        wait_event(&sink->wait, sink_ready(sink) && klog_ready(sink->seq));
+        sink_drain(sink, 1);
+    }
+}
+
+static void klog_serial_worker(void) {
+    sink_worker(&sinks[0]);
+}
+
+static void klog_console_worker(void) {
+    sink_worker(&sinks[1]);
+}
+
+static void klog_virtio_worker(void) {
+    sink_worker(&sinks[2]);
+}
+
+/* hrtimer callback (timer IRQ): wake every sink worker */
+static void klog_kick_fn(hrtimer_t *timer) {
+    (void)timer;
+    atomic_set(&klog_kick_armed, 0);
+    for (size_t i = 0; i < NR_SINKS; i++) {
+        wake_up_all(&sinks[i].wait);
+    }
+}
+
+void klog_start(void) {
+    hrtimer_init(&klog_kick_timer, NULL);
+
+    /* With virtio-console carrying the full log, the UART keeps only what matters */
+    if (virtio_console_present()) {
+        sinks[0].max_level = LOG_WARN;
+    }
+
+    scheduler_add(task_create(klog_serial_worker));
+    scheduler_add(task_create(klog_console_worker));
+    scheduler_add(task_create(klog_virtio_worker));
+
+    klog_deferred = 1;
+    pr_info("klog: sink workers started");
+}
+
+void klog_flush(void) {
+    for (size_t i = 0; i < NR_SINKS; i++) {
+        sink_drain(&sinks[i], 1);
+    }
+}
+
+uint64_t klog_pending(void) {
+    uint64_t next = klog_count();
+    uint64_t pending = 0;
+    for (size_t i = 0; i < NR_SINKS; i++) {
+        if (!sink_ready(&sinks[i])) {
+            continue;
+        }
+        uint64_t seq = __atomic_load_n(&sinks[i].seq, __ATOMIC_RELAXED);
+        if (next - seq > pending) {
+            pending = next - seq;
+        }
+    }
+    return pending;
+}
+
+void klog_emergency(void) {
+    klog_deferred = 0;
+    sink_drain(&sinks[0], 0);
+}
+
+/* ---- printk ---- */
+
+void vprintk(int level, const char *fmt, va_list ap) {
+    uint64_t flags = local_irq_save();
+
+    uint64_t tsc = rdtsc();
+    if (klog_tsc_base == 0) {
+        klog_tsc_base = tsc;
+    }
+
+    uint64_t seq = (uint64_t)atomic64_fetch_add(&klog_next, 1);
+    struct klog_record *rec = &klog_ring[seq & (KLOG_RECORDS - 1)];
+    __atomic_store_n(&rec->state, BUSY(seq), __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    int len = kvsnprintf(rec->text, sizeof(rec->text), fmt, ap);
+    if (len >= (int)sizeof(rec->text)) {
+        len = sizeof(rec->text) - 1;
+    }
+    if (len > 0 && rec->text[len - 1] == '\n') {
+        rec->text[--len] = '\0';
+    }
+    rec->len = (uint16_t)len;
+    rec->level = (uint8_t)level;
+    rec->tsc = tsc;
+    __atomic_store_n(&rec->state, DONE(seq), __ATOMIC_RELEASE);
+
+    local_irq_restore(flags);
+
+    if (!klog_deferred) {
+        klog_flush();
+    } else if (atomic_cmpxchg(&klog_kick_armed, 0, 1) == 0) {
+        hrtimer_start(&klog_kick_timer, ktime_get_ns(), klog_kick_fn);
+    }
+}
+
+void printk(int level, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vprintk(level, fmt, ap);
+    va_end(ap);
+}
@@ -0,0 +1,317 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "profile.h"
+#include "isr.h"
+#include "hrtimer.h"
+#include "clocksource.h"
+#include "percpu.h"
+#include "smp.h"
+#include "spinlock.h"
+#include "mutex.h"
+#include "cpu.h"
+#include "task.h"
+#include "ksyms.h"
+#include "elf.h"
+#include "vfs.h"
+#include "heap.h"
+
+#define PROFILE_PERIOD_NS   (NSEC_PER_SEC / PROFILE_HZ)
+#define PROFILE_PROG_NONE   0xffff  /* User sample without a program slot */
+
+/* New addresses are dropped once the table is this full */
+#define PROFILE_BUCKETS_MAX (PROFILE_BUCKETS - PROFILE_BUCKETS / 8)
+
+struct profile_bucket {
+    uint64_t addr;
+    uint32_t samples;
+    uint16_t prog;
+    uint16_t used;
+};
+
+volatile int profile_active = 0;
+
+static struct profile_bucket buckets[PROFILE_BUCKETS];
+static uint32_t buckets_used;
+static char prog_names[PROFILE_PROGS][TASK_COMM_LEN];
+static int nprogs = 1;
+static struct profile_stats stats;
+static spinlock_t profile_lock = SPINLOCK_INITIALIZER("profile");
+
+/* Per-CPU sampling timer; each CPU only ever arms its own */
+static struct profile_cpu {
+    hrtimer_t timer;
+    volatile int due;       /* Timer fired: sample this interrupt */
+} profile_cpus[SMP_MAX_CPUS];
+static int timers_ready = 0;
+
+/* ---- Sampling ---- */
+
+static void profile_timer_fn(hrtimer_t *timer) {
+    struct profile_cpu *pc = (struct profile_cpu *)timer->data;
+    pc->due = 1;
+    if (profile_active) {
+        /* Keep the period, but do not make up for missed ticks */
+        uint64_t next = timer->deadline_ns + PROFILE_PERIOD_NS;
+        uint64_t now = ktime_get_ns();
+        if (next <= now) {
+            next = now + PROFILE_PERIOD_NS;
+        }
+        hrtimer_start(timer, next, profile_timer_fn);
+    }
+}
+
+/* Start the calling CPU's timer if it is not running (interrupts off) */
+static void profile_arm(uint32_t cpu) {
+    hrtimer_t *timer = &profile_cpus[cpu].timer;
+    if (!hrtimer_active(timer)) {
+        hrtimer_start(timer, ktime_get_ns() + PROFILE_PERIOD_NS, profile_timer_fn);
+    }
+}
+
+/* Program slot for a user task (lock held) */
+static uint16_t prog_slot(const task_t *task) {
+    if (task == NULL || task->comm[0] == '\0') {
+        return PROFILE_PROG_NONE;
+    }
+    for (int i = 1; i < nprogs; i++) {
+        int j = 0;
+        while (j < TASK_COMM_LEN && prog_names[i][j] == task->comm[j] && task->comm[j]) {
+            j++;
+        }
+        if (j == TASK_COMM_LEN || prog_names[i][j] == task->comm[j]) {
+            return (uint16_t)i;
+        }
+    }
+    if (nprogs == PROFILE_PROGS) {
+        return PROFILE_PROG_NONE;
+    }
+    for (int j = 0; j < TASK_COMM_LEN; j++) {
+        prog_names[nprogs][j] = task->comm[j];
+    }
+    return (uint16_t)nprogs++;
+}
+
+/* Count one sample (lock held) */
+static void profile_record(uint64_t addr, uint16_t prog) {
+    uint64_t key = addr ^ ((uint64_t)prog << 48);
+    uint32_t i = (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & (PROFILE_BUCKETS - 1);
+
+    while (buckets[i].used) {
+        if (buckets[i].addr == addr && buckets[i].prog == prog) {
+            buckets[i].samples++;
+            return;
+        }
+        i = (i + 1) & (PROFILE_BUCKETS - 1);
+    }
+
+    if (buckets_used >= PROFILE_BUCKETS_MAX) {
+        stats.dropped++;
+        return;
+    }
+    buckets[i].addr = addr;
+    buckets[i].prog = prog;
+    buckets[i].samples = 1;
+    buckets[i].used = 1;
+    buckets_used++;
+}
+
+void profile_sample(struct interrupt_frame *frame) {
+    percpu_t *cpu = this_cpu();
+    struct profile_cpu *pc = &profile_cpus[cpu->cpu_id];
+
+    if (!pc->due) {
+        /* First interrupt on this CPU since profile_start() */
+        profile_arm(cpu->cpu_id);
+        return;
+    }
+    pc->due = 0;
+
+    int user = (frame->cs & 3) == 3;
+    uint64_t flags = spin_lock_irqsave(&profile_lock);
+    profile_record(frame->rip, user ? prog_slot(cpu->curr) : PROFILE_KERNEL);
+    stats.samples++;
+    if (user) {
+        stats.user++;
+    }
+    spin_unlock_irqrestore(&profile_lock, flags);
+}
+
+/* ---- Control ---- */
+
+void profile_start(void) {
+    uint64_t flags = local_irq_save();
+
+    if (!timers_ready) {
+        for (uint32_t i = 0; i < SMP_MAX_CPUS; i++) {
+            hrtimer_init(&profile_cpus[i].timer, &profile_cpus[i]);
+        }
+        timers_ready = 1;
+    }
+
+    spin_lock(&profile_lock);
+    for (uint32_t i = 0; i < PROFILE_BUCKETS; i++) {
+        buckets[i].used = 0;
+    }
+    buckets_used = 0;
+    nprogs = 1;
+    stats.samples = 0;
+    stats.user = 0;
+    stats.dropped = 0;
+    for (uint32_t i = 0; i < SMP_MAX_CPUS; i++) {
+        profile_cpus[i].due = 0;
+    }
+    spin_unlock(&profile_lock);
+
+    profile_active = 1;
+    profile_arm(this_cpu()->cpu_id);
+    local_irq_restore(flags);
+}
+
+void profile_stop(void) {
+    /* Timers lapse by themselves within a period */
+    profile_active = 0;
+}
+
+void profile_get_stats(struct profile_stats *out) {
+    uint64_t flags = spin_lock_irqsave(&profile_lock);
+    *out = stats;
+    spin_unlock_irqrestore(&profile_lock, flags);
+}
+
+const char *profile_prog_name(int prog) {
+    if (prog == PROFILE_KERNEL) {
+        return "kernel";
+    }
+    if (prog < 0 || prog >= nprogs) {
+        return NULL;
+    }
+    return prog_names[prog];
+}
+
+/* ---- Reports ---- */
+
+struct profile_hit {
+    uint64_t addr;
+    uint32_t samples;
+};
+
+/* Report scratch space, too big for a task stack */
+static struct profile_hit hits[PROFILE_BUCKETS];
+static mutex_t report_lock = MUTEX_INITIALIZER("profile_report");
+
+/* Read a program's ELF file for its symbols; NULL if that fails */
+static void *load_elf(const char *path, uint64_t *size) {
+    int fd = vfs_open(path);
+    if (fd < 0) {
+        return NULL;
+    }
+    uint32_t len = vfs_size(fd);
+    void *buf = len != 0 ? kmalloc(len) : NULL;
+    if (buf != NULL && vfs_read(fd, buf, len) != (int)len) {
+        kfree(buf);
+        buf = NULL;
+    }
+    vfs_close(fd);
+    *size = len;
+    return buf;
+}
+
+static const char *symbolize(uint64_t addr, const void *elf, uint64_t elf_size,
+                             uint64_t *start) {
+    if (elf != NULL) {
+        return elf_symbolize(elf, elf_size, addr, start);
+    }
+    return ksym_lookup(addr, start);
+}
+
+int profile_top(int prog, struct profile_entry *out, int max) {
+    char path[TASK_COMM_LEN];
+    uint32_t n = 0;
+
+    mutex_lock(&report_lock);
+
+    uint64_t flags = spin_lock_irqsave(&profile_lock);
+    if (prog < 0 || prog >= nprogs) {
+        spin_unlock_irqrestore(&profile_lock, flags);
+        mutex_unlock(&report_lock);
+        return 0;
+    }
+    for (int j = 0; j < TASK_COMM_LEN; j++) {
+        path[j] = prog_names[prog][j];
+    }
+    for (uint32_t i = 0; i < PROFILE_BUCKETS; i++) {
+        if (buckets[i].used && buckets[i].prog == prog) {
+            hits[n].addr = buckets[i].addr;
+            hits[n].samples = buckets[i].samples;
+            n++;
+        }
+    }
+    spin_unlock_irqrestore(&profile_lock, flags);
+
+    uint64_t elf_size = 0;
+    void *elf = prog != PROFILE_KERNEL ? load_elf(path, &elf_size) : NULL;
+    int user_unsymbolized = prog != PROFILE_KERNEL && elf == NULL;
+
+    /* Charge each address to the function containing it */
+    for (uint32_t i = 0; i < n && !user_unsymbolized; i++) {
+        uint64_t start;
+        if (symbolize(hits[i].addr, elf, elf_size, &start) != NULL) {
+            hits[i].addr = start;
+        }
+    }
+
+    /* Sort by address (Shell sort) and merge equal ones */
+    for (uint32_t gap = n / 2; gap > 0; gap /= 2) {
+        for (uint32_t i = gap; i < n; i++) {
+            struct profile_hit h = hits[i];
+            uint32_t j = i;
+            while (j >= gap && hits[j - gap].addr > h.addr) {
+                hits[j] = hits[j - gap];
+                j -= gap;
+            }
+            hits[j] = h;
+        }
+    }
+    uint32_t m = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (m > 0 && hits[m - 1].addr == hits[i].addr) {
+            hits[m - 1].samples += hits[i].samples;
+        } else {
+            hits[m++] = hits[i];
+        }
+    }
+
+    /* Pick the hottest */
+    int count = 0;
+    while (count < max) {
+        uint32_t best = m;
+        for (uint32_t i = 0; i < m; i++) {
+            if (hits[i].samples != 0 && (best == m || hits[i].samples > hits[best].samples)) {
+                best = i;
+            }
+        }
+        if (best == m) {
+            break;
+        }
+
+        struct profile_entry *e = &out[count++];
+        e->start = hits[best].addr;
+        e->samples = hits[best].samples;
+        hits[best].samples = 0;
+
+        const char *name = user_unsymbolized ? NULL
+                         : symbolize(e->start, elf, elf_size, NULL);
+        int j = 0;
+        while (name != NULL && name[j] && j < PROFILE_NAME_MAX - 1) {
+            e->name[j] = name[j];
+            j++;
+        }
+        e->name[j] = '\0';
+    }
+
+    if (elf != NULL) {
+        kfree(elf);
+    }
+    mutex_unlock(&report_lock);
+    return count;
+}
@@ -0,0 +1,110 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "regbench.h"
+#include "regtest.h"
+#include "cpu.h"
+#include "clocksource.h"
+
+/*
+ * Microbenchmark support for the regtest flavor; the benchmarks
+ * themselves are in tests/regbench_suites.c.
+ */
+
+#ifdef REGTEST_BUILD
+
+static uint64_t samples[REGBENCH_MAX_ITERS];
+static uint64_t overhead;
+static struct regbench_result last;
+
+/* TSC read that waits for earlier instructions to finish */
+static inline uint64_t bench_tsc(void) {
+    asm volatile("lfence" ::: "memory");
+    return rdtsc();
+}
+
+static void sort_samples(uint64_t *s, uint32_t n) {
+    for (uint32_t gap = n / 2; gap > 0; gap /= 2) {
+        for (uint32_t i = gap; i < n; i++) {
+            uint64_t v = s[i];
+            uint32_t j = i;
+            while (j >= gap && s[j - gap] > v) {
+                s[j] = s[j - gap];
+                j -= gap;
+            }
+            s[j] = v;
+        }
+    }
+}
+
+void regbench_report(const char *name, uint64_t *s, uint32_t n) {
+    if (n == 0) {
+        return;
+    }
+    sort_samples(s, n);
+    last.min = s[0];
+    last.median = s[n / 2];
+    last.p99 = s[(uint64_t)n * 99 / 100];
+    regtest_log("BENCH %s iters=%d min=%d median=%d p99=%d unit=tsc\n", name, (int)n,
+                (int)last.min, (int)last.median, (int)last.p99);
+}
+
+const struct regbench_result *regbench_last(void) {
+    return &last;
+}
+
+struct regbench regbench_begin(const char *name, uint32_t iterations) {
+    struct regbench bench;
+    if (iterations > REGBENCH_MAX_ITERS) {
+        iterations = REGBENCH_MAX_ITERS;
+    }
+    bench.name = name;
+    bench.iterations = iterations;
+    bench.runs = iterations + REGBENCH_WARMUP;
+    bench.index = 0;
+    bench.started = 0;
+    bench.start = 0;
+    return bench;
+}
+
+int regbench_next(struct regbench *bench) {
+    uint64_t now = bench_tsc();
+
+    if (bench->started) {
+        if (bench->index >= REGBENCH_WARMUP) {
+            uint64_t t = now - bench->start;
+            samples[bench->index - REGBENCH_WARMUP] = t > overhead ? t - overhead : 0;
+        }
+        bench->index++;
+    }
+    bench->started = 1;
+
+    if (bench->index == bench->runs) {
+        if (bench->name != NULL) {
+            regbench_report(bench->name, samples, bench->iterations);
+        }
+        return 0;
+    }
+    bench->start = bench_tsc();
+    return 1;
+}
+
+void regbench_init(void) {
+    /* Cheapest empty body: what every sample pays for being timed */
+    overhead = 0;
+    uint64_t best = ~0ULL;
+    for (int round = 0; round < 4; round++) {
+        struct regbench b = regbench_begin(NULL, 256);
+        while (regbench_next(&b)) {
+        }
+        for (uint32_t i = 0; i < 256; i++) {
+            if (samples[i] < best) {
+                best = samples[i];
+            }
+        }
+    }
+    overhead = best;
+    regtest_log("BENCH-INFO tsc_khz=%d overhead=%d\n",
+                (int)clocksource_tsc_khz(), (int)overhead);
+}
+
+#endif /* REGTEST_BUILD */
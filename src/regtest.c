@@ -1,6 +1,10 @@
 #include "regtest.h"
 #include "serial.h"
+#include "printk.h"
+#include "virtio_console.h"
+#include "trace.h"
 #include "ports.h"
+#include "clocksource.h"
 #include <stdarg.h>
 
 /*
@@ -15,6 +19,9 @@ static int total_failed = 0;
 static int suite_passed = 0;
 static int suite_failed = 0;
 
+/* Start time of the current suite (ktime ns) */
+static uint64_t suite_start_ns = 0;
+
 /*
  * Exit QEMU with test result via isa-debug-exit device.
  * QEMU exit code = (value << 1) | 1
@@ -24,6 +31,9 @@ static int suite_failed = 0;
 void regtest_exit(int success) {
     uint8_t code = success ? REGTEST_SUCCESS : REGTEST_FAILURE;
     regtest_log("EXIT %d\n", success ? 1 : 3);
+    klog_flush();
+    virtio_console_flush();
+    serial_flush();
     /* Use outb to write to isa-debug-exit device.
      * QEMU exit code = (code << 1) | 1
      * code=0x00 -> QEMU exits with 1 (success)
@@ -37,15 +47,47 @@ void regtest_exit(int success) {
 }
 
 /*
- * Print a decimal number to serial.
+ * A log line being built. Lines go out in one write, to virtio-console
+ * when QEMU provides one (much faster than the UART) and to serial
+ * otherwise.
  */
-static void print_dec(int val) {
+typedef struct {
+    char buf[256];
+    uint64_t len;
+} log_line_t;
+
+static void line_emit(log_line_t *line) {
+    if (virtio_console_present()) {
+        virtio_console_write(line->buf, line->len);
+    } else {
+        serial_write(line->buf, line->len);
+    }
+    line->len = 0;
+}
+
+static void line_putc(log_line_t *line, char c) {
+    if (line->len == sizeof(line->buf)) {
+        line_emit(line);
+    }
+    line->buf[line->len++] = c;
+}
+
+static void line_puts(log_line_t *line, const char *s) {
+    while (*s) {
+        line_putc(line, *s++);
+    }
+}
+
+/*
+ * Print a decimal number.
+ */
+static void print_dec(log_line_t *line, int val) {
     if (val < 0) {
-        serial_putc('-');
+        line_putc(line, '-');
         val = -val;
     }
     if (val == 0) {
-        serial_putc('0');
+        line_putc(line, '0');
         return;
     }
     char buf[12];
@@ -55,21 +97,21 @@ static void print_dec(int val) {
         val /= 10;
     }
     while (i > 0) {
-        serial_putc(buf[--i]);
+        line_putc(line, buf[--i]);
     }
 }
 
 /*
- * Print a hex number to serial.
+ * Print a hex number.
  */
-static void print_hex(uint64_t val) {
+static void print_hex(log_line_t *line, uint64_t val) {
     const char *hex = "0123456789abcdef";
-    serial_puts("0x");
+    line_puts(line, "0x");
     int started = 0;
     for (int i = 60; i >= 0; i -= 4) {
         int digit = (val >> i) & 0xf;
         if (digit || started || i == 0) {
-            serial_putc(hex[digit]);
+            line_putc(line, hex[digit]);
             started = 1;
         }
     }
@@ -83,7 +125,9 @@ void regtest_log(const char *fmt, ...) {
     va_list ap;
     va_start(ap, fmt);
 
-    serial_puts("[REGTEST] ");
+    log_line_t line;
+    line.len = 0;
+    line_puts(&line, "[REGTEST] ");
 
     while (*fmt) {
         if (*fmt == '%') {
@@ -91,37 +135,38 @@ void regtest_log(const char *fmt, ...) {
             switch (*fmt) {
                 case 's': {
                     const char *s = va_arg(ap, const char *);
-                    serial_puts(s ? s : "(null)");
+                    line_puts(&line, s ? s : "(null)");
                     break;
                 }
                 case 'd': {
                     int d = va_arg(ap, int);
-                    print_dec(d);
+                    print_dec(&line, d);
                     break;
                 }
                 case 'x': {
                     uint64_t x = va_arg(ap, uint64_t);
-                    print_hex(x);
+                    print_hex(&line, x);
                     break;
                 }
                 case 'p': {
                     void *p = va_arg(ap, void *);
-                    print_hex((uint64_t)p);
+                    print_hex(&line, (uint64_t)p);
                     break;
                 }
                 case '%':
-                    serial_putc('%');
+                    line_putc(&line, '%');
                     break;
                 default:
-                    serial_putc('%');
-                    serial_putc(*fmt);
+                    line_putc(&line, '%');
+                    line_putc(&line, *fmt);
                     break;
             }
         } else {
-            serial_putc(*fmt);
+            line_putc(&line, *fmt);
         }
         fmt++;
     }
+    line_emit(&line);
 
     va_end(ap);
 }
@@ -150,6 +195,7 @@ void regtest_fail(const char *test_name, const char *reason) {
 void regtest_start_suite(const char *suite_name) {
     suite_passed = 0;
     suite_failed = 0;
+    suite_start_ns = ktime_get_ns();
     regtest_log("START %s\n", suite_name);
 }
 
@@ -157,7 +203,9 @@ void regtest_start_suite(const char *suite_name) {
  * Mark the end of a test suite.
  */
 void regtest_end_suite(const char *suite_name) {
-    regtest_log("END %s passed=%d failed=%d\n", suite_name, suite_passed, suite_failed);
+    int elapsed_us = (int)((ktime_get_ns() - suite_start_ns) / NSEC_PER_USEC);
+    regtest_log("END %s passed=%d failed=%d time_us=%d\n",
+                suite_name, suite_passed, suite_failed, elapsed_us);
 }
 
 /*
@@ -169,6 +217,7 @@ int regtest_run_all(void) {
     int result = 0;
 
     regtest_log("=== cool-os Regression Test Suite ===\n");
+    uint64_t run_start_ns = ktime_get_ns();
 
 #ifdef REGTEST_PMM
     if (regtest_pmm() != 0) result = -1;
@@ -226,8 +275,68 @@ int regtest_run_all(void) {
     if (regtest_preempt() != 0) result = -1;
 #endif
 
-    regtest_log("SUMMARY total=%d passed=%d failed=%d\n",
-                total_passed + total_failed, total_passed, total_failed);
+#ifdef REGTEST_CLOCK
+    if (regtest_clock() != 0) result = -1;
+#endif
+
+#ifdef REGTEST_SIMD
+    if (regtest_simd() != 0) result = -1;
+#endif
+
+#ifdef REGTEST_SMP
+    if (regtest_smp() != 0) result = -1;
+#endif
+
+#ifdef REGTEST_LOCKS
+    if (regtest_locks() != 0) result = -1;
+#endif
+
+#ifdef REGTEST_RING
+    if (regtest_ring() != 0) result = -1;
+#endif
+
+#ifdef REGTEST_SERIAL
+    if (regtest_serial() != 0) result = -1;
+#endif
+
+#ifdef REGTEST_KLOG
+    if (regtest_klog() != 0) result = -1;
+#endif
+
+#ifdef REGTEST_VIRTIO
+    if (regtest_virtio() != 0) result = -1;
+#endif
+
+#ifdef REGTEST_TRACE
+    if (regtest_trace() != 0) result = -1;
+#endif
+
+#ifdef REGTEST_PROFILE
+    if (regtest_profile() != 0) result = -1;
+#endif
+
+#ifdef REGTEST_PMU
+    if (regtest_pmu() != 0) result = -1;
+#endif
+
+#ifdef REGTEST_BOOT
+    if (regtest_boot() != 0) result = -1;
+#endif
+
+#ifdef REGTEST_BENCH
+    if (regtest_bench() != 0) result = -1;
+#endif
+
+#ifdef REGTEST_UBENCH
+    if (regtest_ubench() != 0) result = -1;
+#endif
+
+    int total_ms = (int)((ktime_get_ns() - run_start_ns) / NSEC_PER_MSEC);
+    regtest_log("SUMMARY total=%d passed=%d failed=%d time_ms=%d\n",
+                total_passed + total_failed, total_passed, total_failed, total_ms);
+
+    /* Tracepoints from the last suites, for scripts/trace2json.py */
+    trace_dump();
 
     return result;
 }
@@ -2,46 +2,369 @@
 #include <stddef.h>
 #include "scheduler.h"
 #include "task.h"
+#include "fpu.h"
+#include "pmu.h"
 #include "heap.h"
 #include "panic.h"
 #include "serial.h"
 #include "gdt.h"
 #include "paging.h"
 #include "cpu.h"
-#include "isr.h"
-
-/* External: current_task is defined in task.c */
-extern task_t *current_task;
+#include "percpu.h"
+#include "trace.h"
+#include "preempt.h"
+#include "hrtimer.h"
+#include "waitqueue.h"
+#include "clocksource.h"
+#include "spinlock.h"
+#include "smp.h"
 
 /* Assembly context switch function */
 extern void context_switch(task_t *old, task_t *new);
 
-/* Idle task: runs when no other tasks are ready */
-static task_t *idle_task = NULL;
+/*
+ * Per-CPU run queues.
+ *
+ * Each CPU owns one FIFO per priority level; bitmap has bit p set while
+ * queue[p] is non-empty. A task sits on the run queue of task->cpu. The
+ * running task and the idle task are never on a run queue. A CPU that
+ * runs out of work steals the best queued task from the busiest CPU.
+ */
+typedef struct run_queue {
+    spinlock_t lock;
+    task_list_t queue[SCHED_NUM_PRIO];
+    uint32_t bitmap;
+    uint32_t nr_running;    /* Tasks queued (not counting the running one) */
+    hrtimer_t slice_timer;  /* Fires when the running task's slice runs out */
+    task_t *prev;           /* Task just switched away from (finish_switch()) */
+} run_queue_t;
+
+static run_queue_t run_queues[SMP_MAX_CPUS];
+
+/*
+ * Blocked and zombie tasks sit on their own lists so the scheduler never
+ * has to skip over them.
+ */
+static task_list_t blocked_list;
+static task_list_t zombie_list;
+
+/* Every scheduled task, for PID lookup */
+static task_t *all_tasks = NULL;
 
 /*
- * Preemption support (Proto 17).
+ * Locking.
  *
- * preempt_new_rsp: Reserved for future IRQ-based context switching.
- * Currently unused - preemption uses scheduler_yield() instead.
- * Kept for compatibility with isr_stubs.S which references it.
+ * sched_lock covers all_tasks, the blocked/zombie lists, every wait queue
+ * and the blocked and zombie state changes. Each run queue's own lock
+ * covers its queues and the task->cpu and READY/RUNNING state of the
+ * tasks on it, so switching and stealing on one CPU do not serialize
+ * against the others.
+ *
+ * A CPU's run queue lock is held across context_switch() and released by
+ * whichever task runs next on that CPU (finish_switch()), so no other CPU
+ * can pick the outgoing task before its registers are saved.
+ *
+ * Order: sched_lock before any run queue lock. A CPU stealing with its
+ * own run queue locked takes the victim's only in CPU id order and
+ * otherwise just tries it.
  */
-volatile uint64_t preempt_new_rsp = 0;
+static spinlock_t sched_lock = SPINLOCK_INITIALIZER("sched");
+
+static void list_push_back(task_list_t *list, task_t *task) {
+    task->next = NULL;
+    task->prev = list->tail;
+    if (list->tail) {
+        list->tail->next = task;
+    } else {
+        list->head = task;
+    }
+    list->tail = task;
+    task->queue = list;
+}
+
+static void list_unlink(task_t *task) {
+    task_list_t *list = task->queue;
+    if (list == NULL) return;
+
+    if (task->prev) {
+        task->prev->next = task->next;
+    } else {
+        list->head = task->next;
+    }
+    if (task->next) {
+        task->next->prev = task->prev;
+    } else {
+        list->tail = task->prev;
+    }
+    task->next = NULL;
+    task->prev = NULL;
+    task->queue = NULL;
+}
 
-/* Reentrancy guard - prevents nested scheduler calls from timer IRQs */
-static volatile int in_scheduler = 0;
+static inline int is_run_queue(task_list_t *list) {
+    return (void *)list >= (void *)&run_queues[0] &&
+           (void *)list < (void *)&run_queues[SMP_MAX_CPUS];
+}
+
+static void enqueue_ready(task_t *task) {
+    run_queue_t *rq = &run_queues[task->cpu];
+    int prio = task->priority;
+    list_push_back(&rq->queue[prio], task);
+    rq->bitmap |= 1U << prio;
+    rq->nr_running++;
+}
 
-/* Idle task entry point: halts until next interrupt, then yields */
-static void idle_entry(void) {
+/* Unlink a task from its current list, keeping run queue state in sync */
+static void dequeue(task_t *task) {
+    task_list_t *list = task->queue;
+    list_unlink(task);
+    if (list != NULL && is_run_queue(list)) {
+        run_queue_t *rq = &run_queues[task->cpu];
+        rq->nr_running--;
+        if (list->head == NULL) {
+            rq->bitmap &= ~(1U << (list - rq->queue));
+        }
+    }
+}
+
+/* Pop the highest-priority task queued on rq, or NULL if none */
+static task_t *rq_pop(run_queue_t *rq) {
+    if (rq->bitmap == 0) {
+        return NULL;
+    }
+    int prio = __builtin_ctz(rq->bitmap);
+    task_t *task = rq->queue[prio].head;
+    dequeue(task);
+    return task;
+}
+
+/* Busiest other online CPU with queued work, or -1 */
+static int busiest_cpu(uint32_t self) {
+    int busiest = -1;
+    uint32_t most = 0;
+    for (uint32_t i = 0; i < SMP_MAX_CPUS; i++) {
+        percpu_t *pc = smp_cpu(i);
+        if (i == self || pc == NULL || !pc->online) continue;
+        if (run_queues[i].nr_running > most) {
+            most = run_queues[i].nr_running;
+            busiest = (int)i;
+        }
+    }
+    return busiest;
+}
+
+/*
+ * Next task for cpu: its own highest-priority queued task, else one
+ * stolen from the busiest CPU. Returns NULL if there is nothing to run.
+ * Called with cpu's run queue lock held.
+ */
+static task_t *pick_next_ready(uint32_t cpu) {
+    task_t *task = rq_pop(&run_queues[cpu]);
+    if (task != NULL) {
+        return task;
+    }
+
+    int victim = busiest_cpu(cpu);
+    if (victim < 0) {
+        return NULL;
+    }
+
+    /*
+     * Lock the victim in CPU id order, else only try it: a failed try
+     * leaves the task for the next pass of the idle loop.
+     */
+    run_queue_t *vrq = &run_queues[victim];
+    if ((uint32_t)victim > cpu) {
+        spin_lock(&vrq->lock);
+    } else if (!spin_trylock(&vrq->lock)) {
+        return NULL;
+    }
+    task = rq_pop(vrq);
+    if (task != NULL) {
+        task->cpu = cpu;  /* Migrates here */
+    }
+    spin_unlock(&vrq->lock);
+    return task;
+}
+
+/* Lock the run queue task is on; task->cpu only changes under that lock */
+static run_queue_t *task_rq_lock(task_t *task) {
     for (;;) {
+        uint32_t cpu = task->cpu;
+        run_queue_t *rq = &run_queues[cpu];
+        spin_lock(&rq->lock);
+        if (task->cpu == cpu) {
+            return rq;
+        }
+        spin_unlock(&rq->lock);
+    }
+}
+
+/* Non-zero if cpu has queued work or could steal some (lockless peek) */
+static int has_work(uint32_t cpu) {
+    return run_queues[cpu].nr_running != 0 || busiest_cpu(cpu) >= 0;
+}
+
+static void all_tasks_insert(task_t *task) {
+    task->all_prev = NULL;
+    task->all_next = all_tasks;
+    if (all_tasks) {
+        all_tasks->all_prev = task;
+    }
+    all_tasks = task;
+}
+
+static void all_tasks_remove(task_t *task) {
+    if (task->all_prev) {
+        task->all_prev->all_next = task->all_next;
+    } else if (all_tasks == task) {
+        all_tasks = task->all_next;
+    } else {
+        return;  /* Not on the list */
+    }
+    if (task->all_next) {
+        task->all_next->all_prev = task->all_prev;
+    }
+    task->all_next = NULL;
+    task->all_prev = NULL;
+}
+
+static void slice_expired(hrtimer_t *timer);
+
+/* Start a fresh time slice for task on this CPU (none for idle: tickless idle) */
+static void start_slice(percpu_t *cpu, task_t *task) {
+    run_queue_t *rq = &run_queues[cpu->cpu_id];
+    if (task == cpu->idle_task) {
+        task->ticks_remaining = 0;
+        hrtimer_cancel(&rq->slice_timer);
+    } else {
+        task->ticks_remaining = SCHED_TICK_SLICE;
+        hrtimer_start(&rq->slice_timer, ktime_get_ns() + SCHED_SLICE_US * NSEC_PER_USEC,
+                      slice_expired);
+    }
+}
+
+/* Load of cpu for placement: queued tasks plus the running one (if not idle) */
+static uint32_t cpu_load(uint32_t cpu) {
+    percpu_t *pc = smp_cpu(cpu);
+    return run_queues[cpu].nr_running + (pc->curr != pc->idle_task ? 1 : 0);
+}
+
+/* Send one idle CPU (other than self) off to steal work */
+static void kick_idle_cpu(uint32_t self) {
+    for (uint32_t i = 0; i < SMP_MAX_CPUS; i++) {
+        percpu_t *pc = smp_cpu(i);
+        if (i == self || pc == NULL || !pc->online) continue;
+        if (pc->curr == pc->idle_task && run_queues[i].nr_running == 0) {
+            if (!pc->need_resched) {
+                smp_send_resched(i);
+            }
+            return;
+        }
+    }
+}
+
+/*
+ * Request a reschedule if a newly runnable task should run before the
+ * one currently on its CPU; otherwise let an idle CPU steal it.
+ * Called with the task's run queue lock held.
+ */
+static void check_preempt(task_t *task) {
+    percpu_t *pc = smp_cpu(task->cpu);
+    task_t *curr = pc->curr;
+    if (curr == pc->idle_task || task->priority < curr->priority) {
+        smp_send_resched(task->cpu);
+    } else {
+        kick_idle_cpu(task->cpu);
+    }
+}
+
+/* Least-loaded online CPU, preferring the calling one on ties */
+static uint32_t select_cpu(void) {
+    uint32_t best = this_cpu()->cpu_id;
+    uint32_t best_load = cpu_load(best);
+    for (uint32_t i = 0; i < SMP_MAX_CPUS && best_load > 0; i++) {
+        percpu_t *pc = smp_cpu(i);
+        if (pc == NULL || !pc->online) continue;
+        uint32_t load = cpu_load(i);
+        if (load < best_load) {
+            best = i;
+            best_load = load;
+        }
+    }
+    return best;
+}
+
+/* Idle loop: halts until an interrupt, switching away whenever there is work */
+static void __attribute__((noreturn)) idle_loop(void) {
+    for (;;) {
+        asm volatile("cli");
+        if (has_work(this_cpu()->cpu_id)) {
+            scheduler_yield();
+            continue;
+        }
+        /* sti takes effect after hlt starts, so a wakeup IPI is not lost */
         asm volatile("sti; hlt");
-        scheduler_yield();  /* Give other tasks a chance to run */
     }
 }
 
+/*
+ * Fill in a task that represents a context which is already running on
+ * its own (boot) stack: kmain on the BSP and each AP's idle loop.
+ */
+static void init_boot_task(task_t *task, uint32_t cpu) {
+    task->rsp = 0;  /* Will be saved on first yield */
+    task->next = NULL;
+    task->state = PROC_RUNNING;
+    task->on_cpu = 1;
+    task->stack_base = NULL;  /* Using Limine-provided stack */
+    task->id = 0;
+    task->entry = NULL;
+    /* Initialize user mode fields (kernel task) */
+    task->user_rsp = 0;
+    task->kernel_rsp = 0;
+    task->user_rip = 0;
+    task->is_user = 0;
+    task->user_stack_base = NULL;
+    /* Initialize process lifecycle fields (PID 0) */
+    task->pid = 0;
+    task->ppid = 0;
+    task->parent = NULL;
+    task->exit_code = 0;
+    task->first_child = NULL;
+    task->next_sibling = NULL;
+
+    /* Kernel address space */
+    task->cr3 = paging_get_kernel_cr3();
+    task->pml4 = NULL;  /* Not tracked for kernel tasks */
+
+    /* Running, so it starts off every list */
+    task->ticks_remaining = 0;
+    task->prev = NULL;
+    task->queue = NULL;
+    task->priority = SCHED_PRIO_DEFAULT;
+    task->preempt_count = 0;
+    hrtimer_init(&task->sleep_timer, task);
+    wait_queue_init(&task->child_exit_wait);
+    task->fpu_state = NULL;
+    task->fpu_alloc = NULL;
+    task->cpu = cpu;
+    task->user_fs_base = 0;
+    task->user_gs_base = 0;
+    task->comm[0] = '\0';
+    task->perf.enabled = 0;
+}
+
 void scheduler_init(void) {
     serial_puts("SCHED: Initializing scheduler\n");
 
+    percpu_t *cpu = this_cpu();
+
+    for (uint32_t i = 0; i < SMP_MAX_CPUS; i++) {
+        spin_lock_init(&run_queues[i].lock, "runqueue");
+        hrtimer_init(&run_queues[i].slice_timer, NULL);
+    }
+
     /*
      * Create bootstrap task to represent kmain's context.
      * This allows kmain to yield properly.
@@ -49,99 +372,247 @@ void scheduler_init(void) {
      */
     task_t *bootstrap = kmalloc(sizeof(task_t));
     ASSERT(bootstrap != NULL);
-    bootstrap->rsp = 0;  /* Will be saved on first yield */
-    bootstrap->next = NULL;
-    bootstrap->state = PROC_RUNNING;
-    bootstrap->stack_base = NULL;  /* Using Limine-provided stack */
-    bootstrap->id = 0;
-    bootstrap->entry = NULL;
-    /* Initialize user mode fields (bootstrap is kernel task) */
-    bootstrap->user_rsp = 0;
-    bootstrap->kernel_rsp = 0;
-    bootstrap->user_rip = 0;
-    bootstrap->is_user = 0;
-    bootstrap->user_stack_base = NULL;
-    /* Initialize process lifecycle fields (bootstrap is PID 0) */
-    bootstrap->pid = 0;
-    bootstrap->ppid = 0;
-    bootstrap->parent = NULL;
-    bootstrap->exit_code = 0;
-    bootstrap->first_child = NULL;
-    bootstrap->next_sibling = NULL;
-
-    /* Initialize address space fields (bootstrap uses kernel address space) */
-    bootstrap->cr3 = paging_get_kernel_cr3();
-    bootstrap->pml4 = NULL;  /* Not tracked for kernel tasks */
+    init_boot_task(bootstrap, cpu->cpu_id);
+    all_tasks_insert(bootstrap);
+
+    cpu->curr = bootstrap;
+
+    /* Create idle task (never queued - picked only when there is no work) */
+    task_t *idle = task_create(idle_loop);
+    ASSERT(idle != NULL);
+    idle->priority = SCHED_PRIO_LOWEST;
+    idle->cpu = cpu->cpu_id;
+    all_tasks_insert(idle);
+    cpu->idle_task = idle;
 
     /* Initialize preemptive scheduling time slice (Proto 17) */
-    bootstrap->ticks_remaining = SCHED_TICK_SLICE;
+    start_slice(cpu, bootstrap);
 
-    current_task = bootstrap;
+    serial_puts("SCHED: Scheduler initialized\n");
+}
 
-    /* Create idle task */
-    idle_task = task_create(idle_entry);
-    ASSERT(idle_task != NULL);
+void scheduler_run_ap(void) {
+    percpu_t *cpu = this_cpu();
 
-    /* Link bootstrap and idle in circular queue */
-    bootstrap->next = idle_task;
-    idle_task->next = bootstrap;
+    /* The AP's boot context becomes its idle task */
+    task_t *idle = kmalloc(sizeof(task_t));
+    ASSERT(idle != NULL);
+    init_boot_task(idle, cpu->cpu_id);
+    idle->priority = SCHED_PRIO_LOWEST;
 
-    serial_puts("SCHED: Scheduler initialized\n");
+    uint64_t flags = scheduler_lock();
+    all_tasks_insert(idle);
+    cpu->idle_task = idle;
+    cpu->curr = idle;
+    cpu->online = 1;
+    scheduler_unlock(flags);
+
+    idle_loop();
+}
+
+uint64_t scheduler_lock(void) {
+    return spin_lock_irqsave(&sched_lock);
+}
+
+void scheduler_unlock(uint64_t flags) {
+    spin_unlock_irqrestore(&sched_lock, flags);
+}
+
+/*
+ * Second half of a switch, run by the incoming task: the outgoing one is
+ * now off its stack. Drops the run queue lock inherited from
+ * context_switch().
+ */
+static void finish_switch(void) {
+    run_queue_t *rq = &run_queues[this_cpu()->cpu_id];
+    task_t *prev = rq->prev;
+    rq->prev = NULL;
+    if (prev != NULL) {
+        __atomic_store_n(&prev->on_cpu, 0, __ATOMIC_RELEASE);
+    }
+    spin_unlock(&rq->lock);
+}
+
+void scheduler_schedule_tail(void) {
+    finish_switch();
 }
 
 void scheduler_add(task_t *task) {
     ASSERT(task != NULL);
     ASSERT(current_task != NULL);
+    ASSERT(task->priority >= 0 && task->priority < SCHED_NUM_PRIO);
+
+    uint64_t flags = scheduler_lock();
 
-    /* Disable interrupts during queue manipulation */
-    uint64_t flags;
-    asm volatile("pushfq; pop %0; cli" : "=r"(flags));
+    all_tasks_insert(task);
+    task->cpu = select_cpu();
 
-    /* Insert task after current task in circular queue */
-    task->next = current_task->next;
-    current_task->next = task;
+    run_queue_t *rq = &run_queues[task->cpu];
+    spin_lock(&rq->lock);
+    task->state = PROC_READY;
+    enqueue_ready(task);
+    check_preempt(task);
+    spin_unlock(&rq->lock);
 
-    /* Restore interrupt state */
-    asm volatile("push %0; popfq" : : "r"(flags));
+    scheduler_unlock(flags);
 }
 
-void scheduler_yield(void) {
-    ASSERT(current_task != NULL);
+void scheduler_wake_locked(task_t *task) {
+    if (task == NULL || task->state != PROC_BLOCKED) return;
 
-    /* Disable interrupts during scheduling */
-    asm volatile("cli");
+    /*
+     * A blocked task is always linked on a wait queue or blocked_list.
+     * If it is still switching away, its CPU's run queue lock holds us
+     * off until the switch is done.
+     */
+    run_queue_t *rq = task_rq_lock(task);
+    dequeue(task);
+    task->state = PROC_READY;
+    enqueue_ready(task);
+    check_preempt(task);
+    spin_unlock(&rq->lock);
+}
+
+void scheduler_wake(task_t *task) {
+    if (task == NULL) return;
+
+    uint64_t flags = scheduler_lock();
+    scheduler_wake_locked(task);
+    scheduler_unlock(flags);
+}
+
+static void schedule_locked(void);
+
+/* Trade sched_lock for this CPU's run queue lock, keeping IRQs off */
+static void sched_lock_to_rq(void) {
+    spin_lock(&run_queues[this_cpu()->cpu_id].lock);
+    spin_unlock(&sched_lock);
+}
 
-    /* Find next READY task (round-robin) */
-    task_t *old = current_task;
-    task_t *next = old->next;
+void scheduler_block_on(task_list_t *list) {
+    task_t *task = current_task;
 
-    /* Skip ZOMBIE and BLOCKED tasks, but always allow idle_task */
-    while ((next->state == PROC_ZOMBIE || next->state == PROC_BLOCKED) && next != idle_task) {
-        next = next->next;
-        /* Safety: don't loop forever if no runnable tasks */
-        if (next == old->next) {
-            next = idle_task;
+    if (task == NULL) {
+        /* Before the scheduler exists: wait for any interrupt */
+        spin_unlock(&sched_lock);
+        asm volatile("sti; hlt; cli");
+        spin_lock(&sched_lock);
+        return;
+    }
+    ASSERT(task != this_cpu()->idle_task);
+
+    task->state = PROC_BLOCKED;
+    list_push_back(list != NULL ? list : &blocked_list, task);
+
+    sched_lock_to_rq();
+    schedule_locked();
+    spin_lock(&sched_lock);
+}
+
+void scheduler_remove(task_t *task) {
+    if (task == NULL) return;
+
+    uint64_t flags = scheduler_lock();
+
+    run_queue_t *rq = task_rq_lock(task);
+    dequeue(task);
+    spin_unlock(&rq->lock);
+    all_tasks_remove(task);
+
+    scheduler_unlock(flags);
+
+    /* An exiting task may still be switching away on its own stack */
+    while (__atomic_load_n(&task->on_cpu, __ATOMIC_ACQUIRE)) {
+        cpu_relax();
+    }
+}
+
+void scheduler_set_priority(task_t *task, int priority) {
+    if (task == NULL) return;
+    if (priority < SCHED_PRIO_HIGHEST) priority = SCHED_PRIO_HIGHEST;
+    if (priority > SCHED_PRIO_LOWEST) priority = SCHED_PRIO_LOWEST;
+
+    uint64_t flags = local_irq_save();
+    run_queue_t *rq = task_rq_lock(task);
+
+    if (task->queue != NULL && is_run_queue(task->queue)) {
+        dequeue(task);
+        task->priority = priority;
+        enqueue_ready(task);
+    } else {
+        task->priority = priority;
+    }
+
+    spin_unlock(&rq->lock);
+    local_irq_restore(flags);
+}
+
+task_t *scheduler_find_by_pid(uint32_t pid) {
+    uint64_t flags = scheduler_lock();
+
+    task_t *found = NULL;
+    for (task_t *t = all_tasks; t != NULL; t = t->all_next) {
+        if (t->pid == pid) {
+            found = t;
             break;
         }
     }
 
-    /* If only zombie/blocked tasks remain (except idle), switch to idle */
-    if (next->state == PROC_ZOMBIE || next->state == PROC_BLOCKED) {
-        next = idle_task;
-    }
+    scheduler_unlock(flags);
+    return found;
+}
+
+/*
+ * Switch to the next task on this CPU. Called with this CPU's run queue
+ * lock held and interrupts disabled. Once the calling task is picked
+ * again (possibly on another CPU) it returns with the lock dropped and
+ * interrupts still disabled.
+ */
+static void schedule_locked(void) {
+    percpu_t *cpu = this_cpu();
+    run_queue_t *rq = &run_queues[cpu->cpu_id];
+    task_t *old = cpu->curr;
 
-    /* Update states */
-    if (old->state == PROC_RUNNING) {
+    /* Any switch satisfies a pending reschedule request */
+    cpu->need_resched = 0;
+
+    /*
+     * Requeue the outgoing task if it is still runnable; blocked and
+     * zombie tasks were put on their lists under sched_lock. The idle
+     * task is never queued; it is only chosen when nothing else is ready.
+     */
+    if (old == cpu->idle_task) {
         old->state = PROC_READY;
+    } else if (old->state == PROC_RUNNING || old->state == PROC_READY) {
+        old->state = PROC_READY;
+        enqueue_ready(old);
+    }
+
+    /* Highest-priority ready task in O(1), else steal, else idle */
+    task_t *next = pick_next_ready(cpu->cpu_id);
+    if (next == NULL) {
+        next = cpu->idle_task;
     }
+
     next->state = PROC_RUNNING;
-    current_task = next;
+    next->on_cpu = 1;
+    cpu->curr = next;
+
+    /* Tasks are still waiting here: let an idle CPU take one */
+    if (rq->nr_running != 0) {
+        kick_idle_cpu(cpu->cpu_id);
+    }
 
-    /* Reset time slice for next task (Proto 17) */
-    next->ticks_remaining = SCHED_TICK_SLICE;
+    /*
+     * Arm the next task's time slice. Idle gets none, so the timer stays
+     * quiet until a sleeper or a wakeup needs the CPU (tickless idle).
+     */
+    start_slice(cpu, next);
 
     /* Perform context switch if switching to different task */
     if (old != next) {
+        trace_event(TRACE_SCHED_SWITCH, old->pid, next->pid);
+
         /* Switch address space if different */
         uint64_t current_cr3 = read_cr3() & PTE_ADDR_MASK;
         if (next->cr3 != 0 && next->cr3 != current_cr3) {
@@ -152,8 +623,28 @@ void scheduler_yield(void) {
         if (next->is_user && next->kernel_rsp) {
             tss_set_rsp0(next->kernel_rsp);
         }
+
+        /* Eager FPU switch: only user tasks own SIMD state */
+        fpu_save(old);
+        fpu_restore(next);
+        smp_switch_user_bases(old, next);
+        pmu_switch(old, next);
+
+        /* The task we switch to drops rq->lock (finish_switch()) */
+        rq->prev = old;
         context_switch(old, next);
     }
+    finish_switch();
+}
+
+void scheduler_yield(void) {
+    ASSERT(current_task != NULL);
+
+    /* Disable interrupts during scheduling */
+    asm volatile("cli");
+    spin_lock(&run_queues[this_cpu()->cpu_id].lock);
+
+    schedule_locked();
 
     /*
      * Re-enable interrupts (Proto 17).
@@ -170,50 +661,61 @@ void scheduler_yield(void) {
     asm volatile("sti");
 }
 
+void scheduler_yield_locked(void) {
+    task_t *task = current_task;
+    if (task->state == PROC_ZOMBIE) {
+        list_push_back(&zombie_list, task);
+    }
+
+    sched_lock_to_rq();
+    schedule_locked();
+    asm volatile("sti");
+}
+
 /*
- * Preemptive scheduler entry point (Proto 17).
- *
- * Called from timer IRQ handler when current task's time slice expires.
- * This function uses the standard scheduler_yield() path to switch tasks,
- * avoiding the complexity of IRQ-frame vs context-switch frame mismatch.
- *
- * When called for a user task in IRQ context:
- * - The IRQ handler has already saved all registers on the kernel stack
- * - We call scheduler_yield() which will:
- *   - Save current context (via context_switch)
- *   - Pick next task
- *   - Restore next task's context
- * - When we return here, we're in the same task, IRQ handler returns normally
- *
- * The key insight: scheduler_yield() does cooperative switching. When we
- * preempt a user task, we're in kernel mode (in IRQ handler), so we can
- * safely call scheduler_yield(). The user-mode state is already saved
- * on the task's kernel stack by the IRQ entry, and will be restored by iretq.
- *
- * This approach works because:
- * 1. IRQ saves user state on kernel stack
- * 2. scheduler_yield saves kernel state via context_switch
- * 3. Later, context_switch restores kernel state
- * 4. IRQ return restores user state via iretq
+ * Time slice expiry (slice_timer callback, timer IRQ context).
+ * Only requests a reschedule; the switch happens on interrupt return.
  */
-void scheduler_preempt(struct interrupt_frame *frame) {
-    (void)frame;  /* Not used - context saved by scheduler_yield */
+static void slice_expired(hrtimer_t *timer) {
+    (void)timer;
+    percpu_t *cpu = this_cpu();
+    task_t *task = cpu->curr;
+    if (task == NULL || task == cpu->idle_task) return;
+
+    task->ticks_remaining = 0;
+    set_need_resched();
+}
 
-    /* Reentrancy guard - timer could fire while we're in the scheduler */
-    if (in_scheduler) {
-        return;
+/*
+ * Reschedule from interrupt or syscall return.
+ *
+ * Entered with interrupts disabled and the interrupted context saved on
+ * this task's kernel stack. scheduler_yield() returns with IF=1, so the
+ * task's preempt_count is held while it runs to keep a nested IRQ from
+ * preempting again inside this window. Returns with interrupts disabled.
+ */
+void preempt_schedule_irq(void) {
+    task_t *task = current_task;
+    if (task == NULL || task->preempt_count != 0) {
+        return;  /* Deferred to preempt_enable() */
     }
 
-    ASSERT(current_task != NULL);
+    while (this_cpu()->need_resched) {
+        task->preempt_count++;
+        scheduler_yield();
+        asm volatile("cli");
+        task->preempt_count--;
+    }
+}
 
-    /*
-     * Call the standard yield function. This will:
-     * - Save current kernel context
-     * - Switch to next ready task
-     * - Restore that task's kernel context
-     *
-     * When we return (if we return), the IRQ handler will continue
-     * and iretq will restore user state.
-     */
+/*
+ * Reschedule from preempt_enable(). Only switches if interrupts are on;
+ * otherwise the request stays pending for the next interrupt return.
+ */
+void preempt_schedule(void) {
+    task_t *task = current_task;
+    if (task == NULL || task->preempt_count != 0 || !cpu_irqs_enabled()) {
+        return;
+    }
     scheduler_yield();
 }
@@ -1,8 +1,67 @@
+#include <stddef.h>
 #include "serial.h"
 #include "ports.h"
+#include "pic.h"
+#include "spinlock.h"
+#include "waitqueue.h"
 
 #define COM1_PORT 0x3F8
 
+/* UART registers (offsets from COM1_PORT) */
+#define UART_DATA 0     /* THR (write) / RBR (read) */
+#define UART_IER  1     /* Interrupt enable */
+#define UART_IIR  2     /* Interrupt identification (read) */
+#define UART_MCR  4     /* Modem control */
+#define UART_LSR  5     /* Line status */
+
+#define IER_RDI   0x01  /* Received data available */
+#define IER_THRI  0x02  /* Transmit holding register empty */
+
+#define IIR_NO_INT    0x01
+#define IIR_ID_MASK   0x0E
+#define IIR_MSI       0x00  /* Modem status */
+#define IIR_THRI      0x02
+#define IIR_RDI       0x04
+#define IIR_RLSI      0x06  /* Receiver line status */
+#define IIR_TIMEOUT   0x0C  /* Character timeout: data below the RX threshold */
+
+#define LSR_DR    0x01  /* Data ready */
+#define LSR_THRE  0x20  /* THR (and the TX FIFO) empty */
+
+#define UART_FIFO_SIZE 16
+
+/* COM1 is IRQ4 on the legacy PIC */
+#define SERIAL_IRQ 4
+
+#define SERIAL_TX_SIZE 16384    /* Must be a power of two */
+#define SERIAL_RX_SIZE 256
+
+/*
+ * Output starts polled. Once serial_enable_irq() has run it goes into
+ * the TX ring and the THRE interrupt feeds the FIFO, so callers never
+ * wait for the 115200 baud line. serial_emergency() drops back to
+ * polling for good.
+ */
+enum {
+    SERIAL_POLLED,
+    SERIAL_BUFFERED,
+    SERIAL_EMERGENCY
+};
+static volatile int serial_mode = SERIAL_POLLED;
+
+static char tx_buf[SERIAL_TX_SIZE];
+static volatile uint32_t tx_head;   /* Next byte to queue */
+static volatile uint32_t tx_tail;   /* Next byte to send */
+static uint8_t ier_shadow;
+
+static char rx_buf[SERIAL_RX_SIZE];
+static volatile uint32_t rx_head;
+static volatile uint32_t rx_tail;
+static wait_queue_t rx_wait = WAIT_QUEUE_INITIALIZER;
+
+/* TX and RX rings and the IER; taken from the IRQ handler */
+static spinlock_t serial_lock = SPINLOCK_INITIALIZER("serial");
+
 void serial_init(void) {
     outb(COM1_PORT + 1, 0x00);  /* Disable all interrupts */
     outb(COM1_PORT + 3, 0x80);  /* Enable DLAB (set baud rate divisor) */
@@ -13,19 +72,194 @@ void serial_init(void) {
     outb(COM1_PORT + 4, 0x0B);  /* IRQs enabled, RTS/DSR set */
 }
 
+#ifdef REGTEST_BUILD
+void serial_set_loopback(int on) {
+    outb(COM1_PORT + UART_MCR, on ? 0x1B : 0x0B);
+}
+#endif
+
 static int serial_transmit_empty(void) {
-    return inb(COM1_PORT + 5) & 0x20;
+    return inb(COM1_PORT + UART_LSR) & LSR_THRE;
 }
 
-void serial_putc(char c) {
+static void serial_putc_polled(char c) {
     while (!serial_transmit_empty())
         ;
-    outb(COM1_PORT, c);
+    outb(COM1_PORT + UART_DATA, c);
+}
+
+static void set_ier(uint8_t ier) {
+    ier_shadow = ier;
+    outb(COM1_PORT + UART_IER, ier);
+}
+
+/* Refill the TX FIFO if it has drained. Called with serial_lock held. */
+static void tx_fill_fifo(void) {
+    if (!serial_transmit_empty()) {
+        return;
+    }
+    for (int i = 0; i < UART_FIFO_SIZE && tx_tail != tx_head; i++) {
+        outb(COM1_PORT + UART_DATA, tx_buf[tx_tail & (SERIAL_TX_SIZE - 1)]);
+        tx_tail++;
+    }
+}
+
+/* Send everything queued by polling. Called with serial_lock held (or in an emergency). */
+static void tx_drain_polled(void) {
+    while (tx_tail != tx_head) {
+        serial_putc_polled(tx_buf[tx_tail & (SERIAL_TX_SIZE - 1)]);
+        tx_tail++;
+    }
+}
+
+void serial_write(const char *buf, uint64_t len) {
+    if (serial_mode != SERIAL_BUFFERED) {
+        for (uint64_t i = 0; i < len; i++) {
+            serial_putc_polled(buf[i]);
+        }
+        return;
+    }
+
+    uint64_t flags = spin_lock_irqsave(&serial_lock);
+
+    for (uint64_t i = 0; i < len; i++) {
+        /* Ring full: wait for the line rather than drop output */
+        if (tx_head - tx_tail == SERIAL_TX_SIZE) {
+            serial_putc_polled(tx_buf[tx_tail & (SERIAL_TX_SIZE - 1)]);
+            tx_tail++;
+        }
+        tx_buf[tx_head & (SERIAL_TX_SIZE - 1)] = buf[i];
+        tx_head++;
+    }
+
+    /* Idle transmitter: prime the FIFO; THRE interrupts take it from there */
+    if (!(ier_shadow & IER_THRI)) {
+        tx_fill_fifo();
+        if (tx_tail != tx_head) {
+            set_ier(ier_shadow | IER_THRI);
+        }
+    }
+
+    spin_unlock_irqrestore(&serial_lock, flags);
+}
+
+void serial_putc(char c) {
+    serial_write(&c, 1);
 }
 
 void serial_puts(const char *s) {
-    while (*s) {
-        serial_putc(*s++);
+    uint64_t len = 0;
+    while (s[len]) {
+        len++;
+    }
+    serial_write(s, len);
+}
+
+void serial_enable_irq(void) {
+    uint64_t flags = spin_lock_irqsave(&serial_lock);
+    tx_head = tx_tail = 0;
+    rx_head = rx_tail = 0;
+    set_ier(IER_RDI);
+    serial_mode = SERIAL_BUFFERED;
+    spin_unlock_irqrestore(&serial_lock, flags);
+
+    pic_clear_mask(SERIAL_IRQ);
+    serial_puts("SERIAL: IRQ4 enabled, buffered output\n");
+}
+
+void serial_handle_irq(void) {
+    int woke_rx = 0;
+
+    spin_lock(&serial_lock);
+    for (;;) {
+        uint8_t iir = inb(COM1_PORT + UART_IIR);
+        if (iir & IIR_NO_INT) {
+            break;
+        }
+
+        switch (iir & IIR_ID_MASK) {
+        case IIR_RDI:
+        case IIR_TIMEOUT:
+            while (inb(COM1_PORT + UART_LSR) & LSR_DR) {
+                char c = (char)inb(COM1_PORT + UART_DATA);
+                if (rx_head - rx_tail < SERIAL_RX_SIZE) {
+                    rx_buf[rx_head % SERIAL_RX_SIZE] = c;
+                    rx_head++;
+                    woke_rx = 1;
+                }
+            }
+            break;
+        case IIR_THRI:
+            tx_fill_fifo();
+            if (tx_tail == tx_head) {
+                set_ier(ier_shadow & ~IER_THRI);
+            }
+            break;
+        case IIR_RLSI:
+            inb(COM1_PORT + UART_LSR);
+            break;
+        default:
+            inb(COM1_PORT + 6);     /* MSR */
+            break;
+        }
+    }
+    spin_unlock(&serial_lock);
+
+    if (woke_rx) {
+        wake_up_all(&rx_wait);
+    }
+}
+
+void serial_flush(void) {
+    if (serial_mode != SERIAL_BUFFERED) {
+        return;
+    }
+    uint64_t flags = spin_lock_irqsave(&serial_lock);
+    tx_drain_polled();
+    spin_unlock_irqrestore(&serial_lock, flags);
+}
+
+void serial_emergency(void) {
+    /*
+     * The lock may be held by a CPU that will never release it (it was
+     * stopped, or it is us); the caller has interrupts off and the other
+     * CPUs halted, so drain without it.
+     */
+    if (serial_mode == SERIAL_BUFFERED) {
+        serial_mode = SERIAL_EMERGENCY;
+        tx_drain_polled();
+    }
+    serial_mode = SERIAL_EMERGENCY;
+}
+
+uint32_t serial_tx_pending(void) {
+    return tx_head - tx_tail;
+}
+
+int serial_getc_nonblock(void) {
+    int c = -1;
+    uint64_t flags = spin_lock_irqsave(&serial_lock);
+
+    if (rx_tail != rx_head) {
+        c = (unsigned char)rx_buf[rx_tail % SERIAL_RX_SIZE];
+        rx_tail++;
+    } else if (inb(COM1_PORT + UART_LSR) & LSR_DR) {
+        /* Interrupts not on yet (or masked): take it straight from the UART */
+        c = inb(COM1_PORT + UART_DATA);
+    }
+
+    spin_unlock_irqrestore(&serial_lock, flags);
+    return c;
+}
+
+char serial_getc_blocking(void) {
+    for (;;) {
+        wait_event(&rx_wait, rx_head != rx_tail);
+
+        int c = serial_getc_nonblock();
+        if (c >= 0) {
+            return (char)c;
+        }
     }
 }
 
@@ -9,6 +9,12 @@
 #include "heap.h"
 #include "serial.h"
 #include "framebuffer.h"
+#include "lockstat.h"
+#include "printk.h"
+#include "trace.h"
+#include "profile.h"
+#include "bootstat.h"
+#include "clocksource.h"
 
 /*
  * Kernel Shell
@@ -17,6 +23,11 @@
  * - Filesystem inspection (ls, cat)
  * - Program execution (run)
  * - Screen control (clear, help)
+ * - Kernel log (dmesg)
+ * - Tracepoints (trace)
+ * - Sampling profiler (profile)
+ * - Boot timeline (bootstat)
+ * - Lock statistics (lockstat, debug builds only)
  */
 
 /* Forward declarations for command handlers (return SHELL_OK or error code) */
@@ -25,6 +36,13 @@ static int cmd_clear(int argc, char **argv);
 static int cmd_ls(int argc, char **argv);
 static int cmd_cat(int argc, char **argv);
 static int cmd_run(int argc, char **argv);
+static int cmd_dmesg(int argc, char **argv);
+static int cmd_trace(int argc, char **argv);
+static int cmd_profile(int argc, char **argv);
+static int cmd_bootstat(int argc, char **argv);
+#ifdef LOCK_STATS
+static int cmd_lockstat(int argc, char **argv);
+#endif
 
 /* Command table entry */
 typedef struct {
@@ -39,7 +57,14 @@ static const shell_cmd_t commands[] = {
     {"clear", "Clear the screen",             cmd_clear},
     {"ls",    "List files in root directory", cmd_ls},
     {"cat",   "Display file contents",        cmd_cat},
-    {"run",   "Execute an ELF program",       cmd_run},
+    {"run",   "Execute ELF programs",         cmd_run},
+    {"dmesg", "Show the kernel log",          cmd_dmesg},
+    {"trace", "Dump tracepoints to the host (on|off|clear)", cmd_trace},
+    {"profile", "Sample the CPUs (start|stop|report [n])", cmd_profile},
+    {"bootstat", "Show how long each boot stage took", cmd_bootstat},
+#ifdef LOCK_STATS
+    {"lockstat", "Show lock statistics (-r resets)", cmd_lockstat},
+#endif
     {NULL, NULL, NULL}  /* Sentinel */
 };
 
@@ -111,6 +136,143 @@ static int cmd_help(int argc, char **argv) {
     return SHELL_OK;
 }
 
+static int cmd_dmesg(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+
+    struct klog_record rec;
+    char line[KLOG_TEXT_MAX + 24];
+    uint64_t seq = klog_first_seq();
+    while (klog_read(&seq, &rec)) {
+        klog_format(&rec, line, sizeof(line));
+        console_puts(line);
+    }
+    return SHELL_OK;
+}
+
+static int cmd_trace(int argc, char **argv) {
+    if (argc > 1) {
+        if (shell_strcmp(argv[1], "on") == 0) {
+            trace_set_enabled(1);
+        } else if (shell_strcmp(argv[1], "off") == 0) {
+            trace_set_enabled(0);
+        } else if (shell_strcmp(argv[1], "clear") == 0) {
+            trace_clear();
+        } else {
+            console_puts("Usage: trace [on|off|clear]\n");
+            return SHELL_ERR_ARGS;
+        }
+        return SHELL_OK;
+    }
+
+    char line[64];
+    ksnprintf(line, sizeof(line), "trace: %lu events written\n", trace_dump());
+    console_puts(line);
+    return SHELL_OK;
+}
+
+/* Print the hottest functions of one program slot */
+static void profile_print(int prog, uint64_t total, int top) {
+    struct profile_entry entries[16];
+    char line[96];
+
+    int n = profile_top(prog, entries, top);
+    if (n == 0) {
+        return;
+    }
+    ksnprintf(line, sizeof(line), "%s:\n", profile_prog_name(prog));
+    console_puts(line);
+    for (int i = 0; i < n; i++) {
+        uint64_t permille = entries[i].samples * 1000 / total;
+        if (entries[i].name[0]) {
+            ksnprintf(line, sizeof(line), "  %3lu.%lu%%  %6u  %s\n",
+                      permille / 10, permille % 10, entries[i].samples, entries[i].name);
+        } else {
+            ksnprintf(line, sizeof(line), "  %3lu.%lu%%  %6u  0x%lx\n",
+                      permille / 10, permille % 10, entries[i].samples, entries[i].start);
+        }
+        console_puts(line);
+    }
+}
+
+static int cmd_profile(int argc, char **argv) {
+    if (argc > 1 && shell_strcmp(argv[1], "start") == 0) {
+        profile_start();
+        return SHELL_OK;
+    }
+    if (argc > 1 && shell_strcmp(argv[1], "stop") == 0) {
+        profile_stop();
+        return SHELL_OK;
+    }
+    if (argc < 2 || shell_strcmp(argv[1], "report") != 0) {
+        console_puts("Usage: profile start|stop|report [n]\n");
+        return SHELL_ERR_ARGS;
+    }
+
+    int top = 10;
+    if (argc > 2) {
+        top = 0;
+        for (const char *p = argv[2]; *p >= '0' && *p <= '9'; p++) {
+            top = top * 10 + (*p - '0');
+        }
+        if (top < 1 || top > 16) {
+            top = 16;
+        }
+    }
+
+    struct profile_stats stats;
+    char line[96];
+    profile_get_stats(&stats);
+    ksnprintf(line, sizeof(line), "profile: %lu samples, %lu user, %lu dropped\n",
+              stats.samples, stats.user, stats.dropped);
+    console_puts(line);
+    if (stats.samples == 0) {
+        return SHELL_OK;
+    }
+    for (int prog = PROFILE_KERNEL; prog < PROFILE_PROGS; prog++) {
+        if (profile_prog_name(prog) != NULL) {
+            profile_print(prog, stats.samples, top);
+        }
+    }
+    return SHELL_OK;
+}
+
+static int cmd_bootstat(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+
+    char line[96];
+    uint64_t total = bootstat_total_ns();
+    uint64_t ms = total / NSEC_PER_MSEC;
+    uint64_t us = total % NSEC_PER_MSEC / NSEC_PER_USEC;
+    uint64_t preboot_ms = bootstat_preboot_ns() / NSEC_PER_MSEC;
+    ksnprintf(line, sizeof(line), "boot: %lu.%03lu ms in the kernel, %lu ms before it\n",
+              ms, us, preboot_ms);
+    console_puts(line);
+
+    struct bootstat_stage st;
+    for (int i = 0; bootstat_get(i, &st) == 0; i++) {
+        uint64_t permille = total ? st.ns * 1000 / total : 0;
+        ms = st.ns / NSEC_PER_MSEC;
+        us = st.ns % NSEC_PER_MSEC / NSEC_PER_USEC;
+        ksnprintf(line, sizeof(line), "  %6lu.%03lu ms %3lu.%lu%%  %s\n",
+                  ms, us, permille / 10, permille % 10, st.name);
+        console_puts(line);
+    }
+    return SHELL_OK;
+}
+
+#ifdef LOCK_STATS
+static int cmd_lockstat(int argc, char **argv) {
+    if (argc > 1 && shell_strcmp(argv[1], "-r") == 0) {
+        lockstat_reset();
+        return SHELL_OK;
+    }
+    lockstat_dump();
+    return SHELL_OK;
+}
+#endif
+
 static int cmd_clear(int argc, char **argv) {
     (void)argc;
     (void)argv;
@@ -215,52 +377,64 @@ static int cmd_cat(int argc, char **argv) {
 
 static int cmd_run(int argc, char **argv) {
     if (argc < 2) {
-        console_puts("Usage: run <program.elf>\n");
+        console_puts("Usage: run <program.elf> [program.elf ...]\n");
         return SHELL_ERR_ARGS;
     }
 
-    /* Convert filename to uppercase for FAT32 compatibility */
-    char upper_name[SHELL_MAX_LINE];
-    int i;
-    for (i = 0; argv[1][i] && i < SHELL_MAX_LINE - 1; i++) {
-        char c = argv[1][i];
-        if (c >= 'a' && c <= 'z') {
-            c -= 32;  /* Convert to uppercase */
+    /*
+     * Start every program before waiting on any of them, so several jobs
+     * run concurrently (on different CPUs when there are several).
+     */
+    int started = 0;
+    int result = SHELL_OK;
+    for (int arg = 1; arg < argc; arg++) {
+        /* Convert filename to uppercase for FAT32 compatibility */
+        char upper_name[SHELL_MAX_LINE];
+        int i;
+        for (i = 0; argv[arg][i] && i < SHELL_MAX_LINE - 1; i++) {
+            char c = argv[arg][i];
+            if (c >= 'a' && c <= 'z') {
+                c -= 32;  /* Convert to uppercase */
+            }
+            upper_name[i] = c;
+        }
+        upper_name[i] = '\0';
+
+        task_t *task = task_create_from_path(upper_name);
+        if (task == NULL) {
+            console_puts("Failed to load: ");
+            console_puts(upper_name);
+            console_puts("\n");
+            result = SHELL_ERR_FILE;
+            continue;
         }
-        upper_name[i] = c;
-    }
-    upper_name[i] = '\0';
 
-    task_t *task = task_create_from_path(upper_name);
-    if (task == NULL) {
-        console_puts("Failed to load: ");
+        /* Set shell as parent so we can wait for child */
+        task_set_parent(task, task_current());
+        scheduler_add(task);
+        started++;
+
+        console_puts("Running: ");
         console_puts(upper_name);
         console_puts("\n");
-        return SHELL_ERR_FILE;
     }
-
-    /* Set shell as parent so we can wait for child */
-    task_set_parent(task, task_current());
-    scheduler_add(task);
-
-    console_puts("Running: ");
-    console_puts(upper_name);
-    console_puts("\n");
-    fb_present();  /* Show "Running" message immediately */
-
-    /* Wait for child to complete (blocking) */
-    int status;
-    int pid = task_wait(&status);
-
-    if (pid > 0) {
-        console_puts("Process ");
-        console_print_dec(pid);
-        console_puts(" exited with code ");
-        console_print_dec(status);
-        console_puts("\n");
+    fb_present();  /* Show "Running" messages immediately */
+
+    /* Wait for the children to complete (blocking), in exit order */
+    for (int n = 0; n < started; n++) {
+        int status;
+        int pid = task_wait(&status);
+
+        if (pid > 0) {
+            console_puts("Process ");
+            console_print_dec(pid);
+            console_puts(" exited with code ");
+            console_print_dec(status);
+            console_puts("\n");
+        }
     }
 
-    return SHELL_OK;
+    return result;
 }
 
 /* Shell main loop */
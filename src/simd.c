@@ -0,0 +1,220 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "simd.h"
+#include "fpu.h"
+#include "cpu.h"
+#include "pmm.h"
+#include "serial.h"
+
+/* CPUID.(07H,0):EBX */
+#define CPUID_7_EBX_AVX2 (1U << 5)
+
+/* Below this many bytes the FPU save/restore costs more than it saves */
+#define SIMD_MIN_BYTES 256
+
+/* Bulk kernels (simd_ops.S): n is a non-zero multiple of 64, dst 32-aligned */
+extern void simd_copy_sse2(void *dst, const void *src, uint64_t n);
+extern void simd_copy_nt_sse2(void *dst, const void *src, uint64_t n);
+extern void simd_fill_nt_sse2(void *dst, uint64_t pattern, uint64_t n);
+extern void simd_copy_avx2(void *dst, const void *src, uint64_t n);
+extern void simd_copy_nt_avx2(void *dst, const void *src, uint64_t n);
+extern void simd_fill_nt_avx2(void *dst, uint64_t pattern, uint64_t n);
+
+static simd_impl_t impl = SIMD_SCALAR;
+static int has_avx2 = 0;
+
+/* --- Scalar fallbacks (64-bit words) --- */
+
+static void scalar_copy(uint8_t *d, const uint8_t *s, uint64_t n) {
+    uint64_t words = n / 8;
+    for (uint64_t i = 0; i < words; i++) {
+        ((uint64_t *)d)[i] = ((const uint64_t *)s)[i];
+    }
+    for (uint64_t i = words * 8; i < n; i++) {
+        d[i] = s[i];
+    }
+}
+
+static void scalar_copy_backward(uint8_t *d, const uint8_t *s, uint64_t n) {
+    uint64_t words = n / 8;
+    for (uint64_t i = n; i > words * 8; i--) {
+        d[i - 1] = s[i - 1];
+    }
+    for (uint64_t i = words; i > 0; i--) {
+        ((uint64_t *)d)[i - 1] = ((const uint64_t *)s)[i - 1];
+    }
+}
+
+static void scalar_fill32(uint8_t *d, uint32_t value, uint64_t n) {
+    uint64_t pair = ((uint64_t)value << 32) | value;
+    uint64_t words = n / 8;
+    for (uint64_t i = 0; i < words; i++) {
+        ((uint64_t *)d)[i] = pair;
+    }
+    if (n & 4) {
+        *(uint32_t *)(d + words * 8) = value;
+    }
+}
+
+/* --- Dispatch helpers: scalar head/tail around an aligned SIMD body --- */
+
+static uint64_t head_bytes(const void *p) {
+    return (32 - ((uint64_t)p & 31)) & 31;
+}
+
+static void copy_row(uint8_t *d, const uint8_t *s, uint64_t n, int nt) {
+    uint64_t head = head_bytes(d);
+    if (head > n) head = n;
+    scalar_copy(d, s, head);
+    d += head;
+    s += head;
+    n -= head;
+
+    uint64_t body = n & ~63ULL;
+    if (body) {
+        if (impl == SIMD_AVX2) {
+            if (nt) simd_copy_nt_avx2(d, s, body);
+            else simd_copy_avx2(d, s, body);
+        } else {
+            if (nt) simd_copy_nt_sse2(d, s, body);
+            else simd_copy_sse2(d, s, body);
+        }
+    }
+    scalar_copy(d + body, s + body, n - body);
+}
+
+static void fill_row(uint8_t *d, uint32_t value, uint64_t n) {
+    /* The pattern repeats every 4 bytes, so align in whole pixels */
+    uint64_t head = head_bytes(d);
+    if (head > n) head = n;
+    scalar_fill32(d, value, head);
+    d += head;
+    n -= head;
+
+    uint64_t body = n & ~63ULL;
+    if (body) {
+        uint64_t pair = ((uint64_t)value << 32) | value;
+        if (impl == SIMD_AVX2) {
+            simd_fill_nt_avx2(d, pair, body);
+        } else {
+            simd_fill_nt_sse2(d, pair, body);
+        }
+    }
+    scalar_fill32(d + body, value, n - body);
+}
+
+static int use_simd(uint64_t bytes) {
+    return impl != SIMD_SCALAR && bytes >= SIMD_MIN_BYTES && kernel_fpu_usable();
+}
+
+void simd_init(void) {
+    uint32_t a, b, c, d;
+    cpuid(0, 0, &a, &b, &c, &d);
+    if (a >= 7) {
+        cpuid(7, 0, &a, &b, &c, &d);
+        has_avx2 = (b & CPUID_7_EBX_AVX2) && fpu_has_avx();
+    }
+
+    /* SSE2 is architectural on x86-64 */
+    impl = has_avx2 ? SIMD_AVX2 : SIMD_SSE2;
+
+    serial_puts("SIMD: using ");
+    serial_puts(simd_impl_name(impl));
+    serial_puts(" for bulk memory operations\n");
+}
+
+simd_impl_t simd_get_impl(void) {
+    return impl;
+}
+
+int simd_impl_supported(simd_impl_t which) {
+    switch (which) {
+        case SIMD_SCALAR: return 1;
+        case SIMD_SSE2:   return 1;
+        case SIMD_AVX2:   return has_avx2;
+        default:          return 0;
+    }
+}
+
+int simd_set_impl(simd_impl_t which) {
+    if (!simd_impl_supported(which)) {
+        return -1;
+    }
+    impl = which;
+    return 0;
+}
+
+const char *simd_impl_name(simd_impl_t which) {
+    switch (which) {
+        case SIMD_AVX2: return "avx2";
+        case SIMD_SSE2: return "sse2";
+        default:        return "scalar";
+    }
+}
+
+void simd_copy_rect_nt(void *dst, uint64_t dst_pitch,
+                       const void *src, uint64_t src_pitch,
+                       uint64_t row_bytes, uint32_t rows) {
+    uint8_t *d = (uint8_t *)dst;
+    const uint8_t *s = (const uint8_t *)src;
+
+    if (!use_simd(row_bytes * rows)) {
+        for (uint32_t y = 0; y < rows; y++) {
+            scalar_copy(d + y * dst_pitch, s + y * src_pitch, row_bytes);
+        }
+        return;
+    }
+
+    kernel_fpu_begin();
+    for (uint32_t y = 0; y < rows; y++) {
+        copy_row(d + y * dst_pitch, s + y * src_pitch, row_bytes, 1);
+    }
+    kernel_fpu_end();
+}
+
+void simd_fill32_rect_nt(void *dst, uint64_t pitch, uint32_t value,
+                         uint64_t row_bytes, uint32_t rows) {
+    uint8_t *d = (uint8_t *)dst;
+
+    if (!use_simd(row_bytes * rows) || ((uint64_t)d & 3) || (pitch & 3)) {
+        for (uint32_t y = 0; y < rows; y++) {
+            scalar_fill32(d + y * pitch, value, row_bytes);
+        }
+        return;
+    }
+
+    kernel_fpu_begin();
+    for (uint32_t y = 0; y < rows; y++) {
+        fill_row(d + y * pitch, value, row_bytes);
+    }
+    kernel_fpu_end();
+}
+
+void simd_memmove(void *dst, const void *src, uint64_t n) {
+    uint8_t *d = (uint8_t *)dst;
+    const uint8_t *s = (const uint8_t *)src;
+
+    if (d == s || n == 0) {
+        return;
+    }
+
+    /* Overlapping with dst above src: must copy backward (scalar) */
+    if (d > s && d < s + n) {
+        scalar_copy_backward(d, s, n);
+        return;
+    }
+
+    if (!use_simd(n)) {
+        scalar_copy(d, s, n);
+        return;
+    }
+
+    /* Forward copy: loads of each 64-byte block precede its stores */
+    kernel_fpu_begin();
+    copy_row(d, s, n, 0);
+    kernel_fpu_end();
+}
+
+void simd_zero_page(void *page) {
+    simd_fill32_rect_nt(page, PAGE_SIZE, 0, PAGE_SIZE, 1);
+}
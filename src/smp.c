@@ -0,0 +1,193 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "smp.h"
+#define LIMINE_API_REVISION 2
+#include "limine.h"
+#include "percpu.h"
+#include "gdt.h"
+#include "idt.h"
+#include "msr.h"
+#include "cpu.h"
+#include "fpu.h"
+#include "pmu.h"
+#include "lapic.h"
+#include "timer.h"
+#include "paging.h"
+#include "syscall.h"
+#include "scheduler.h"
+#include "clocksource.h"
+#include "serial.h"
+
+/* Limine MP response (set by kernel.c, may be NULL) */
+extern struct limine_mp_response *limine_mp;
+
+/* How long to wait for an AP to report in */
+#define SMP_AP_TIMEOUT_MS 1000
+
+/* CPUID.(EAX=7,ECX=0):EBX bit 0 - RDFSBASE/WRFSBASE/RDGSBASE/WRGSBASE */
+#define CPUID_7_EBX_FSGSBASE (1U << 0)
+#define CR4_FSGSBASE         (1ULL << 16)
+
+/* Per-CPU areas; index 0 is the BSP */
+static percpu_t cpus[SMP_MAX_CPUS];
+
+/* FSGSBASE instructions enabled on every CPU */
+static int fsgsbase = 0;
+
+/* Point GS at pc for kernel mode; user mode starts with a zero GS base */
+static void load_percpu(percpu_t *pc) {
+    if (fsgsbase) {
+        write_cr4(read_cr4() | CR4_FSGSBASE);
+        wrgsbase((uint64_t)pc);
+    } else {
+        wrmsr(MSR_IA32_GS_BASE, (uint64_t)pc);
+    }
+    wrmsr(MSR_IA32_KERNEL_GS_BASE, 0);
+}
+
+void smp_early_init(void) {
+    uint32_t a, b, c, d;
+    cpuid(0, 0, &a, &b, &c, &d);
+    if (a >= 7) {
+        cpuid(7, 0, &a, &b, &c, &d);
+        fsgsbase = (b & CPUID_7_EBX_FSGSBASE) != 0;
+    }
+
+    percpu_t *bsp = &cpus[0];
+    bsp->self = bsp;
+    bsp->cpu_id = 0;
+    bsp->tss = gdt_get_tss(0);
+    bsp->online = 1;
+    load_percpu(bsp);
+
+    if (fsgsbase) {
+        serial_puts("SMP: FSGSBASE enabled\n");
+    }
+}
+
+/* First code an AP runs, on the stack Limine gave it */
+static void ap_entry(struct limine_mp_info *info) {
+    percpu_t *pc = (percpu_t *)info->extra_argument;
+
+    write_cr3(paging_get_kernel_cr3());
+    gdt_init_cpu(pc->cpu_id);
+    idt_load();
+    load_percpu(pc);
+
+    fpu_init_cpu();
+    syscall_init_cpu();
+    pmu_init_cpu();
+    lapic_init_ap();
+
+    /* Becomes this CPU's idle task; sets pc->online */
+    scheduler_run_ap();
+}
+
+void smp_init(void) {
+    cpus[0].lapic_id = lapic_id();
+
+    if (limine_mp == NULL || limine_mp->cpu_count <= 1) {
+        serial_puts("SMP: 1 CPU\n");
+        return;
+    }
+    if (!timer_is_oneshot()) {
+        serial_puts("SMP: No LAPIC timer, staying on the BSP\n");
+        return;
+    }
+
+    uint32_t next = 1;
+    for (uint64_t i = 0; i < limine_mp->cpu_count; i++) {
+        struct limine_mp_info *info = limine_mp->cpus[i];
+        if (info->lapic_id == limine_mp->bsp_lapic_id) {
+            continue;
+        }
+        if (next >= SMP_MAX_CPUS) {
+            serial_puts("SMP: Too many CPUs, ignoring the rest\n");
+            break;
+        }
+
+        percpu_t *pc = &cpus[next];
+        pc->self = pc;
+        pc->cpu_id = next;
+        pc->lapic_id = info->lapic_id;
+        pc->tss = gdt_get_tss(next);
+        pc->online = 0;
+
+        /* Writing goto_address releases the AP */
+        info->extra_argument = (uint64_t)pc;
+        __atomic_store_n(&info->goto_address, ap_entry, __ATOMIC_SEQ_CST);
+
+        /* Start APs one at a time */
+        uint64_t deadline = ktime_get_ns() + SMP_AP_TIMEOUT_MS * NSEC_PER_MSEC;
+        while (!pc->online && ktime_get_ns() < deadline) {
+            asm volatile("pause");
+        }
+        if (!pc->online) {
+            /* Keep its slot: it may still come up late */
+            serial_puts("SMP: CPU with APIC ID ");
+            serial_print_dec(info->lapic_id);
+            serial_puts(" did not start\n");
+        }
+        next++;
+    }
+
+    serial_puts("SMP: ");
+    serial_print_dec(smp_cpu_count());
+    serial_puts(" CPUs online\n");
+}
+
+int smp_has_fsgsbase(void) {
+    return fsgsbase;
+}
+
+/*
+ * With FSGSBASE, ring 3 can change its own FS/GS bases, so they become
+ * per-task state. Called with interrupts disabled: between the swapgs
+ * pair the kernel GS base is not loaded.
+ */
+void smp_switch_user_bases(task_t *prev, task_t *next) {
+    if (!fsgsbase) {
+        return;
+    }
+    if (prev->is_user) {
+        prev->user_fs_base = rdfsbase();
+        asm volatile("swapgs; rdgsbase %0; swapgs" : "=r"(prev->user_gs_base));
+    }
+    if (next->is_user) {
+        wrfsbase(next->user_fs_base);
+        asm volatile("swapgs; wrgsbase %0; swapgs" : : "r"(next->user_gs_base) : "memory");
+    }
+}
+
+uint32_t smp_cpu_count(void) {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < SMP_MAX_CPUS; i++) {
+        if (cpus[i].self != NULL && cpus[i].online) {
+            count++;
+        }
+    }
+    return count;
+}
+
+percpu_t *smp_cpu(uint32_t id) {
+    if (id >= SMP_MAX_CPUS || cpus[id].self == NULL) {
+        return NULL;
+    }
+    return &cpus[id];
+}
+
+void smp_send_resched(uint32_t id) {
+    percpu_t *pc = smp_cpu(id);
+    if (pc == NULL) return;
+
+    pc->need_resched = 1;
+    if (pc != this_cpu()) {
+        lapic_send_ipi(pc->lapic_id, SMP_RESCHED_VECTOR);
+    }
+}
+
+void smp_stop_others(void) {
+    if (smp_cpu_count() > 1) {
+        lapic_send_ipi_others(SMP_STOP_VECTOR);
+    }
+}
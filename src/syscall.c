@@ -1,14 +1,25 @@
+#include <stddef.h>
 #include "syscall.h"
 #include "msr.h"
 #include "gdt.h"
 #include "serial.h"
+#include "virtio_console.h"
+#include "trace.h"
 #include "task.h"
 #include "scheduler.h"
+#include "clocksource.h"
+#include "uring.h"
+#include "pmu.h"
 
 /* Assembly entry point */
 extern void syscall_entry(void);
 
 void syscall_init(void) {
+    syscall_init_cpu();
+    serial_puts("SYSCALL: Initialized MSRs\n");
+}
+
+void syscall_init_cpu(void) {
     uint64_t efer;
 
     /* Enable SYSCALL/SYSRET and NX in EFER */
@@ -40,32 +51,32 @@ void syscall_init(void) {
      * Clear TF (0x100) to disable single-stepping
      */
     wrmsr(MSR_IA32_FMASK, 0x700);
-
-    serial_puts("SYSCALL: Initialized MSRs\n");
 }
 
 /* Syscall: exit(code) - terminate the current task */
-static void sys_exit(uint64_t code) {
+static int64_t sys_exit(uint64_t code) {
     task_exit((int)code);
-    /* Should not return */
+    return 0;  /* Never reached */
 }
 
 /* Syscall: write(fd, buf, len) - write to fd (only fd=1 supported) */
-static uint64_t sys_write(uint64_t fd, uint64_t buf, uint64_t len) {
+static int64_t sys_write(uint64_t fd, uint64_t buf, uint64_t len) {
     if (fd != 1) {
-        return (uint64_t)-1;  /* Only stdout supported */
+        return -1;  /* Only stdout supported */
     }
 
-    const char *s = (const char *)buf;
-    for (uint64_t i = 0; i < len; i++) {
-        serial_putc(s[i]);
+    if (virtio_console_present()) {
+        virtio_console_write((const char *)buf, len);
+    } else {
+        serial_write((const char *)buf, len);
     }
-    return len;
+    return (int64_t)len;
 }
 
 /* Syscall: yield() - voluntarily give up CPU */
-static void sys_yield(void) {
+static int64_t sys_yield(void) {
     scheduler_yield();
+    return 0;
 }
 
 /* Syscall: wait(status) - wait for child to exit */
@@ -76,7 +87,7 @@ static int64_t sys_wait(uint64_t status_ptr) {
     /* Copy status to user space if pointer valid */
     if (pid > 0 && status_ptr != 0) {
         /* Validate user pointer is in user address range */
-        if (status_ptr < 0x800000000000ULL) {  /* Low canonical half */
+        if (status_ptr < USER_ADDR_LIMIT) {
             *(int *)status_ptr = status;
         }
     }
@@ -85,39 +96,136 @@ static int64_t sys_wait(uint64_t status_ptr) {
 }
 
 /* Syscall: getpid() - get current process ID */
-static uint64_t sys_getpid(void) {
+static int64_t sys_getpid(void) {
     return task_getpid();
 }
 
 /* Syscall: getppid() - get parent process ID */
-static uint64_t sys_getppid(void) {
+static int64_t sys_getppid(void) {
     return task_getppid();
 }
 
-uint64_t syscall_dispatch(uint64_t num, uint64_t arg1, uint64_t arg2, uint64_t arg3) {
-    switch (num) {
-        case SYS_exit:
-            sys_exit(arg1);
-            return 0;  /* Never reached */
+/* Syscall: clock_gettime(clk, ts) - read the monotonic clock */
+static int64_t sys_clock_gettime(uint64_t clk, uint64_t ts_ptr) {
+    if (clk != CLOCK_MONOTONIC) {
+        return -1;
+    }
+
+    /* Validate user pointer is in user address range */
+    if (ts_ptr == 0 || ts_ptr + sizeof(struct timespec) > USER_ADDR_LIMIT) {
+        return -1;
+    }
+
+    uint64_t ns = ktime_get_ns();
+    struct timespec *ts = (struct timespec *)ts_ptr;
+    ts->tv_sec = (int64_t)(ns / NSEC_PER_SEC);
+    ts->tv_nsec = (int64_t)(ns % NSEC_PER_SEC);
+    return 0;
+}
+
+/* Syscall: nanosleep(req, rem) - block for the requested interval */
+static int64_t sys_nanosleep(uint64_t req_ptr, uint64_t rem_ptr) {
+    /* Validate user pointers are in user address range */
+    if (req_ptr == 0 || req_ptr + sizeof(struct timespec) > USER_ADDR_LIMIT) {
+        return -EFAULT;
+    }
+    if (rem_ptr != 0 && rem_ptr + sizeof(struct timespec) > USER_ADDR_LIMIT) {
+        return -EFAULT;
+    }
+
+    const struct timespec *req = (const struct timespec *)req_ptr;
+    if (req->tv_sec < 0 || req->tv_nsec < 0 || req->tv_nsec >= (int64_t)NSEC_PER_SEC) {
+        return -EINVAL;
+    }
+
+    int err = task_sleep_ns((uint64_t)req->tv_sec * NSEC_PER_SEC + (uint64_t)req->tv_nsec);
+    if (err != 0) {
+        return err;
+    }
+
+    /* Sleeps are never interrupted early, so nothing remains */
+    if (rem_ptr != 0) {
+        struct timespec *rem = (struct timespec *)rem_ptr;
+        rem->tv_sec = 0;
+        rem->tv_nsec = 0;
+    }
+    return 0;
+}
+
+/* Syscall: ring_setup() - map a submission/completion ring (see uring.h) */
+static int64_t sys_ring_setup(void) {
+    return uring_setup();
+}
 
-        case SYS_write:
-            return sys_write(arg1, arg2, arg3);
+/* Syscall: ring_enter(to_submit, min_complete) - submit a batch, optionally wait */
+static int64_t sys_ring_enter(uint64_t to_submit, uint64_t min_complete) {
+    return uring_enter((uint32_t)to_submit, (uint32_t)min_complete);
+}
 
-        case SYS_yield:
-            sys_yield();
-            return 0;
+/* Syscall: perf_counter(event) - the caller's virtual count of a PMU event */
+static int64_t sys_perf_counter(uint64_t event) {
+    if (event >= PERF_COUNT_MAX) {
+        return -EINVAL;
+    }
+    return pmu_task_read((int)event);
+}
 
-        case SYS_wait:
-            return (uint64_t)sys_wait(arg1);
+/* The compiler checks that handler really takes n arguments */
+#define SYSCALL(handler, n) { .fn##n = (handler), .nargs = (n), .name = #handler }
+
+static const syscall_desc_t syscall_table[NR_SYSCALLS] = {
+    [SYS_exit]          = SYSCALL(sys_exit, 1),
+    [SYS_write]         = SYSCALL(sys_write, 3),
+    [SYS_yield]         = SYSCALL(sys_yield, 0),
+    [SYS_wait]          = SYSCALL(sys_wait, 1),
+    [SYS_getpid]        = SYSCALL(sys_getpid, 0),
+    [SYS_getppid]       = SYSCALL(sys_getppid, 0),
+    [SYS_clock_gettime] = SYSCALL(sys_clock_gettime, 2),
+    [SYS_nanosleep]     = SYSCALL(sys_nanosleep, 2),
+    [SYS_ring_setup]    = SYSCALL(sys_ring_setup, 0),
+    [SYS_ring_enter]    = SYSCALL(sys_ring_enter, 2),
+    [SYS_perf_counter]  = SYSCALL(sys_perf_counter, 1),
+};
+
+const syscall_desc_t *syscall_lookup(uint64_t num) {
+    if (num >= NR_SYSCALLS || syscall_table[num].fn0 == NULL) {
+        return NULL;
+    }
+    return &syscall_table[num];
+}
 
-        case SYS_getpid:
-            return sys_getpid();
+int64_t syscall_dispatch(uint64_t num, uint64_t arg1, uint64_t arg2, uint64_t arg3,
+                         uint64_t arg4, uint64_t arg5, uint64_t arg6) {
+    const syscall_desc_t *desc = syscall_lookup(num);
+    if (desc == NULL) {
+        return -ENOSYS;
+    }
+    trace_event(TRACE_SYSCALL_ENTER, num, arg1);
+    int64_t ret;
+    switch (desc->nargs) {
+    case 0:  ret = desc->fn0(); break;
+    case 1:  ret = desc->fn1(arg1); break;
+    case 2:  ret = desc->fn2(arg1, arg2); break;
+    case 3:  ret = desc->fn3(arg1, arg2, arg3); break;
+    case 4:  ret = desc->fn4(arg1, arg2, arg3, arg4); break;
+    case 5:  ret = desc->fn5(arg1, arg2, arg3, arg4, arg5); break;
+    default: ret = desc->fn6(arg1, arg2, arg3, arg4, arg5, arg6); break;
+    }
+    trace_event(TRACE_SYSCALL_EXIT, num, ret);
+    return ret;
+}
 
-        case SYS_getppid:
-            return sys_getppid();
+void syscall_handler(struct syscall_frame *frame) {
+    frame->rax = (uint64_t)syscall_dispatch(frame->rax, frame->rdi, frame->rsi, frame->rdx,
+                                            frame->r10, frame->r8, frame->r9);
 
-        default:
-            /* Unknown syscall */
-            return (uint64_t)-1;
+    /*
+     * SYSRET with a non-canonical RIP faults in ring 0 on the user stack.
+     * Only a syscall at the very top of the lower half can produce one;
+     * such a task could not have continued anyway, so it dies here.
+     */
+    if (frame->rip >= USER_ADDR_LIMIT) {
+        serial_puts("SYSCALL: Non-canonical return address, killing task\n");
+        task_exit(-1);
     }
 }
@@ -8,18 +8,32 @@
 #include "panic.h"
 #include "gdt.h"
 #include "paging.h"
-#include "serial.h"
+#include "printk.h"
 #include "elf.h"
 #include "vfs.h"
 #include "cpu.h"
+#include "clocksource.h"
+#include "waitqueue.h"
+#include "fpu.h"
+#include "simd.h"
+#include "atomic.h"
+#include "vdso.h"
+#include "uring.h"
+#include "percpu.h"
 
-static uint64_t next_task_id = 0;
+static atomic64_t next_task_id = ATOMIC_INIT(0);
 
 /* PID counter - starts at 1 (PID 0 reserved for kernel) */
-static uint32_t next_pid = 1;
+static atomic_t next_pid = ATOMIC_INIT(1);
 
-/* Current task pointer - exported for scheduler */
-task_t *current_task = NULL;
+/* IDs are handed out from any CPU */
+static inline uint64_t alloc_task_id(void) {
+    return (uint64_t)atomic64_fetch_add(&next_task_id, 1);
+}
+
+static inline uint32_t alloc_pid(void) {
+    return (uint32_t)atomic_fetch_add(&next_pid, 1);
+}
 
 /* Forward declarations */
 static void task_trampoline(void);
@@ -38,7 +52,7 @@ task_t *task_create(void (*entry)(void)) {
     task->stack_base = stack_base;
     task->entry = entry;
     task->state = PROC_READY;
-    task->id = next_task_id++;
+    task->id = alloc_task_id();
     task->next = NULL;
 
     /* Initialize user mode fields (not used for kernel tasks) */
@@ -49,7 +63,7 @@ task_t *task_create(void (*entry)(void)) {
     task->user_stack_base = NULL;
 
     /* Initialize process lifecycle fields */
-    task->pid = next_pid++;
+    task->pid = alloc_pid();
     task->ppid = 0;                /* Kernel tasks have no parent */
     task->parent = NULL;
     task->exit_code = 0;
@@ -63,6 +77,25 @@ task_t *task_create(void (*entry)(void)) {
     /* Initialize preemptive scheduling time slice (Proto 17) */
     task->ticks_remaining = SCHED_TICK_SLICE;
 
+    /* Not on any scheduler list until scheduler_add() */
+    task->prev = NULL;
+    task->queue = NULL;
+    task->priority = SCHED_PRIO_DEFAULT;
+    task->all_next = NULL;
+    task->all_prev = NULL;
+    task->preempt_count = 0;
+    hrtimer_init(&task->sleep_timer, task);
+    wait_queue_init(&task->child_exit_wait);
+    task->fpu_state = NULL;
+    task->fpu_alloc = NULL;
+    task->cpu = 0;
+    task->on_cpu = 0;
+    task->user_fs_base = 0;
+    task->user_gs_base = 0;
+    task->uring = NULL;
+    task->comm[0] = '\0';
+    task->perf.enabled = 0;
+
     /*
      * Set up initial stack frame for context_switch.
      * Stack grows downward, so start at top of allocated region.
@@ -93,15 +126,25 @@ task_t *task_create(void (*entry)(void)) {
  * Calls the task's entry point, then marks task as finished and yields.
  */
 static void task_trampoline(void) {
+    /* Drop the run queue lock held across the switch to us */
+    scheduler_schedule_tail();
+
     /* Enable interrupts - new task starts with interrupts disabled from scheduler_yield */
     asm volatile("sti");
 
     /* Call the actual entry function */
     current_task->entry();
 
-    /* Task has returned - mark as finished and yield */
-    current_task->state = TASK_FINISHED;
-    task_yield();
+    /*
+     * Task has returned - mark as finished, wake a waiting parent and
+     * yield. The parent's task_reap() waits for our final switch away
+     * before it frees the stack we are still running on.
+     */
+    scheduler_lock();
+    task_t *self = current_task;
+    self->state = TASK_FINISHED;
+    task_notify_exit_locked(self);
+    scheduler_yield_locked();
 
     /* Should never reach here */
     ASSERT(0);
@@ -120,11 +163,17 @@ task_t *task_current(void) {
  * Called via context_switch when a user task starts.
  */
 static void user_task_trampoline(void) {
-    /* Enable interrupts */
-    asm volatile("sti");
+    /* Drop the run queue lock held across the switch to us */
+    scheduler_schedule_tail();
+
+    /*
+     * Interrupts stay disabled until iretq: between swapgs and iretq the
+     * GS base already belongs to user mode.
+     */
+    task_t *self = current_task;
 
     /* Set TSS RSP0 so interrupts use this task's kernel stack */
-    tss_set_rsp0(current_task->kernel_rsp);
+    tss_set_rsp0(self->kernel_rsp);
 
     /*
      * Build iretq frame on stack and execute iretq to enter user mode.
@@ -143,10 +192,11 @@ static void user_task_trampoline(void) {
         "pushq %3\n\t"              /* RFLAGS with IF set */
         "pushq %4\n\t"              /* CS = USER_CS */
         "pushq %%rax\n\t"           /* RIP = user entry */
+        "swapgs\n\t"                /* User GS base in, per-CPU area out */
         "iretq\n\t"
         :
-        : "r"(current_task->user_rip),
-          "r"(current_task->user_rsp),
+        : "r"(self->user_rip),
+          "r"(self->user_rsp),
           "i"((uint64_t)USER_DS),
           "i"((uint64_t)0x202),      /* RFLAGS: IF=1, reserved bit 1=1 */
           "i"((uint64_t)USER_CS)
@@ -176,9 +226,7 @@ task_t *task_create_user(const void *code, uint64_t code_size) {
     uint64_t *pml4 = (uint64_t *)phys_to_hhdm(pml4_phys);
 
     /* Zero the PML4 */
-    for (int i = 0; i < 512; i++) {
-        pml4[i] = 0;
-    }
+    simd_zero_page(pml4);
 
     /* Clone kernel mappings into new address space */
     paging_clone_kernel_mappings(pml4);
@@ -211,15 +259,12 @@ task_t *task_create_user(const void *code, uint64_t code_size) {
     }
 
     /* Zero the user stack page */
-    uint8_t *stack_page = (uint8_t *)phys_to_hhdm(user_stack_phys);
-    for (int i = 0; i < TASK_STACK_SIZE; i++) {
-        stack_page[i] = 0;
-    }
+    simd_zero_page(phys_to_hhdm(user_stack_phys));
 
     task->stack_base = kernel_stack_base;
     task->entry = NULL;  /* Not used for user tasks */
     task->state = PROC_READY;
-    task->id = next_task_id++;
+    task->id = alloc_task_id();
     task->next = NULL;
 
     /* User mode fields - all user-space virtual addresses */
@@ -232,7 +277,7 @@ task_t *task_create_user(const void *code, uint64_t code_size) {
     task->kernel_rsp = (uint64_t)kernel_stack_base + TASK_STACK_SIZE;
 
     /* Initialize process lifecycle fields */
-    task->pid = next_pid++;
+    task->pid = alloc_pid();
     task->ppid = current_task ? current_task->pid : 0;
     task->parent = NULL;  /* Not tracked for task_create_user */
     task->exit_code = 0;
@@ -246,6 +291,25 @@ task_t *task_create_user(const void *code, uint64_t code_size) {
     /* Initialize preemptive scheduling time slice (Proto 17) */
     task->ticks_remaining = SCHED_TICK_SLICE;
 
+    /* Not on any scheduler list until scheduler_add() */
+    task->prev = NULL;
+    task->queue = NULL;
+    task->priority = SCHED_PRIO_DEFAULT;
+    task->all_next = NULL;
+    task->all_prev = NULL;
+    task->preempt_count = 0;
+    hrtimer_init(&task->sleep_timer, task);
+    wait_queue_init(&task->child_exit_wait);
+    int fret = fpu_alloc_state(task);
+    ASSERT(fret == 0);
+    task->cpu = 0;
+    task->on_cpu = 0;
+    task->user_fs_base = 0;
+    task->user_gs_base = 0;
+    task->uring = NULL;
+    task->comm[0] = '\0';
+    task->perf.enabled = 0;
+
     /*
      * Set up kernel stack frame for context_switch.
      * Stack grows downward, so start at top of allocated region.
@@ -272,14 +336,14 @@ task_t *task_create_user(const void *code, uint64_t code_size) {
 
 task_t *task_create_elf(const void *data, uint64_t size) {
     if (data == NULL || size == 0) {
-        serial_puts("task_create_elf: Invalid parameters\n");
+        pr_err("task_create_elf: Invalid parameters");
         return NULL;
     }
 
     /* Allocate task struct from heap */
     task_t *task = kmalloc(sizeof(task_t));
     if (task == NULL) {
-        serial_puts("task_create_elf: Out of memory for task struct\n");
+        pr_err("task_create_elf: Out of memory for task struct");
         return NULL;
     }
 
@@ -287,7 +351,7 @@ task_t *task_create_elf(const void *data, uint64_t size) {
     uint64_t kernel_stack_phys = pmm_alloc_frame();
     if (kernel_stack_phys == 0) {
         kfree(task);
-        serial_puts("task_create_elf: Out of memory for kernel stack\n");
+        pr_err("task_create_elf: Out of memory for kernel stack");
         return NULL;
     }
     void *kernel_stack_base = (void *)phys_to_hhdm(kernel_stack_phys);
@@ -297,15 +361,13 @@ task_t *task_create_elf(const void *data, uint64_t size) {
     if (pml4_phys == 0) {
         pmm_free_frame(kernel_stack_phys);
         kfree(task);
-        serial_puts("task_create_elf: Out of memory for PML4\n");
+        pr_err("task_create_elf: Out of memory for PML4");
         return NULL;
     }
     uint64_t *pml4 = (uint64_t *)phys_to_hhdm(pml4_phys);
 
     /* Zero the PML4 */
-    for (int i = 0; i < 512; i++) {
-        pml4[i] = 0;
-    }
+    simd_zero_page(pml4);
 
     /* Clone kernel mappings into new address space */
     paging_clone_kernel_mappings(pml4);
@@ -316,7 +378,7 @@ task_t *task_create_elf(const void *data, uint64_t size) {
         pmm_free_frame(pml4_phys);
         pmm_free_frame(kernel_stack_phys);
         kfree(task);
-        serial_puts("task_create_elf: ELF load failed\n");
+        pr_err("task_create_elf: ELF load failed");
         return NULL;
     }
 
@@ -333,15 +395,12 @@ task_t *task_create_elf(const void *data, uint64_t size) {
             pmm_free_frame(pml4_phys);
             pmm_free_frame(kernel_stack_phys);
             kfree(task);
-            serial_puts("task_create_elf: Out of memory for user stack\n");
+            pr_err("task_create_elf: Out of memory for user stack");
             return NULL;
         }
 
         /* Zero the stack page */
-        uint8_t *stack_page = (uint8_t *)phys_to_hhdm(stack_phys);
-        for (int j = 0; j < 4096; j++) {
-            stack_page[j] = 0;
-        }
+        simd_zero_page(phys_to_hhdm(stack_phys));
 
         /* Map user stack page (read-write, non-executable) into this address space */
         uint64_t page_vaddr = user_stack_base + i * 0x1000;
@@ -351,7 +410,7 @@ task_t *task_create_elf(const void *data, uint64_t size) {
             pmm_free_frame(pml4_phys);
             pmm_free_frame(kernel_stack_phys);
             kfree(task);
-            serial_puts("task_create_elf: Failed to map user stack\n");
+            pr_err("task_create_elf: Failed to map user stack");
             return NULL;
         }
     }
@@ -360,7 +419,7 @@ task_t *task_create_elf(const void *data, uint64_t size) {
     task->stack_base = kernel_stack_base;
     task->entry = NULL;  /* Not used for user tasks */
     task->state = PROC_READY;
-    task->id = next_task_id++;
+    task->id = alloc_task_id();
     task->next = NULL;
 
     /* User mode fields */
@@ -379,7 +438,7 @@ task_t *task_create_elf(const void *data, uint64_t size) {
     task->kernel_rsp = (uint64_t)kernel_stack_base + TASK_STACK_SIZE;
 
     /* Initialize process lifecycle fields */
-    task->pid = next_pid++;
+    task->pid = alloc_pid();
     task->ppid = current_task ? current_task->pid : 0;
     task->parent = NULL;  /* Set via task_set_parent if needed */
     task->exit_code = 0;
@@ -393,6 +452,42 @@ task_t *task_create_elf(const void *data, uint64_t size) {
     /* Initialize preemptive scheduling time slice (Proto 17) */
     task->ticks_remaining = SCHED_TICK_SLICE;
 
+    /* Not on any scheduler list until scheduler_add() */
+    task->prev = NULL;
+    task->queue = NULL;
+    task->priority = SCHED_PRIO_DEFAULT;
+    task->all_next = NULL;
+    task->all_prev = NULL;
+    task->preempt_count = 0;
+    hrtimer_init(&task->sleep_timer, task);
+    wait_queue_init(&task->child_exit_wait);
+
+    /* getpid() and clock reads are served from the vDSO */
+    if (vdso_map(pml4, task->pid) != 0) {
+        paging_free_user_pages(pml4);
+        pmm_free_frame(pml4_phys);
+        pmm_free_frame(kernel_stack_phys);
+        kfree(task);
+        pr_err("task_create_elf: Failed to map vDSO");
+        return NULL;
+    }
+
+    if (fpu_alloc_state(task) != 0) {
+        paging_free_user_pages(pml4);
+        pmm_free_frame(pml4_phys);
+        pmm_free_frame(kernel_stack_phys);
+        kfree(task);
+        pr_err("task_create_elf: Out of memory for FPU state");
+        return NULL;
+    }
+    task->cpu = 0;
+    task->on_cpu = 0;
+    task->user_fs_base = 0;
+    task->user_gs_base = 0;
+    task->uring = NULL;
+    task->comm[0] = '\0';
+    task->perf.enabled = 0;
+
     /*
      * Set up kernel stack frame for context_switch.
      * First context_switch will "return" to user_task_trampoline,
@@ -418,25 +513,23 @@ task_t *task_create_elf(const void *data, uint64_t size) {
 
 task_t *task_create_from_path(const char *path) {
     if (path == NULL) {
-        serial_puts("task_create_from_path: NULL path\n");
+        pr_err("task_create_from_path: NULL path");
         return NULL;
     }
 
-    serial_puts("task_create_from_path: Loading ");
-    serial_puts(path);
-    serial_puts("\n");
+    pr_debug("task_create_from_path: Loading %s", path);
 
     /* Open the file */
     int fd = vfs_open(path);
     if (fd < 0) {
-        serial_puts("task_create_from_path: File not found\n");
+        pr_err("task_create_from_path: File not found");
         return NULL;
     }
 
     /* Get file size */
     uint32_t size = vfs_size(fd);
     if (size == 0) {
-        serial_puts("task_create_from_path: Empty file\n");
+        pr_err("task_create_from_path: Empty file");
         vfs_close(fd);
         return NULL;
     }
@@ -444,7 +537,7 @@ task_t *task_create_from_path(const char *path) {
     /* Allocate buffer for ELF data */
     void *buf = kmalloc(size);
     if (buf == NULL) {
-        serial_puts("task_create_from_path: Out of memory\n");
+        pr_err("task_create_from_path: Out of memory");
         vfs_close(fd);
         return NULL;
     }
@@ -454,13 +547,20 @@ task_t *task_create_from_path(const char *path) {
     vfs_close(fd);
 
     if (bytes_read != (int)size) {
-        serial_puts("task_create_from_path: Read error\n");
+        pr_err("task_create_from_path: Read error");
         kfree(buf);
         return NULL;
     }
 
     /* Create task from ELF data */
     task_t *task = task_create_elf(buf, size);
+    if (task != NULL) {
+        int i;
+        for (i = 0; path[i] && i < TASK_COMM_LEN - 1; i++) {
+            task->comm[i] = path[i];
+        }
+        task->comm[i] = '\0';
+    }
 
     /* Free the buffer (ELF loader copies data to user pages) */
     kfree(buf);
@@ -487,6 +587,8 @@ uint32_t task_getppid(void) {
 void task_set_parent(task_t *child, task_t *parent) {
     if (child == NULL) return;
 
+    uint64_t flags = scheduler_lock();
+
     child->parent = parent;
     child->ppid = parent ? parent->pid : 0;
 
@@ -495,22 +597,17 @@ void task_set_parent(task_t *child, task_t *parent) {
         child->next_sibling = parent->first_child;
         parent->first_child = child;
     }
+
+    scheduler_unlock(flags);
 }
 
 /*
  * Find task by PID.
- * Linear scan of scheduler queue. Returns NULL if not found.
+ * Scans the scheduler's global task list. Returns NULL if not found.
  */
 task_t *task_find_by_pid(uint32_t pid) {
     if (current_task == NULL || pid == 0) return NULL;
-
-    task_t *t = current_task;
-    do {
-        if (t->pid == pid) return t;
-        t = t->next;
-    } while (t != current_task);
-
-    return NULL;
+    return scheduler_find_by_pid(pid);
 }
 
 /*
@@ -533,23 +630,6 @@ static void remove_from_children_list(task_t *child, task_t *parent) {
     child->next_sibling = NULL;
 }
 
-/*
- * Remove task from scheduler queue.
- */
-static void remove_from_scheduler(task_t *task) {
-    if (current_task == NULL || task == NULL) return;
-
-    /* Find predecessor in circular queue */
-    task_t *prev = current_task;
-    while (prev->next != task && prev->next != current_task) {
-        prev = prev->next;
-    }
-
-    if (prev->next == task) {
-        prev->next = task->next;
-    }
-}
-
 /*
  * Reap a zombie task - free its resources.
  * Called after wait() collects the exit code.
@@ -557,33 +637,17 @@ static void remove_from_scheduler(task_t *task) {
 void task_reap(task_t *zombie) {
     if (zombie == NULL) return;
 
-    serial_puts("task_reap: Reaping PID ");
-    /* Simple decimal print */
-    char buf[16];
-    int i = 0;
-    uint32_t n = zombie->pid;
-    if (n == 0) {
-        buf[i++] = '0';
-    } else {
-        char tmp[16];
-        int j = 0;
-        while (n > 0) {
-            tmp[j++] = '0' + (n % 10);
-            n /= 10;
-        }
-        while (j > 0) {
-            buf[i++] = tmp[--j];
-        }
-    }
-    buf[i] = '\0';
-    serial_puts(buf);
-    serial_puts("\n");
+    pr_debug("task_reap: Reaping PID %u", zombie->pid);
 
     /* Remove from parent's children list */
+    uint64_t flags = scheduler_lock();
     remove_from_children_list(zombie, zombie->parent);
+    scheduler_unlock(flags);
 
-    /* Remove from scheduler queue */
-    remove_from_scheduler(zombie);
+    /* Remove from scheduler lists */
+    scheduler_remove(zombie);
+    hrtimer_cancel(&zombie->sleep_timer);
+    fpu_free_state(zombie);
 
     /* Free address space if this is a user task with its own address space */
     if (zombie->pml4 != NULL && zombie->cr3 != paging_get_kernel_cr3()) {
@@ -601,43 +665,91 @@ void task_reap(task_t *zombie) {
     kfree(zombie);
 }
 
+/* First zombie among parent's children, or NULL */
+static task_t *find_zombie_child(task_t *parent) {
+    for (task_t *child = parent->first_child; child != NULL; child = child->next_sibling) {
+        if (child->state == PROC_ZOMBIE) {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Child check for task_wait() and task_try_wait_for(), run under the
+ * scheduler lock. A zombie is unlinked from the children list here, so
+ * two waiters on the same parent can never reap the same child.
+ */
+static int wait_child_ready(task_t *parent, const volatile int *cancel, task_t **zombie) {
+    if (cancel != NULL && *cancel) {
+        return 1;
+    }
+    if (parent->first_child == NULL) {
+        return 1;  /* No children left to wait for */
+    }
+    *zombie = find_zombie_child(parent);
+    if (*zombie != NULL) {
+        remove_from_children_list(*zombie, parent);
+    }
+    return *zombie != NULL;
+}
+
+/* Collect a zombie's exit code and reap it; returns its pid */
+static int reap_child(task_t *zombie, int *status) {
+    int code = zombie->exit_code;
+    uint32_t pid = zombie->pid;
+
+    if (status != NULL) {
+        *status = code;
+    }
+
+    task_reap(zombie);
+    return (int)pid;
+}
+
 /*
  * Wait for any child to exit.
  * Returns child PID on success, -1 if no children.
  * Stores exit code in *status if non-NULL.
  */
 int task_wait(int *status) {
-    task_t *current = task_current();
-    if (current == NULL) return -1;
+    task_t *parent = task_current();
+    if (parent == NULL) return -1;
 
-    /* Check if we have any children at all */
-    if (current->first_child == NULL) {
-        return -1;  /* No children */
+    /*
+     * Sleep on the parent's child_exit_wait queue until a child is a
+     * zombie. wait_event() checks under the scheduler lock, so a child
+     * exiting between the scan and the block cannot be missed.
+     * task_reap() waits for the zombie to switch off its stack.
+     */
+    task_t *zombie = NULL;
+    wait_event(&parent->child_exit_wait, wait_child_ready(parent, NULL, &zombie));
+    if (zombie == NULL) {
+        return -1;  /* No children left */
     }
+    return reap_child(zombie, status);
+}
 
-retry:
-    /* Look for zombie child */
-    for (task_t *child = current->first_child; child != NULL; child = child->next_sibling) {
-        if (child->state == PROC_ZOMBIE) {
-            /* Found zombie - collect exit code and reap */
-            int code = child->exit_code;
-            uint32_t pid = child->pid;
-
-            if (status != NULL) {
-                *status = code;
-            }
+int task_try_wait_for(task_t *parent, int *status, const volatile int *cancel) {
+    task_t *zombie = NULL;
+    uint64_t flags = scheduler_lock();
+    int ready = wait_child_ready(parent, cancel, &zombie);
+    scheduler_unlock(flags);
 
-            task_reap(child);
-            return (int)pid;
-        }
+    if (!ready) {
+        return 0;
     }
+    if (zombie == NULL) {
+        return -1;  /* No children, or cancelled */
+    }
+    return reap_child(zombie, status);
+}
 
-    /* No zombie yet - block until one exits */
-    current->state = PROC_BLOCKED;
-    scheduler_yield();
-
-    /* Woken by child exit - retry to find and reap */
-    goto retry;
+void task_notify_exit_locked(task_t *task) {
+    if (task->parent != NULL) {
+        wake_up_all_locked(&task->parent->child_exit_wait);
+        uring_child_exit(task->parent);
+    }
 }
 
 /*
@@ -648,53 +760,20 @@ void task_exit(int code) {
     task_t *current = task_current();
     if (current == NULL) return;
 
-    serial_puts("task_exit: PID ");
-    char buf[16];
-    int i = 0;
-    uint32_t n = current->pid;
-    if (n == 0) {
-        buf[i++] = '0';
-    } else {
-        char tmp[16];
-        int j = 0;
-        while (n > 0) {
-            tmp[j++] = '0' + (n % 10);
-            n /= 10;
-        }
-        while (j > 0) {
-            buf[i++] = tmp[--j];
-        }
-    }
-    buf[i] = '\0';
-    serial_puts(buf);
-    serial_puts(" exiting with code ");
-
-    i = 0;
-    int val = code;
-    if (val < 0) {
-        buf[i++] = '-';
-        val = -val;
-    }
-    if (val == 0) {
-        buf[i++] = '0';
-    } else {
-        char tmp[16];
-        int j = 0;
-        while (val > 0) {
-            tmp[j++] = '0' + (val % 10);
-            val /= 10;
-        }
-        while (j > 0) {
-            buf[i++] = tmp[--j];
-        }
-    }
-    buf[i] = '\0';
-    serial_puts(buf);
-    serial_puts("\n");
+    pr_debug("task_exit: PID %u exiting with code %d", current->pid, code);
 
     /* Store exit code */
     current->exit_code = code;
 
+    /* Detach the ring before our address space can be reaped */
+    uring_exit(current);
+
+    /*
+     * Orphaning and the zombie transition run under the scheduler lock;
+     * task_reap() waits for our final switch away before freeing us.
+     */
+    scheduler_lock();
+
     /* Orphan any children - set their parent to NULL */
     for (task_t *child = current->first_child; child != NULL; child = child->next_sibling) {
         child->parent = NULL;
@@ -705,11 +784,44 @@ void task_exit(int code) {
     /* Transition to zombie state */
     current->state = PROC_ZOMBIE;
 
-    /* Wake parent if blocked (waiting for us) */
-    if (current->parent != NULL && current->parent->state == PROC_BLOCKED) {
-        current->parent->state = PROC_READY;
-    }
+    /* Wake parent if blocked in task_wait() */
+    task_notify_exit_locked(current);
 
     /* Yield to scheduler - we won't run again */
-    scheduler_yield();
+    scheduler_yield_locked();
+}
+
+/* sleep_timer callback (timer IRQ context): make the sleeper runnable */
+static void task_sleep_timer_fn(hrtimer_t *timer) {
+    scheduler_wake((task_t *)timer->data);
+}
+
+int task_sleep_until(uint64_t deadline_ns) {
+    task_t *current = task_current();
+    if (current == NULL) return 0;
+
+    /*
+     * Arm the timer and block under the scheduler lock so the wakeup
+     * cannot run before we are marked blocked. Loop in case of an early
+     * wakeup.
+     */
+    int ret = 0;
+    uint64_t flags = scheduler_lock();
+    for (;;) {
+        if (ktime_get_ns() >= deadline_ns) {
+            break;
+        }
+        ret = hrtimer_try_start(&current->sleep_timer, deadline_ns, task_sleep_timer_fn);
+        if (ret != 0) {
+            break;
+        }
+        scheduler_block_on(NULL);
+    }
+    hrtimer_cancel(&current->sleep_timer);
+    scheduler_unlock(flags);
+    return ret;
+}
+
+int task_sleep_ns(uint64_t ns) {
+    return task_sleep_until(ktime_get_ns() + ns);
 }
@@ -1,41 +1,114 @@
 #include "timer.h"
 #include "pit.h"
 #include "pic.h"
+#include "lapic.h"
 #include "isr.h"
 #include "kbd.h"
 #include "xhci.h"
 #include "serial.h"
+#include "cpu.h"
+#include "clocksource.h"
+#include "hrtimer.h"
 #include "task.h"
-#include "scheduler.h"
+#include "smp.h"
+#include "preempt.h"
+#include "trace.h"
+#include "profile.h"
 
 #define IRQ_TIMER    0x20
 #define IRQ_KEYBOARD 0x21
 #define IRQ_XHCI     0x22
+#define IRQ_SERIAL   0x24
 #define IRQ_XHCI_MSI 0x40
 
-/* External: current_task is defined in task.c */
-extern task_t *current_task;
+/* Nanoseconds per timer_get_ticks() tick */
+#define NSEC_PER_TICK (NSEC_PER_SEC / TIMER_HZ)
+
+/*
+ * Clock event device.
+ *
+ * Time is read from the clocksource, so timer_get_ticks() does not depend
+ * on periodic interrupts. The hrtimer layer keeps the hardware armed for
+ * its earliest deadline via timer_arm(); with nothing pending the LAPIC
+ * timer stays silent, so an idle system takes no timer interrupts at all.
+ *
+ * If the LAPIC timer cannot be calibrated the PIT keeps running at
+ * TIMER_HZ and expired hrtimers are run on every tick instead.
+ */
+static int oneshot = 0;  /* 1 = LAPIC one-shot, 0 = PIT periodic fallback */
+
+void timer_arm(uint64_t deadline_ns) {
+    if (!oneshot) {
+        return;  /* Periodic PIT checks deadlines every tick */
+    }
+
+    if (deadline_ns == 0) {
+        lapic_timer_stop();
+    } else {
+        uint64_t now = ktime_get_ns();
+        lapic_timer_oneshot(deadline_ns > now ? deadline_ns - now : 0);
+    }
+}
 
 void timer_init(void) {
-    /* Timer is already set up by pic_init() and pit_init() */
-    /* This function exists for future expansion (e.g., callback registration) */
+    if (lapic_timer_init(clocksource_tsc_khz()) == 0) {
+        /* One-shot LAPIC timer takes over; silence the PIT */
+        oneshot = 1;
+        pic_set_mask(0);
+        serial_puts("TIMER: Using LAPIC one-shot timer (tickless)\n");
+    } else {
+        serial_puts("TIMER: Falling back to periodic PIT\n");
+    }
+}
+
+int timer_is_oneshot(void) {
+    return oneshot;
 }
 
 uint64_t timer_get_ticks(void) {
-    return pit_get_ticks();
+    return ktime_get_ns() / NSEC_PER_TICK;
 }
 
-void timer_sleep_ticks(uint64_t ticks) {
-    uint64_t target = timer_get_ticks() + ticks;
-    while (timer_get_ticks() < target) {
-        asm volatile("hlt");
+/* hrtimer callback for timer_sleep_ns(): flag the sleeper */
+static void sleep_timer_fn(hrtimer_t *timer) {
+    *(volatile int *)timer->data = 1;
+}
+
+void timer_sleep_ns(uint64_t ns) {
+    /* Once the scheduler is up, block instead of halting the whole CPU */
+    if (task_current() != NULL) {
+        uint64_t deadline = ktime_get_ns() + ns;
+        if (task_sleep_until(deadline) != 0) {
+            /* Timer heap full of user sleeps: give the CPU away instead */
+            while (ktime_get_ns() < deadline) {
+                task_yield();
+            }
+        }
+        return;
     }
+
+    volatile int fired = 0;
+    hrtimer_t timer;
+    hrtimer_init(&timer, (void *)&fired);
+    hrtimer_start(&timer, ktime_get_ns() + ns, sleep_timer_fn);
+
+    /*
+     * Check and halt with interrupts off so the wakeup cannot slip in
+     * between the test and the hlt (sti takes effect after hlt starts).
+     */
+    asm volatile("cli");
+    while (!fired) {
+        asm volatile("sti; hlt; cli");
+    }
+    asm volatile("sti");
+}
+
+void timer_sleep_ticks(uint64_t ticks) {
+    timer_sleep_ns(ticks * NSEC_PER_TICK);
 }
 
 void timer_sleep_ms(uint64_t ms) {
-    /* Round up to ensure minimum delay is met */
-    uint64_t ticks = (ms * TIMER_HZ + 999) / 1000;
-    timer_sleep_ticks(ticks);
+    timer_sleep_ns(ms * NSEC_PER_MSEC);
 }
 
 /*
@@ -43,28 +116,40 @@ void timer_sleep_ms(uint64_t ms) {
  * Dispatches to appropriate handler based on vector number.
  */
 void irq_handler(struct interrupt_frame *frame) {
-    if (frame->vector == IRQ_TIMER) {
+    trace_event(TRACE_IRQ_ENTER, frame->vector, 0);
+
+    if (frame->vector == LAPIC_TIMER_VECTOR) {
+        lapic_eoi();
+        hrtimer_run_expired();
+        profile_tick(frame);
+    } else if (frame->vector == SMP_RESCHED_VECTOR) {
+        /* Another CPU queued work for us; switch on interrupt return */
+        lapic_eoi();
+        set_need_resched();
+    } else if (frame->vector == SMP_STOP_VECTOR) {
+        /* Another CPU panicked */
+        lapic_eoi();
+        cpu_halt();
+    } else if (frame->vector == IRQ_TIMER) {
         pit_tick();
         pic_send_eoi(0);  /* IRQ0 = timer */
 
         /*
-         * Preemptive scheduling (Proto 17).
-         * Decrement time slice for current task and preempt if expired.
-         * Only preempt RUNNING tasks - idle, zombie, blocked tasks skip.
+         * Run expired hrtimers only - any task switch happens on
+         * interrupt return in irq_common_stub.
          */
-        if (current_task != NULL && current_task->state == PROC_RUNNING) {
-            if (current_task->ticks_remaining > 0) {
-                current_task->ticks_remaining--;
-            }
-            if (current_task->ticks_remaining == 0) {
-                scheduler_preempt(frame);
-            }
-        }
+        hrtimer_run_expired();
+        profile_tick(frame);
     } else if (frame->vector == IRQ_KEYBOARD) {
         kbd_handle_irq();
         pic_send_eoi(1);  /* IRQ1 = keyboard */
+    } else if (frame->vector == IRQ_SERIAL) {
+        serial_handle_irq();
+        pic_send_eoi(4);  /* IRQ4 = COM1 */
     } else if (frame->vector == IRQ_XHCI || frame->vector == IRQ_XHCI_MSI) {
         xhci_handle_irq();
         /* No PIC EOI needed for MSI, but good to know it fired */
     }
+
+    trace_event(TRACE_IRQ_EXIT, frame->vector, 0);
 }
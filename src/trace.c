@@ -0,0 +1,148 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "trace.h"
+#include "cpu.h"
+#include "percpu.h"
+#include "task.h"
+#include "smp.h"
+#include "clocksource.h"
+#include "printk.h"
+#include "serial.h"
+#include "virtio_console.h"
+
+volatile int trace_enabled = 0;
+
+/* Per-CPU rings; only the owning CPU writes, with interrupts off */
+static struct trace_event trace_rings[SMP_MAX_CPUS][TRACE_EVENTS_PER_CPU];
+static uint64_t trace_heads[SMP_MAX_CPUS];     /* Records ever written */
+
+/* Names and phases for the dump header, indexed by event id */
+static const struct {
+    const char *name;
+    char phase;
+} trace_event_info[TRACE_NR_EVENTS] = {
+    [TRACE_SCHED_SWITCH]     = { "sched_switch", 'I' },
+    [TRACE_SYSCALL_ENTER]    = { "syscall",      'B' },
+    [TRACE_SYSCALL_EXIT]     = { "syscall",      'E' },
+    [TRACE_IRQ_ENTER]        = { "irq",          'B' },
+    [TRACE_IRQ_EXIT]         = { "irq",          'E' },
+    [TRACE_BLOCK_READ_BEGIN] = { "block_read",   'B' },
+    [TRACE_BLOCK_READ_END]   = { "block_read",   'E' },
+    [TRACE_FAT_READ_BEGIN]   = { "fat_read",     'B' },
+    [TRACE_FAT_READ_END]     = { "fat_read",     'E' },
+    [TRACE_MARK]             = { "mark",         'I' },
+};
+
+void trace_record(uint16_t id, uint64_t arg0, uint64_t arg1) {
+    uint64_t flags = local_irq_save();
+    percpu_t *cpu = this_cpu();
+    task_t *task = cpu->curr;
+
+    uint64_t n = trace_heads[cpu->cpu_id]++;
+    struct trace_event *ev = &trace_rings[cpu->cpu_id][n & (TRACE_EVENTS_PER_CPU - 1)];
+    ev->tsc = rdtsc();
+    ev->id = id;
+    ev->cpu = (uint16_t)cpu->cpu_id;
+    ev->pid = task != NULL ? task->pid : 0;
+    ev->arg0 = arg0;
+    ev->arg1 = arg1;
+
+    local_irq_restore(flags);
+}
+
+void trace_init(void) {
+    trace_enabled = 1;
+}
+
+void trace_set_enabled(int on) {
+    trace_enabled = on;
+}
+
+void trace_clear(void) {
+    int was = trace_enabled;
+    trace_enabled = 0;
+    for (uint32_t i = 0; i < SMP_MAX_CPUS; i++) {
+        trace_heads[i] = 0;
+    }
+    trace_enabled = was;
+}
+
+uint32_t trace_count(uint32_t cpu) {
+    if (cpu >= SMP_MAX_CPUS) {
+        return 0;
+    }
+    uint64_t head = trace_heads[cpu];
+    return head < TRACE_EVENTS_PER_CPU ? (uint32_t)head : TRACE_EVENTS_PER_CPU;
+}
+
+int trace_get(uint32_t cpu, uint32_t n, struct trace_event *out) {
+    uint32_t count = trace_count(cpu);
+    if (n >= count) {
+        return -1;
+    }
+    uint64_t first = trace_heads[cpu] - count;
+    *out = trace_rings[cpu][(first + n) & (TRACE_EVENTS_PER_CPU - 1)];
+    return 0;
+}
+
+/* ---- Dump ---- */
+
+static void dump_write(const char *buf, uint64_t len) {
+    if (virtio_console_present()) {
+        virtio_console_write(buf, len);
+    } else {
+        serial_write(buf, len);
+    }
+}
+
+uint64_t trace_dump(void) {
+    static const char hex[] = "0123456789abcdef";
+    char out[1024];
+    int len = 0;
+    uint64_t written = 0;
+
+    int was = trace_enabled;
+    trace_enabled = 0;
+
+    uint32_t ncpus = smp_cpu_count();
+    len = ksnprintf(out, sizeof(out), "TRACE-BEGIN khz=%lu cpus=%u\n",
+                    clocksource_tsc_khz(), ncpus);
+    for (int id = 0; id < TRACE_NR_EVENTS; id++) {
+        len += ksnprintf(out + len, sizeof(out) - len, "TRACE-EVENT %d %c %s\n",
+                         id, trace_event_info[id].phase, trace_event_info[id].name);
+    }
+    dump_write(out, (uint64_t)len);
+    len = 0;
+
+    /* "TRACE " + 64 hex digits + newline per record */
+    for (uint32_t cpu = 0; cpu < ncpus && cpu < SMP_MAX_CPUS; cpu++) {
+        uint32_t count = trace_count(cpu);
+        for (uint32_t n = 0; n < count; n++) {
+            struct trace_event ev;
+            trace_get(cpu, n, &ev);
+
+            if (len + 72 > (int)sizeof(out)) {
+                dump_write(out, (uint64_t)len);
+                len = 0;
+            }
+            const uint8_t *bytes = (const uint8_t *)&ev;
+            out[len++] = 'T'; out[len++] = 'R'; out[len++] = 'A';
+            out[len++] = 'C'; out[len++] = 'E'; out[len++] = ' ';
+            for (uint32_t i = 0; i < sizeof(ev); i++) {
+                out[len++] = hex[bytes[i] >> 4];
+                out[len++] = hex[bytes[i] & 0xf];
+            }
+            out[len++] = '\n';
+            written++;
+        }
+    }
+    if (len + 48 > (int)sizeof(out)) {
+        dump_write(out, (uint64_t)len);
+        len = 0;
+    }
+    len += ksnprintf(out + len, sizeof(out) - len, "TRACE-END records=%lu\n", written);
+    dump_write(out, (uint64_t)len);
+
+    trace_enabled = was;
+    return written;
+}
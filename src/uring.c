@@ -0,0 +1,675 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "uring.h"
+#include "syscall.h"
+#include "task.h"
+#include "scheduler.h"
+#include "waitqueue.h"
+#include "spinlock.h"
+#include "atomic.h"
+#include "hrtimer.h"
+#include "clocksource.h"
+#include "paging.h"
+#include "pmm.h"
+#include "heap.h"
+#include "hhdm.h"
+#include "simd.h"
+#include "kbd.h"
+#include "serial.h"
+#include "virtio_console.h"
+
+/*
+ * Kernel tasks that run operations for every ring. They never block on
+ * an operation: a read or wait that cannot finish yet is parked until a
+ * key arrives or a child exits, and a worker picks it up again then.
+ */
+#define URING_WORKERS 2
+
+typedef struct uring {
+    struct uring_shared *shared;    /* Ring page via HHDM */
+    uint64_t page_phys;
+    uint64_t *pml4;                 /* Owner's address space (valid while !dead) */
+    task_t *owner;                  /* Valid while !dead */
+    volatile int dead;              /* Owner has exited */
+    atomic_t refs;                  /* Owner plus one per operation */
+    atomic_t inflight;              /* Submitted, CQE not yet posted */
+    atomic_t timers;                /* Nanosleeps with an hrtimer pending */
+    uint32_t sq_head;               /* Private copy; user code cannot move it */
+    spinlock_t lock;                /* CQ posting, dead, waits, user memory access */
+    wait_queue_t cq_wait;           /* Owner blocked in uring_enter() */
+    struct uring_op *waits;         /* Parked WAITs, retried when a child exits */
+    uint32_t child_exits;           /* Bumped with waits taken, under lock */
+} uring_t;
+
+typedef struct uring_op {
+    struct uring_op *next;          /* Worker queue or parked list */
+    struct uring_op *link;          /* Held back until this op completes */
+    uring_t *ring;
+    struct uring_sqe sqe;           /* Copied at submit */
+    void *buf;                      /* Kernel copy of the write data */
+    uint64_t sleep_ns;
+    int done;                       /* res is final; the worker only posts it */
+    int64_t res;
+    hrtimer_t timer;
+} uring_op_t;
+
+/* Operations waiting for a worker */
+static uring_op_t *work_head = NULL;
+static uring_op_t *work_tail = NULL;
+static spinlock_t work_lock = SPINLOCK_INITIALIZER("uring");
+static wait_queue_t work_wait = WAIT_QUEUE_INITIALIZER;
+static atomic_t workers_started = ATOMIC_INIT(0);
+
+/* Reads parked until the keyboard has input, oldest first */
+static uring_op_t *read_head = NULL;
+static uring_op_t *read_tail = NULL;
+static spinlock_t read_lock = SPINLOCK_INITIALIZER("uring_read");
+
+static void start_op(uring_op_t *op);
+
+static void uring_put(uring_t *ring) {
+    if (atomic_dec_and_test(&ring->refs)) {
+        spin_lock_destroy(&ring->lock);
+        pmm_free_frame(ring->page_phys);
+        kfree(ring);
+    }
+}
+
+static void op_free(uring_op_t *op) {
+    uring_t *ring = op->ring;
+    if (op->buf != NULL) {
+        kfree(op->buf);
+    }
+    kfree(op);
+    uring_put(ring);
+}
+
+static void enqueue_work(uring_op_t *op) {
+    op->next = NULL;
+    uint64_t flags = spin_lock_irqsave(&work_lock);
+    if (work_tail != NULL) {
+        work_tail->next = op;
+    } else {
+        work_head = op;
+    }
+    work_tail = op;
+    spin_unlock_irqrestore(&work_lock, flags);
+}
+
+/* Hand op to a worker. Safe from IRQs. */
+static void queue_work(uring_op_t *op) {
+    enqueue_work(op);
+    wake_up_one(&work_wait);
+}
+
+/* wait_event() condition: runs under the scheduler lock */
+static uring_op_t *dequeue_work(void) {
+    spin_lock(&work_lock);
+    uring_op_t *op = work_head;
+    if (op != NULL) {
+        work_head = op->next;
+        if (work_head == NULL) {
+            work_tail = NULL;
+        }
+    }
+    spin_unlock(&work_lock);
+    return op;
+}
+
+static uint32_t cq_pending(const uring_t *ring) {
+    const struct uring_shared *sh = ring->shared;
+    return __atomic_load_n(&sh->cq_tail, __ATOMIC_ACQUIRE) -
+           __atomic_load_n(&sh->cq_head, __ATOMIC_ACQUIRE);
+}
+
+static void post_cqe(uring_t *ring, uint64_t user_data, int64_t res) {
+    struct uring_shared *sh = ring->shared;
+
+    uint64_t flags = spin_lock_irqsave(&ring->lock);
+    if (!ring->dead) {
+        uint32_t tail = sh->cq_tail;
+        if (tail - sh->cq_head >= URING_CQ_ENTRIES) {
+            sh->cq_overflow++;
+        } else {
+            struct uring_cqe *cqe = &sh->cqes[tail & (URING_CQ_ENTRIES - 1)];
+            cqe->user_data = user_data;
+            cqe->res = res;
+            __atomic_store_n(&sh->cq_tail, tail + 1, __ATOMIC_RELEASE);
+        }
+    }
+    atomic_dec(&ring->inflight);
+    spin_unlock_irqrestore(&ring->lock, flags);
+
+    wake_up_all(&ring->cq_wait);
+}
+
+/* Post op's result and start (or cancel) whatever was linked behind it */
+static void complete_op(uring_op_t *op) {
+    int64_t res = op->res;
+    uring_op_t *next = op->link;
+
+    post_cqe(op->ring, op->sqe.user_data, res);
+    op_free(op);
+
+    while (next != NULL && res < 0) {
+        uring_op_t *after = next->link;
+        post_cqe(next->ring, next->sqe.user_data, -ECANCELED);
+        op_free(next);
+        next = after;
+    }
+    if (next != NULL) {
+        start_op(next);
+    }
+}
+
+/* Copy len bytes to user address uaddr in the ring owner's address space */
+static int64_t copy_to_owner(uring_t *ring, uint64_t uaddr, const void *src, uint64_t len) {
+    const uint8_t *from = (const uint8_t *)src;
+    int64_t ret = 0;
+
+    /* The lock keeps the owner from being reaped (and its pages freed) meanwhile */
+    uint64_t flags = spin_lock_irqsave(&ring->lock);
+    if (ring->dead) {
+        ret = -ECANCELED;
+    }
+    while (ret == 0 && len > 0) {
+        uint64_t pte = paging_get_pte_in(ring->pml4, uaddr);
+        if ((pte & (PTE_USER | PTE_WRITABLE)) != (PTE_USER | PTE_WRITABLE)) {
+            ret = -EFAULT;
+            break;
+        }
+        uint64_t off = uaddr & 0xFFF;
+        uint64_t chunk = 0x1000 - off;
+        if (chunk > len) {
+            chunk = len;
+        }
+        simd_memmove((uint8_t *)phys_to_hhdm(pte & PTE_ADDR_MASK) + off, from, chunk);
+        uaddr += chunk;
+        from += chunk;
+        len -= chunk;
+    }
+    spin_unlock_irqrestore(&ring->lock, flags);
+    return ret;
+}
+
+/* hrtimer callback (timer IRQ): the sleep is over */
+static void sleep_timer_fn(hrtimer_t *timer) {
+    uring_op_t *op = (uring_op_t *)timer->data;
+    atomic_dec(&op->ring->timers);
+    op->res = 0;
+    op->done = 1;
+    queue_work(op);
+}
+
+static void start_op(uring_op_t *op) {
+    switch (op->sqe.opcode) {
+    case URING_OP_NOP:
+        op->res = 0;
+        complete_op(op);
+        break;
+    case URING_OP_NANOSLEEP:
+        /* Bound what one process can put on the shared timer heap */
+        if (atomic_add_return(&op->ring->timers, 1) > URING_MAX_TIMERS) {
+            atomic_dec(&op->ring->timers);
+            op->res = -EAGAIN;
+            complete_op(op);
+            break;
+        }
+        hrtimer_init(&op->timer, op);
+        if (hrtimer_try_start(&op->timer, ktime_get_ns() + op->sleep_ns,
+                              sleep_timer_fn) != 0) {
+            atomic_dec(&op->ring->timers);
+            op->res = -EAGAIN;
+            complete_op(op);
+        }
+        break;
+    default:
+        queue_work(op);
+        break;
+    }
+}
+
+/*
+ * Take up to len buffered keys for a read, or park it if there are none.
+ * Returns the number taken, 0 if parked, or -ECANCELED once the owner
+ * has exited. read_lock is held throughout, so a key queued after the
+ * buffer was found empty finds the read parked (see uring_kbd_input()),
+ * and uring_exit() either finds it parked or it sees dead.
+ */
+static int64_t take_keys(uring_op_t *op, char *buf) {
+    int64_t n = 0;
+    uint64_t flags = spin_lock_irqsave(&read_lock);
+    if (op->ring->dead) {
+        n = -ECANCELED;
+    }
+    while (n >= 0 && n < op->sqe.len) {
+        int c = kbd_getc_nonblock();
+        if (c < 0) {
+            break;
+        }
+        buf[n++] = (char)c;
+    }
+    if (n == 0) {
+        op->next = NULL;
+        if (read_tail != NULL) {
+            read_tail->next = op;
+        } else {
+            read_head = op;
+        }
+        read_tail = op;
+    }
+    spin_unlock_irqrestore(&read_lock, flags);
+    return n;
+}
+
+/*
+ * Reap a child for a WAIT, or park it on the ring if none has exited.
+ * Returns the pid, 0 if parked, or -1 if there are no children (or the
+ * owner has exited). A child exiting between the check and the park
+ * bumps child_exits, so the check is run again instead of parking.
+ */
+static int wait_child(uring_op_t *op, int *status) {
+    uring_t *ring = op->ring;
+    for (;;) {
+        uint32_t seen = __atomic_load_n(&ring->child_exits, __ATOMIC_ACQUIRE);
+        int pid = task_try_wait_for(ring->owner, status, &ring->dead);
+        if (pid != 0) {
+            return pid;
+        }
+        uint64_t flags = spin_lock_irqsave(&ring->lock);
+        if (!ring->dead && ring->child_exits == seen) {
+            op->next = ring->waits;
+            ring->waits = op;
+            spin_unlock_irqrestore(&ring->lock, flags);
+            return 0;
+        }
+        spin_unlock_irqrestore(&ring->lock, flags);
+    }
+}
+
+/*
+ * Run an operation on a worker and set op->res. Returns 1 if it was
+ * parked instead, to be queued again when it can make progress.
+ */
+static int run_op(uring_op_t *op) {
+    uring_t *ring = op->ring;
+
+    switch (op->sqe.opcode) {
+    case URING_OP_WRITE: {
+        if (virtio_console_present()) {
+            virtio_console_write((const char *)op->buf, op->sqe.len);
+        } else {
+            serial_write((const char *)op->buf, op->sqe.len);
+        }
+        op->res = op->sqe.len;
+        break;
+    }
+
+    case URING_OP_READ: {
+        /* Take whatever keys are buffered, or wait for the next one */
+        char *buf = kmalloc(op->sqe.len);
+        if (buf == NULL) {
+            op->res = -ENOMEM;
+            break;
+        }
+        int64_t n = take_keys(op, buf);
+        if (n == 0) {
+            kfree(buf);
+            return 1;
+        }
+        if (n < 0) {
+            uring_kbd_input();  /* Pass on the wakeup this read may have taken */
+        }
+        int64_t err = n < 0 ? n : copy_to_owner(ring, op->sqe.addr, buf, n);
+        op->res = err != 0 ? err : n;
+        kfree(buf);
+        break;
+    }
+
+    case URING_OP_WAIT: {
+        int status = 0;
+        int pid = wait_child(op, &status);
+        if (pid == 0) {
+            return 1;
+        }
+        if (pid < 0) {
+            op->res = ring->dead ? -ECANCELED : -ECHILD;
+            break;
+        }
+        op->res = pid;
+        if (op->sqe.addr != 0) {
+            int64_t err = copy_to_owner(ring, op->sqe.addr, &status, sizeof(status));
+            if (err != 0) {
+                op->res = err;
+            }
+        }
+        break;
+    }
+
+    default:
+        op->res = -EINVAL;
+        break;
+    }
+    return 0;
+}
+
+static void uring_worker(void) {
+    for (;;) {
+        uring_op_t *op = NULL;
+        wait_event(&work_wait, (op = dequeue_work()) != NULL);
+        if (!op->done && run_op(op) != 0) {
+            continue;  /* Parked */
+        }
+        complete_op(op);
+    }
+}
+
+void uring_kbd_input(void) {
+    uint64_t flags = spin_lock_irqsave(&read_lock);
+    uring_op_t *op = read_head;
+    if (op != NULL) {
+        read_head = op->next;
+        if (read_head == NULL) {
+            read_tail = NULL;
+        }
+    }
+    spin_unlock_irqrestore(&read_lock, flags);
+
+    if (op != NULL) {
+        queue_work(op);
+    }
+}
+
+void uring_child_exit(task_t *parent) {
+    /* uring_exit() clears parent->uring under the scheduler lock we hold */
+    uring_t *ring = parent->uring;
+    if (ring == NULL) {
+        return;
+    }
+
+    spin_lock(&ring->lock);
+    uring_op_t *op = ring->waits;
+    ring->waits = NULL;
+    ring->child_exits++;
+    spin_unlock(&ring->lock);
+
+    if (op == NULL) {
+        return;
+    }
+    while (op != NULL) {
+        uring_op_t *next = op->next;
+        enqueue_work(op);
+        op = next;
+    }
+    wake_up_all_locked(&work_wait);
+}
+
+static void start_workers(void) {
+    if (atomic_cmpxchg(&workers_started, 0, 1) != 0) {
+        return;
+    }
+    for (int i = 0; i < URING_WORKERS; i++) {
+        scheduler_add(task_create(uring_worker));
+    }
+    serial_puts("URING: Started workers\n");
+}
+
+static int user_range_ok(uint64_t addr, uint64_t len) {
+    return addr != 0 && addr + len >= addr && addr + len <= USER_ADDR_LIMIT;
+}
+
+/*
+ * Validate an SQE and build its operation. Runs in the owner's address
+ * space, so user memory is read directly. Returns NULL with *err set if
+ * the SQE is rejected.
+ */
+static uring_op_t *prepare_op(uring_t *ring, const struct uring_sqe *sqe, int64_t *err) {
+    uint64_t sleep_ns = 0;
+
+    switch (sqe->opcode) {
+    case URING_OP_NOP:
+        break;
+
+    case URING_OP_WRITE:
+    case URING_OP_READ:
+        if (sqe->fd != (sqe->opcode == URING_OP_WRITE ? 1 : 0)) {
+            *err = -EBADF;
+            return NULL;
+        }
+        if (sqe->len > URING_MAX_IO || (sqe->opcode == URING_OP_READ && sqe->len == 0)) {
+            *err = -EINVAL;
+            return NULL;
+        }
+        if (sqe->len != 0 && !user_range_ok(sqe->addr, sqe->len)) {
+            *err = -EFAULT;
+            return NULL;
+        }
+        break;
+
+    case URING_OP_NANOSLEEP: {
+        if (!user_range_ok(sqe->addr, sizeof(struct timespec))) {
+            *err = -EFAULT;
+            return NULL;
+        }
+        const struct timespec *ts = (const struct timespec *)sqe->addr;
+        if (ts->tv_sec < 0 || ts->tv_nsec < 0 || ts->tv_nsec >= (int64_t)NSEC_PER_SEC) {
+            *err = -EINVAL;
+            return NULL;
+        }
+        sleep_ns = (uint64_t)ts->tv_sec * NSEC_PER_SEC + (uint64_t)ts->tv_nsec;
+        break;
+    }
+
+    case URING_OP_WAIT:
+        if (sqe->addr != 0 && !user_range_ok(sqe->addr, sizeof(int))) {
+            *err = -EFAULT;
+            return NULL;
+        }
+        break;
+
+    default:
+        *err = -EINVAL;
+        return NULL;
+    }
+
+    uring_op_t *op = kmalloc(sizeof(uring_op_t));
+    if (op == NULL) {
+        *err = -ENOMEM;
+        return NULL;
+    }
+    op->next = NULL;
+    op->link = NULL;
+    op->ring = ring;
+    op->sqe = *sqe;
+    op->buf = NULL;
+    op->sleep_ns = sleep_ns;
+    op->done = 0;
+    op->res = 0;
+
+    /* Writes are copied now, so the buffer is reusable once ring_enter returns */
+    if (sqe->opcode == URING_OP_WRITE && sqe->len != 0) {
+        op->buf = kmalloc(sqe->len);
+        if (op->buf == NULL) {
+            kfree(op);
+            *err = -ENOMEM;
+            return NULL;
+        }
+        simd_memmove(op->buf, (const void *)sqe->addr, sqe->len);
+    }
+
+    atomic_inc(&ring->refs);
+    return op;
+}
+
+int64_t uring_setup(void) {
+    task_t *current = task_current();
+    if (current == NULL || !current->is_user || current->pml4 == NULL) {
+        return -EINVAL;
+    }
+    if (current->uring != NULL) {
+        return -EEXIST;
+    }
+
+    uring_t *ring = kmalloc(sizeof(uring_t));
+    if (ring == NULL) {
+        return -ENOMEM;
+    }
+    uint64_t phys = pmm_alloc_frame();
+    if (phys == 0) {
+        kfree(ring);
+        return -ENOMEM;
+    }
+    struct uring_shared *sh = (struct uring_shared *)phys_to_hhdm(phys);
+    simd_zero_page(sh);
+    sh->sq_entries = URING_SQ_ENTRIES;
+    sh->cq_entries = URING_CQ_ENTRIES;
+
+    /* PTE_SHARED: the frame outlives the address space while ops are in flight */
+    if (paging_map_page_in(current->pml4, URING_VADDR, phys,
+                           PTE_PRESENT | PTE_USER | PTE_WRITABLE | PTE_NX | PTE_SHARED) != 0) {
+        pmm_free_frame(phys);
+        kfree(ring);
+        return -ENOMEM;
+    }
+
+    ring->shared = sh;
+    ring->page_phys = phys;
+    ring->pml4 = current->pml4;
+    ring->owner = current;
+    ring->dead = 0;
+    atomic_set(&ring->refs, 1);
+    atomic_set(&ring->inflight, 0);
+    atomic_set(&ring->timers, 0);
+    ring->waits = NULL;
+    ring->child_exits = 0;
+    ring->sq_head = 0;
+    spin_lock_init(&ring->lock, "uring_cq");
+    wait_queue_init(&ring->cq_wait);
+    current->uring = ring;
+
+    start_workers();
+    return (int64_t)URING_VADDR;
+}
+
+int64_t uring_enter(uint32_t to_submit, uint32_t min_complete) {
+    task_t *current = task_current();
+    uring_t *ring = current != NULL ? current->uring : NULL;
+    if (ring == NULL) {
+        return -EINVAL;
+    }
+    struct uring_shared *sh = ring->shared;
+
+    uint32_t avail = __atomic_load_n(&sh->sq_tail, __ATOMIC_ACQUIRE) - ring->sq_head;
+    if (avail > URING_SQ_ENTRIES) {
+        return -EINVAL;  /* sq_tail is garbage */
+    }
+    if (to_submit > avail) {
+        to_submit = avail;
+    }
+
+    /*
+     * Never have more operations outstanding than the CQ can hold, so
+     * completions are only dropped if user code stops reaping them.
+     */
+    uint32_t submitted = 0;
+    uring_op_t *chain_head = NULL;
+    uring_op_t *chain_tail = NULL;
+    while (submitted < to_submit &&
+           cq_pending(ring) + (uint32_t)atomic_read(&ring->inflight) < URING_CQ_ENTRIES) {
+        struct uring_sqe sqe = sh->sqes[ring->sq_head & (URING_SQ_ENTRIES - 1)];
+        ring->sq_head++;
+        submitted++;
+
+        atomic_inc(&ring->inflight);
+        int64_t err = 0;
+        uring_op_t *op = prepare_op(ring, &sqe, &err);
+        if (op == NULL) {
+            post_cqe(ring, sqe.user_data, err);
+            continue;
+        }
+
+        /* Linked SQEs are chained and started together once the chain ends */
+        if (chain_tail != NULL) {
+            chain_tail->link = op;
+        } else {
+            chain_head = op;
+        }
+        chain_tail = op;
+        if (!(sqe.flags & URING_SQE_LINK)) {
+            start_op(chain_head);
+            chain_head = chain_tail = NULL;
+        }
+    }
+    if (chain_head != NULL) {
+        start_op(chain_head);  /* A link on the last SQE of the batch goes nowhere */
+    }
+    __atomic_store_n(&sh->sq_head, ring->sq_head, __ATOMIC_RELEASE);
+
+    if (min_complete > URING_CQ_ENTRIES) {
+        min_complete = URING_CQ_ENTRIES;
+    }
+    if (min_complete > 0) {
+        wait_event(&ring->cq_wait,
+                   cq_pending(ring) >= min_complete || atomic_read(&ring->inflight) == 0);
+    }
+
+    if (submitted == 0 && to_submit > 0) {
+        return -EBUSY;
+    }
+    return submitted;
+}
+
+/* Hand a parked operation back to a worker to post -ECANCELED */
+static void cancel_parked(uring_op_t *op) {
+    op->res = -ECANCELED;
+    op->done = 1;
+    queue_work(op);
+}
+
+void uring_exit(task_t *task) {
+    uring_t *ring = task->uring;
+    if (ring == NULL) {
+        return;
+    }
+
+    /* Under the scheduler lock so uring_child_exit() cannot still be using it */
+    uint64_t flags = scheduler_lock();
+    task->uring = NULL;
+    scheduler_unlock(flags);
+
+    flags = spin_lock_irqsave(&ring->lock);
+    ring->dead = 1;
+    uring_op_t *waits = ring->waits;
+    ring->waits = NULL;
+    spin_unlock_irqrestore(&ring->lock, flags);
+
+    /* Pull our reads off the keyboard queue so they take no more keys */
+    uring_op_t *reads = NULL;
+    flags = spin_lock_irqsave(&read_lock);
+    uring_op_t **link = &read_head;
+    read_tail = NULL;
+    while (*link != NULL) {
+        uring_op_t *op = *link;
+        if (op->ring == ring) {
+            *link = op->next;
+            op->next = reads;
+            reads = op;
+        } else {
+            read_tail = op;
+            link = &op->next;
+        }
+    }
+    spin_unlock_irqrestore(&read_lock, flags);
+
+    while (waits != NULL) {
+        uring_op_t *next = waits->next;
+        cancel_parked(waits);
+        waits = next;
+    }
+    while (reads != NULL) {
+        uring_op_t *next = reads->next;
+        cancel_parked(reads);
+        reads = next;
+    }
+    uring_put(ring);
+}
@@ -0,0 +1,72 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "vdso.h"
+#include "paging.h"
+#include "pmm.h"
+#include "hhdm.h"
+#include "clocksource.h"
+#include "simd.h"
+#include "serial.h"
+
+/* Image assembled in vdso_image.S */
+extern const uint8_t vdso_image_start[];
+extern const uint8_t vdso_image_end[];
+
+/* Shared code page (0 until vdso_init() succeeds) */
+static uint64_t vdso_phys = 0;
+
+void vdso_init(void) {
+    uint64_t size = (uint64_t)(vdso_image_end - vdso_image_start);
+    if (size > 0x1000) {
+        serial_puts("VDSO: Image larger than a page\n");
+        return;
+    }
+
+    uint64_t phys = pmm_alloc_frame();
+    if (phys == 0) {
+        serial_puts("VDSO: Out of memory\n");
+        return;
+    }
+    uint8_t *page = (uint8_t *)phys_to_hhdm(phys);
+    simd_zero_page(page);
+    for (uint64_t i = 0; i < size; i++) {
+        page[i] = vdso_image_start[i];
+    }
+    vdso_phys = phys;
+
+    serial_puts("VDSO: ");
+    serial_print_dec(size);
+    serial_puts(" bytes\n");
+}
+
+int vdso_map(uint64_t *pml4, uint32_t pid) {
+    if (vdso_phys == 0) {
+        return -1;
+    }
+
+    uint64_t vvar_phys = pmm_alloc_frame();
+    if (vvar_phys == 0) {
+        return -1;
+    }
+    struct vdso_data *data = (struct vdso_data *)phys_to_hhdm(vvar_phys);
+    simd_zero_page(data);
+
+    data->pid = pid;
+    if (clocksource_tsc_conversion(&data->tsc_base, &data->tsc_mult)) {
+        data->clock_mode = VDSO_CLOCK_TSC;
+    } else {
+        data->clock_mode = VDSO_CLOCK_NONE;
+    }
+    data->tsc_khz = clocksource_tsc_khz();
+
+    /* vvar is owned by the process and freed with it; the code page is shared */
+    if (paging_map_user_page_in(pml4, VVAR_VADDR, vvar_phys, 0, 0) != 0) {
+        pmm_free_frame(vvar_phys);
+        return -1;
+    }
+    if (paging_map_page_in(pml4, VDSO_VADDR, vdso_phys,
+                           PTE_PRESENT | PTE_USER | PTE_SHARED) != 0) {
+        return -1;  /* vvar is released with the address space */
+    }
+    return 0;
+}
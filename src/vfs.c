@@ -2,6 +2,7 @@
 #include "vfs.h"
 #include "fat32.h"
 #include "serial.h"
+#include "mutex.h"
 
 /*
  * Virtual Filesystem Layer
@@ -16,6 +17,13 @@ static struct {
     int fat_fd;  /* Underlying FAT32 file descriptor */
 } vfs_fds[VFS_MAX_FD];
 
+/*
+ * Serialises the descriptor table and every call into FAT32, whose
+ * cluster cache and open-file state are not reentrant. A mutex rather
+ * than a spinlock since reads wait on block I/O.
+ */
+static mutex_t vfs_lock = MUTEX_INITIALIZER("vfs");
+
 void vfs_init(void) {
     serial_puts("vfs: Initializing\n");
 
@@ -33,6 +41,8 @@ int vfs_open(const char *path) {
         return -1;
     }
 
+    mutex_lock(&vfs_lock);
+
     /* Find free VFS descriptor */
     int vfd = -1;
     for (int i = 0; i < VFS_MAX_FD; i++) {
@@ -42,6 +52,7 @@ int vfs_open(const char *path) {
         }
     }
     if (vfd < 0) {
+        mutex_unlock(&vfs_lock);
         serial_puts("vfs: No free file descriptors\n");
         return -1;
     }
@@ -49,47 +60,75 @@ int vfs_open(const char *path) {
     /* Dispatch to FAT32 */
     int fat_fd = fat_open(path);
     if (fat_fd < 0) {
+        mutex_unlock(&vfs_lock);
         return -1;
     }
 
     vfs_fds[vfd].in_use = 1;
     vfs_fds[vfd].fat_fd = fat_fd;
 
+    mutex_unlock(&vfs_lock);
     return vfd;
 }
 
 int vfs_read(int fd, void *buf, uint32_t count) {
-    if (fd < 0 || fd >= VFS_MAX_FD || !vfs_fds[fd].in_use) {
+    if (fd < 0 || fd >= VFS_MAX_FD) {
         return -1;
     }
 
-    return fat_read(vfs_fds[fd].fat_fd, buf, count);
+    int ret = -1;
+    mutex_lock(&vfs_lock);
+    if (vfs_fds[fd].in_use) {
+        ret = fat_read(vfs_fds[fd].fat_fd, buf, count);
+    }
+    mutex_unlock(&vfs_lock);
+
+    return ret;
 }
 
 int vfs_seek(int fd, uint32_t offset) {
-    if (fd < 0 || fd >= VFS_MAX_FD || !vfs_fds[fd].in_use) {
+    if (fd < 0 || fd >= VFS_MAX_FD) {
         return -1;
     }
 
-    return fat_seek(vfs_fds[fd].fat_fd, offset);
+    int ret = -1;
+    mutex_lock(&vfs_lock);
+    if (vfs_fds[fd].in_use) {
+        ret = fat_seek(vfs_fds[fd].fat_fd, offset);
+    }
+    mutex_unlock(&vfs_lock);
+
+    return ret;
 }
 
 int vfs_close(int fd) {
-    if (fd < 0 || fd >= VFS_MAX_FD || !vfs_fds[fd].in_use) {
+    if (fd < 0 || fd >= VFS_MAX_FD) {
         return -1;
     }
 
-    int ret = fat_close(vfs_fds[fd].fat_fd);
-    vfs_fds[fd].in_use = 0;
-    vfs_fds[fd].fat_fd = -1;
+    int ret = -1;
+    mutex_lock(&vfs_lock);
+    if (vfs_fds[fd].in_use) {
+        ret = fat_close(vfs_fds[fd].fat_fd);
+        vfs_fds[fd].in_use = 0;
+        vfs_fds[fd].fat_fd = -1;
+    }
+    mutex_unlock(&vfs_lock);
 
     return ret;
 }
 
 uint32_t vfs_size(int fd) {
-    if (fd < 0 || fd >= VFS_MAX_FD || !vfs_fds[fd].in_use) {
+    if (fd < 0 || fd >= VFS_MAX_FD) {
         return 0;
     }
 
-    return fat_get_size(vfs_fds[fd].fat_fd);
+    uint32_t size = 0;
+    mutex_lock(&vfs_lock);
+    if (vfs_fds[fd].in_use) {
+        size = fat_get_size(vfs_fds[fd].fat_fd);
+    }
+    mutex_unlock(&vfs_lock);
+
+    return size;
 }
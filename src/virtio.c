@@ -0,0 +1,104 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "virtio.h"
+#include "pci.h"
+#include "pmm.h"
+#include "hhdm.h"
+#include "ports.h"
+#include "atomic.h"
+
+/*
+ * Legacy virtio transport and split virtqueues.
+ *
+ * Only single-descriptor buffers are used, so descriptor i is always
+ * the head of its own chain and its id doubles as the buffer handle.
+ */
+
+uint32_t virtio_reset(uint16_t io_base, uint8_t bus, uint8_t dev, uint8_t func) {
+    /* I/O space and bus mastering (the device DMAs from our rings) */
+    uint16_t cmd = pci_read_config_16(bus, dev, func, PCI_OFFSET_COMMAND);
+    pci_write_config_16(bus, dev, func, PCI_OFFSET_COMMAND, cmd | (1 << 0) | (1 << 2));
+
+    outb(io_base + VIRTIO_REG_STATUS, 0);
+    outb(io_base + VIRTIO_REG_STATUS, VIRTIO_STATUS_ACKNOWLEDGE);
+    outb(io_base + VIRTIO_REG_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+    return inl(io_base + VIRTIO_REG_DEVICE_FEATURES);
+}
+
+void virtio_set_features(uint16_t io_base, uint32_t features) {
+    outl(io_base + VIRTIO_REG_GUEST_FEATURES, features);
+}
+
+void virtio_driver_ok(uint16_t io_base) {
+    outb(io_base + VIRTIO_REG_STATUS,
+         VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK);
+}
+
+int virtq_init(virtqueue_t *vq, uint16_t io_base, uint16_t index) {
+    outw(io_base + VIRTIO_REG_QUEUE_SELECT, index);
+    uint16_t size = inw(io_base + VIRTIO_REG_QUEUE_SIZE);
+    if (size == 0 || size > VIRTQ_MAX_SIZE || (size & (size - 1)) != 0) {
+        return -1;
+    }
+
+    /* Legacy layout: descriptors and avail ring, then the used ring on the next page */
+    uint64_t avail_end = 16 * (uint64_t)size + 6 + 2 * (uint64_t)size;
+    uint64_t used_off = PAGE_ALIGN_UP(avail_end);
+    uint64_t bytes = used_off + PAGE_ALIGN_UP(6 + 8 * (uint64_t)size);
+    uint64_t pages = bytes / PAGE_SIZE;
+
+    uint64_t phys = pmm_alloc_frames_contiguous(pages);
+    if (phys == 0) {
+        return -1;
+    }
+    uint64_t *zero = (uint64_t *)phys_to_hhdm(phys);
+    for (uint64_t i = 0; i < bytes / sizeof(uint64_t); i++) {
+        zero[i] = 0;
+    }
+
+    uint8_t *base = (uint8_t *)phys_to_hhdm(phys);
+    vq->io_base = io_base;
+    vq->index = index;
+    vq->size = size;
+    vq->last_used = 0;
+    vq->desc = (volatile struct vring_desc *)base;
+    vq->avail = (volatile struct vring_avail *)(base + 16 * (uint64_t)size);
+    vq->used = (volatile struct vring_used *)(base + used_off);
+    vq->phys = phys;
+    vq->pages = pages;
+
+    /* We reclaim buffers by polling; no interrupts wanted */
+    vq->avail->flags = VRING_AVAIL_F_NO_INTERRUPT;
+
+    outl(io_base + VIRTIO_REG_QUEUE_PFN, (uint32_t)(phys >> PAGE_SHIFT));
+    return 0;
+}
+
+void virtq_submit(virtqueue_t *vq, uint16_t desc_id) {
+    uint16_t idx = vq->avail->idx;
+    vq->avail->ring[idx & (vq->size - 1)] = desc_id;
+    /* Descriptor and ring slot before the index the device polls */
+    smp_wmb();
+    vq->avail->idx = idx + 1;
+}
+
+void virtq_kick(virtqueue_t *vq) {
+    smp_mb();
+    if (!(vq->used->flags & VRING_USED_F_NO_NOTIFY)) {
+        outw(vq->io_base + VIRTIO_REG_QUEUE_NOTIFY, vq->index);
+    }
+}
+
+int virtq_next_used(virtqueue_t *vq, uint32_t *len) {
+    if (vq->last_used == vq->used->idx) {
+        return -1;
+    }
+    smp_rmb();
+    volatile struct vring_used_elem *e = &vq->used->ring[vq->last_used & (vq->size - 1)];
+    if (len != NULL) {
+        *len = e->len;
+    }
+    int id = (int)e->id;
+    vq->last_used++;
+    return id;
+}
@@ -0,0 +1,174 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "virtio_console.h"
+#include "virtio.h"
+#include "pci.h"
+#include "pmm.h"
+#include "hhdm.h"
+#include "ports.h"
+#include "spinlock.h"
+#include "atomic.h"
+#include "printk.h"
+
+/* Port 0's transmit queue (queue 0 is its receive queue, unused) */
+#define VCON_QUEUE_TX   1
+
+/* Page-sized transmit buffers, each described by its own descriptor */
+#define VCON_TX_BUFS    32
+
+/* Give up on a host that stops returning buffers (roughly a second) */
+#define VCON_STALL_SPINS 100000000ULL
+
+static struct {
+    volatile int present;
+    uint16_t io_base;
+    virtqueue_t txq;
+    uint16_t nbufs;
+    uint64_t buf_phys[VCON_TX_BUFS];
+    uint16_t free_ids[VCON_TX_BUFS];    /* Stack of idle buffers */
+    uint16_t nfree;
+    spinlock_t lock;
+} vcon = { .lock = SPINLOCK_INITIALIZER("virtio_console") };
+
+/* Take back buffers the host is done with (lock held) */
+static void vcon_reclaim(void) {
+    int id;
+    while ((id = virtq_next_used(&vcon.txq, NULL)) >= 0) {
+        if (id < vcon.nbufs) {
+            vcon.free_ids[vcon.nfree++] = (uint16_t)id;
+        }
+    }
+}
+
+/*
+ * Wait until at least want buffers are idle (lock held). Returns 0, or
+ * -1 after marking the device absent if the host has stalled.
+ */
+static int vcon_wait_free(uint16_t want) {
+    uint64_t spins = 0;
+    vcon_reclaim();
+    while (vcon.nfree < want) {
+        if (++spins == VCON_STALL_SPINS) {
+            vcon.present = 0;
+            return -1;
+        }
+        cpu_relax();
+        vcon_reclaim();
+    }
+    return 0;
+}
+
+int virtio_console_init(void) {
+    pci_device_t pdev;
+    if (pci_find_device(VIRTIO_PCI_VENDOR, VIRTIO_PCI_DEVICE_CONSOLE, &pdev) != 0) {
+        return -1;
+    }
+
+    uint32_t bar0 = pci_read_config_32(pdev.bus, pdev.device, pdev.function, PCI_OFFSET_BAR0);
+    if (!(bar0 & 1)) {
+        pr_warn("virtio-console: no legacy I/O BAR, not using it");
+        return -1;
+    }
+    vcon.io_base = (uint16_t)(bar0 & ~0x3u);
+
+    /* No optional features: a single port, no size reports */
+    virtio_reset(vcon.io_base, pdev.bus, pdev.device, pdev.function);
+    virtio_set_features(vcon.io_base, 0);
+
+    if (virtq_init(&vcon.txq, vcon.io_base, VCON_QUEUE_TX) != 0) {
+        pr_err("virtio-console: transmit queue setup failed");
+        outb(vcon.io_base + VIRTIO_REG_STATUS, VIRTIO_STATUS_FAILED);
+        return -1;
+    }
+
+    vcon.nbufs = vcon.txq.size < VCON_TX_BUFS ? vcon.txq.size : VCON_TX_BUFS;
+    vcon.nfree = 0;
+    for (uint16_t i = 0; i < vcon.nbufs; i++) {
+        uint64_t phys = pmm_alloc_frame();
+        if (phys == 0) {
+            break;
+        }
+        vcon.buf_phys[i] = phys;
+        vcon.free_ids[vcon.nfree++] = i;
+    }
+    vcon.nbufs = vcon.nfree;
+    if (vcon.nbufs == 0) {
+        outb(vcon.io_base + VIRTIO_REG_STATUS, VIRTIO_STATUS_FAILED);
+        return -1;
+    }
+
+    virtio_driver_ok(vcon.io_base);
+    vcon.present = 1;
+
+    pr_info("virtio-console: %u transmit buffers at I/O 0x%x",
+            (unsigned int)vcon.nbufs, (unsigned int)vcon.io_base);
+    return 0;
+}
+
+int virtio_console_present(void) {
+    return vcon.present;
+}
+
+void virtio_console_write(const char *buf, uint64_t len) {
+    if (!vcon.present || len == 0) {
+        return;
+    }
+
+    uint64_t flags = spin_lock_irqsave(&vcon.lock);
+    int queued = 0;
+
+    while (len > 0 && vcon.present) {
+        if (vcon.nfree == 0) {
+            /* Let the host see what is queued, then wait for a buffer */
+            if (queued) {
+                virtq_kick(&vcon.txq);
+                queued = 0;
+            }
+            if (vcon_wait_free(1) != 0) {
+                break;
+            }
+        }
+
+        uint16_t id = vcon.free_ids[--vcon.nfree];
+        uint64_t chunk = len < PAGE_SIZE ? len : PAGE_SIZE;
+        char *dst = (char *)phys_to_hhdm(vcon.buf_phys[id]);
+        for (uint64_t i = 0; i < chunk; i++) {
+            dst[i] = buf[i];
+        }
+
+        volatile struct vring_desc *d = &vcon.txq.desc[id];
+        d->addr = vcon.buf_phys[id];
+        d->len = (uint32_t)chunk;
+        d->flags = 0;
+        d->next = 0;
+        virtq_submit(&vcon.txq, id);
+        queued = 1;
+
+        buf += chunk;
+        len -= chunk;
+    }
+
+    if (queued) {
+        virtq_kick(&vcon.txq);
+    }
+    spin_unlock_irqrestore(&vcon.lock, flags);
+}
+
+void virtio_console_flush(void) {
+    if (!vcon.present) {
+        return;
+    }
+    uint64_t flags = spin_lock_irqsave(&vcon.lock);
+    vcon_wait_free(vcon.nbufs);
+    spin_unlock_irqrestore(&vcon.lock, flags);
+}
+
+uint32_t virtio_console_in_flight(void) {
+    uint64_t flags = spin_lock_irqsave(&vcon.lock);
+    if (vcon.present) {
+        vcon_reclaim();
+    }
+    uint32_t n = (uint32_t)(vcon.nbufs - vcon.nfree);
+    spin_unlock_irqrestore(&vcon.lock, flags);
+    return n;
+}
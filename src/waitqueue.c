@@ -0,0 +1,44 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "waitqueue.h"
+#include "scheduler.h"
+
+void wait_queue_init(wait_queue_t *wq) {
+    wq->waiters.head = NULL;
+    wq->waiters.tail = NULL;
+}
+
+void wait_queue_sleep(wait_queue_t *wq) {
+    /* Before the scheduler exists this just waits for an interrupt */
+    scheduler_block_on(&wq->waiters);
+}
+
+int wake_up_one(wait_queue_t *wq) {
+    uint64_t flags = scheduler_lock();
+
+    task_t *task = wq->waiters.head;
+    if (task != NULL) {
+        scheduler_wake_locked(task);  /* Unlinks it from wq */
+    }
+
+    scheduler_unlock(flags);
+    return task != NULL;
+}
+
+int wake_up_all_locked(wait_queue_t *wq) {
+    int woken = 0;
+
+    while (wq->waiters.head != NULL) {
+        scheduler_wake_locked(wq->waiters.head);
+        woken++;
+    }
+
+    return woken;
+}
+
+int wake_up_all(wait_queue_t *wq) {
+    uint64_t flags = scheduler_lock();
+    int woken = wake_up_all_locked(wq);
+    scheduler_unlock(flags);
+    return woken;
+}
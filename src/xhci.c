@@ -1,6 +1,6 @@
 #include "xhci.h"
 #include "pci.h"
-#include "serial.h"
+#include "printk.h"
 #include "paging.h"
 #include "hhdm.h"
 #include "pmm.h"
@@ -49,9 +49,7 @@ static void xhci_handle_keyboard_report(uint8_t *report) {
             if (key < sizeof(hid_to_scancode)) {
                 uint8_t sc = hid_to_scancode[key];
                 if (sc) {
-                    serial_puts("XHCI: Key Pressed Scancode: ");
-                    serial_print_hex(sc);
-                    serial_puts("\n");
+                    pr_debug("XHCI: Key Pressed Scancode: 0x%x", sc);
                     kbd_process_scancode(sc, 1);
                 }
             }
@@ -185,15 +183,13 @@ static int xhci_enable_slot(void) {
     xhci_send_command(TRB_ENABLE_SLOT, 0, 0, 0);
     xhci_trb_t *ev = xhci_wait_for_event(TRB_CMD_COMPLETION);
     if (!ev) {
-        serial_puts("XHCI: Enable Slot timed out\n");
+        pr_err("XHCI: Enable Slot timed out");
         return -1;
     }
     
     uint8_t code = TRB_GET_CODE(ev->status);
     if (code != 1) {
-        serial_puts("XHCI: Enable Slot failed. Code: ");
-        serial_print_dec(code);
-        serial_puts("\n");
+        pr_err("XHCI: Enable Slot failed. Code: %d", code);
         return -1;
     }
     
@@ -249,21 +245,17 @@ static int xhci_address_device(uint8_t slot_id, uint8_t root_port, uint8_t speed
     
     xhci_trb_t *ev = xhci_wait_for_event(TRB_CMD_COMPLETION);
     if (!ev) {
-        serial_puts("XHCI: Address Device timed out\n");
+        pr_err("XHCI: Address Device timed out");
         return -1;
     }
     
     uint8_t code = TRB_GET_CODE(ev->status);
     if (code != 1) {
-        serial_puts("XHCI: Address Device failed. Code: ");
-        serial_print_dec(code);
-        serial_puts("\n");
+        pr_err("XHCI: Address Device failed. Code: %d", code);
         return -1;
     }
     
-    serial_puts("XHCI: Device Addressed successfully! Slot: ");
-    serial_print_dec(slot_id);
-    serial_puts("\n");
+    pr_debug("XHCI: Device Addressed successfully! Slot: %d", slot_id);
     return 0;
 }
 
@@ -322,10 +314,8 @@ static int xhci_send_control_transfer(uint8_t slot_id, uint8_t req_type, uint8_t
     /* Wait for completion */
     xhci_trb_t *ev = xhci_wait_for_event(32); /* Transfer Event */
     if (!ev || TRB_GET_CODE(ev->status) != 1) {
-        serial_puts("XHCI: Control Transfer Failed. Code: ");
-        if (ev) serial_print_dec(TRB_GET_CODE(ev->status));
-        else serial_puts("Timeout");
-        serial_puts("\n");
+        if (ev) pr_err("XHCI: Control Transfer Failed. Code: %u", TRB_GET_CODE(ev->status));
+        else pr_err("XHCI: Control Transfer Failed. Code: Timeout");
         return -1;
     }
     return 0;
@@ -367,14 +357,12 @@ static int xhci_configure_endpoint(uint8_t slot_id, uint8_t root_port, uint8_t s
     
     xhci_trb_t *ev = xhci_wait_for_event(TRB_CMD_COMPLETION);
     if (!ev || TRB_GET_CODE(ev->status) != 1) {
-        serial_puts("XHCI: Configure Endpoint failed. Code: ");
-        if (ev) serial_print_dec(TRB_GET_CODE(ev->status));
-        else serial_puts("Timeout");
-        serial_puts("\n");
+        if (ev) pr_err("XHCI: Configure Endpoint failed. Code: %u", TRB_GET_CODE(ev->status));
+        else pr_err("XHCI: Configure Endpoint failed. Code: Timeout");
         return -1;
     }
     
-    serial_puts("XHCI: Endpoint Configured!\n");
+    pr_info("XHCI: Endpoint Configured!");
     return 0;
 }
 
@@ -444,11 +432,9 @@ static xhci_trb_t* xhci_wait_for_event(uint32_t type) {
             }
             /* If it's a Port Status Change, just log it and keep waiting */
             if (TRB_GET_TYPE(ev->control) == TRB_PORT_STATUS_CHANGE) {
-                 serial_puts("XHCI: Ignored Port Status Change Event\n");
+                 pr_debug("XHCI: Ignored Port Status Change Event");
             } else {
-                 serial_puts("XHCI: Unexpected Event Type: ");
-                 serial_print_dec(TRB_GET_TYPE(ev->control));
-                 serial_puts("\n");
+                 pr_debug("XHCI: Unexpected Event Type: %u", TRB_GET_TYPE(ev->control));
             }
         }
         asm volatile("pause");
@@ -478,9 +464,7 @@ void xhci_handle_irq(void) {
             if (code == 1 || code == 13) { /* Success or Short Packet */
                  xhci_handle_keyboard_report((uint8_t*)kbd_buf_virt);
             } else {
-                 serial_puts("XHCI: Transfer Error Code: ");
-                 serial_print_dec(code);
-                 serial_puts("\n");
+                 pr_debug("XHCI: Transfer Error Code: %d", code);
             }
             
             /* Re-queue transfer */
@@ -490,7 +474,7 @@ void xhci_handle_irq(void) {
 }
 
 void xhci_init(uint8_t bus, uint8_t device, uint8_t function) {
-    serial_puts("XHCI: Initializing...\n");
+    pr_info("XHCI: Initializing...");
 
     /* 1. Get MMIO Base Address from BAR0 */
     uint32_t bar0 = pci_read_config_32(bus, device, function, PCI_OFFSET_BAR0);
@@ -506,9 +490,7 @@ void xhci_init(uint8_t bus, uint8_t device, uint8_t function) {
         mmio_phys |= ((uint64_t)bar1 << 32);
     }
     
-    serial_puts("XHCI: BAR0 Physical Address: ");
-    serial_print_hex(mmio_phys);
-    serial_puts("\n");
+    pr_debug("XHCI: BAR0 Physical Address: 0x%lx", mmio_phys);
 
     /* Map 64KB for registers at a high kernel address */
     uint64_t mmio_virt = 0xFFFFFFA000000000;
@@ -516,13 +498,7 @@ void xhci_init(uint8_t bus, uint8_t device, uint8_t function) {
         paging_map_page(mmio_virt + (i * 4096), mmio_phys + (i * 4096), PTE_PRESENT | PTE_WRITABLE | PTE_CACHE_DIS);
     }
     
-    serial_puts("XHCI: Mapped to Virtual Address: ");
-    serial_print_hex(mmio_virt);
-    serial_puts("\n");
-    
-    serial_puts("XHCI: Mapped to Virtual Address: ");
-    serial_print_hex(mmio_virt);
-    serial_puts("\n");
+    pr_debug("XHCI: Mapped to Virtual Address: 0x%lx", mmio_virt);
     
     /* 2. Read Capability Registers */
     uint32_t caps_0 = mmio_read32(mmio_virt, XHCI_CAP_CAPLENGTH);
@@ -531,11 +507,7 @@ void xhci_init(uint8_t bus, uint8_t device, uint8_t function) {
 
     uint32_t hcs_params1 = mmio_read32(mmio_virt, XHCI_CAP_HCSPARAMS1);
     
-    serial_puts("XHCI: CapLength: ");
-    serial_print_dec(cap_length);
-    serial_puts(" Version: ");
-    serial_print_hex(hci_version);
-    serial_puts("\n");
+    pr_debug("XHCI: CapLength: %d Version: 0x%x", cap_length, hci_version);
     
     /* Perform BIOS Handoff */
     uint32_t hccparams1 = mmio_read32(mmio_virt, XHCI_CAP_HCCPARAMS1);
@@ -548,12 +520,10 @@ void xhci_init(uint8_t bus, uint8_t device, uint8_t function) {
             uint8_t cap_id = cap_reg & 0xFF;
             
             if (cap_id == 1) { /* USB Legacy Support */
-                serial_puts("XHCI: Found USB Legacy Support capability at offset ");
-                serial_print_hex(offset);
-                serial_puts("\n");
+                pr_debug("XHCI: Found USB Legacy Support capability at offset 0x%x", offset);
                 
                 if (cap_reg & (1 << 16)) { /* BIOS Owned */
-                    serial_puts("XHCI: BIOS owns controller. Requesting handoff...\n");
+                    pr_info("XHCI: BIOS owns controller. Requesting handoff...");
                     
                     /* Request ownership */
                     mmio_write32(mmio_virt, offset, cap_reg | (1 << 24));
@@ -563,18 +533,18 @@ void xhci_init(uint8_t bus, uint8_t device, uint8_t function) {
                     while (1) {
                         uint32_t val = mmio_read32(mmio_virt, offset);
                         if ((val & (1 << 16)) == 0 && (val & (1 << 24))) {
-                            serial_puts("XHCI: Handoff successful!\n");
+                            pr_info("XHCI: Handoff successful!");
                             break;
                         }
                         if (timeout-- <= 0) {
-                            serial_puts("XHCI: Handoff timed out! Force continuing.\n");
+                            pr_warn("XHCI: Handoff timed out! Force continuing.");
                             break;
                         }
                         /* Small delay loop */
                         for (volatile int t=0; t<10000; t++);
                     }
                 } else {
-                     serial_puts("XHCI: OS already owns controller.\n");
+                     pr_info("XHCI: OS already owns controller.");
                      mmio_write32(mmio_virt, offset, cap_reg | (1 << 24));
                 }
                 
@@ -590,7 +560,7 @@ void xhci_init(uint8_t bus, uint8_t device, uint8_t function) {
             offset += (next << 2);
         }
     } else {
-        serial_puts("XHCI: No Extended Capabilities found.\n");
+        pr_info("XHCI: No Extended Capabilities found.");
     }
 
     mmio_base_virt = mmio_virt;
@@ -600,14 +570,12 @@ void xhci_init(uint8_t bus, uint8_t device, uint8_t function) {
     rt_base = mmio_virt + rtsoff;
     db_base = mmio_virt + dboff;
     
-    serial_puts("XHCI: Runtime Base Offset: ");
-    serial_print_hex(rtsoff);
-    serial_puts("\n");
+    pr_debug("XHCI: Runtime Base Offset: 0x%x", rtsoff);
 
     /* Enable MSI or MSI-X */
     uint8_t msi_ptr = pci_find_capability(bus, device, function, PCI_CAP_ID_MSI);
     if (msi_ptr) {
-        serial_puts("XHCI: Configuring MSI...\n");
+        pr_info("XHCI: Configuring MSI...");
         uint16_t msg_ctrl = pci_read_config_16(bus, device, function, msi_ptr + PCI_MSI_CTRL);
         
         /* 
@@ -628,7 +596,7 @@ void xhci_init(uint8_t bus, uint8_t device, uint8_t function) {
         /* Try MSI-X */
         uint8_t msix_ptr = pci_find_capability(bus, device, function, PCI_CAP_ID_MSIX);
         if (msix_ptr) {
-             serial_puts("XHCI: Configuring MSI-X...\n");
+             pr_info("XHCI: Configuring MSI-X...");
              uint16_t msg_ctrl = pci_read_config_16(bus, device, function, msix_ptr + 2); // Message Control
              uint32_t table_off = pci_read_config_32(bus, device, function, msix_ptr + 4); // Table Offset
              
@@ -654,14 +622,12 @@ void xhci_init(uint8_t bus, uint8_t device, uint8_t function) {
                  /* Also Clear Mask All (Bit 14) just in case */
                  pci_write_config_16(bus, device, function, msix_ptr + 2, (msg_ctrl & ~0x4000) | 0x8000); // Bit 15: Enable, Bit 14: Mask
                  
-                 serial_puts("XHCI: MSI-X Enabled.\n");
+                 pr_info("XHCI: MSI-X Enabled.");
              } else {
-                 serial_puts("XHCI: MSI-X Table in unsupported BAR: ");
-                 serial_print_dec(bir);
-                 serial_puts("\n");
+                 pr_err("XHCI: MSI-X Table in unsupported BAR: %d", bir);
              }
         } else {
-             serial_puts("XHCI: MSI/MSI-X not supported by controller!\n");
+             pr_err("XHCI: MSI/MSI-X not supported by controller!");
         }
     }
     
@@ -682,14 +648,14 @@ void xhci_init(uint8_t bus, uint8_t device, uint8_t function) {
     }
     
     /* Reset Controller */
-    serial_puts("XHCI: Resetting controller...\n");
+    pr_info("XHCI: Resetting controller...");
     mmio_write32(op_base, XHCI_OP_USBCMD, XHCI_CMD_RESET);
     
     /* Wait for reset to complete */
     while (mmio_read32(op_base, XHCI_OP_USBCMD) & XHCI_CMD_RESET) {
         asm volatile("pause");
     }
-    serial_puts("XHCI: Reset complete.\n");
+    pr_info("XHCI: Reset complete.");
     
     /* Wait for CNR */
     while (mmio_read32(op_base, XHCI_OP_USBSTS) & XHCI_STS_CNR) {
@@ -699,9 +665,7 @@ void xhci_init(uint8_t bus, uint8_t device, uint8_t function) {
     /* 4. Configure Device Context Base Address Array (DCBAA) */
     /* Max Slots is in HCSPARAMS1 bits 7:0 */
     uint8_t max_slots = hcs_params1 & 0xFF;
-    serial_puts("XHCI: Max Slots: ");
-    serial_print_dec(max_slots);
-    serial_puts("\n");
+    pr_debug("XHCI: Max Slots: %d", max_slots);
     
     /* Allocate DCBAA (pointers) - size depends on MaxSlots. 64-bit pointers. */
     /* (MaxSlots + 1) * 8 bytes. */
@@ -745,19 +709,19 @@ void xhci_init(uint8_t bus, uint8_t device, uint8_t function) {
     mmio_write32(op_base, XHCI_OP_USBCMD, XHCI_CMD_INTE); /* Global Interrupt Enable */
 
     /* 7. Start Controller */
-    serial_puts("XHCI: Starting controller...\n");
+    pr_info("XHCI: Starting controller...");
     mmio_write32(op_base, XHCI_OP_USBCMD, XHCI_CMD_RUN | XHCI_CMD_INTE);
     
     /* Send NO_OP to verify rings */
-    serial_puts("XHCI: Sending NO_OP...\n");
+    pr_debug("XHCI: Sending NO_OP...");
     xhci_send_command(TRB_NOOP, 0, 0, 0);
     
     /* Poll for completion */
     xhci_trb_t *noop_ev = xhci_wait_for_event(TRB_CMD_COMPLETION);
     if (noop_ev && TRB_GET_CODE(noop_ev->status) == 1) {
-        serial_puts("XHCI: NO_OP Success!\n");
+        pr_info("XHCI: NO_OP Success!");
     } else {
-        serial_puts("XHCI: NO_OP Failed!\n");
+        pr_err("XHCI: NO_OP Failed!");
     }
 
     uint64_t port_base = op_base + 0x400;
@@ -769,9 +733,7 @@ void xhci_init(uint8_t bus, uint8_t device, uint8_t function) {
         uint32_t portsc = mmio_read32(port_reg, 0);
         
         if (portsc & XHCI_PORTSC_CCS) {
-            serial_puts("XHCI: Port ");
-            serial_print_dec(i);
-            serial_puts(" connected!\n");
+            pr_debug("XHCI: Port %d connected!", i);
             
             /* Reset Port to enable it */
             mmio_write32(port_reg, 0, portsc | XHCI_PORTSC_PR);
@@ -787,18 +749,14 @@ void xhci_init(uint8_t bus, uint8_t device, uint8_t function) {
             /* Check if enabled */
             portsc = mmio_read32(port_reg, 0);
             if (portsc & XHCI_PORTSC_PED) {
-                serial_puts("XHCI: Port Enabled.\n");
+                pr_debug("XHCI: Port Enabled.");
                 
                 uint8_t speed = (portsc >> 10) & 0xF;
-                serial_puts("XHCI: Port Speed: ");
-                serial_print_dec(speed);
-                serial_puts("\n");
+                pr_debug("XHCI: Port Speed: %d", speed);
                 
                 int slot_id = xhci_enable_slot();
                 if (slot_id > 0) {
-                    serial_puts("XHCI: Slot Enabled: ");
-                    serial_print_dec(slot_id);
-                    serial_puts("\n");
+                    pr_debug("XHCI: Slot Enabled: %d", slot_id);
                     
                     if (xhci_address_device(slot_id, i, speed) == 0) {
                         /* Set Configuration 1 */
@@ -807,30 +765,30 @@ void xhci_init(uint8_t bus, uint8_t device, uint8_t function) {
                         /* Value = 1 (Config Value) */
                         /* Index = 0 */
                         /* Length = 0 */
-                        serial_puts("XHCI: Sending SetConfiguration(1)...\n");
+                        pr_debug("XHCI: Sending SetConfiguration(1)...");
                         xhci_send_control_transfer(slot_id, 0, 9, 1, 0, 0);
                         
                         /* Ignore failure and try to configure endpoint anyway */
-                        serial_puts("XHCI: Proceeding to Configure Endpoint...\n");
+                        pr_debug("XHCI: Proceeding to Configure Endpoint...");
                             
                         if (xhci_configure_endpoint(slot_id, i, speed) == 0) {
                             /* Queue a transfer to read 8 bytes */
                             kbd_buf_phys = xhci_alloc_page(&kbd_buf_virt);
                             
-                            serial_puts("XHCI: Queuing transfer...\n");
+                            pr_debug("XHCI: Queuing transfer...");
                             xhci_queue_transfer(kbd_buf_phys, 8);
                             
-                            serial_puts("XHCI: Waiting for transfer event (Press a key in QEMU window)...\n");
+                            pr_debug("XHCI: Waiting for transfer event (Press a key in QEMU window)...");
                             /* We won't wait forever here since it blocks boot. */
                             /* In a real OS, this would be interrupt driven. */
                             /* For now, we leave the transfer queued. */
                             
-                            serial_puts("XHCI: USB Keyboard Ready & Listening!\n");
+                            pr_info("XHCI: USB Keyboard Ready & Listening!");
                         }
                     }
                 }
             } else {
-                serial_puts("XHCI: Port Reset failed to enable port.\n");
+                pr_err("XHCI: Port Reset failed to enable port.");
             }
         }
     }
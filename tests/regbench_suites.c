@@ -0,0 +1,399 @@
+/*
+ * Kernel Microbenchmarks for cool-os
+ *
+ * Times the hot paths that performance work touches, with regbench.h,
+ * and prints one BENCH line per benchmark for scripts/run_regtest.sh.
+ * Runs as the "bench" regtest suite; a benchmark only fails if it
+ * could not run at all, never because it was slow.
+ *
+ * The "ubench" suite runs the user benchmark programs (user/b*.c) from
+ * the FAT image. Each reports ticks per operation as its exit status;
+ * several runs of a program make the samples of one BENCH line.
+ */
+
+#include "regtest.h"
+#include "regbench.h"
+#include "pmm.h"
+#include "heap.h"
+#include "hhdm.h"
+#include "paging.h"
+#include "task.h"
+#include "scheduler.h"
+#include "syscall.h"
+#include "trace.h"
+#include "smp.h"
+#include "block.h"
+#include "fat32.h"
+#include "vfs.h"
+#include "cpu.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef REGTEST_BUILD
+
+#define BENCH_FRAMES    512
+#define BENCH_SYSCALLS  256
+#define UBENCH_RUNS     5
+#define UBENCH_SPAWNS   32
+
+static uint64_t bench_frames[BENCH_FRAMES + REGBENCH_WARMUP];
+
+/* ---- Physical memory and heap ---- */
+
+static int bench_pmm(void) {
+    for (uint32_t i = 0; i < BENCH_FRAMES + REGBENCH_WARMUP; i++) {
+        bench_frames[i] = 0;
+    }
+    BENCH("pmm_alloc_frame", BENCH_FRAMES) {
+        bench_frames[BENCH_INDEX] = pmm_alloc_frame();
+    }
+    int ok = 1;
+    for (uint32_t i = 0; i < BENCH_FRAMES + REGBENCH_WARMUP; i++) {
+        if (bench_frames[i] == 0) {
+            ok = 0;
+        }
+    }
+    BENCH("pmm_free_frame", BENCH_FRAMES) {
+        if (bench_frames[BENCH_INDEX] != 0) {
+            pmm_free_frame(bench_frames[BENCH_INDEX]);
+        }
+    }
+    if (!ok) {
+        regtest_fail("bench_pmm", "pmm_alloc_frame failed");
+        return -1;
+    }
+    regtest_pass("bench_pmm");
+    return 0;
+}
+
+static int bench_heap(void) {
+    BENCH("kmalloc_kfree_64", 1000) {
+        kfree(kmalloc(64));
+    }
+    BENCH("kmalloc_kfree_4096", 500) {
+        kfree(kmalloc(4096));
+    }
+    regtest_pass("bench_heap");
+    return 0;
+}
+
+/* ---- Page tables ---- */
+
+static int bench_paging(void) {
+    uint64_t pml4_phys = pmm_alloc_frame();
+    uint64_t page = pmm_alloc_frame();
+    if (pml4_phys == 0 || page == 0) {
+        regtest_fail("bench_paging", "out of frames");
+        return -1;
+    }
+    uint64_t *pml4 = (uint64_t *)phys_to_hhdm(pml4_phys);
+    for (int i = 0; i < 512; i++) {
+        pml4[i] = 0;
+    }
+
+    /* Consecutive pages: a new page table now and then shows up in p99 */
+    int failed = 0;
+    BENCH("paging_map_page_in", BENCH_FRAMES) {
+        if (paging_map_page_in(pml4, 0x40000000ULL + (uint64_t)BENCH_INDEX * 4096, page,
+                               PTE_PRESENT | PTE_WRITABLE | PTE_USER | PTE_SHARED) != 0) {
+            failed = 1;
+        }
+    }
+
+    paging_free_user_pages(pml4);
+    pmm_free_frame(pml4_phys);
+    pmm_free_frame(page);
+    if (failed) {
+        regtest_fail("bench_paging", "paging_map_page_in failed");
+        return -1;
+    }
+    regtest_pass("bench_paging");
+    return 0;
+}
+
+/* ---- Scheduler ---- */
+
+static volatile int bench_yield_done;
+
+static void bench_yield_partner(void) {
+    while (!bench_yield_done) {
+        task_yield();
+    }
+}
+
+/*
+ * Each yield switches to the partner and back. With several CPUs the
+ * partner may be placed elsewhere, and then a yield switches nowhere.
+ */
+static int bench_sched(void) {
+    bench_yield_done = 0;
+    task_t *partner = task_create(bench_yield_partner);
+    if (partner == NULL) {
+        regtest_fail("bench_sched", "failed to create partner task");
+        return -1;
+    }
+    task_set_parent(partner, task_current());
+    scheduler_add(partner);
+    task_yield();
+
+    BENCH("sched_yield_roundtrip", 1000) {
+        task_yield();
+    }
+
+    bench_yield_done = 1;
+    task_wait(NULL);
+    regtest_pass("bench_sched");
+    return 0;
+}
+
+/* ---- Syscalls from user mode ---- */
+
+/*
+ * user_getppid_loop_code: BENCH_SYSCALLS getppid syscalls back to back,
+ * then exit(0)
+ */
+static const uint8_t user_getppid_loop_code[] = {
+    0x41, 0xbc, BENCH_SYSCALLS & 0xff, BENCH_SYSCALLS >> 8, 0x00, 0x00, /* mov r12d, n */
+    /* loop: */
+    0xb8, SYS_getppid, 0x00, 0x00, 0x00,        /* mov eax, SYS_getppid */
+    0x0f, 0x05,                                 /* syscall */
+    0x41, 0xff, 0xcc,                           /* dec r12d */
+    0x75, 0xf4,                                 /* jnz loop */
+    0x31, 0xff,                                 /* xor edi, edi */
+    0x31, 0xc0,                                 /* xor eax, eax (SYS_exit) */
+    0x0f, 0x05,                                 /* syscall */
+};
+
+static uint64_t bench_syscall_samples[BENCH_SYSCALLS];
+
+/*
+ * The loop cannot report its own timings, so they come from the
+ * syscall tracepoints: consecutive syscall entries of the task on one
+ * CPU are one full round trip apart (tracepoint cost included).
+ */
+static int bench_syscall(void) {
+    if (!trace_enabled) {
+        regtest_log("NOTE: Tracing off, skipping user syscall benchmark\n");
+        regtest_pass("bench_syscall_skip");
+        return 0;
+    }
+    task_t *task = task_create_user(user_getppid_loop_code, sizeof(user_getppid_loop_code));
+    if (task == NULL) {
+        regtest_fail("bench_syscall", "create failed");
+        return -1;
+    }
+    uint32_t pid = task->pid;
+    trace_clear();
+    task_set_parent(task, task_current());
+    scheduler_add(task);
+    task_wait(NULL);
+
+    uint32_t n = 0;
+    for (uint32_t cpu = 0; cpu < smp_cpu_count() && cpu < SMP_MAX_CPUS; cpu++) {
+        uint64_t prev = 0;
+        uint32_t count = trace_count(cpu);
+        for (uint32_t i = 0; i < count && n < BENCH_SYSCALLS; i++) {
+            struct trace_event ev;
+            trace_get(cpu, i, &ev);
+            if (ev.pid != pid) {
+                continue;
+            }
+            if (ev.id == TRACE_SCHED_SWITCH) {
+                prev = 0;   /* Switched away: not a round trip */
+            } else if (ev.id == TRACE_SYSCALL_ENTER && ev.arg0 == SYS_getppid) {
+                if (prev != 0) {
+                    bench_syscall_samples[n++] = ev.tsc - prev;
+                }
+                prev = ev.tsc;
+            }
+        }
+    }
+    if (n < BENCH_SYSCALLS / 4) {
+        regtest_fail("bench_syscall", "too few syscall records in the trace");
+        return -1;
+    }
+    regbench_report("syscall_getppid_user", bench_syscall_samples, n);
+    regtest_pass("bench_syscall");
+    return 0;
+}
+
+/* ---- Block device and filesystem ---- */
+
+static int bench_io(void) {
+    uint8_t *buf = kmalloc(4096);
+    if (buf == NULL) {
+        regtest_fail("bench_io", "out of memory");
+        return -1;
+    }
+
+    int fd = fat_open("INIT.ELF");
+    if (fd < 0) {
+        regtest_log("NOTE: Filesystem not available, skipping I/O benchmarks\n");
+        regtest_pass("bench_io_skip");
+        kfree(buf);
+        return 0;
+    }
+
+    int failed = 0;
+    BENCH("block_read_4k", 128) {
+        if (block_read(0, 8, buf) != 0) {
+            failed = 1;
+        }
+    }
+    BENCH("fat_read_4k", 128) {
+        fat_seek(fd, 0);
+        if (fat_read(fd, buf, 4096) <= 0) {
+            failed = 1;
+        }
+    }
+    fat_close(fd);
+    kfree(buf);
+
+    if (failed) {
+        regtest_fail("bench_io", "read failed");
+        return -1;
+    }
+    regtest_pass("bench_io");
+    return 0;
+}
+
+int regtest_bench(void) {
+    int result = 0;
+    regtest_start_suite("bench");
+    regbench_init();
+
+    if (bench_pmm() != 0) result = -1;
+    if (bench_heap() != 0) result = -1;
+    if (bench_paging() != 0) result = -1;
+    if (bench_sched() != 0) result = -1;
+    if (bench_syscall() != 0) result = -1;
+    if (bench_io() != 0) result = -1;
+
+    regtest_end_suite("bench");
+    return result;
+}
+
+
+/* ---- User benchmark programs ---- */
+
+static uint64_t ubench_samples[UBENCH_SPAWNS];
+
+/* Start a program from the FAT image as a child of the calling task */
+static task_t *ubench_spawn(const char *path) {
+    task_t *task = task_create_from_path(path);
+    if (task != NULL) {
+        task_set_parent(task, task_current());
+        scheduler_add(task);
+    }
+    return task;
+}
+
+/*
+ * Run path UBENCH_RUNS times, instances at a time, and report the exit
+ * statuses as the samples of name. A status of 0 or less means the
+ * program failed (a killed task exits with 0).
+ */
+static int ubench_program(const char *path, int instances, const char *name) {
+    uint32_t n = 0;
+    for (int run = 0; run < UBENCH_RUNS; run++) {
+        for (int i = 0; i < instances; i++) {
+            if (ubench_spawn(path) == NULL) {
+                regtest_fail(name, "create failed");
+                return -1;
+            }
+        }
+        for (int i = 0; i < instances; i++) {
+            int status = 0;
+            task_wait(&status);
+            if (status <= 0) {
+                regtest_fail(name, "program failed");
+                return -1;
+            }
+            ubench_samples[n++] = (uint64_t)status;
+        }
+    }
+    regbench_report(name, ubench_samples, n);
+    regtest_pass(name);
+    return 0;
+}
+
+/* Process creation, like the shell's run command, and reaping */
+static int ubench_spawn_wait(void) {
+    for (uint32_t i = 0; i < UBENCH_SPAWNS; i++) {
+        uint64_t start = rdtsc();
+        if (ubench_spawn("BNULL.ELF") == NULL) {
+            regtest_fail("user_spawn_wait", "create failed");
+            return -1;
+        }
+        task_wait(NULL);
+        ubench_samples[i] = rdtsc() - start;
+    }
+    regbench_report("user_spawn_wait", ubench_samples, UBENCH_SPAWNS);
+    regtest_pass("user_spawn_wait");
+    return 0;
+}
+
+/*
+ * Sequential read of a whole file through the VFS, in ticks per 4 KiB.
+ * User programs have no file syscalls, so this one runs in the kernel.
+ */
+static int ubench_file_read(void) {
+    uint8_t *buf = kmalloc(4096);
+    if (buf == NULL) {
+        regtest_fail("vfs_read_file_4k", "out of memory");
+        return -1;
+    }
+    for (int run = 0; run < UBENCH_RUNS; run++) {
+        int fd = vfs_open("KERNEL.ELF");
+        if (fd < 0) {
+            kfree(buf);
+            regtest_fail("vfs_read_file_4k", "cannot open KERNEL.ELF");
+            return -1;
+        }
+        uint32_t size = vfs_size(fd);
+        uint64_t start = rdtsc();
+        uint32_t total = 0;
+        int got;
+        while ((got = vfs_read(fd, buf, 4096)) > 0) {
+            total += (uint32_t)got;
+        }
+        uint64_t ticks = rdtsc() - start;
+        vfs_close(fd);
+        if (total != size || size < 4096) {
+            kfree(buf);
+            regtest_fail("vfs_read_file_4k", "short read");
+            return -1;
+        }
+        ubench_samples[run] = ticks / (size / 4096);
+    }
+    kfree(buf);
+    regbench_report("vfs_read_file_4k", ubench_samples, UBENCH_RUNS);
+    regtest_pass("vfs_read_file_4k");
+    return 0;
+}
+
+int regtest_ubench(void) {
+    int result = 0;
+    regtest_start_suite("ubench");
+
+    int fd = vfs_open("BNULL.ELF");
+    if (fd < 0) {
+        regtest_log("NOTE: Filesystem not available, skipping user benchmarks\n");
+        regtest_pass("ubench_skip");
+        regtest_end_suite("ubench");
+        return 0;
+    }
+    vfs_close(fd);
+
+    if (ubench_program("BSYSCALL.ELF", 1, "user_syscall_getppid") != 0) result = -1;
+    if (ubench_program("BYIELD.ELF", 2, "user_yield_pingpong") != 0) result = -1;
+    if (ubench_spawn_wait() != 0) result = -1;
+    if (ubench_file_read() != 0) result = -1;
+    if (ubench_program("BTOUCH.ELF", 1, "user_mem_touch_4k") != 0) result = -1;
+    if (ubench_program("BFAULT.ELF", 1, "user_page_first_touch") != 0) result = -1;
+
+    regtest_end_suite("ubench");
+    return result;
+}
+
+#endif /* REGTEST_BUILD */
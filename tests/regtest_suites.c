@@ -21,6 +21,27 @@
 #include "paging.h"
 #include "cpu.h"
 #include "timer.h"
+#include "percpu.h"
+#include "preempt.h"
+#include "clocksource.h"
+#include "hrtimer.h"
+#include "waitqueue.h"
+#include "syscall.h"
+#include "fpu.h"
+#include "simd.h"
+#include "smp.h"
+#include "msr.h"
+#include "spinlock.h"
+#include "mutex.h"
+#include "seqlock.h"
+#include "atomic.h"
+#include "printk.h"
+#include "virtio_console.h"
+#include "trace.h"
+#include "profile.h"
+#include "ksyms.h"
+#include "pmu.h"
+#include "bootstat.h"
 #include <stdint.h>
 #include <stddef.h>
 
@@ -275,6 +296,30 @@ static void regtest_task_exit_fn(void) {
     task_exit_ran = 1;
 }
 
+/* Priority ordering: each task records its position in run order */
+static volatile int task_prio_seq = 0;
+static volatile int task_prio_hi_pos = 0;
+static volatile int task_prio_lo_pos = 0;
+
+static void regtest_task_prio_hi_fn(void) {
+    task_prio_hi_pos = ++task_prio_seq;
+}
+
+static void regtest_task_prio_lo_fn(void) {
+    task_prio_lo_pos = ++task_prio_seq;
+}
+
+static wait_queue_t regtest_wq = WAIT_QUEUE_INITIALIZER;
+static volatile int wq_tokens = 0;
+static volatile int wq_done = 0;
+
+/* Consumes one token, sleeping on regtest_wq until one is available */
+static void regtest_wq_waiter_fn(void) {
+    wait_event(&regtest_wq, wq_tokens > 0);
+    wq_tokens--;
+    wq_done++;
+}
+
 int regtest_task(void) {
     regtest_start_suite("task");
 
@@ -345,6 +390,71 @@ int regtest_task(void) {
     }
     regtest_pass("task_exit");
 
+    /* Test 5: Higher-priority task runs first even when queued last */
+    task_prio_seq = 0;
+    task_prio_hi_pos = 0;
+    task_prio_lo_pos = 0;
+    task_t *tlo = task_create(regtest_task_prio_lo_fn);
+    task_t *thi = task_create(regtest_task_prio_hi_fn);
+    if (tlo == NULL || thi == NULL) {
+        regtest_fail("task_priority_create", "create failed");
+        regtest_end_suite("task");
+        return -1;
+    }
+    scheduler_set_priority(tlo, SCHED_PRIO_DEFAULT - 1);
+    scheduler_set_priority(thi, SCHED_PRIO_HIGHEST);
+    scheduler_add(tlo);
+    scheduler_add(thi);
+    while (tlo->state != TASK_FINISHED || thi->state != TASK_FINISHED) {
+        task_yield();
+    }
+    if (task_prio_hi_pos != 1 || task_prio_lo_pos != 2) {
+        regtest_fail("task_priority_order", "high-priority task did not run first");
+        regtest_end_suite("task");
+        return -1;
+    }
+    regtest_pass("task_priority_order");
+
+    /* Test 6: Wait queue - waiters block, wake_up_one/all wake exactly them */
+    wq_tokens = 0;
+    wq_done = 0;
+    task_t *w1 = task_create(regtest_wq_waiter_fn);
+    task_t *w2 = task_create(regtest_wq_waiter_fn);
+    if (w1 == NULL || w2 == NULL) {
+        regtest_fail("task_waitqueue_create", "create failed");
+        regtest_end_suite("task");
+        return -1;
+    }
+    scheduler_add(w1);
+    scheduler_add(w2);
+    task_yield();
+    if (w1->state != PROC_BLOCKED || w2->state != PROC_BLOCKED || wq_done != 0) {
+        regtest_fail("task_waitqueue", "waiters did not block");
+        regtest_end_suite("task");
+        return -1;
+    }
+
+    wq_tokens = 1;
+    int woken = wake_up_one(&regtest_wq);
+    task_yield();
+    if (woken != 1 || wq_done != 1 || w2->state != PROC_BLOCKED) {
+        regtest_fail("task_waitqueue", "wake_up_one did not wake exactly one waiter");
+        regtest_end_suite("task");
+        return -1;
+    }
+
+    wq_tokens = 1;
+    woken = wake_up_all(&regtest_wq);
+    while (w1->state != TASK_FINISHED || w2->state != TASK_FINISHED) {
+        task_yield();
+    }
+    if (woken != 1 || wq_done != 2 || wq_tokens != 0) {
+        regtest_fail("task_waitqueue", "wake_up_all did not wake remaining waiter");
+        regtest_end_suite("task");
+        return -1;
+    }
+    regtest_pass("task_waitqueue");
+
     regtest_end_suite("task");
     return 0;
 }
@@ -404,6 +514,31 @@ static const uint8_t user_yield_code2[] = {
     'U', '2', ' '
 };
 
+/*
+ * user_syscall_abi_code: calls an unknown syscall with R10/R8/R9 set and
+ * exits 0 only if it got -ENOSYS and those registers survived
+ */
+static const uint8_t user_syscall_abi_code[] = {
+    0x41, 0xba, 0x11, 0x00, 0x00, 0x00,         /* mov r10d, 0x11 */
+    0x41, 0xb8, 0x22, 0x00, 0x00, 0x00,         /* mov r8d, 0x22 */
+    0x41, 0xb9, 0x33, 0x00, 0x00, 0x00,         /* mov r9d, 0x33 */
+    0xb8, 0xe8, 0x03, 0x00, 0x00,               /* mov eax, 1000 */
+    0x0f, 0x05,                                 /* syscall */
+    0xbf, 0x01, 0x00, 0x00, 0x00,               /* mov edi, 1 */
+    0x48, 0x83, 0xf8, 0xda,                     /* cmp rax, -38 (-ENOSYS) */
+    0x75, 0x14,                                 /* jne exit */
+    0x49, 0x83, 0xfa, 0x11,                     /* cmp r10, 0x11 */
+    0x75, 0x0e,                                 /* jne exit */
+    0x49, 0x83, 0xf8, 0x22,                     /* cmp r8, 0x22 */
+    0x75, 0x08,                                 /* jne exit */
+    0x49, 0x83, 0xf9, 0x33,                     /* cmp r9, 0x33 */
+    0x75, 0x02,                                 /* jne exit */
+    0x31, 0xff,                                 /* xor edi, edi */
+    /* exit: */
+    0x31, 0xc0,                                 /* xor eax, eax (SYS_exit) */
+    0x0f, 0x05,                                 /* syscall */
+};
+
 /* user_fault_code: triggers invalid opcode */
 static const uint8_t user_fault_code[] = {
     0x0f, 0x0b  /* ud2 */
@@ -457,6 +592,32 @@ int regtest_user(void) {
     /* If we get here, the kernel survived the user fault */
     regtest_pass("user_fault_isolation");
 
+    /* Test 5: Table dispatch bounds-checks numbers and forwards six arguments */
+    const syscall_desc_t *write_desc = syscall_lookup(SYS_write);
+    if (write_desc == NULL || write_desc->nargs != 3 || syscall_lookup(NR_SYSCALLS) != NULL ||
+        syscall_dispatch(NR_SYSCALLS, 0, 0, 0, 0, 0, 0) != -ENOSYS ||
+        syscall_dispatch(~0ULL, 0, 0, 0, 0, 0, 0) != -ENOSYS) {
+        regtest_fail("user_syscall_table", "bad table lookup");
+        regtest_end_suite("user");
+        return -1;
+    }
+    task_t *abi_task = task_create_user(user_syscall_abi_code, sizeof(user_syscall_abi_code));
+    if (abi_task == NULL) {
+        regtest_fail("user_syscall_table", "create failed");
+        regtest_end_suite("user");
+        return -1;
+    }
+    task_set_parent(abi_task, task_current());
+    scheduler_add(abi_task);
+    int abi_status = -1;
+    task_wait(&abi_status);
+    if (abi_status != 0) {
+        regtest_fail("user_syscall_table", "unknown syscall not -ENOSYS or args clobbered");
+        regtest_end_suite("user");
+        return -1;
+    }
+    regtest_pass("user_syscall_table");
+
     regtest_end_suite("user");
     return 0;
 }
@@ -1323,6 +1484,24 @@ int regtest_libc(void) {
     /* If we got here, the C program with libc executed successfully */
     regtest_pass("libc_exec");
 
+    /* Test 5: hello.elf exits 0 only if its vDSO getpid/clock checks pass */
+    task_t *vdso_task = task_create_elf(hello_mod->address, hello_mod->size);
+    if (vdso_task == NULL) {
+        regtest_fail("libc_vdso", "task_create_elf returned NULL");
+        regtest_end_suite("libc");
+        return -1;
+    }
+    task_set_parent(vdso_task, task_current());
+    scheduler_add(vdso_task);
+    int vdso_status = -1;
+    task_wait(&vdso_status);
+    if (vdso_status != 0) {
+        regtest_fail("libc_vdso", "vDSO checks failed in user mode");
+        regtest_end_suite("libc");
+        return -1;
+    }
+    regtest_pass("libc_vdso");
+
     regtest_end_suite("libc");
     return 0;
 }
@@ -1803,6 +1982,12 @@ static void preempt_observer_fn(void) {
     }
 }
 
+/* Same-priority task used to check that preempt_disable() defers a switch */
+static volatile int preempt_deferred_ran = 0;
+static void preempt_deferred_fn(void) {
+    preempt_deferred_ran = 1;
+}
+
 /*
  * User code that busy-loops without yielding.
  * Used to test user-mode preemption.
@@ -1847,6 +2032,53 @@ static const uint8_t preempt_user_yield_code[] = {
     0x0f, 0x05
 };
 
+/*
+ * User code that parks a value in XMM0 across several yields and exits
+ * with 0 only if it is still there. The imm64 at FPU_USER_IMM_OFFSET is
+ * patched per task so two instances hold different values.
+ */
+#define FPU_USER_IMM_OFFSET 2
+static const uint8_t fpu_user_xmm_code[] = {
+    /* mov rbx, imm64 */
+    0x48, 0xbb, 0, 0, 0, 0, 0, 0, 0, 0,
+    /* movq xmm0, rbx */
+    0x66, 0x48, 0x0f, 0x6e, 0xc3,
+    /* mov r12d, 5 (loop counter) */
+    0x41, 0xbc, 0x05, 0x00, 0x00, 0x00,
+    /* .loop: */
+    /* mov eax, 2 (SYS_yield) */
+    0xb8, 0x02, 0x00, 0x00, 0x00,
+    /* syscall */
+    0x0f, 0x05,
+    /* dec r12d */
+    0x41, 0xff, 0xcc,
+    /* jnz .loop (-12) */
+    0x75, 0xf4,
+    /* movq rax, xmm0 */
+    0x66, 0x48, 0x0f, 0x7e, 0xc0,
+    /* xor edi, edi */
+    0x31, 0xff,
+    /* cmp rax, rbx */
+    0x48, 0x39, 0xd8,
+    /* setne dil */
+    0x40, 0x0f, 0x95, 0xc7,
+    /* xor eax, eax (SYS_exit) */
+    0x31, 0xc0,
+    /* syscall */
+    0x0f, 0x05
+};
+
+static task_t *fpu_create_xmm_task(uint64_t value) {
+    uint8_t code[sizeof(fpu_user_xmm_code)];
+    for (uint64_t i = 0; i < sizeof(code); i++) {
+        code[i] = fpu_user_xmm_code[i];
+    }
+    for (int i = 0; i < 8; i++) {
+        code[FPU_USER_IMM_OFFSET + i] = (uint8_t)(value >> (i * 8));
+    }
+    return task_create_user(code, sizeof(code));
+}
+
 int regtest_preempt(void) {
     regtest_start_suite("preempt");
 
@@ -1998,8 +2230,1355 @@ int regtest_preempt(void) {
 
     regtest_pass("preempt_stress");
 
+    /*
+     * Test 7: preempt_disable() holds off a switch past the end of the
+     * slice; the pending request is honoured by preempt_enable().
+     */
+    preempt_deferred_ran = 0;
+    task_t *deferred = task_create(preempt_deferred_fn);
+    if (deferred == NULL) {
+        regtest_fail("preempt_disable_create", "failed to create task");
+        regtest_end_suite("preempt");
+        return -1;
+    }
+    scheduler_add(deferred);
+
+    preempt_disable();
+    uint64_t start = timer_get_ticks();
+    while (timer_get_ticks() < start + SCHED_TICK_SLICE * 2) {
+        asm volatile("pause");
+    }
+    int ran_while_disabled = preempt_deferred_ran;
+    int resched_pending = this_cpu()->need_resched;
+    preempt_enable();
+    int ran_after_enable = preempt_deferred_ran;
+
+    if (ran_while_disabled) {
+        regtest_fail("preempt_disable", "task switched inside preempt_disable()");
+        regtest_end_suite("preempt");
+        return -1;
+    }
+    if (!resched_pending) {
+        regtest_fail("preempt_disable", "need_resched not set after slice expired");
+        regtest_end_suite("preempt");
+        return -1;
+    }
+    if (!ran_after_enable) {
+        regtest_fail("preempt_disable", "preempt_enable() did not reschedule");
+        regtest_end_suite("preempt");
+        return -1;
+    }
+    regtest_pass("preempt_disable");
+
+    /* Test 8: One-shot timer wakes a sleeper (no periodic tick needed) */
+    uint64_t sleep_start = timer_get_ticks();
+    timer_sleep_ms(30);
+    uint64_t slept = timer_get_ticks() - sleep_start;
+    if (slept < 3 || slept > 50) {
+        regtest_fail("preempt_timer_sleep", "sleep duration out of range");
+        regtest_end_suite("preempt");
+        return -1;
+    }
+    regtest_pass("preempt_timer_sleep");
+
+    /* Test 9: XMM state survives switches between two user tasks */
+    task_t *fpu_a = fpu_create_xmm_task(0x1111222233334444ULL);
+    task_t *fpu_b = fpu_create_xmm_task(0xAAAABBBBCCCCDDDDULL);
+    if (fpu_a == NULL || fpu_b == NULL || fpu_a->fpu_state == NULL) {
+        regtest_fail("preempt_fpu_create", "failed to create user task with FPU state");
+        regtest_end_suite("preempt");
+        return -1;
+    }
+    task_set_parent(fpu_a, task_current());
+    task_set_parent(fpu_b, task_current());
+    scheduler_add(fpu_a);
+    scheduler_add(fpu_b);
+    int fpu_status_a = -1;
+    int fpu_status_b = -1;
+    task_wait(&fpu_status_a);
+    task_wait(&fpu_status_b);
+    if (fpu_status_a != 0 || fpu_status_b != 0) {
+        regtest_fail("preempt_fpu_switch", "XMM0 corrupted across task switch");
+        regtest_end_suite("preempt");
+        return -1;
+    }
+    regtest_pass("preempt_fpu_switch");
+
     regtest_end_suite("preempt");
     return 0;
 }
 
+/* hrtimer callbacks record their firing order here */
+static volatile int hrtimer_fired[3];
+static volatile int hrtimer_fire_seq = 0;
+
+static void regtest_hrtimer_fn(hrtimer_t *timer) {
+    int slot = (int)(uint64_t)timer->data;
+    hrtimer_fired[slot] = ++hrtimer_fire_seq;
+}
+
+/* Kernel task that sleeps 30 ms, then records when it woke */
+static volatile uint64_t sleeper_woke_ns = 0;
+static void regtest_sleeper_fn(void) {
+    task_sleep_ns(30 * NSEC_PER_MSEC);
+    sleeper_woke_ns = ktime_get_ns();
+}
+
+/*
+ * User code: nanosleep({0, 20ms}, NULL), then exit with its return value.
+ */
+static const uint8_t user_nanosleep_code[] = {
+    /* sub rsp, 16 */
+    0x48, 0x83, 0xec, 0x10,
+    /* mov qword [rsp], 0 (tv_sec) */
+    0x48, 0xc7, 0x04, 0x24, 0x00, 0x00, 0x00, 0x00,
+    /* mov qword [rsp+8], 20000000 (tv_nsec) */
+    0x48, 0xc7, 0x44, 0x24, 0x08, 0x00, 0x2d, 0x31, 0x01,
+    /* mov rdi, rsp */
+    0x48, 0x89, 0xe7,
+    /* xor esi, esi */
+    0x31, 0xf6,
+    /* mov eax, 7 (SYS_nanosleep) */
+    0xb8, 0x07, 0x00, 0x00, 0x00,
+    /* syscall */
+    0x0f, 0x05,
+    /* mov edi, eax */
+    0x89, 0xc7,
+    /* xor eax, eax (SYS_exit) */
+    0x31, 0xc0,
+    /* syscall */
+    0x0f, 0x05
+};
+
+/*
+ * Clocksource Test Suite
+ *
+ * Tests the nanosecond monotonic clock, SYS_clock_gettime and hrtimers.
+ */
+int regtest_clock(void) {
+    regtest_start_suite("clock");
+
+    /* Test 1: Clocksource selected */
+    const char *name = clocksource_name();
+    if (name == NULL || clocksource_tsc_khz() == 0) {
+        regtest_fail("clock_init", "no calibrated clocksource");
+        regtest_end_suite("clock");
+        return -1;
+    }
+    regtest_log("clocksource=%s tsc_khz=%d\n", name, (int)clocksource_tsc_khz());
+    regtest_pass("clock_init");
+
+    /* Test 2: Monotonic across consecutive reads */
+    uint64_t prev = ktime_get_ns();
+    int backwards = 0;
+    for (int i = 0; i < 1000; i++) {
+        uint64_t now = ktime_get_ns();
+        if (now < prev) backwards++;
+        prev = now;
+    }
+    if (backwards) {
+        regtest_fail("clock_monotonic", "ktime_get_ns went backwards");
+        regtest_end_suite("clock");
+        return -1;
+    }
+    regtest_pass("clock_monotonic");
+
+    /* Test 3: Sub-tick resolution - the clock advances within a spin */
+    uint64_t t0 = ktime_get_ns();
+    uint64_t t1 = t0;
+    for (int i = 0; i < 1000000 && t1 == t0; i++) {
+        t1 = ktime_get_ns();
+    }
+    if (t1 == t0 || t1 - t0 >= 10 * NSEC_PER_MSEC) {
+        regtest_fail("clock_resolution", "clock did not advance at sub-tick resolution");
+        regtest_end_suite("clock");
+        return -1;
+    }
+    regtest_pass("clock_resolution");
+
+    /* Test 4: Sleep length measured in nanoseconds */
+    t0 = ktime_get_ns();
+    timer_sleep_ms(20);
+    uint64_t slept_ns = ktime_get_ns() - t0;
+    if (slept_ns < 20 * NSEC_PER_MSEC || slept_ns > 200 * NSEC_PER_MSEC) {
+        regtest_fail("clock_sleep", "timer_sleep_ms(20) duration out of range");
+        regtest_end_suite("clock");
+        return -1;
+    }
+    regtest_pass("clock_sleep");
+
+    /* Test 5: SYS_clock_gettime rejects bad clocks and kernel pointers */
+    struct timespec ts;
+    if ((int64_t)syscall_dispatch(SYS_clock_gettime, CLOCK_REALTIME, (uint64_t)&ts, 0, 0, 0, 0) != -1 ||
+        (int64_t)syscall_dispatch(SYS_clock_gettime, CLOCK_MONOTONIC, 0, 0, 0, 0, 0) != -1 ||
+        (int64_t)syscall_dispatch(SYS_clock_gettime, CLOCK_MONOTONIC, (uint64_t)&ts, 0, 0, 0, 0) != -1) {
+        regtest_fail("clock_gettime_validate", "invalid arguments accepted");
+        regtest_end_suite("clock");
+        return -1;
+    }
+    regtest_pass("clock_gettime_validate");
+
+    /* Test 6: hrtimers fire in deadline order regardless of start order */
+    hrtimer_t timers[3];
+    hrtimer_fire_seq = 0;
+    for (int i = 0; i < 3; i++) {
+        hrtimer_fired[i] = 0;
+        hrtimer_init(&timers[i], (void *)(uint64_t)i);
+    }
+    int pending_before = hrtimer_pending();
+    uint64_t base = ktime_get_ns();
+    hrtimer_start(&timers[0], base + 6 * NSEC_PER_MSEC, regtest_hrtimer_fn);
+    hrtimer_start(&timers[1], base + 2 * NSEC_PER_MSEC, regtest_hrtimer_fn);
+    hrtimer_start(&timers[2], base + 4 * NSEC_PER_MSEC, regtest_hrtimer_fn);
+    timer_sleep_ms(15);
+    if (hrtimer_fired[1] != 1 || hrtimer_fired[2] != 2 || hrtimer_fired[0] != 3) {
+        regtest_fail("hrtimer_order", "timers fired out of deadline order");
+        regtest_end_suite("clock");
+        return -1;
+    }
+    regtest_pass("hrtimer_order");
+
+    /* Test 7: A cancelled timer never fires */
+    hrtimer_fired[0] = 0;
+    hrtimer_start(&timers[0], ktime_get_ns() + 3 * NSEC_PER_MSEC, regtest_hrtimer_fn);
+    int was_pending = hrtimer_cancel(&timers[0]);
+    timer_sleep_ms(10);
+    if (!was_pending || hrtimer_fired[0] != 0 || hrtimer_active(&timers[0])) {
+        regtest_fail("hrtimer_cancel", "cancelled timer fired or stayed pending");
+        regtest_end_suite("clock");
+        return -1;
+    }
+    if (hrtimer_pending() != pending_before) {
+        regtest_fail("hrtimer_cancel", "timer heap size changed");
+        regtest_end_suite("clock");
+        return -1;
+    }
+    regtest_pass("hrtimer_cancel");
+
+    /* Test 8: A sleeping task is blocked (off the CPU) until its deadline */
+    sleeper_woke_ns = 0;
+    task_t *sleeper = task_create(regtest_sleeper_fn);
+    if (sleeper == NULL) {
+        regtest_fail("task_sleep_create", "failed to create task");
+        regtest_end_suite("clock");
+        return -1;
+    }
+    task_set_parent(sleeper, task_current());
+    uint64_t sleep_start = ktime_get_ns();
+    scheduler_add(sleeper);
+    task_yield();
+    if (sleeper->state != PROC_BLOCKED) {
+        regtest_fail("task_sleep", "sleeper not blocked");
+        regtest_end_suite("clock");
+        return -1;
+    }
+    task_wait(NULL);
+    if (sleeper_woke_ns < sleep_start + 30 * NSEC_PER_MSEC) {
+        regtest_fail("task_sleep", "sleeper woke early");
+        regtest_end_suite("clock");
+        return -1;
+    }
+    regtest_pass("task_sleep");
+
+    /* Test 9: SYS_nanosleep from user mode */
+    task_t *user_sleeper = task_create_user(user_nanosleep_code, sizeof(user_nanosleep_code));
+    if (user_sleeper == NULL) {
+        regtest_fail("nanosleep_create", "failed to create user task");
+        regtest_end_suite("clock");
+        return -1;
+    }
+    task_set_parent(user_sleeper, task_current());
+    sleep_start = ktime_get_ns();
+    scheduler_add(user_sleeper);
+    int sleep_status = -1;
+    task_wait(&sleep_status);
+    if (sleep_status != 0 || ktime_get_ns() - sleep_start < 20 * NSEC_PER_MSEC) {
+        regtest_fail("nanosleep", "nanosleep failed or returned early");
+        regtest_end_suite("clock");
+        return -1;
+    }
+    regtest_pass("nanosleep");
+
+    /* Test 10: SYS_nanosleep reports bad pointers with a negated errno */
+    struct timespec nap = { 0, 1000 };
+    if ((int64_t)syscall_dispatch(SYS_nanosleep, 0, 0, 0, 0, 0, 0) != -EFAULT ||
+        (int64_t)syscall_dispatch(SYS_nanosleep, (uint64_t)&nap, 0, 0, 0, 0, 0) != -EFAULT) {
+        regtest_fail("nanosleep_validate", "bad pointer not rejected with -EFAULT");
+        regtest_end_suite("clock");
+        return -1;
+    }
+    regtest_pass("nanosleep_validate");
+
+    /*
+     * Test 11: A full timer heap refuses new timers instead of panicking,
+     * and hrtimer_try_start() leaves the reserved slots to hrtimer_start().
+     * Interrupts stay off so every timer lands on this CPU's heap.
+     */
+    static hrtimer_t fill[HRTIMER_MAX];
+    uint64_t far = ktime_get_ns() + 10 * NSEC_PER_SEC;
+    uint64_t irq = local_irq_save();
+    int pending_start = hrtimer_pending();
+    int armed = 0;
+    while (armed < HRTIMER_MAX) {
+        hrtimer_init(&fill[armed], NULL);
+        if (hrtimer_try_start(&fill[armed], far, regtest_hrtimer_fn) != 0) {
+            break;
+        }
+        armed++;
+    }
+    int try_full = hrtimer_pending();
+    int reserved_ok = 1;
+    while (armed < HRTIMER_MAX) {
+        hrtimer_init(&fill[armed], NULL);
+        if (hrtimer_start(&fill[armed], far, regtest_hrtimer_fn) != 0) {
+            reserved_ok = 0;
+            break;
+        }
+        armed++;
+    }
+    hrtimer_t extra;
+    hrtimer_init(&extra, NULL);
+    int full_err = hrtimer_start(&extra, far, regtest_hrtimer_fn);
+    int extra_pending = hrtimer_active(&extra);
+    for (int i = 0; i < armed; i++) {
+        hrtimer_cancel(&fill[i]);
+    }
+    int pending_end = hrtimer_pending();
+    local_irq_restore(irq);
+    if (try_full != HRTIMER_MAX - HRTIMER_RESERVED || !reserved_ok) {
+        regtest_fail("hrtimer_full", "reserved slots not kept for hrtimer_start");
+        regtest_end_suite("clock");
+        return -1;
+    }
+    if (full_err != -EAGAIN || extra_pending || pending_end != pending_start) {
+        regtest_fail("hrtimer_full", "full heap accepted a timer");
+        regtest_end_suite("clock");
+        return -1;
+    }
+    regtest_pass("hrtimer_full");
+
+    regtest_end_suite("clock");
+    return 0;
+}
+
+
+/*
+ * SIMD Bulk Memory Test Suite
+ * Tests the vectorized fill/copy/memmove/zero routines against scalar
+ * results and reports throughput for each implementation.
+ */
+
+#define SIMD_TEST_BYTES  8192
+#define SIMD_BENCH_BYTES (256 * 1024)
+#define SIMD_BENCH_REPS  32
+
+/* Run one implementation through the edge cases; returns reason or NULL */
+static const char *simd_check_impl(uint8_t *a, uint8_t *b) {
+    /* Rect fill: misaligned start, row length not a multiple of 64 */
+    for (int i = 0; i < SIMD_TEST_BYTES; i++) a[i] = 0xEE;
+    simd_fill32_rect_nt(a + 4, 1100, 0x11223344, 1000, 3);
+    for (int y = 0; y < 3; y++) {
+        uint8_t *row = a + 4 + y * 1100;
+        for (int x = 0; x < 1000; x += 4) {
+            if (*(uint32_t *)(row + x) != 0x11223344) return "fill wrote wrong value";
+        }
+        if (row[-1] != 0xEE || row[1000] != 0xEE) return "fill overran row";
+    }
+
+    /* Rect copy: unaligned source and destination, different pitches */
+    for (int i = 0; i < SIMD_TEST_BYTES; i++) {
+        a[i] = (uint8_t)(i * 7);
+        b[i] = 0xEE;
+    }
+    simd_copy_rect_nt(b + 12, 1200, a + 3, 1010, 1000, 3);
+    for (int y = 0; y < 3; y++) {
+        for (int x = 0; x < 1000; x++) {
+            if (b[12 + y * 1200 + x] != a[3 + y * 1010 + x]) return "copy mismatch";
+        }
+        if (b[12 + y * 1200 + 1000] != 0xEE) return "copy overran row";
+    }
+
+    /* memmove forward overlap (console scroll direction) */
+    for (int i = 0; i < SIMD_TEST_BYTES; i++) a[i] = (uint8_t)i;
+    simd_memmove(a + 8, a + 108, 3000);
+    for (int i = 0; i < 3000; i++) {
+        if (a[8 + i] != (uint8_t)(108 + i)) return "memmove forward mismatch";
+    }
+
+    /* memmove backward overlap */
+    for (int i = 0; i < SIMD_TEST_BYTES; i++) a[i] = (uint8_t)i;
+    simd_memmove(a + 200, a + 100, 3000);
+    for (int i = 0; i < 3000; i++) {
+        if (a[200 + i] != (uint8_t)(100 + i)) return "memmove backward mismatch";
+    }
+
+    /* Page zeroing */
+    uint64_t frame = pmm_alloc_frame();
+    if (frame == 0) return "out of memory";
+    uint8_t *page = (uint8_t *)phys_to_hhdm(frame);
+    for (int i = 0; i < PAGE_SIZE; i++) page[i] = 0xFF;
+    simd_zero_page(page);
+    int nonzero = 0;
+    for (int i = 0; i < PAGE_SIZE; i++) nonzero |= page[i];
+    pmm_free_frame(frame);
+    if (nonzero) return "zero_page left data";
+
+    return NULL;
+}
+
+static int simd_mb_per_s(uint64_t bytes, uint64_t ns) {
+    return ns ? (int)(bytes * 1000 / ns) : 0;
+}
+
+int regtest_simd(void) {
+    regtest_start_suite("simd");
+
+    /* Test 1: A vector implementation is selected (SSE2 is baseline) */
+    simd_impl_t selected = simd_get_impl();
+    if (selected == SIMD_SCALAR) {
+        regtest_fail("simd_select", "no SIMD implementation selected");
+        regtest_end_suite("simd");
+        return -1;
+    }
+    regtest_log("simd=%s fpu=%s avx=%d\n", simd_impl_name(selected),
+                fpu_save_mode(), fpu_has_avx());
+    regtest_pass("simd_select");
+
+    uint8_t *a = kmalloc(SIMD_BENCH_BYTES);
+    uint8_t *b = kmalloc(SIMD_BENCH_BYTES);
+    if (a == NULL || b == NULL) {
+        regtest_fail("simd_alloc", "kmalloc failed");
+        regtest_end_suite("simd");
+        return -1;
+    }
+
+    /* Test 2: Every supported implementation matches the scalar semantics */
+    const char *reason = NULL;
+    for (int impl = SIMD_SCALAR; impl <= SIMD_AVX2 && reason == NULL; impl++) {
+        if (simd_set_impl((simd_impl_t)impl) == 0) {
+            reason = simd_check_impl(a, b);
+        }
+    }
+    simd_set_impl(selected);
+    if (reason != NULL) {
+        regtest_fail("simd_correctness", reason);
+        kfree(a);
+        kfree(b);
+        regtest_end_suite("simd");
+        return -1;
+    }
+    regtest_pass("simd_correctness");
+
+    /* Test 3: Throughput of each implementation (reported, not asserted) */
+    for (int impl = SIMD_SCALAR; impl <= SIMD_AVX2; impl++) {
+        if (simd_set_impl((simd_impl_t)impl) != 0) {
+            continue;
+        }
+        uint64_t start = ktime_get_ns();
+        for (int r = 0; r < SIMD_BENCH_REPS; r++) {
+            simd_copy_rect_nt(b, SIMD_BENCH_BYTES, a, SIMD_BENCH_BYTES, SIMD_BENCH_BYTES, 1);
+        }
+        uint64_t copy_ns = ktime_get_ns() - start;
+
+        start = ktime_get_ns();
+        for (int r = 0; r < SIMD_BENCH_REPS; r++) {
+            simd_fill32_rect_nt(b, SIMD_BENCH_BYTES, 0x55AA55AA, SIMD_BENCH_BYTES, 1);
+        }
+        uint64_t fill_ns = ktime_get_ns() - start;
+
+        uint64_t total = (uint64_t)SIMD_BENCH_BYTES * SIMD_BENCH_REPS;
+        regtest_log("simd_bench impl=%s copy_mb_s=%d fill_mb_s=%d\n",
+                    simd_impl_name((simd_impl_t)impl),
+                    simd_mb_per_s(total, copy_ns), simd_mb_per_s(total, fill_ns));
+    }
+    simd_set_impl(selected);
+    kfree(a);
+    kfree(b);
+    regtest_pass("simd_bench");
+
+    regtest_end_suite("simd");
+    return 0;
+}
+
+
+/* CPU each SMP worker observed itself on, filled in by smp_worker_fn */
+#define SMP_TEST_WORKERS 8
+static volatile int smp_worker_cpu[SMP_TEST_WORKERS];
+static volatile int smp_worker_next = 0;
+static volatile int smp_workers_done = 0;
+
+static void smp_worker_fn(void) {
+    int slot = __atomic_fetch_add(&smp_worker_next, 1, __ATOMIC_RELAXED);
+    /* Spin long enough that idle CPUs get a chance to steal the rest */
+    uint64_t end = ktime_get_ns() + 20000000ULL;
+    while (ktime_get_ns() < end) {
+        __asm__ volatile ("pause");
+    }
+    if (slot < SMP_TEST_WORKERS) {
+        smp_worker_cpu[slot] = (int)this_cpu()->cpu_id;
+    }
+    __atomic_fetch_add(&smp_workers_done, 1, __ATOMIC_RELEASE);
+}
+
+int regtest_smp(void) {
+    regtest_start_suite("smp");
+
+    /* Test 1: The per-CPU area points at itself and at the running task */
+    percpu_t *cpu = this_cpu();
+    if (cpu == NULL || cpu->self != cpu || cpu->curr != task_current()) {
+        regtest_fail("smp_percpu", "per-CPU area inconsistent");
+        regtest_end_suite("smp");
+        return -1;
+    }
+    regtest_pass("smp_percpu");
+
+    /* Test 2: GS base is the per-CPU area; the user base is parked in KERNEL_GS_BASE */
+    uint64_t gs = smp_has_fsgsbase() ? rdgsbase() : rdmsr(MSR_IA32_GS_BASE);
+    if (gs != (uint64_t)cpu || rdmsr(MSR_IA32_KERNEL_GS_BASE) == (uint64_t)cpu) {
+        regtest_fail("smp_gs_base", "GS base does not match per-CPU area");
+        regtest_end_suite("smp");
+        return -1;
+    }
+    regtest_log("smp fsgsbase=%d\n", smp_has_fsgsbase());
+    regtest_pass("smp_gs_base");
+
+    /* Test 3: CPU 0 is registered and online */
+    int count = smp_cpu_count();
+    if (count < 1 || smp_cpu(0) == NULL || !smp_cpu(0)->online) {
+        regtest_fail("smp_bsp", "boot CPU not online");
+        regtest_end_suite("smp");
+        return -1;
+    }
+    regtest_log("smp cpus=%d this=%d\n", count, (int)cpu->cpu_id);
+    regtest_pass("smp_bsp");
+
+    /* Test 4: CPU-bound tasks spread over more than one CPU */
+    smp_worker_next = 0;
+    smp_workers_done = 0;
+    for (int i = 0; i < SMP_TEST_WORKERS; i++) {
+        smp_worker_cpu[i] = -1;
+        task_t *t = task_create(smp_worker_fn);
+        if (t == NULL) {
+            regtest_fail("smp_spread", "failed to create worker");
+            regtest_end_suite("smp");
+            return -1;
+        }
+        scheduler_add(t);
+    }
+
+    int timeout = 0;
+    while (__atomic_load_n(&smp_workers_done, __ATOMIC_ACQUIRE) < SMP_TEST_WORKERS &&
+           timeout < 100000) {
+        task_yield();
+        timeout++;
+    }
+    if (smp_workers_done < SMP_TEST_WORKERS) {
+        regtest_fail("smp_spread", "workers did not finish");
+        regtest_end_suite("smp");
+        return -1;
+    }
+
+    uint32_t seen = 0;
+    int distinct = 0;
+    for (int i = 0; i < SMP_TEST_WORKERS; i++) {
+        int c = smp_worker_cpu[i];
+        if (c >= 0 && !(seen & (1u << c))) {
+            seen |= 1u << c;
+            distinct++;
+        }
+    }
+    regtest_log("smp workers ran on %d CPU(s)\n", distinct);
+    if (count > 1 && distinct < 2) {
+        regtest_fail("smp_spread", "all workers ran on one CPU");
+        regtest_end_suite("smp");
+        return -1;
+    }
+    regtest_pass("smp_spread");
+
+    regtest_end_suite("smp");
+    return 0;
+}
+
+
+/* Mutex contention: each worker does a yield-spanning read-modify-write */
+#define LOCKS_TEST_WORKERS 4
+#define LOCKS_TEST_ITERS   50
+static mutex_t locks_test_mutex = MUTEX_INITIALIZER("regtest");
+
+/* Static so their lockstat records stay valid after the suite returns */
+static spinlock_t locks_test_spin = SPINLOCK_INITIALIZER("regtest_spin");
+static seqlock_t locks_test_seq = SEQLOCK_INITIALIZER("regtest_seq");
+static volatile int locks_test_counter = 0;
+static atomic_t locks_workers_done = ATOMIC_INIT(0);
+
+static void locks_mutex_worker(void) {
+    for (int i = 0; i < LOCKS_TEST_ITERS; i++) {
+        mutex_lock(&locks_test_mutex);
+        int value = locks_test_counter;
+        task_yield();  /* Let the others pile up on the mutex */
+        locks_test_counter = value + 1;
+        mutex_unlock(&locks_test_mutex);
+    }
+    atomic_inc(&locks_workers_done);
+}
+
+int regtest_locks(void) {
+    regtest_start_suite("locks");
+
+    /* Test 1: Ticket spinlock lock/trylock/unlock */
+    spinlock_t *lock = &locks_test_spin;
+    uint16_t owner = lock->tickets.owner;
+    if (spin_is_locked(lock) || !spin_trylock(lock) || !spin_is_locked(lock) ||
+        spin_trylock(lock)) {
+        regtest_fail("locks_spin_trylock", "trylock state wrong");
+        regtest_end_suite("locks");
+        return -1;
+    }
+    spin_unlock(lock);
+    uint64_t flags = spin_lock_irqsave(lock);
+    int irqs_off = !cpu_irqs_enabled();
+    spin_unlock_irqrestore(lock, flags);
+    if (spin_is_locked(lock) || !irqs_off || lock->tickets.owner != (uint16_t)(owner + 2)) {
+        regtest_fail("locks_spin_trylock", "unlock or irqsave wrong");
+        regtest_end_suite("locks");
+        return -1;
+    }
+    regtest_pass("locks_spin_trylock");
+
+    /* Test 2: Atomics helpers */
+    atomic_t a = ATOMIC_INIT(2);
+    if (atomic_cmpxchg(&a, 1, 5) != 2 || atomic_read(&a) != 2 ||
+        atomic_cmpxchg(&a, 2, 1) != 2 || !atomic_dec_and_test(&a) ||
+        atomic_add_return(&a, 3) != 3) {
+        regtest_fail("locks_atomic", "atomic ops wrong");
+        regtest_end_suite("locks");
+        return -1;
+    }
+    regtest_pass("locks_atomic");
+
+    /* Test 3: Seqlock readers see a concurrent write and retry */
+    seqlock_t *sl = &locks_test_seq;
+    uint32_t seq = read_seqbegin(sl);
+    if (read_seqretry(sl, seq)) {
+        regtest_fail("locks_seqlock", "retry without writer");
+        regtest_end_suite("locks");
+        return -1;
+    }
+    write_seqlock(sl);
+    write_sequnlock(sl);
+    if (!read_seqretry(sl, seq) || read_seqbegin(sl) != seq + 2) {
+        regtest_fail("locks_seqlock", "write not detected");
+        regtest_end_suite("locks");
+        return -1;
+    }
+    regtest_pass("locks_seqlock");
+
+    /* Test 4: Mutex keeps a yield-spanning update atomic */
+    locks_test_counter = 0;
+    atomic_set(&locks_workers_done, 0);
+    for (int i = 0; i < LOCKS_TEST_WORKERS; i++) {
+        task_t *t = task_create(locks_mutex_worker);
+        if (t == NULL) {
+            regtest_fail("locks_mutex", "failed to create worker");
+            regtest_end_suite("locks");
+            return -1;
+        }
+        scheduler_add(t);
+    }
+
+    int timeout = 0;
+    while (atomic_read(&locks_workers_done) < LOCKS_TEST_WORKERS && timeout < 100000) {
+        task_yield();
+        timeout++;
+    }
+    if (atomic_read(&locks_workers_done) < LOCKS_TEST_WORKERS) {
+        regtest_fail("locks_mutex", "workers did not finish");
+        regtest_end_suite("locks");
+        return -1;
+    }
+    if (locks_test_counter != LOCKS_TEST_WORKERS * LOCKS_TEST_ITERS ||
+        mutex_is_locked(&locks_test_mutex)) {
+        regtest_fail("locks_mutex", "lost update");
+        regtest_end_suite("locks");
+        return -1;
+    }
+    regtest_pass("locks_mutex");
+
+    /* Test 5: Statistics are collected for kernel and test locks */
+    struct lock_stats *pmm = lockstat_find("pmm");
+    struct lock_stats *mtx = lockstat_find("regtest");
+    if (pmm == NULL || pmm->acquisitions == 0 || mtx == NULL ||
+        mtx->acquisitions < LOCKS_TEST_WORKERS * LOCKS_TEST_ITERS) {
+        regtest_fail("locks_stats", "lock statistics missing");
+        regtest_end_suite("locks");
+        return -1;
+    }
+    regtest_log("lockstat mutex acq=%d contended=%d\n",
+                (int)mtx->acquisitions, (int)mtx->contended);
+    regtest_pass("locks_stats");
+
+    /* Test 6: A heap-allocated lock leaves the registry before it is freed */
+    spinlock_t *dyn = kmalloc(sizeof(spinlock_t));
+    if (dyn == NULL) {
+        regtest_fail("locks_unregister", "allocation failed");
+        regtest_end_suite("locks");
+        return -1;
+    }
+    spin_lock_init(dyn, "regtest_dyn");
+    spin_lock(dyn);
+    spin_unlock(dyn);
+    int found = lockstat_find("regtest_dyn") == &dyn->stats;
+    spin_lock_destroy(dyn);
+    int gone = lockstat_find("regtest_dyn") == NULL;
+    kfree(dyn);
+    if (!found || !gone || lockstat_find("pmm") != pmm) {
+        regtest_fail("locks_unregister", "registry not updated");
+        regtest_end_suite("locks");
+        return -1;
+    }
+    regtest_pass("locks_unregister");
+
+    regtest_end_suite("locks");
+    return 0;
+}
+
+/* ========== Ring Suite ========== */
+
+/*
+ * Ring Test Suite
+ *
+ * Runs ringtest.elf, which checks batched submission, asynchronous
+ * completion, links and reads through its submission/completion ring
+ * and exits 0 if they all behave. Keyboard input for its read is
+ * injected first. It exits with a second read pending, which must be
+ * cancelled rather than hold a worker or take later keys.
+ */
+
+/* Run ringtest.elf to completion; returns its exit status */
+static int ring_run(struct limine_file *mod) {
+    task_t *t = task_create_elf(mod->address, mod->size);
+    if (t == NULL) {
+        return -1;
+    }
+    kbd_reset_state();
+    kbd_inject_string("abc");
+    task_set_parent(t, task_current());
+    scheduler_add(t);
+    int status = -1;
+    task_wait(&status);
+    return status;
+}
+
+int regtest_ring(void) {
+    regtest_start_suite("ring");
+
+    if (limine_modules == NULL || limine_modules->module_count == 0) {
+        regtest_log("NOTE: No modules loaded, skipping ring tests\n");
+        regtest_pass("ring_skip_no_modules");
+        regtest_end_suite("ring");
+        return 0;
+    }
+
+    struct limine_file *mod = find_module("ringtest.elf");
+    if (mod == NULL) {
+        regtest_fail("ring_find_module", "ringtest.elf not found in modules");
+        regtest_end_suite("ring");
+        return -1;
+    }
+    regtest_pass("ring_find_module");
+
+    /* Test 1: every check in user mode passes */
+    int status = ring_run(mod);
+    if (status != 0) {
+        regtest_fail("ring_user_checks", "ringtest.elf failed a check");
+        regtest_end_suite("ring");
+        return -1;
+    }
+    regtest_pass("ring_user_checks");
+
+    /* Test 2: the read left pending at exit was cancelled and takes no key */
+    kbd_inject_string("x");
+    if (kbd_getc_nonblock() != 'x') {
+        regtest_fail("ring_read_cancelled", "pending read outlived its process");
+        regtest_end_suite("ring");
+        return -1;
+    }
+    regtest_pass("ring_read_cancelled");
+
+    /* Test 3: the ring page and every operation are freed with the process */
+    uint64_t free_before = pmm_get_free_frames();
+    status = ring_run(mod);
+    /* A worker posts the cancelled read, dropping the last ring reference */
+    for (int i = 0; i < 100 && pmm_get_free_frames() < free_before; i++) {
+        timer_sleep_ms(1);
+    }
+    uint64_t free_after = pmm_get_free_frames();
+    if (status != 0 || free_after < free_before) {
+        regtest_fail("ring_no_leak", "frames lost across a ringtest.elf run");
+        regtest_end_suite("ring");
+        return -1;
+    }
+    regtest_pass("ring_no_leak");
+
+    /* Test 4: a freed ring's lock is no longer in the lockstat registry */
+    if (lockstat_find("uring_cq") != NULL) {
+        regtest_fail("ring_lockstat", "freed ring lock still registered");
+        regtest_end_suite("ring");
+        return -1;
+    }
+    regtest_pass("ring_lockstat");
+
+    regtest_end_suite("ring");
+    return 0;
+}
+
+/* ========== Serial Suite ========== */
+
+/*
+ * Serial Test Suite
+ *
+ * Tests the interrupt-driven UART: output is queued rather than sent
+ * while the caller waits, serial_flush() drains it, and received bytes
+ * come back through the RX path (UART loopback, so the host sees none).
+ */
+
+/* 200 bytes of output, more than the 16-byte TX FIFO can take at once */
+static const char serial_test_line[] =
+    "[serial] buffered output test: 0123456789abcdefghijklmnopqrstuvwxyz"
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ 0123456789abcdefghijklmnopqrstuvwxyz"
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ 0123456789abcdefghijklmnopqrs\n";
+
+int regtest_serial(void) {
+    regtest_start_suite("serial");
+
+    /* Test 1: a long line is queued, not sent, while IRQ4 cannot run */
+    serial_flush();
+    uint64_t flags = local_irq_save();
+    uint64_t start = ktime_get_ns();
+    serial_puts(serial_test_line);
+    uint64_t queue_ns = ktime_get_ns() - start;
+    uint32_t pending = serial_tx_pending();
+    local_irq_restore(flags);
+    if (pending < (sizeof(serial_test_line) - 1) / 2) {
+        regtest_fail("serial_buffered", "line was not queued in the TX ring");
+        regtest_end_suite("serial");
+        return -1;
+    }
+    regtest_log("serial: queued %d bytes in %d ns\n",
+                (int)(sizeof(serial_test_line) - 1), (int)queue_ns);
+    regtest_pass("serial_buffered");
+
+    /* Test 2: serial_flush() leaves nothing queued */
+    serial_flush();
+    if (serial_tx_pending() != 0) {
+        regtest_fail("serial_flush", "bytes still queued after flush");
+        regtest_end_suite("serial");
+        return -1;
+    }
+    regtest_pass("serial_flush");
+
+    /* Test 3: bytes sent in loopback come back through the RX path */
+    char rx[4] = { 0, 0, 0, 0 };
+    int got = 0;
+    flags = local_irq_save();
+    serial_set_loopback(1);
+    serial_write("ping", 4);
+    serial_flush();
+    for (int spins = 0; got < 4 && spins < 100000; spins++) {
+        int c = serial_getc_nonblock();
+        if (c >= 0) {
+            rx[got++] = (char)c;
+        }
+    }
+    serial_set_loopback(0);
+    local_irq_restore(flags);
+    if (got != 4 || rx[0] != 'p' || rx[1] != 'i' || rx[2] != 'n' || rx[3] != 'g') {
+        regtest_fail("serial_rx_loopback", "did not receive the looped-back bytes");
+        regtest_end_suite("serial");
+        return -1;
+    }
+    regtest_pass("serial_rx_loopback");
+
+    regtest_end_suite("serial");
+    return 0;
+}
+
+/* ========== Kernel Log Suite ========== */
+
+/*
+ * Kernel Log Test Suite
+ *
+ * Tests printk(): formatting, records landing in the ring with their
+ * level and timestamp, and klog_flush() pushing them through the sinks.
+ */
+
+static int klog_streq(const char *a, const char *b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+int regtest_klog(void) {
+    regtest_start_suite("klog");
+
+    /* Test 1: formatting, including truncation */
+    char buf[48];
+    int len = ksnprintf(buf, sizeof(buf), "%d %u %x %4s|%lx|%03d%%", -42, 7u, 0xbeefu, "ab",
+                        (uint64_t)0x123456789abULL, 5);
+    if (!klog_streq(buf, "-42 7 beef   ab|123456789ab|005%") || len != 32) {
+        regtest_fail("klog_format", "ksnprintf output mismatch");
+        regtest_end_suite("klog");
+        return -1;
+    }
+    len = ksnprintf(buf, 6, "%s", "truncated");
+    if (!klog_streq(buf, "trunc") || len != 9) {
+        regtest_fail("klog_format", "ksnprintf truncation mismatch");
+        regtest_end_suite("klog");
+        return -1;
+    }
+    regtest_pass("klog_format");
+
+    /* Test 2: a message becomes exactly one record with its level */
+    uint64_t before = klog_count();
+    uint64_t tsc = rdtsc();
+    uint64_t start = ktime_get_ns();
+    printk(LOG_WARN, "klog: regtest marker %d\n", 4242);
+    uint64_t printk_ns = ktime_get_ns() - start;
+    if (klog_count() != before + 1) {
+        regtest_fail("klog_record", "record count did not advance by one");
+        regtest_end_suite("klog");
+        return -1;
+    }
+    struct klog_record rec;
+    uint64_t seq = before;
+    if (!klog_read(&seq, &rec) || rec.level != LOG_WARN || rec.tsc < tsc ||
+        !klog_streq(rec.text, "klog: regtest marker 4242")) {
+        regtest_fail("klog_record", "record missing or wrong");
+        regtest_end_suite("klog");
+        return -1;
+    }
+    regtest_log("klog: printk took %d ns\n", (int)printk_ns);
+    regtest_pass("klog_record");
+
+    /* Test 3: klog_flush() leaves nothing for the sinks to write */
+    printk(LOG_INFO, "klog: flush test");
+    klog_flush();
+    if (klog_pending() != 0) {
+        regtest_fail("klog_flush", "records still pending after flush");
+        regtest_end_suite("klog");
+        return -1;
+    }
+    regtest_pass("klog_flush");
+
+    regtest_end_suite("klog");
+    return 0;
+}
+
+/* ========== virtio-console Suite ========== */
+
+/*
+ * virtio-console Test Suite
+ *
+ * Only runs when QEMU provides the device (run_regtest.sh does). Pushes
+ * a burst through the transmit queue, reports the rate, and checks
+ * that every buffer comes back from the host.
+ */
+
+#define VIRTIO_BURST_BYTES (64 * 1024)
+
+int regtest_virtio(void) {
+    regtest_start_suite("virtio");
+
+    if (!virtio_console_present()) {
+        regtest_log("NOTE: No virtio-console, skipping virtio tests\n");
+        regtest_pass("virtio_skip_not_present");
+        regtest_end_suite("virtio");
+        return 0;
+    }
+
+    /* Test 1: a burst of full lines goes out and comes back */
+    static char chunk[4096];
+    for (int i = 0; i < (int)sizeof(chunk); i++) {
+        chunk[i] = (i % 64 == 63) ? '\n' : (char)('a' + i % 26);
+    }
+    uint64_t start = ktime_get_ns();
+    for (int sent = 0; sent < VIRTIO_BURST_BYTES; sent += (int)sizeof(chunk)) {
+        virtio_console_write(chunk, sizeof(chunk));
+    }
+    virtio_console_flush();
+    uint64_t elapsed_ns = ktime_get_ns() - start;
+    if (!virtio_console_present() || virtio_console_in_flight() != 0) {
+        regtest_fail("virtio_burst", "host did not return the transmit buffers");
+        regtest_end_suite("virtio");
+        return -1;
+    }
+    if (elapsed_ns == 0) {
+        elapsed_ns = 1;
+    }
+    regtest_log("virtio: %d KB in %d us (%d KB/s)\n", VIRTIO_BURST_BYTES / 1024,
+                (int)(elapsed_ns / NSEC_PER_USEC),
+                (int)((uint64_t)VIRTIO_BURST_BYTES * (NSEC_PER_SEC / 1024) / elapsed_ns));
+    regtest_pass("virtio_burst");
+
+    /* Test 2: the kernel log reaches the device too */
+    printk(LOG_DEBUG, "virtio: klog sink check");
+    klog_flush();
+    virtio_console_flush();
+    if (klog_pending() != 0 || virtio_console_in_flight() != 0) {
+        regtest_fail("virtio_klog_sink", "log records not written to virtio-console");
+        regtest_end_suite("virtio");
+        return -1;
+    }
+    regtest_pass("virtio_klog_sink");
+
+    regtest_end_suite("virtio");
+    return 0;
+}
+
+/* ========== Trace Suite ========== */
+
+/*
+ * Trace Test Suite
+ *
+ * Tests the tracepoint rings: a record carries its id, arguments, CPU
+ * and pid, the scheduler and IRQ tracepoints fire, and a file read
+ * records fat_read and block_read spans.
+ */
+
+/* Is there a record with this id (from task pid, if non-zero) on any CPU? */
+static int trace_seen(uint16_t id, uint32_t pid) {
+    struct trace_event ev;
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        for (uint32_t n = 0; trace_get(cpu, n, &ev) == 0; n++) {
+            if (ev.id == id && (pid == 0 || ev.pid == pid)) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int regtest_trace(void) {
+    regtest_start_suite("trace");
+
+    /* Test 1: a mark lands in this CPU's ring with everything filled in */
+    trace_clear();
+    uint64_t flags = local_irq_save();
+    uint32_t cpu = this_cpu()->cpu_id;
+    uint64_t tsc = rdtsc();
+    trace_event(TRACE_MARK, 0x1234, 0x5678);
+    local_irq_restore(flags);
+    struct trace_event ev;
+    uint32_t pid = task_current()->pid;
+    if (trace_get(cpu, 0, &ev) != 0 || ev.id != TRACE_MARK || ev.arg0 != 0x1234 ||
+        ev.arg1 != 0x5678 || ev.cpu != cpu || ev.pid != pid || ev.tsc < tsc) {
+        regtest_fail("trace_mark", "mark record missing or wrong");
+        regtest_end_suite("trace");
+        return -1;
+    }
+    regtest_pass("trace_mark");
+
+    /* Test 2: sleeping switches away and back on a timer interrupt */
+    trace_clear();
+    timer_sleep_ms(2);
+    if (!trace_seen(TRACE_SCHED_SWITCH, 0) || !trace_seen(TRACE_IRQ_ENTER, 0) ||
+        !trace_seen(TRACE_IRQ_EXIT, 0)) {
+        regtest_fail("trace_sched_irq", "no sched_switch or irq events after a sleep");
+        regtest_end_suite("trace");
+        return -1;
+    }
+    regtest_pass("trace_sched_irq");
+
+    /* Test 3: a file read shows up as fat_read and block_read */
+    int fd = vfs_open("INIT.ELF");
+    if (fd < 0) {
+        regtest_log("NOTE: Filesystem not available, skipping read tracing\n");
+        regtest_pass("trace_read_skip");
+    } else {
+        char buf[16];
+        trace_clear();
+        vfs_read(fd, buf, sizeof(buf));
+        vfs_close(fd);
+        if (!trace_seen(TRACE_FAT_READ_BEGIN, pid) || !trace_seen(TRACE_BLOCK_READ_BEGIN, pid) ||
+            !trace_seen(TRACE_BLOCK_READ_END, pid) || !trace_seen(TRACE_FAT_READ_END, pid)) {
+            regtest_fail("trace_read", "fat_read/block_read events missing");
+            regtest_end_suite("trace");
+            return -1;
+        }
+        regtest_pass("trace_read");
+    }
+
+    regtest_end_suite("trace");
+    return 0;
+}
+
+/* ========== Profiler Suite ========== */
+
+/* Start of the kernel's text (linker.ld) */
+extern const char __text_start[];
+
+/* Busy kernel code for the profiler to find */
+static __attribute__((noinline)) void profile_spin(uint64_t ms) {
+    uint64_t end = ktime_get_ns() + ms * NSEC_PER_MSEC;
+    while (ktime_get_ns() < end) {
+        for (volatile int i = 0; i < 1000; i++) {
+        }
+    }
+}
+
+/* Samples charged to the named function in a program slot's report */
+static uint32_t profile_samples_in(int prog, const char *name) {
+    struct profile_entry entries[16];
+    int n = profile_top(prog, entries, 16);
+    for (int i = 0; i < n; i++) {
+        if (klog_streq(entries[i].name, name)) {
+            return entries[i].samples;
+        }
+    }
+    return 0;
+}
+
+int regtest_profile(void) {
+    regtest_start_suite("profile");
+
+    /* Test 1: the embedded symbol table maps addresses back to functions */
+    uint64_t fn = (uint64_t)profile_start;
+    uint64_t start = 0;
+    const char *name = ksym_lookup(fn + 1, &start);
+    if (ksym_count() == 0 || name == NULL || start != fn ||
+        ksym_address("profile_start") != fn || ksym_lookup((uint64_t)&profile_active, NULL) != NULL) {
+        regtest_fail("profile_ksyms", "symbol table lookup wrong");
+        regtest_end_suite("profile");
+        return -1;
+    }
+
+    /* The lowest text symbol is in the table too, and nothing below it */
+    uint64_t text = (uint64_t)__text_start;
+    name = ksym_lookup(text, &start);
+    if (name == NULL || name[0] == '\0' || start != text ||
+        ksym_address(name) != text || ksym_lookup(text - 1, NULL) != NULL) {
+        regtest_fail("profile_ksyms", "first text symbol missing");
+        regtest_end_suite("profile");
+        return -1;
+    }
+    regtest_pass("profile_ksyms");
+
+    /* Test 2: a kernel busy loop dominates its own samples */
+    profile_start();
+    profile_spin(200);
+    profile_stop();
+    struct profile_stats stats;
+    profile_get_stats(&stats);
+    uint32_t spin = profile_samples_in(PROFILE_KERNEL, "profile_spin");
+    regtest_log("profile: %d samples, %d in profile_spin\n", (int)stats.samples, (int)spin);
+    if (stats.samples < 20 || spin < 10) {
+        regtest_fail("profile_kernel", "too few samples in profile_spin");
+        regtest_end_suite("profile");
+        return -1;
+    }
+    regtest_pass("profile_kernel");
+
+    /* Test 3: user samples are charged to the program and symbolized from its ELF */
+    int prog = -1;
+    profile_start();
+    for (int run = 0; run < 5 && prog < 0; run++) {
+        task_t *task = task_create_from_path("SPINNER.ELF");
+        if (task == NULL) {
+            break;
+        }
+        task_set_parent(task, task_current());
+        scheduler_add(task);
+        task_wait(NULL);
+
+        profile_get_stats(&stats);
+        if (stats.user >= 5) {
+            for (int i = PROFILE_KERNEL + 1; i < PROFILE_PROGS; i++) {
+                const char *p = profile_prog_name(i);
+                if (p != NULL && klog_streq(p, "SPINNER.ELF")) {
+                    prog = i;
+                }
+            }
+        }
+    }
+    profile_stop();
+    if (prog < 0) {
+        regtest_fail("profile_user", "no user samples for SPINNER.ELF");
+        regtest_end_suite("profile");
+        return -1;
+    }
+    uint32_t in_main = profile_samples_in(prog, "main");
+    regtest_log("profile: %d user samples, %d in main\n", (int)stats.user, (int)in_main);
+    if (in_main == 0) {
+        regtest_fail("profile_user", "user samples not symbolized");
+        regtest_end_suite("profile");
+        return -1;
+    }
+    regtest_pass("profile_user");
+
+    regtest_end_suite("profile");
+    return 0;
+}
+
+/* ========== PMU Suite ========== */
+
+#define PMU_ROUNDS      50
+#define PMU_SPIN        20000
+
+static volatile int pmu_workers_done;
+static volatile int64_t pmu_worker_counts[2];
+
+/* A fixed amount of work */
+static __attribute__((noinline)) void pmu_spin(void) {
+    for (volatile int i = 0; i < PMU_SPIN; i++) {
+    }
+}
+
+/* Does PMU_ROUNDS of pmu_spin(), yielding between them */
+static void pmu_worker(int slot) {
+    int64_t start = pmu_task_read(PERF_COUNT_INSTRUCTIONS);
+    for (int r = 0; r < PMU_ROUNDS; r++) {
+        pmu_spin();
+        task_yield();
+    }
+    pmu_worker_counts[slot] = pmu_task_read(PERF_COUNT_INSTRUCTIONS) - start;
+    __atomic_fetch_add(&pmu_workers_done, 1, __ATOMIC_RELEASE);
+}
+
+static void pmu_worker0(void) { pmu_worker(0); }
+static void pmu_worker1(void) { pmu_worker(1); }
+
+int regtest_pmu(void) {
+    regtest_start_suite("pmu");
+
+    /* Test 1: detection; without a PMU everything reports -ENODEV */
+    if (pmu_version() == 0) {
+        if (pmu_task_read(PERF_COUNT_INSTRUCTIONS) != -ENODEV ||
+            syscall_dispatch(SYS_perf_counter, PERF_COUNT_CYCLES, 0, 0, 0, 0, 0) != -ENODEV) {
+            regtest_fail("pmu_absent", "reads without a PMU did not fail with -ENODEV");
+            regtest_end_suite("pmu");
+            return -1;
+        }
+        regtest_log("NOTE: No architectural PMU, skipping counter tests\n");
+        regtest_pass("pmu_skip_absent");
+        regtest_end_suite("pmu");
+        return 0;
+    }
+    if (!pmu_event_supported(PERF_COUNT_INSTRUCTIONS) || !pmu_event_supported(PERF_COUNT_CYCLES)) {
+        regtest_log("NOTE: PMU cannot count instructions and cycles, skipping\n");
+        regtest_pass("pmu_skip_events");
+        regtest_end_suite("pmu");
+        return 0;
+    }
+    regtest_log("pmu: version %d\n", pmu_version());
+    regtest_pass("pmu_detect");
+
+    /* Test 2: the raw counters see a known amount of work */
+    uint64_t flags = local_irq_save();
+    uint64_t i0 = pmu_read(PERF_COUNT_INSTRUCTIONS);
+    uint64_t c0 = pmu_read(PERF_COUNT_CYCLES);
+    for (int r = 0; r < PMU_ROUNDS; r++) {
+        pmu_spin();
+    }
+    uint64_t work = pmu_delta(PERF_COUNT_INSTRUCTIONS, i0, pmu_read(PERF_COUNT_INSTRUCTIONS));
+    uint64_t cycles = pmu_delta(PERF_COUNT_CYCLES, c0, pmu_read(PERF_COUNT_CYCLES));
+    local_irq_restore(flags);
+    regtest_log("pmu: %d instructions, %d cycles for %d loop iterations\n",
+                (int)work, (int)cycles, PMU_ROUNDS * PMU_SPIN);
+    if (work < (uint64_t)PMU_ROUNDS * PMU_SPIN || cycles == 0) {
+        regtest_fail("pmu_count", "counters did not advance with the loop");
+        regtest_end_suite("pmu");
+        return -1;
+    }
+    regtest_pass("pmu_count");
+
+    /* Test 3: two tasks doing the same work are each charged only their own */
+    pmu_workers_done = 0;
+    task_t *w0 = task_create(pmu_worker0);
+    task_t *w1 = task_create(pmu_worker1);
+    if (w0 == NULL || w1 == NULL) {
+        regtest_fail("pmu_task_virtual", "failed to create tasks");
+        regtest_end_suite("pmu");
+        return -1;
+    }
+    scheduler_add(w0);
+    scheduler_add(w1);
+    int timeout = 0;
+    while (__atomic_load_n(&pmu_workers_done, __ATOMIC_ACQUIRE) < 2 && timeout < 100000) {
+        task_yield();
+        timeout++;
+    }
+    regtest_log("pmu: workers charged %d and %d instructions\n",
+                (int)pmu_worker_counts[0], (int)pmu_worker_counts[1]);
+    for (int w = 0; w < 2; w++) {
+        if (pmu_workers_done < 2 || pmu_worker_counts[w] < (int64_t)work ||
+            pmu_worker_counts[w] > (int64_t)(work + work / 2)) {
+            regtest_fail("pmu_task_virtual", "task count outside [work, 1.5 * work]");
+            regtest_end_suite("pmu");
+            return -1;
+        }
+    }
+    regtest_pass("pmu_task_virtual");
+
+    /* Test 4: SYS_perf_counter reads the caller's counts */
+    int64_t a = syscall_dispatch(SYS_perf_counter, PERF_COUNT_INSTRUCTIONS, 0, 0, 0, 0, 0);
+    pmu_spin();
+    int64_t b = syscall_dispatch(SYS_perf_counter, PERF_COUNT_INSTRUCTIONS, 0, 0, 0, 0, 0);
+    if (a < 0 || b - a < PMU_SPIN ||
+        syscall_dispatch(SYS_perf_counter, PERF_COUNT_MAX, 0, 0, 0, 0, 0) != -EINVAL) {
+        regtest_fail("pmu_syscall", "perf_counter results wrong");
+        regtest_end_suite("pmu");
+        return -1;
+    }
+    regtest_pass("pmu_syscall");
+
+    regtest_end_suite("pmu");
+    return 0;
+}
+
+
+/* ========== Boot Timeline Suite ========== */
+
+/* Budget for kmain() up to the regression tests, timeline included */
+#define BOOT_MAX_NS     (2 * NSEC_PER_SEC)
+
+int regtest_boot(void) {
+    regtest_start_suite("boot");
+
+    /* Test 1: every stage is recorded and the stages add up to the total */
+    int n = bootstat_count();
+    int found = 0;
+    uint64_t sum = 0;
+    struct bootstat_stage st;
+    for (int i = 0; i < n; i++) {
+        bootstat_get(i, &st);
+        sum += st.ns;
+        if (klog_streq(st.name, "pmm_init") || klog_streq(st.name, "heap_init") ||
+            klog_streq(st.name, "clocksource_init")) {
+            found++;
+        }
+    }
+    uint64_t total = bootstat_total_ns();
+    if (n < 10 || found != 3 || bootstat_get(n, &st) != -1 ||
+        sum > total || total - sum > (uint64_t)n) {
+        regtest_fail("boot_stages", "timeline incomplete or inconsistent");
+        regtest_end_suite("boot");
+        return -1;
+    }
+    regtest_pass("boot_stages");
+
+    /* Test 2: the kernel boots within its budget */
+    regtest_log("boot: %d stages in %d us\n", n, (int)(total / NSEC_PER_USEC));
+    if (total == 0 || total > BOOT_MAX_NS) {
+        regtest_fail("boot_total", "boot took longer than 2 s");
+        regtest_end_suite("boot");
+        return -1;
+    }
+    regtest_pass("boot_total");
+
+    regtest_end_suite("boot");
+    return 0;
+}
+
 #endif /* REGTEST_BUILD */
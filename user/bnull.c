@@ -0,0 +1,10 @@
+/*
+ * bnull.c - Empty program for the spawn-and-wait benchmark
+ *
+ * Exits at once, so timing its creation and reaping measures process
+ * startup and teardown alone.
+ */
+
+int main(void) {
+    return 0;
+}
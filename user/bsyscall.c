@@ -0,0 +1,24 @@
+/*
+ * bsyscall.c - Syscall round-trip benchmark
+ *
+ * Times getppid(), the cheapest real syscall (getpid() is served by the
+ * vDSO): one SYSCALL/SYSRET round trip plus dispatch.
+ */
+
+#include <unistd.h>
+#include <bench.h>
+
+#define WARMUP      100
+#define ITERATIONS  10000
+
+int main(void) {
+    for (int i = 0; i < WARMUP; i++) {
+        getppid();
+    }
+
+    uint64_t start = bench_tsc();
+    for (int i = 0; i < ITERATIONS; i++) {
+        getppid();
+    }
+    return bench_result("syscall_getppid", ITERATIONS, bench_tsc() - start);
+}
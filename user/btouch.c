@@ -0,0 +1,31 @@
+/*
+ * btouch.c - Memory touch bandwidth benchmark
+ *
+ * Repeatedly updates every word of a 1 MiB buffer that is already
+ * mapped and cached as far as it fits. One operation is one 4 KiB page.
+ */
+
+#include <bench.h>
+
+#define BUF_SIZE    (1024 * 1024)
+#define PAGE_SIZE   4096
+#define PASSES      16
+
+/* Not static, so the stores cannot be optimized away */
+uint64_t touch_buf[BUF_SIZE / sizeof(uint64_t)];
+
+static void touch(void) {
+    for (uint32_t i = 0; i < BUF_SIZE / sizeof(uint64_t); i++) {
+        touch_buf[i] += i;
+    }
+}
+
+int main(void) {
+    touch();    /* Warm up */
+
+    uint64_t start = bench_tsc();
+    for (int pass = 0; pass < PASSES; pass++) {
+        touch();
+    }
+    return bench_result("mem_touch_4k", PASSES * (BUF_SIZE / PAGE_SIZE), bench_tsc() - start);
+}
@@ -0,0 +1,25 @@
+/*
+ * byield.c - Yield ping-pong benchmark
+ *
+ * Run two instances on one CPU: each yield() switches to the other,
+ * which yields straight back, so one operation is a round trip of two
+ * context switches. Run alone, yield() returns without switching.
+ */
+
+#include <unistd.h>
+#include <bench.h>
+
+#define WARMUP      50
+#define ITERATIONS  2000
+
+int main(void) {
+    for (int i = 0; i < WARMUP; i++) {
+        yield();
+    }
+
+    uint64_t start = bench_tsc();
+    for (int i = 0; i < ITERATIONS; i++) {
+        yield();
+    }
+    return bench_result("yield_pingpong", ITERATIONS, bench_tsc() - start);
+}
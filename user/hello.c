@@ -7,6 +7,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 int main(void) {
     printf("Hello from C!\n");
@@ -25,5 +27,27 @@ int main(void) {
         printf("malloc failed!\n");
     }
 
+    /* Test the vDSO: pid and a clock that agrees with a kernel sleep */
+    if (getpid() == 0) {
+        printf("vDSO getpid failed\n");
+        return 1;
+    }
+    struct timespec nap = { 0, 2000000 };
+    uint64_t before = clock_monotonic_ns();
+    nanosleep(&nap, NULL);
+    uint64_t slept = clock_monotonic_ns() - before;
+    if (slept < 2000000) {
+        printf("vDSO clock failed: slept %u ns\n", (unsigned int)slept);
+        return 1;
+    }
+
+    struct timespec ts;
+    uint64_t start = clock_monotonic_ns();
+    for (int i = 0; i < 1000; i++) {
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+    }
+    uint64_t per_call = (clock_monotonic_ns() - start) / 1000;
+    printf("vDSO: pid %u, clock_gettime %u ns/call\n", getpid(), (unsigned int)per_call);
+
     return 0;
 }
@@ -0,0 +1,36 @@
+/*
+ * bench.h - Timing helpers for the user benchmark programs (user/b*.c)
+ *
+ * Each benchmark times a loop with the TSC and reports the cost of one
+ * operation in ticks twice: as a line on stdout,
+ *
+ *   BENCH <name> iters=<n> per_op=<ticks> unit=tsc
+ *
+ * and as its exit status, which is how the regtest "ubench" suite
+ * collects it.
+ */
+
+#ifndef _BENCH_H
+#define _BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* TSC, ordered after the instructions before it */
+static inline uint64_t bench_tsc(void) {
+    uint32_t lo, hi;
+    __asm__ volatile("lfence; rdtsc" : "=a"(lo), "=d"(hi) :: "memory");
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/* Print the result line; returns ticks per operation for main() */
+static inline int bench_result(const char *name, uint32_t iters, uint64_t ticks) {
+    uint64_t per_op = ticks / iters;
+    if (per_op > 0x7fffffff) {
+        per_op = 0x7fffffff;
+    }
+    printf("BENCH %s iters=%u per_op=%u unit=tsc\n", name, iters, (unsigned)per_op);
+    return (int)per_op;
+}
+
+#endif /* _BENCH_H */
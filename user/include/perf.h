@@ -0,0 +1,28 @@
+/*
+ * perf.h - Hardware performance counters
+ */
+
+#ifndef _PERF_H
+#define _PERF_H
+
+#include <stdint.h>
+
+/* Events (must match kernel's pmu.h) */
+#define PERF_COUNT_CYCLES           0   /* Unhalted core cycles */
+#define PERF_COUNT_INSTRUCTIONS     1   /* Instructions retired */
+#define PERF_COUNT_REF_CYCLES       2   /* Unhalted reference cycles */
+#define PERF_COUNT_LLC_REFERENCES   3   /* Last-level cache references */
+#define PERF_COUNT_LLC_MISSES       4   /* Last-level cache misses */
+#define PERF_COUNT_BRANCHES         5   /* Branch instructions retired */
+#define PERF_COUNT_BRANCH_MISSES    6   /* Mispredicted branches retired */
+
+/*
+ * The calling process's count of event, in user and kernel mode,
+ * since its first perf_counter() call (which returns about zero). The
+ * difference of two calls measures the code between them. Returns a
+ * negative error if the CPU has no performance counters (-19) or cannot
+ * count the event (-2, -22).
+ */
+int64_t perf_counter(int event);
+
+#endif /* _PERF_H */
@@ -0,0 +1,37 @@
+/*
+ * time.h - Time types and functions
+ */
+
+#ifndef _TIME_H
+#define _TIME_H
+
+#include <stdint.h>
+
+/* Clock IDs (only CLOCK_MONOTONIC is supported) */
+#define CLOCK_REALTIME  0
+#define CLOCK_MONOTONIC 1
+
+struct timespec {
+    int64_t tv_sec;
+    int64_t tv_nsec;
+};
+
+/*
+ * Read a clock. Returns 0 on success, -1 on error. Served by the vDSO:
+ * no kernel entry while the clock is TSC-based.
+ */
+int clock_gettime(int clk, struct timespec *ts);
+
+/* CLOCK_MONOTONIC in nanoseconds, for cheap timing of hot loops */
+uint64_t clock_monotonic_ns(void);
+
+/*
+ * Block for the interval in req without using CPU time.
+ * rem (may be NULL) receives the unslept time, always zero.
+ * Returns 0 on success or a negated error code: -14 (EFAULT) for a bad
+ * pointer, -22 (EINVAL) for an out-of-range req, or -11 (EAGAIN),
+ * without sleeping, if the kernel has too many timers pending.
+ */
+int nanosleep(const struct timespec *req, struct timespec *rem);
+
+#endif /* _TIME_H */
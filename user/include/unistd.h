@@ -21,7 +21,7 @@ void yield(void);
 
 /* Process management (Proto 15) */
 int wait(int *status);
-uint32_t getpid(void);
+uint32_t getpid(void);      /* Read from the vDSO, no syscall */
 uint32_t getppid(void);
 
 /* Note: exit() is in stdlib.h as per standard C */
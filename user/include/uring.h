@@ -0,0 +1,79 @@
+/*
+ * uring.h - Batched syscalls through shared submission/completion rings
+ *
+ * Queue operations with ring_get_sqe()/ring_prep(), then hand the whole
+ * batch to the kernel with one ring_submit(). Results arrive as CQEs,
+ * posted asynchronously by kernel workers, in any order unless
+ * URING_SQE_LINK chains them.
+ */
+
+#ifndef _URING_H
+#define _URING_H
+
+#include <stdint.h>
+
+/* Ring layout (must match kernel's uring.h) */
+#define URING_SQ_ENTRIES 32
+#define URING_CQ_ENTRIES 64
+#define URING_MAX_IO     4096
+#define URING_MAX_TIMERS 16     /* Pending nanosleeps; more fail with -EAGAIN */
+
+#define URING_OP_NOP       0    /* res = 0 */
+#define URING_OP_WRITE     1    /* fd 1; buffer is copied at submit */
+#define URING_OP_READ      2    /* fd 0 (keyboard); res = bytes read */
+#define URING_OP_NANOSLEEP 3    /* addr = const struct timespec * */
+#define URING_OP_WAIT      4    /* addr = int *status or 0; res = child pid */
+
+#define URING_SQE_LINK 0x01     /* Start the next SQE only after this one completes */
+
+struct uring_sqe {
+    uint8_t opcode;
+    uint8_t flags;
+    uint16_t reserved;
+    int32_t fd;
+    uint64_t addr;
+    uint32_t len;
+    uint32_t reserved2;
+    uint64_t user_data;
+};
+
+struct uring_cqe {
+    uint64_t user_data;
+    int64_t res;                /* Result, or a negated error code */
+};
+
+struct uring_shared {
+    volatile uint32_t sq_head;
+    volatile uint32_t sq_tail;
+    volatile uint32_t cq_head;
+    volatile uint32_t cq_tail;
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    volatile uint32_t cq_overflow;
+    uint32_t reserved[9];
+    struct uring_sqe sqes[URING_SQ_ENTRIES];
+    struct uring_cqe cqes[URING_CQ_ENTRIES];
+};
+
+/* Map this process's ring. Returns 0, or a negated error code. */
+int ring_setup(void);
+
+/* Next free SQE (zeroed), or NULL if the SQ is full or not set up */
+struct uring_sqe *ring_get_sqe(void);
+
+/* Fill in an SQE */
+void ring_prep(struct uring_sqe *sqe, int op, int fd, const void *addr, uint32_t len,
+               uint64_t user_data);
+
+/*
+ * Submit every queued SQE in one kernel entry and wait for at least
+ * wait_nr completions. Returns the number submitted, or a negated
+ * error code.
+ */
+int ring_submit(unsigned int wait_nr);
+
+/* Oldest unread CQE, or NULL; release it with ring_cqe_seen() */
+struct uring_cqe *ring_peek_cqe(void);
+void ring_cqe_seen(void);
+
+#endif /* _URING_H */
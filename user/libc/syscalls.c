@@ -6,6 +6,8 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <time.h>
+#include <perf.h>
 
 /* Syscall numbers (must match kernel's syscall.h) */
 #define SYS_exit    0
@@ -14,11 +16,30 @@
 #define SYS_wait    3
 #define SYS_getpid  4
 #define SYS_getppid 5
+#define SYS_clock_gettime 6
+#define SYS_nanosleep 7
+#define SYS_perf_counter 10
+
+/*
+ * vDSO entry points (must match kernel's vdso.h). The kernel maps the
+ * vDSO into every ELF process at a fixed address.
+ */
+#define VDSO_VADDR         0x70002000UL
+#define VDSO_CLOCK_GETTIME 0x00
+#define VDSO_GETPID        0x10
+#define VDSO_MONOTONIC_NS  0x20
+
+#define VDSO_FN(off, type) ((type)(VDSO_VADDR + (off)))
 
 /* Assembly syscall stubs */
 extern long _syscall0(long num);
 extern long _syscall1(long num, long arg1);
+extern long _syscall2(long num, long arg1, long arg2);
 extern long _syscall3(long num, long arg1, long arg2, long arg3);
+extern long _syscall4(long num, long arg1, long arg2, long arg3, long arg4);
+extern long _syscall5(long num, long arg1, long arg2, long arg3, long arg4, long arg5);
+extern long _syscall6(long num, long arg1, long arg2, long arg3, long arg4, long arg5,
+                      long arg6);
 
 void exit(int code) {
     _syscall1(SYS_exit, code);
@@ -41,9 +62,25 @@ int wait(int *status) {
 }
 
 uint32_t getpid(void) {
-    return (uint32_t)_syscall0(SYS_getpid);
+    return VDSO_FN(VDSO_GETPID, uint32_t (*)(void))();
 }
 
 uint32_t getppid(void) {
     return (uint32_t)_syscall0(SYS_getppid);
 }
+
+int clock_gettime(int clk, struct timespec *ts) {
+    return VDSO_FN(VDSO_CLOCK_GETTIME, int (*)(int, struct timespec *))(clk, ts);
+}
+
+uint64_t clock_monotonic_ns(void) {
+    return VDSO_FN(VDSO_MONOTONIC_NS, uint64_t (*)(void))();
+}
+
+int nanosleep(const struct timespec *req, struct timespec *rem) {
+    return (int)_syscall2(SYS_nanosleep, (long)req, (long)rem);
+}
+
+int64_t perf_counter(int event) {
+    return (int64_t)_syscall1(SYS_perf_counter, event);
+}
@@ -0,0 +1,85 @@
+/*
+ * uring.c - Submission/completion ring helpers
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <uring.h>
+
+/* Syscall numbers (must match kernel's syscall.h) */
+#define SYS_ring_setup 8
+#define SYS_ring_enter 9
+
+extern long _syscall0(long num);
+extern long _syscall2(long num, long arg1, long arg2);
+
+/* The process's ring, NULL until ring_setup() */
+static struct uring_shared *ring = NULL;
+
+/* SQEs handed out by ring_get_sqe() but not yet submitted */
+static uint32_t sq_queued = 0;
+
+int ring_setup(void) {
+    long ret = _syscall0(SYS_ring_setup);
+    if (ret < 0) {
+        return (int)ret;
+    }
+    ring = (struct uring_shared *)ret;
+    return 0;
+}
+
+struct uring_sqe *ring_get_sqe(void) {
+    if (ring == NULL) {
+        return NULL;
+    }
+    uint32_t head = __atomic_load_n(&ring->sq_head, __ATOMIC_ACQUIRE);
+    uint32_t next = ring->sq_tail + sq_queued;
+    if (next - head >= URING_SQ_ENTRIES) {
+        return NULL;
+    }
+    sq_queued++;
+
+    struct uring_sqe *sqe = &ring->sqes[next & (URING_SQ_ENTRIES - 1)];
+    ring_prep(sqe, URING_OP_NOP, 0, NULL, 0, 0);
+    return sqe;
+}
+
+void ring_prep(struct uring_sqe *sqe, int op, int fd, const void *addr, uint32_t len,
+               uint64_t user_data) {
+    sqe->opcode = (uint8_t)op;
+    sqe->flags = 0;
+    sqe->reserved = 0;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)addr;
+    sqe->len = len;
+    sqe->reserved2 = 0;
+    sqe->user_data = user_data;
+}
+
+int ring_submit(unsigned int wait_nr) {
+    if (ring == NULL) {
+        return -22;  /* EINVAL */
+    }
+    uint32_t tail = ring->sq_tail + sq_queued;
+    __atomic_store_n(&ring->sq_tail, tail, __ATOMIC_RELEASE);
+    sq_queued = 0;
+
+    /* Includes SQEs a previous call left behind because the CQ was full */
+    uint32_t pending = tail - __atomic_load_n(&ring->sq_head, __ATOMIC_ACQUIRE);
+    return (int)_syscall2(SYS_ring_enter, pending, wait_nr);
+}
+
+struct uring_cqe *ring_peek_cqe(void) {
+    if (ring == NULL) {
+        return NULL;
+    }
+    uint32_t head = ring->cq_head;
+    if (head == __atomic_load_n(&ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    return &ring->cqes[head & (URING_CQ_ENTRIES - 1)];
+}
+
+void ring_cqe_seen(void) {
+    __atomic_store_n(&ring->cq_head, ring->cq_head + 1, __ATOMIC_RELEASE);
+}
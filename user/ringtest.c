@@ -0,0 +1,129 @@
+/*
+ * ringtest.c - Exercise the submission/completion rings
+ *
+ * Exits 0 if every check passes, otherwise the number of the first
+ * failing check. Check 5 reads from the keyboard: type a few keys when
+ * prompted (the regression tests inject them). Check 6 exits with a
+ * read still pending, which the kernel must cancel.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <time.h>
+#include <uring.h>
+
+#define EBADF     9
+#define ECHILD    10
+#define EEXIST    17
+#define EINVAL    22
+#define ECANCELED 125
+
+/* CQE results indexed by user_data */
+static int64_t results[16];
+
+/* Collect every available CQE into results[] */
+static int reap(void) {
+    int n = 0;
+    struct uring_cqe *cqe;
+    while ((cqe = ring_peek_cqe()) != NULL) {
+        if (cqe->user_data < 16) {
+            results[cqe->user_data] = cqe->res;
+        }
+        ring_cqe_seen();
+        n++;
+    }
+    return n;
+}
+
+static struct uring_sqe *queue(int op, int fd, const void *addr, uint32_t len,
+                               uint64_t user_data) {
+    struct uring_sqe *sqe = ring_get_sqe();
+    if (sqe != NULL) {
+        ring_prep(sqe, op, fd, addr, len, user_data);
+    }
+    return sqe;
+}
+
+int main(void) {
+    /* Check 1: one ring per process */
+    if (ring_setup() != 0 || ring_setup() != -EEXIST) {
+        printf("ring: setup failed\n");
+        return 1;
+    }
+
+    /* Check 2: a mixed batch in a single kernel entry */
+    static const char first[] = "ring: batched ";
+    static const char second[] = "write\n";
+    struct timespec nap = { 0, 2000000 };
+
+    queue(URING_OP_WRITE, 1, first, sizeof(first) - 1, 1)->flags |= URING_SQE_LINK;
+    queue(URING_OP_WRITE, 1, second, sizeof(second) - 1, 2);
+    queue(URING_OP_NANOSLEEP, 0, &nap, 0, 3);
+    queue(URING_OP_NOP, 0, NULL, 0, 4);
+    queue(99, 0, NULL, 0, 5);
+    queue(URING_OP_WRITE, 2, first, 1, 6);
+
+    uint64_t start = clock_monotonic_ns();
+    int submitted = ring_submit(6);
+    uint64_t elapsed = clock_monotonic_ns() - start;
+    int reaped = reap();
+    if (submitted != 6 || reaped != 6) {
+        printf("ring: batch submitted %d, reaped %d\n", submitted, reaped);
+        return 2;
+    }
+    if (results[1] != (int64_t)sizeof(first) - 1 || results[2] != (int64_t)sizeof(second) - 1 ||
+        results[3] != 0 || results[4] != 0 ||
+        results[5] != -EINVAL || results[6] != -EBADF) {
+        printf("ring: unexpected batch results\n");
+        return 2;
+    }
+    if (elapsed < 2000000) {
+        printf("ring: nanosleep completed after %u ns\n", (unsigned int)elapsed);
+        return 2;
+    }
+
+    /* Check 3: a failed operation cancels what is linked behind it */
+    queue(URING_OP_WAIT, 0, NULL, 0, 7)->flags |= URING_SQE_LINK;
+    queue(URING_OP_NOP, 0, NULL, 0, 8);
+    if (ring_submit(2) != 2 || reap() != 2 ||
+        results[7] != -ECHILD || results[8] != -ECANCELED) {
+        printf("ring: link cancellation failed\n");
+        return 3;
+    }
+
+    /* Check 4: a full SQ's worth of operations per entry */
+    start = clock_monotonic_ns();
+    for (int i = 0; i < URING_SQ_ENTRIES; i++) {
+        queue(URING_OP_NOP, 0, NULL, 0, 9);
+    }
+    if (ring_get_sqe() != NULL) {
+        printf("ring: SQ accepted more than %d entries\n", URING_SQ_ENTRIES);
+        return 4;
+    }
+    if (ring_submit(URING_SQ_ENTRIES) != URING_SQ_ENTRIES || reap() != URING_SQ_ENTRIES) {
+        printf("ring: full batch failed\n");
+        return 4;
+    }
+    printf("ring: %d ops in one entry, %u ns\n", URING_SQ_ENTRIES,
+           (unsigned int)(clock_monotonic_ns() - start));
+
+    /* Check 5: read lands in our buffer from a worker */
+    char buf[4] = { 0, 0, 0, 0 };
+    printf("ring: waiting for keyboard input\n");
+    queue(URING_OP_READ, 0, buf, 3, 10);
+    if (ring_submit(1) != 1 || reap() != 1 || results[10] < 1 || buf[0] == 0) {
+        printf("ring: read failed\n");
+        return 5;
+    }
+    printf("ring: read \"%s\"\n", buf);
+
+    /* Check 6: leave a read pending; exiting cancels it, so it takes no key */
+    static char unread[4];
+    queue(URING_OP_READ, 0, unread, 3, 11);
+    if (ring_submit(0) != 1) {
+        printf("ring: pending read not submitted\n");
+        return 6;
+    }
+
+    return 0;
+}